@@ -0,0 +1,452 @@
+#include "Allocator.h"
+#include "Renderer.h"
+#include "Shared.h"
+#include <assert.h>
+#include <iostream>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static uint32_t bit_scan_forward(uint64_t value) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return (uint32_t)index;
+#else
+	return (uint32_t)__builtin_ctzll(value);
+#endif
+}
+
+static uint32_t bit_scan_reverse(uint64_t value) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return (uint32_t)index;
+#else
+	return 63 - (uint32_t)__builtin_clzll(value);
+#endif
+}
+
+static VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+//first level is the power of two, second level splits that range into ALLOCATOR_SL_COUNT slices.
+//everything below 2^ALLOCATOR_SMALL_LOG2 lives in first level 0 in linear slices
+static void tlsf_mapping(VkDeviceSize size, uint32_t & fl, uint32_t & sl) {
+	if (size < (1ull << ALLOCATOR_SMALL_LOG2)) {
+		fl = 0;
+		sl = (uint32_t)(size >> (ALLOCATOR_SMALL_LOG2 - ALLOCATOR_SL_LOG2));
+	}
+	else {
+		uint32_t msb = bit_scan_reverse(size);
+		sl = (uint32_t)(size >> (msb - ALLOCATOR_SL_LOG2)) ^ ALLOCATOR_SL_COUNT;
+		fl = msb - ALLOCATOR_SMALL_LOG2 + 1;
+	}
+}
+
+Allocator::Allocator(Renderer * renderer, VkDeviceSize block_size) :
+	m_renderer(renderer),
+	m_device(renderer->GetVulkanDevice()),
+	m_memory_properties(renderer->GetPhysicalDeviceMemoryProperties()),
+	m_buffer_image_granularity(renderer->GetVulkanPhysicalDeviceProperties().limits.bufferImageGranularity),
+	m_non_coherent_atom_size(renderer->GetVulkanPhysicalDeviceProperties().limits.nonCoherentAtomSize),
+	m_dedicated_allocation_count(0)
+{
+	m_pools.resize(m_memory_properties.memoryTypeCount * 2);
+	for (uint32_t i = 0; i < m_pools.size(); i++) {
+		uint32_t memory_type = i / 2;
+		VkDeviceSize heap_size = m_memory_properties.memoryHeaps[m_memory_properties.memoryTypes[memory_type].heapIndex].size;
+		m_pools[i].memory_type = memory_type;
+		//small heaps (e.g. the 256MB host visible device local window) get smaller blocks
+		m_pools[i].block_size = block_size;
+		while (m_pools[i].block_size > (1ull << 20) && m_pools[i].block_size > heap_size / 8) {
+			m_pools[i].block_size /= 2;
+		}
+	}
+}
+
+Allocator::~Allocator() {
+	for (uint32_t i = 0; i < m_pools.size(); i++) {
+		for (uint32_t j = 0; j < m_pools[i].blocks.size(); j++) {
+			if (m_pools[i].blocks[j] != nullptr) {
+#if BUILD_OPTIONS_DEBUG
+				if (m_pools[i].blocks[j]->live_allocations > 0) {
+					std::cout << "Allocator: " << m_pools[i].blocks[j]->live_allocations << " allocations leaked in memory type " << m_pools[i].memory_type << std::endl;
+				}
+#endif
+				DestroyBlock(m_pools[i].blocks[j]);
+			}
+		}
+	}
+}
+
+Allocation Allocator::Allocate(const VkMemoryRequirements & requirements, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, AllocationKind kind) {
+	Allocation allocation{};
+	uint32_t type_bits = requirements.memoryTypeBits;
+	uint32_t memory_type = 0;
+	while (memory_types_from_properties(type_bits, required, preferred, &memory_type, m_memory_properties)) {
+		if (AllocateFromType(memory_type, requirements, kind, allocation)) {
+			return allocation;
+		}
+		//that heap is full, fall back to the next best type
+		type_bits &= ~(1u << memory_type);
+	}
+	assert(0 && "Allocator: no memory type could satisfy the allocation");
+	return allocation;
+}
+
+Allocation Allocator::AllocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) {
+	VkMemoryRequirements memory_requirements;
+	vkGetBufferMemoryRequirements(m_device, buffer, &memory_requirements);
+	Allocation allocation = Allocate(memory_requirements, required, preferred, ALLOCATION_LINEAR);
+	ErrorCheck(vkBindBufferMemory(m_device, buffer, allocation.memory, allocation.offset));
+	return allocation;
+}
+
+Allocation Allocator::AllocateForImage(VkImage image, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) {
+	VkMemoryRequirements memory_requirements;
+	vkGetImageMemoryRequirements(m_device, image, &memory_requirements);
+	Allocation allocation = Allocate(memory_requirements, required, preferred, ALLOCATION_OPTIMAL);
+	ErrorCheck(vkBindImageMemory(m_device, image, allocation.memory, allocation.offset));
+	return allocation;
+}
+
+void Allocator::Free(Allocation & allocation) {
+	if (allocation.memory == VK_NULL_HANDLE) {
+		return;
+	}
+	if (allocation.pool == ALLOCATOR_DEDICATED) {
+		vkFreeMemory(m_device, allocation.memory, VK_NULL_HANDLE);
+		m_dedicated_allocation_count--;
+		allocation = Allocation{};
+		return;
+	}
+
+	Pool & pool = m_pools[allocation.pool];
+	Block * block = pool.blocks[allocation.block];
+	uint32_t node = allocation.node;
+	assert(!block->nodes[node].free && "Allocator: double free");
+
+	//coalesce with the physical neighbours so the block never fragments into adjacent free nodes
+	uint32_t prev = block->nodes[node].prev_physical;
+	if (prev != ALLOCATOR_NULL_NODE && block->nodes[prev].free) {
+		RemoveFree(block, prev);
+		block->nodes[prev].size += block->nodes[node].size;
+		block->nodes[prev].next_physical = block->nodes[node].next_physical;
+		if (block->nodes[node].next_physical != ALLOCATOR_NULL_NODE) {
+			block->nodes[block->nodes[node].next_physical].prev_physical = prev;
+		}
+		RecycleNode(block, node);
+		node = prev;
+	}
+	uint32_t next = block->nodes[node].next_physical;
+	if (next != ALLOCATOR_NULL_NODE && block->nodes[next].free) {
+		RemoveFree(block, next);
+		block->nodes[node].size += block->nodes[next].size;
+		block->nodes[node].next_physical = block->nodes[next].next_physical;
+		if (block->nodes[next].next_physical != ALLOCATOR_NULL_NODE) {
+			block->nodes[block->nodes[next].next_physical].prev_physical = node;
+		}
+		RecycleNode(block, next);
+	}
+	InsertFree(block, node);
+
+	block->live_allocations--;
+	if (block->live_allocations == 0) {
+		//keep one empty block around per pool so alloc/free churn doesn't hit vkAllocateMemory
+		uint32_t live_blocks = 0;
+		for (uint32_t i = 0; i < pool.blocks.size(); i++) {
+			if (pool.blocks[i] != nullptr) {
+				live_blocks++;
+			}
+		}
+		if (live_blocks > 1) {
+			DestroyBlock(block);
+			pool.blocks[allocation.block] = nullptr;
+		}
+	}
+	allocation = Allocation{};
+}
+
+uint32_t Allocator::GetBlockCount() const {
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < m_pools.size(); i++) {
+		for (uint32_t j = 0; j < m_pools[i].blocks.size(); j++) {
+			if (m_pools[i].blocks[j] != nullptr) {
+				count++;
+			}
+		}
+	}
+	return count;
+}
+
+uint32_t Allocator::GetDedicatedAllocationCount() const {
+	return m_dedicated_allocation_count;
+}
+
+bool Allocator::AllocateFromType(uint32_t memory_type, const VkMemoryRequirements & requirements, AllocationKind kind, Allocation & allocation) {
+	uint32_t pool_index = memory_type * 2 + (m_buffer_image_granularity > 1 ? kind : ALLOCATION_LINEAR);
+	Pool & pool = m_pools[pool_index];
+
+	if (requirements.size > pool.block_size / 2) {
+		return AllocateDedicated(memory_type, requirements, allocation);
+	}
+
+	VkDeviceSize alignment = requirements.alignment > 0 ? requirements.alignment : 1;
+	VkMemoryPropertyFlags flags = m_memory_properties.memoryTypes[memory_type].propertyFlags;
+	if ((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+		//flushes work on whole atoms, so neighbours mustn't share one
+		alignment = alignment > m_non_coherent_atom_size ? alignment : m_non_coherent_atom_size;
+	}
+
+	uint32_t node = ALLOCATOR_NULL_NODE;
+	uint32_t block_index = 0;
+	Block * block = nullptr;
+	for (uint32_t i = 0; i < pool.blocks.size(); i++) {
+		if (pool.blocks[i] != nullptr && AllocateFromBlock(pool.blocks[i], requirements.size, alignment, node)) {
+			block = pool.blocks[i];
+			block_index = i;
+			break;
+		}
+	}
+	if (block == nullptr) {
+		block = CreateBlock(pool, block_index);
+		if (block == nullptr || !AllocateFromBlock(block, requirements.size, alignment, node)) {
+			return false;
+		}
+	}
+
+	block->live_allocations++;
+	allocation.memory = block->memory;
+	allocation.offset = block->nodes[node].offset;
+	allocation.size = block->nodes[node].size;
+	allocation.mapped = block->mapped != nullptr ? (uint8_t *)block->mapped + allocation.offset : nullptr;
+	allocation.memory_type = memory_type;
+	allocation.pool = pool_index;
+	allocation.block = block_index;
+	allocation.node = node;
+	return true;
+}
+
+bool Allocator::AllocateDedicated(uint32_t memory_type, const VkMemoryRequirements & requirements, Allocation & allocation) {
+	VkMemoryAllocateInfo memory_allocate_info{};
+	memory_allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memory_allocate_info.pNext = VK_NULL_HANDLE;
+	memory_allocate_info.allocationSize = requirements.size;
+	memory_allocate_info.memoryTypeIndex = memory_type;
+
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	if (vkAllocateMemory(m_device, &memory_allocate_info, VK_NULL_HANDLE, &memory) != VK_SUCCESS) {
+		return false;
+	}
+
+	void * mapped = nullptr;
+	if (m_memory_properties.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		ErrorCheck(vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, &mapped));
+	}
+
+	m_dedicated_allocation_count++;
+	allocation.memory = memory;
+	allocation.offset = 0;
+	allocation.size = requirements.size;
+	allocation.mapped = mapped;
+	allocation.memory_type = memory_type;
+	allocation.pool = ALLOCATOR_DEDICATED;
+	allocation.block = 0;
+	allocation.node = ALLOCATOR_NULL_NODE;
+	return true;
+}
+
+bool Allocator::AllocateFromBlock(Block * block, VkDeviceSize size, VkDeviceSize alignment, uint32_t & node) {
+	//ask for enough to align the start anywhere inside the free node, then hand the padding back
+	node = FindFree(block, size + alignment - 1);
+	if (node == ALLOCATOR_NULL_NODE) {
+		return false;
+	}
+	RemoveFree(block, node);
+
+	VkDeviceSize aligned_offset = align_up(block->nodes[node].offset, alignment);
+	VkDeviceSize padding = aligned_offset - block->nodes[node].offset;
+	if (padding > 0) {
+		uint32_t front = NewNode(block);
+		Node & n = block->nodes[node];
+		Node & f = block->nodes[front];
+		f.offset = n.offset;
+		f.size = padding;
+		f.prev_physical = n.prev_physical;
+		f.next_physical = node;
+		if (n.prev_physical != ALLOCATOR_NULL_NODE) {
+			block->nodes[n.prev_physical].next_physical = front;
+		}
+		n.prev_physical = front;
+		n.offset = aligned_offset;
+		n.size -= padding;
+		InsertFree(block, front);
+	}
+
+	if (block->nodes[node].size - size >= (1ull << ALLOCATOR_SL_LOG2)) {
+		uint32_t back = NewNode(block);
+		Node & n = block->nodes[node];
+		Node & b = block->nodes[back];
+		b.offset = n.offset + size;
+		b.size = n.size - size;
+		b.prev_physical = node;
+		b.next_physical = n.next_physical;
+		if (n.next_physical != ALLOCATOR_NULL_NODE) {
+			block->nodes[n.next_physical].prev_physical = back;
+		}
+		n.next_physical = back;
+		n.size = size;
+		InsertFree(block, back);
+	}
+	return true;
+}
+
+Allocator::Block * Allocator::CreateBlock(Pool & pool, uint32_t & block_index) {
+	VkMemoryAllocateInfo memory_allocate_info{};
+	memory_allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memory_allocate_info.pNext = VK_NULL_HANDLE;
+	memory_allocate_info.allocationSize = pool.block_size;
+	memory_allocate_info.memoryTypeIndex = pool.memory_type;
+
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	if (vkAllocateMemory(m_device, &memory_allocate_info, VK_NULL_HANDLE, &memory) != VK_SUCCESS) {
+		return nullptr;
+	}
+
+	Block * block = new Block();
+	block->memory = memory;
+	block->mapped = nullptr;
+	block->size = pool.block_size;
+	block->live_allocations = 0;
+	block->fl_bitmap = 0;
+	for (uint32_t fl = 0; fl < ALLOCATOR_FL_COUNT; fl++) {
+		block->sl_bitmap[fl] = 0;
+		for (uint32_t sl = 0; sl < ALLOCATOR_SL_COUNT; sl++) {
+			block->free_heads[fl][sl] = ALLOCATOR_NULL_NODE;
+		}
+	}
+	if (m_memory_properties.memoryTypes[pool.memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		ErrorCheck(vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, &block->mapped));
+	}
+
+	uint32_t node = NewNode(block);
+	block->nodes[node].offset = 0;
+	block->nodes[node].size = pool.block_size;
+	InsertFree(block, node);
+
+	for (block_index = 0; block_index < pool.blocks.size(); block_index++) {
+		if (pool.blocks[block_index] == nullptr) {
+			pool.blocks[block_index] = block;
+			return block;
+		}
+	}
+	pool.blocks.push_back(block);
+	return block;
+}
+
+void Allocator::DestroyBlock(Block * block) {
+	//freeing implicitly unmaps
+	vkFreeMemory(m_device, block->memory, VK_NULL_HANDLE);
+	delete block;
+}
+
+uint32_t Allocator::NewNode(Block * block) {
+	uint32_t node;
+	if (!block->recycled_nodes.empty()) {
+		node = block->recycled_nodes.back();
+		block->recycled_nodes.pop_back();
+	}
+	else {
+		node = (uint32_t)block->nodes.size();
+		block->nodes.push_back(Node{});
+	}
+	Node & n = block->nodes[node];
+	n.offset = 0;
+	n.size = 0;
+	n.prev_physical = ALLOCATOR_NULL_NODE;
+	n.next_physical = ALLOCATOR_NULL_NODE;
+	n.prev_free = ALLOCATOR_NULL_NODE;
+	n.next_free = ALLOCATOR_NULL_NODE;
+	n.free = false;
+	return node;
+}
+
+void Allocator::RecycleNode(Block * block, uint32_t node) {
+	block->nodes[node].free = false;
+	block->recycled_nodes.push_back(node);
+}
+
+void Allocator::InsertFree(Block * block, uint32_t node) {
+	uint32_t fl, sl;
+	tlsf_mapping(block->nodes[node].size, fl, sl);
+
+	uint32_t head = block->free_heads[fl][sl];
+	block->nodes[node].free = true;
+	block->nodes[node].prev_free = ALLOCATOR_NULL_NODE;
+	block->nodes[node].next_free = head;
+	if (head != ALLOCATOR_NULL_NODE) {
+		block->nodes[head].prev_free = node;
+	}
+	block->free_heads[fl][sl] = node;
+	block->fl_bitmap |= 1ull << fl;
+	block->sl_bitmap[fl] |= 1u << sl;
+}
+
+void Allocator::RemoveFree(Block * block, uint32_t node) {
+	uint32_t fl, sl;
+	tlsf_mapping(block->nodes[node].size, fl, sl);
+
+	Node & n = block->nodes[node];
+	if (n.prev_free != ALLOCATOR_NULL_NODE) {
+		block->nodes[n.prev_free].next_free = n.next_free;
+	}
+	if (n.next_free != ALLOCATOR_NULL_NODE) {
+		block->nodes[n.next_free].prev_free = n.prev_free;
+	}
+	if (block->free_heads[fl][sl] == node) {
+		block->free_heads[fl][sl] = n.next_free;
+		if (n.next_free == ALLOCATOR_NULL_NODE) {
+			block->sl_bitmap[fl] &= ~(1u << sl);
+			if (block->sl_bitmap[fl] == 0) {
+				block->fl_bitmap &= ~(1ull << fl);
+			}
+		}
+	}
+	n.free = false;
+	n.prev_free = ALLOCATOR_NULL_NODE;
+	n.next_free = ALLOCATOR_NULL_NODE;
+}
+
+uint32_t Allocator::FindFree(Block * block, VkDeviceSize size) {
+	if (size > block->size) {
+		return ALLOCATOR_NULL_NODE;
+	}
+	//round up to the next slice so whatever is in the list we land on is guaranteed to fit
+	if (size >= (1ull << ALLOCATOR_SMALL_LOG2)) {
+		size += (1ull << (bit_scan_reverse(size) - ALLOCATOR_SL_LOG2)) - 1;
+	}
+	else {
+		size = align_up(size, 1ull << (ALLOCATOR_SMALL_LOG2 - ALLOCATOR_SL_LOG2));
+	}
+
+	uint32_t fl, sl;
+	tlsf_mapping(size, fl, sl);
+	if (fl >= ALLOCATOR_FL_COUNT) {
+		return ALLOCATOR_NULL_NODE;
+	}
+
+	uint32_t sl_map = block->sl_bitmap[fl] & (~0u << sl);
+	if (sl_map == 0) {
+		uint64_t fl_map = fl + 1 < 64 ? block->fl_bitmap & (~0ull << (fl + 1)) : 0;
+		if (fl_map == 0) {
+			return ALLOCATOR_NULL_NODE;
+		}
+		fl = bit_scan_forward(fl_map);
+		sl_map = block->sl_bitmap[fl];
+	}
+	sl = bit_scan_forward(sl_map);
+	return block->free_heads[fl][sl];
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Platform.h"
+#include <vector>
+
+#define ALLOCATOR_SL_LOG2 4
+#define ALLOCATOR_SL_COUNT (1 << ALLOCATOR_SL_LOG2)
+#define ALLOCATOR_SMALL_LOG2 8
+#define ALLOCATOR_FL_COUNT (64 - ALLOCATOR_SMALL_LOG2 + 1)
+#define ALLOCATOR_DEFAULT_BLOCK_SIZE (64ull * 1024 * 1024)
+#define ALLOCATOR_NULL_NODE UINT32_MAX
+#define ALLOCATOR_DEDICATED UINT32_MAX
+
+class Renderer;
+
+//buffers and linear images can't share a page with optimal images when bufferImageGranularity > 1,
+//so they are carved out of separate blocks
+enum AllocationKind {
+	ALLOCATION_LINEAR = 0,
+	ALLOCATION_OPTIMAL = 1
+};
+
+struct Allocation {
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	//non-null when the memory is host visible; blocks stay mapped for their whole lifetime
+	void * mapped = nullptr;
+	uint32_t memory_type = 0;
+	uint32_t pool = ALLOCATOR_DEDICATED;
+	uint32_t block = 0;
+	uint32_t node = ALLOCATOR_NULL_NODE;
+};
+
+//sub-allocates buffers and images out of large per memory type blocks using a two level
+//segregated fit (TLSF) free list, so allocation and free are O(1) and neighbours coalesce on free
+class Allocator {
+public:
+	Allocator(Renderer * renderer, VkDeviceSize block_size = ALLOCATOR_DEFAULT_BLOCK_SIZE);
+	~Allocator();
+
+	Allocation Allocate(const VkMemoryRequirements & requirements, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, AllocationKind kind);
+	Allocation AllocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred);
+	Allocation AllocateForImage(VkImage image, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred);
+	void Free(Allocation & allocation);
+
+	uint32_t GetBlockCount() const;
+	uint32_t GetDedicatedAllocationCount() const;
+private:
+	struct Node {
+		VkDeviceSize offset;
+		VkDeviceSize size;
+		uint32_t prev_physical;
+		uint32_t next_physical;
+		uint32_t prev_free;
+		uint32_t next_free;
+		bool free;
+	};
+
+	struct Block {
+		VkDeviceMemory memory;
+		void * mapped;
+		VkDeviceSize size;
+		uint32_t live_allocations;
+		std::vector<Node> nodes;
+		std::vector<uint32_t> recycled_nodes;
+		uint64_t fl_bitmap;
+		uint32_t sl_bitmap[ALLOCATOR_FL_COUNT];
+		uint32_t free_heads[ALLOCATOR_FL_COUNT][ALLOCATOR_SL_COUNT];
+	};
+
+	struct Pool {
+		uint32_t memory_type;
+		VkDeviceSize block_size;
+		std::vector<Block *> blocks;
+	};
+
+	bool AllocateFromType(uint32_t memory_type, const VkMemoryRequirements & requirements, AllocationKind kind, Allocation & allocation);
+	bool AllocateDedicated(uint32_t memory_type, const VkMemoryRequirements & requirements, Allocation & allocation);
+	bool AllocateFromBlock(Block * block, VkDeviceSize size, VkDeviceSize alignment, uint32_t & node);
+	Block * CreateBlock(Pool & pool, uint32_t & block_index);
+	void DestroyBlock(Block * block);
+
+	uint32_t NewNode(Block * block);
+	void RecycleNode(Block * block, uint32_t node);
+	void InsertFree(Block * block, uint32_t node);
+	void RemoveFree(Block * block, uint32_t node);
+	uint32_t FindFree(Block * block, VkDeviceSize size);
+
+	Renderer * m_renderer;
+	VkDevice m_device;
+	VkPhysicalDeviceMemoryProperties m_memory_properties;
+	VkDeviceSize m_buffer_image_granularity;
+	VkDeviceSize m_non_coherent_atom_size;
+	std::vector<Pool> m_pools;
+	uint32_t m_dedicated_allocation_count;
+};
\ No newline at end of file
@@ -1,4 +1,22 @@
 #pragma once
 
 #define BUILD_OPTIONS_DEBUG 1
-#define BUILD_OPTIONS_RUNTIME_DEBUG 1
\ No newline at end of file
+#define BUILD_OPTIONS_RUNTIME_DEBUG 1
+
+//how many frames the cpu may record ahead of the gpu
+#define BUILD_OPTIONS_FRAMES_IN_FLIGHT 2
+
+//textured draws index one big descriptor set through push constants instead of binding a set each, on devices with
+//descriptor indexing. without it, or with this off, they fall back to a cached set per texture
+#define BUILD_OPTIONS_BINDLESS 1
+
+//run the microbenchmarks in Benchmark.cpp instead of opening a window
+#define BUILD_OPTIONS_BENCHMARK 0
+
+//render offscreen with no window or swapchain, for machines without a display. stops after
+//BUILD_OPTIONS_HEADLESS_FRAMES frames, or never when that is 0
+#define BUILD_OPTIONS_HEADLESS 0
+#define BUILD_OPTIONS_HEADLESS_FRAMES 1000
+
+//cpu zone markers written to trace.json on exit, for chrome://tracing or perfetto
+#define BUILD_OPTIONS_TRACE 0
\ No newline at end of file
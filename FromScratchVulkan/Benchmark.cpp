@@ -0,0 +1,1494 @@
+#include "Benchmark.h"
+#include "Renderer.h"
+#include "Allocator.h"
+#include "Uploader.h"
+#include "ShaderCache.h"
+#include "ShaderCompiler.h"
+#include "ThreadPool.h"
+#include "RingBuffer.h"
+#include "Pipeline.h"
+#include "VertexFormat.h"
+#include "TransformStore.h"
+#include "FrustumCuller.h"
+#include "GpuCuller.h"
+#include "GpuProfiler.h"
+#include "MeshFile.h"
+#include "Texture.h"
+#include "Ktx2File.h"
+#include "BlockCompression.h"
+#include "DescriptorAllocator.h"
+#include "Shared.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock benchmark_clock;
+
+static double elapsed_microseconds(benchmark_clock::time_point start, benchmark_clock::time_point end) {
+	return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+//the variants only differ in VARIANT, which is enough for every one to be a distinct compile
+static const char * benchmark_shader_text =
+	"#version 400\n"
+	"#extension GL_ARB_separate_shader_objects : enable\n"
+	"#extension GL_ARB_shading_language_420pack : enable\n"
+	"layout (std140, binding = 0) uniform bufferVals {\n"
+	"    mat4 mvp;\n"
+	"} myBufferVals;\n"
+	"layout (location = 0) in vec4 pos;\n"
+	"layout (location = 1) in vec4 inColor;\n"
+	"layout (location = 0) out vec4 outColor;\n"
+	"out gl_PerVertex { \n"
+	"    vec4 gl_Position;\n"
+	"};\n"
+	"void main() {\n"
+	"   outColor = inColor * VARIANT;\n"
+	"   gl_Position = myBufferVals.mvp * pos;\n"
+	"}\n";
+
+void RunBenchmarks() {
+	//first, while no other renderer is alive to skew it
+	BenchmarkStartup();
+
+	//headless, so the benchmarks also run on display-less machines and software icds
+	Renderer r(BUILD_OPTIONS_FRAMES_IN_FLIGHT, true);
+	BenchmarkAllocator(&r);
+	BenchmarkUploader(&r);
+	BenchmarkMeshLoading(&r);
+	BenchmarkTextures(&r);
+	BenchmarkCompressedTextures(&r);
+	BenchmarkShaderCache();
+	BenchmarkShaderCompiler();
+	BenchmarkVertexFormats();
+	BenchmarkTransforms(&r);
+	BenchmarkCulling(&r);
+	BenchmarkDescriptors(&r);
+	//recording needs a render pass and pipeline to draw with
+	r.CreateHeadlessTarget(512, 512);
+	BenchmarkCommandRecording(&r);
+	BenchmarkInstancing(&r);
+	BenchmarkTextureSampling(&r);
+	BenchmarkBindless(&r);
+	BenchmarkPushConstants(&r);
+	BenchmarkGpuCulling(&r);
+}
+
+void BenchmarkAllocator(Renderer * renderer) {
+	VkDevice device = renderer->GetVulkanDevice();
+	Allocator * allocator = renderer->GetAllocator();
+
+	//stay well under maxMemoryAllocationCount so the raw path doesn't fail
+	uint32_t allocation_count = std::min(2000u, renderer->GetVulkanPhysicalDeviceProperties().limits.maxMemoryAllocationCount / 2);
+	const uint32_t rounds = 5;
+
+	//sizes spread log-uniformly between 256 bytes and 1MB, the range buffers and small textures live in
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<double> size_distribution(8.0, 20.0);
+	std::vector<VkMemoryRequirements> requirements(allocation_count);
+	std::vector<uint32_t> free_order(allocation_count);
+	for (uint32_t i = 0; i < allocation_count; i++) {
+		requirements[i].size = (VkDeviceSize)std::pow(2.0, size_distribution(rng));
+		requirements[i].alignment = 256;
+		requirements[i].memoryTypeBits = ~0u;
+		free_order[i] = i;
+	}
+	std::shuffle(free_order.begin(), free_order.end(), rng);
+
+	//only the memory type bits that a real device local buffer could use
+	{
+		VkBufferCreateInfo buffer_create_info{};
+		buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		buffer_create_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+		buffer_create_info.size = 256;
+		buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		VkBuffer buffer;
+		ErrorCheck(vkCreateBuffer(device, &buffer_create_info, VK_NULL_HANDLE, &buffer));
+		VkMemoryRequirements buffer_requirements;
+		vkGetBufferMemoryRequirements(device, buffer, &buffer_requirements);
+		vkDestroyBuffer(device, buffer, VK_NULL_HANDLE);
+		for (uint32_t i = 0; i < allocation_count; i++) {
+			requirements[i].memoryTypeBits = buffer_requirements.memoryTypeBits;
+		}
+	}
+
+	uint32_t memory_type = 0;
+	memory_types_from_properties(requirements[0].memoryTypeBits, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &memory_type, renderer->GetPhysicalDeviceMemoryProperties());
+
+	double allocator_allocate = 0.0, allocator_free = 0.0;
+	double raw_allocate = 0.0, raw_free = 0.0;
+	uint32_t peak_blocks = 0;
+
+	std::vector<Allocation> allocations(allocation_count);
+	std::vector<VkDeviceMemory> memories(allocation_count);
+	for (uint32_t round = 0; round < rounds; round++) {
+		benchmark_clock::time_point start = benchmark_clock::now();
+		for (uint32_t i = 0; i < allocation_count; i++) {
+			allocations[i] = allocator->Allocate(requirements[i], 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, ALLOCATION_LINEAR);
+		}
+		benchmark_clock::time_point middle = benchmark_clock::now();
+		peak_blocks = std::max(peak_blocks, allocator->GetBlockCount());
+		for (uint32_t i = 0; i < allocation_count; i++) {
+			allocator->Free(allocations[free_order[i]]);
+		}
+		benchmark_clock::time_point end = benchmark_clock::now();
+		allocator_allocate += elapsed_microseconds(start, middle);
+		allocator_free += elapsed_microseconds(middle, end);
+
+		start = benchmark_clock::now();
+		for (uint32_t i = 0; i < allocation_count; i++) {
+			VkMemoryAllocateInfo memory_allocate_info{};
+			memory_allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			memory_allocate_info.allocationSize = requirements[i].size;
+			memory_allocate_info.memoryTypeIndex = memory_type;
+			ErrorCheck(vkAllocateMemory(device, &memory_allocate_info, VK_NULL_HANDLE, &memories[i]));
+		}
+		middle = benchmark_clock::now();
+		for (uint32_t i = 0; i < allocation_count; i++) {
+			vkFreeMemory(device, memories[free_order[i]], VK_NULL_HANDLE);
+		}
+		end = benchmark_clock::now();
+		raw_allocate += elapsed_microseconds(start, middle);
+		raw_free += elapsed_microseconds(middle, end);
+	}
+
+	double operations = (double)allocation_count * rounds;
+	std::cout << "allocator benchmark: " << allocation_count << " allocations x " << rounds << " rounds, memory type " << memory_type << std::endl;
+	std::cout << "\tAllocator        alloc " << allocator_allocate / operations << "us  free " << allocator_free / operations << "us  (" << peak_blocks << " blocks, " << allocator->GetDedicatedAllocationCount() << " dedicated)" << std::endl;
+	std::cout << "\tvkAllocateMemory alloc " << raw_allocate / operations << "us  free " << raw_free / operations << "us  (" << allocation_count << " allocations)" << std::endl;
+}
+
+//uploads every (offset, size) pair into one device local buffer through the uploader and waits for it
+static double upload_throughput(Renderer * renderer, VkBuffer buffer, const Allocation & allocation, const std::vector<VkDeviceSize> & sizes, const std::vector<uint8_t> & source) {
+	Uploader * uploader = renderer->GetUploader();
+	VkDeviceSize total = 0;
+	benchmark_clock::time_point start = benchmark_clock::now();
+	uint64_t token = 0;
+	VkDeviceSize offset = 0;
+	for (uint32_t i = 0; i < sizes.size(); i++) {
+		if (offset + sizes[i] > allocation.size) {
+			offset = 0;
+		}
+		token = uploader->UploadBuffer(buffer, allocation, offset, source.data(), sizes[i]);
+		offset = (offset + sizes[i] + 255) / 256 * 256;
+		total += sizes[i];
+	}
+	uploader->Wait(token);
+	benchmark_clock::time_point end = benchmark_clock::now();
+	return (double)total / (1024.0 * 1024.0) / std::chrono::duration<double>(end - start).count();
+}
+
+void BenchmarkUploader(Renderer * renderer) {
+	VkDevice device = renderer->GetVulkanDevice();
+	const VkDeviceSize buffer_size = 256 * 1024 * 1024;
+	const VkDeviceSize blob_size = 64 * 1024 * 1024;
+
+	std::vector<uint8_t> source(blob_size);
+	for (uint32_t i = 0; i < source.size(); i++) {
+		source[i] = (uint8_t)i;
+	}
+
+	//small objects: 20000 meshes and constant blocks between 256 bytes and 64KB
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<uint32_t> small_distribution(256, 64 * 1024);
+	std::vector<VkDeviceSize> small_sizes(20000);
+	for (uint32_t i = 0; i < small_sizes.size(); i++) {
+		small_sizes[i] = small_distribution(rng);
+	}
+	//large blobs: a few 64MB streams, bigger than the staging ring
+	std::vector<VkDeviceSize> large_sizes(4, blob_size);
+
+	VkBufferCreateInfo buffer_create_info{};
+	buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_create_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	buffer_create_info.size = buffer_size;
+	buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	//once through staging into pure device local memory, once with whatever the uploader would pick
+	const char * names[2] = { "staged", "preferred" };
+	VkMemoryPropertyFlags preferred[2] = { 0, UPLOADER_MEMORY_PREFERRED };
+	for (uint32_t i = 0; i < 2; i++) {
+		VkBuffer buffer;
+		ErrorCheck(vkCreateBuffer(device, &buffer_create_info, VK_NULL_HANDLE, &buffer));
+		Allocation allocation = renderer->GetAllocator()->AllocateForBuffer(buffer, UPLOADER_MEMORY_REQUIRED, preferred[i]);
+
+		double small_throughput = upload_throughput(renderer, buffer, allocation, small_sizes, source);
+		double large_throughput = upload_throughput(renderer, buffer, allocation, large_sizes, source);
+		std::cout << "uploader benchmark (" << names[i] << ", memory type " << allocation.memory_type << (allocation.mapped != nullptr ? ", direct" : ", staged") << "):" << std::endl;
+		std::cout << "\tsmall objects " << small_throughput << " MB/s" << std::endl;
+		std::cout << "\tlarge blobs   " << large_throughput << " MB/s" << std::endl;
+
+		vkDestroyBuffer(device, buffer, VK_NULL_HANDLE);
+		renderer->GetAllocator()->Free(allocation);
+	}
+}
+
+void BenchmarkMeshLoading(Renderer * renderer) {
+	VkDevice device = renderer->GetVulkanDevice();
+	const char * path = "benchmark.mesh";
+	//a 2048 x 2048 grid with every attribute: ~84MB of vertices and ~100MB of 32 bit indices
+	const uint32_t side = 2048;
+
+	VertexLayout layout{};
+	layout.position = VERTEX_POSITION_SNORM16;
+	layout.colour = true;
+	layout.normal = true;
+	layout.uv = true;
+	uint32_t vertex_count = side * side;
+	//what's in the vertices doesn't matter to the load, only that the file is well formed
+	std::vector<uint8_t> vertices((size_t)vertex_count * VertexFormat::GetStride(layout));
+	for (size_t i = 0; i < vertices.size(); i++) {
+		vertices[i] = (uint8_t)i;
+	}
+	std::vector<uint32_t> indices;
+	indices.reserve((size_t)(side - 1) * (side - 1) * 6);
+	for (uint32_t y = 0; y + 1 < side; y++) {
+		for (uint32_t x = 0; x + 1 < side; x++) {
+			uint32_t v = y * side + x;
+			uint32_t quad[6] = { v, v + side, v + 1, v + 1, v + side, v + side + 1 };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+
+	MeshFileLod lod{};
+	lod.index_count = (uint32_t)indices.size();
+	MeshFileContents contents{};
+	contents.layout = layout;
+	contents.quantization.offset = glm::vec3(0.0f);
+	contents.quantization.scale = glm::vec3(1.0f);
+	contents.bounds_min = glm::vec3(-1.0f);
+	contents.bounds_max = glm::vec3(1.0f);
+	contents.bounding_sphere = glm::vec4(0.0f, 0.0f, 0.0f, std::sqrt(3.0f));
+	contents.vertices = vertices.data();
+	contents.vertex_count = vertex_count;
+	contents.indices = indices.data();
+	contents.index_count = (uint32_t)indices.size();
+	contents.index_size = sizeof(uint32_t);
+	contents.lods = &lod;
+	contents.lod_count = 1;
+	bool written = MeshFile::Write(path, contents);
+	vertices = std::vector<uint8_t>();
+	indices = std::vector<uint32_t>();
+	if (!written) {
+		std::cout << "mesh loading benchmark: could not write " << path << std::endl;
+		return;
+	}
+
+	//the destinations are made up front so both runs time only getting the bytes in and uploading them
+	MeshFile mesh_file;
+	if (!mesh_file.Open(path)) {
+		std::cout << "mesh loading benchmark: could not open " << path << std::endl;
+		remove(path);
+		return;
+	}
+	VkDeviceSize vertex_data_size = mesh_file.GetVertexDataSize();
+	VkDeviceSize index_data_size = mesh_file.GetIndexDataSize();
+	mesh_file.Close();
+	VkBufferCreateInfo buffer_create_info{};
+	buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	buffer_create_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	buffer_create_info.size = vertex_data_size;
+	VkBuffer vertex_buffer;
+	ErrorCheck(vkCreateBuffer(device, &buffer_create_info, VK_NULL_HANDLE, &vertex_buffer));
+	Allocation vertex_allocation = renderer->GetAllocator()->AllocateForBuffer(vertex_buffer, UPLOADER_MEMORY_REQUIRED, UPLOADER_MEMORY_PREFERRED);
+	buffer_create_info.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	buffer_create_info.size = index_data_size;
+	VkBuffer index_buffer;
+	ErrorCheck(vkCreateBuffer(device, &buffer_create_info, VK_NULL_HANDLE, &index_buffer));
+	Allocation index_allocation = renderer->GetAllocator()->AllocateForBuffer(index_buffer, UPLOADER_MEMORY_REQUIRED, UPLOADER_MEMORY_PREFERRED);
+	Uploader * uploader = renderer->GetUploader();
+
+	//both runs see the file through the page cache the write just filled, so this compares what each does
+	//per byte rather than the disk
+	benchmark_clock::time_point start = benchmark_clock::now();
+	std::vector<uint8_t> data;
+	read_file(path, data);
+	MeshFileHeader header;
+	memcpy(&header, data.data(), sizeof(header));
+	uploader->UploadBuffer(vertex_buffer, vertex_allocation, 0, data.data() + header.vertex_offset, header.vertex_size);
+	uploader->Wait(uploader->UploadBuffer(index_buffer, index_allocation, 0, data.data() + header.index_offset, header.index_size_bytes));
+	double read_ms = elapsed_microseconds(start, benchmark_clock::now()) / 1000.0;
+	double megabytes = data.size() / (1024.0 * 1024.0);
+	data = std::vector<uint8_t>();
+
+	start = benchmark_clock::now();
+	mesh_file.Open(path);
+	uploader->UploadBuffer(vertex_buffer, vertex_allocation, 0, mesh_file.GetVertexData(), vertex_data_size);
+	uploader->Wait(uploader->UploadBuffer(index_buffer, index_allocation, 0, mesh_file.GetIndexData(), index_data_size));
+	double load_ms = elapsed_microseconds(start, benchmark_clock::now()) / 1000.0;
+	mesh_file.Close();
+
+	std::cout << "mesh loading benchmark: " << megabytes << " MB, " << vertex_count << " vertices" << std::endl;
+	std::cout << "	read_file + upload " << read_ms << "ms, " << megabytes / (read_ms / 1000.0) << " MB/s" << std::endl;
+	std::cout << "	map + upload       " << load_ms << "ms, " << megabytes / (load_ms / 1000.0) << " MB/s (" << read_ms / load_ms << "x read_file)" << std::endl;
+
+	vkDestroyBuffer(device, index_buffer, VK_NULL_HANDLE);
+	renderer->GetAllocator()->Free(index_allocation);
+	vkDestroyBuffer(device, vertex_buffer, VK_NULL_HANDLE);
+	renderer->GetAllocator()->Free(vertex_allocation);
+	remove(path);
+}
+
+static const char * mip_generation_method_name(MipGenerationMethod method) {
+	switch (method) {
+	case MIP_GENERATION_BLIT:
+		return "blit";
+	case MIP_GENERATION_COMPUTE:
+		return "compute";
+	default:
+		return "none";
+	}
+}
+
+//noise, so neither the copies nor the filtering get any help from the contents
+static std::vector<uint32_t> noise_pixels(uint32_t count) {
+	std::mt19937 rng(1234);
+	std::vector<uint32_t> pixels(count);
+	for (uint32_t i = 0; i < count; i++) {
+		pixels[i] = rng() | 0xff000000u;
+	}
+	return pixels;
+}
+
+void BenchmarkTextures(Renderer * renderer) {
+	const uint32_t sizes[] = { 512, 1024, 2048, 4096 };
+	const uint32_t repeats = 4;
+
+	std::vector<uint32_t> pixels = noise_pixels(4096 * 4096);
+
+	//the whole round trip: image creation, the copy through staging, the chain and the wait for all of it
+	std::cout << "texture benchmark: rgba8, " << repeats << " textures per size" << std::endl;
+	for (uint32_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		uint32_t size = sizes[s];
+		VkDeviceSize bytes = (VkDeviceSize)size * size * sizeof(uint32_t);
+		double milliseconds[2] = {};
+		MipGenerationMethod method = MIP_GENERATION_NONE;
+		uint32_t mip_levels = 1;
+		for (uint32_t mipmaps = 0; mipmaps < 2; mipmaps++) {
+			benchmark_clock::time_point start = benchmark_clock::now();
+			for (uint32_t i = 0; i < repeats; i++) {
+				Texture texture(renderer, size, size, VK_FORMAT_R8G8B8A8_UNORM, pixels.data(), bytes, mipmaps != 0);
+				texture.Wait();
+				if (mipmaps) {
+					method = texture.GetMipGenerationMethod();
+					mip_levels = texture.GetMipLevels();
+				}
+			}
+			milliseconds[mipmaps] = elapsed_microseconds(start, benchmark_clock::now()) / 1000.0 / repeats;
+		}
+		double megabytes = bytes / (1024.0 * 1024.0);
+		std::cout << "	" << size << "x" << size << ": upload " << milliseconds[0] << "ms (" << megabytes / milliseconds[0] * 1000.0 << " MB/s), with "
+			<< mip_levels << " levels by " << mip_generation_method_name(method) << " " << milliseconds[1] << "ms (" << megabytes / milliseconds[1] * 1000.0 << " MB/s)" << std::endl;
+	}
+
+	//float formats are where devices start refusing linear blits and the compute path takes over
+	const uint32_t float_size = 1024;
+	std::vector<glm::vec4> float_pixels(float_size * float_size);
+	for (uint32_t i = 0; i < float_pixels.size(); i++) {
+		uint32_t pixel = pixels[i];
+		float_pixels[i] = glm::vec4((pixel & 0xff) / 255.0f, ((pixel >> 8) & 0xff) / 255.0f, ((pixel >> 16) & 0xff) / 255.0f, 1.0f);
+	}
+	benchmark_clock::time_point start = benchmark_clock::now();
+	Texture texture(renderer, float_size, float_size, VK_FORMAT_R32G32B32A32_SFLOAT, float_pixels.data(), float_pixels.size() * sizeof(glm::vec4));
+	texture.Wait();
+	double milliseconds = elapsed_microseconds(start, benchmark_clock::now()) / 1000.0;
+	std::cout << "	" << float_size << "x" << float_size << " rgba32f: " << texture.GetMipLevels() << " levels by " << mip_generation_method_name(texture.GetMipGenerationMethod())
+		<< " " << milliseconds << "ms" << std::endl;
+}
+
+//just enough of a ktx2 for Ktx2File: the header, the level index and the levels, smallest first as the spec has
+//them, with no data format descriptor
+static bool write_ktx2(const char * path, VkFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>> & levels) {
+	const uint8_t identifier[KTX2_IDENTIFIER_SIZE] = { 0xab, 0x4b, 0x54, 0x58, 0x20, 0x32, 0x30, 0xbb, 0x0d, 0x0a, 0x1a, 0x0a };
+	Ktx2Header header{};
+	memcpy(header.identifier, identifier, KTX2_IDENTIFIER_SIZE);
+	header.vk_format = format;
+	header.type_size = 1;
+	header.pixel_width = width;
+	header.pixel_height = height;
+	header.face_count = 1;
+	header.level_count = (uint32_t)levels.size();
+
+	std::vector<Ktx2Level> index(levels.size());
+	uint64_t offset = sizeof(Ktx2Header) + levels.size() * sizeof(Ktx2Level);
+	for (size_t i = levels.size(); i-- > 0;) {
+		offset = (offset + 15) / 16 * 16;
+		index[i].byte_offset = offset;
+		index[i].byte_length = levels[i].size();
+		index[i].uncompressed_byte_length = levels[i].size();
+		offset += levels[i].size();
+	}
+
+	std::vector<uint8_t> data((size_t)offset, 0);
+	memcpy(data.data(), &header, sizeof(header));
+	memcpy(data.data() + sizeof(header), index.data(), index.size() * sizeof(Ktx2Level));
+	for (size_t i = 0; i < levels.size(); i++) {
+		memcpy(data.data() + index[i].byte_offset, levels[i].data(), levels[i].size());
+	}
+	return write_file_atomic(path, data.data(), data.size());
+}
+
+void BenchmarkCompressedTextures(Renderer * renderer) {
+	const char * path = "benchmark.ktx2";
+	const uint32_t size = 2048;
+	const uint32_t repeats = 8;
+
+	//random blocks hit every endpoint order and index pattern, which is all the decoders branch on
+	std::mt19937 rng(1234);
+	uint32_t level_count = Texture::GetMipLevelCount(size, size);
+	std::vector<std::vector<uint8_t>> bc1_levels(level_count);
+	for (uint32_t level = 0; level < level_count; level++) {
+		uint32_t level_size = std::max(size >> level, 1u);
+		bc1_levels[level].resize(BlockCompression::GetBlockCount(level_size, level_size) * BLOCK_COMPRESSION_BC1_BLOCK_BYTES);
+		for (size_t i = 0; i < bc1_levels[level].size(); i++) {
+			bc1_levels[level][i] = (uint8_t)rng();
+		}
+	}
+	std::vector<uint8_t> bc3_blocks(BlockCompression::GetBlockCount(size, size) * BLOCK_COMPRESSION_BC3_BLOCK_BYTES);
+	for (size_t i = 0; i < bc3_blocks.size(); i++) {
+		bc3_blocks[i] = (uint8_t)rng();
+	}
+
+	//the fallback for devices without bc support; rates are of decoded rgba8 output
+	std::vector<uint8_t> decoded((size_t)size * size * 4);
+	double megabytes = decoded.size() / (1024.0 * 1024.0);
+	std::cout << "compressed texture benchmark: " << size << "x" << size << std::endl;
+	for (uint32_t simd = 0; simd < 2; simd++) {
+		benchmark_clock::time_point start = benchmark_clock::now();
+		for (uint32_t i = 0; i < repeats; i++) {
+			if (simd) {
+				BlockCompression::DecodeBC1(bc1_levels[0].data(), size, size, false, decoded.data());
+			} else {
+				BlockCompression::DecodeBC1Scalar(bc1_levels[0].data(), size, size, false, decoded.data());
+			}
+		}
+		double bc1_ms = elapsed_microseconds(start, benchmark_clock::now()) / 1000.0 / repeats;
+		start = benchmark_clock::now();
+		for (uint32_t i = 0; i < repeats; i++) {
+			if (simd) {
+				BlockCompression::DecodeBC3(bc3_blocks.data(), size, size, decoded.data());
+			} else {
+				BlockCompression::DecodeBC3Scalar(bc3_blocks.data(), size, size, decoded.data());
+			}
+		}
+		double bc3_ms = elapsed_microseconds(start, benchmark_clock::now()) / 1000.0 / repeats;
+		std::cout << "	" << (simd ? "sse2  " : "scalar") << " decode: bc1 " << bc1_ms << "ms (" << megabytes / bc1_ms * 1000.0 << " MB/s), bc3 "
+			<< bc3_ms << "ms (" << megabytes / bc3_ms * 1000.0 << " MB/s)" << std::endl;
+	}
+
+	//the header promises the two give the same bytes. the odd size leaves partial edge blocks over the same block count
+	const uint32_t edge_width = size - 3;
+	const uint32_t edge_height = size - 1;
+	std::vector<uint8_t> reference((size_t)edge_width * edge_height * 4);
+	std::vector<uint8_t> candidate(reference.size());
+	const char * variant_names[3] = { "bc1", "bc1 with alpha", "bc3" };
+	uint32_t mismatch_count = 0;
+	for (uint32_t variant = 0; variant < 3; variant++) {
+		if (variant < 2) {
+			BlockCompression::DecodeBC1Scalar(bc1_levels[0].data(), edge_width, edge_height, variant == 1, reference.data());
+			BlockCompression::DecodeBC1(bc1_levels[0].data(), edge_width, edge_height, variant == 1, candidate.data());
+		} else {
+			BlockCompression::DecodeBC3Scalar(bc3_blocks.data(), edge_width, edge_height, reference.data());
+			BlockCompression::DecodeBC3(bc3_blocks.data(), edge_width, edge_height, candidate.data());
+		}
+		if (memcmp(reference.data(), candidate.data(), reference.size()) != 0) {
+			std::cout << "	mismatch: sse2 decodes " << variant_names[variant] << " differently to scalar" << std::endl;
+			mismatch_count++;
+		}
+	}
+	if (mismatch_count == 0) {
+		std::cout << "	sse2 decodes match scalar bit for bit" << std::endl;
+	}
+
+	if (!write_ktx2(path, VK_FORMAT_BC1_RGB_UNORM_BLOCK, size, size, bc1_levels)) {
+		std::cout << "	could not write " << path << std::endl;
+		return;
+	}
+
+	benchmark_clock::time_point start = benchmark_clock::now();
+	Texture * compressed = Texture::LoadKtx2(renderer, path);
+	if (compressed == nullptr) {
+		std::cout << "	could not load " << path << std::endl;
+		remove(path);
+		return;
+	}
+	compressed->Wait();
+	double compressed_ms = elapsed_microseconds(start, benchmark_clock::now()) / 1000.0;
+
+	//what the same texture costs without compression, decoded up front and with its chain generated on the gpu
+	BlockCompression::DecodeBC1(bc1_levels[0].data(), size, size, false, decoded.data());
+	start = benchmark_clock::now();
+	Texture uncompressed(renderer, size, size, VK_FORMAT_R8G8B8A8_UNORM, decoded.data(), decoded.size());
+	uncompressed.Wait();
+	double uncompressed_ms = elapsed_microseconds(start, benchmark_clock::now()) / 1000.0;
+
+	std::cout << "	ktx2 bc1 load " << compressed_ms << "ms, " << compressed->GetMemorySize() / 1024 << " KB, format " << compressed->GetFormat() << std::endl;
+	std::cout << "	rgba8 upload  " << uncompressed_ms << "ms, " << uncompressed.GetMemorySize() / 1024 << " KB ("
+		<< (double)uncompressed.GetMemorySize() / compressed->GetMemorySize() << "x the memory)" << std::endl;
+	delete compressed;
+	remove(path);
+
+	//astc has no decoder to fall back on, so a device that samples it has to take it through the direct upload as stored
+	VkFormatProperties astc_properties;
+	vkGetPhysicalDeviceFormatProperties(renderer->GetVulkanPhysicalDevice(), VK_FORMAT_ASTC_4x4_UNORM_BLOCK, &astc_properties);
+	VkFormatFeatureFlags sampled_features = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	if ((astc_properties.optimalTilingFeatures & sampled_features) != sampled_features) {
+		std::cout << "	astc 4x4 not sampled by this device, skipping its load" << std::endl;
+		return;
+	}
+
+	//every block a constant colour (a void extent block), which any decoder takes without caring about the rest of astc
+	const uint32_t astc_size = 256;
+	const uint8_t void_extent_block[16] = { 0xfc, 0xfd, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x80, 0x00, 0x80, 0x00, 0x80, 0xff, 0xff };
+	uint32_t astc_level_count = Texture::GetMipLevelCount(astc_size, astc_size);
+	std::vector<std::vector<uint8_t>> astc_levels(astc_level_count);
+	for (uint32_t level = 0; level < astc_level_count; level++) {
+		uint32_t level_size = std::max(astc_size >> level, 1u);
+		uint32_t block_count = ((level_size + 3) / 4) * ((level_size + 3) / 4);
+		for (uint32_t i = 0; i < block_count; i++) {
+			astc_levels[level].insert(astc_levels[level].end(), void_extent_block, void_extent_block + sizeof(void_extent_block));
+		}
+	}
+	if (!write_ktx2(path, VK_FORMAT_ASTC_4x4_UNORM_BLOCK, astc_size, astc_size, astc_levels)) {
+		std::cout << "	could not write " << path << std::endl;
+		return;
+	}
+	Texture * astc = Texture::LoadKtx2(renderer, path);
+	if (astc == nullptr) {
+		std::cout << "	mismatch: astc 4x4 ktx2 did not load" << std::endl;
+	} else {
+		astc->Wait();
+		if (astc->GetFormat() == VK_FORMAT_ASTC_4x4_UNORM_BLOCK && astc->GetMipLevels() == astc_level_count) {
+			std::cout << "	ktx2 astc 4x4 load took the direct upload, " << astc->GetMipLevels() << " levels" << std::endl;
+		} else {
+			std::cout << "	mismatch: astc 4x4 ktx2 loaded as format " << astc->GetFormat() << " with " << astc->GetMipLevels() << " levels" << std::endl;
+		}
+		delete astc;
+	}
+	remove(path);
+}
+
+void BenchmarkShaderCache() {
+	const uint32_t variant_count = 32;
+
+	//a define nobody has used before guarantees the first pass misses without touching the cache directory
+	std::string run = "BENCHMARK_RUN " + std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+	std::vector<std::vector<std::string>> defines(variant_count);
+	for (uint32_t i = 0; i < variant_count; i++) {
+		defines[i].push_back(run);
+		defines[i].push_back("VARIANT " + std::to_string(i + 1) + ".0");
+	}
+
+	double milliseconds[2];
+	for (uint32_t pass = 0; pass < 2; pass++) {
+		benchmark_clock::time_point start = benchmark_clock::now();
+		//a fresh cache each pass, so the warm pass also skips bringing glslang up like a real warm start
+		ShaderCache cache;
+		std::vector<unsigned int> spirv;
+		for (uint32_t i = 0; i < variant_count; i++) {
+			cache.GetSPIRV(VK_SHADER_STAGE_VERTEX_BIT, benchmark_shader_text, defines[i], spirv);
+		}
+		milliseconds[pass] = elapsed_microseconds(start, benchmark_clock::now()) / 1000.0;
+	}
+	//the run define makes every entry unique to this run, so nothing would ever hit them again
+	ShaderCache cache;
+	for (uint32_t i = 0; i < variant_count; i++) {
+		cache.Evict(VK_SHADER_STAGE_VERTEX_BIT, benchmark_shader_text, defines[i]);
+	}
+	std::cout << "shader cache benchmark: " << variant_count << " shaders" << std::endl;
+	std::cout << "\tcold " << milliseconds[0] << "ms" << std::endl;
+	std::cout << "\twarm " << milliseconds[1] << "ms" << std::endl;
+}
+
+void BenchmarkShaderCompiler() {
+	//roughly the size of a real shader library once every permutation is counted
+	const uint32_t variant_count = 384;
+	std::vector<ShaderCompileJob> jobs(variant_count);
+	for (uint32_t i = 0; i < variant_count; i++) {
+		jobs[i].stage = VK_SHADER_STAGE_VERTEX_BIT;
+		jobs[i].source = benchmark_shader_text;
+		jobs[i].defines.push_back("VARIANT " + std::to_string(i + 1) + ".0");
+	}
+
+	uint32_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<uint32_t> thread_counts;
+	for (uint32_t threads = 1; threads < max_threads; threads *= 2) {
+		thread_counts.push_back(threads);
+	}
+	thread_counts.push_back(max_threads);
+
+	//no cache, every job is a real compile
+	std::cout << "shader compiler benchmark: " << variant_count << " shaders" << std::endl;
+	double serial_milliseconds = 0.0;
+	for (uint32_t i = 0; i < thread_counts.size(); i++) {
+		ThreadPool pool(thread_counts[i]);
+		ShaderCompiler compiler(&pool);
+
+		benchmark_clock::time_point start = benchmark_clock::now();
+		std::vector<std::future<ShaderCompileResult>> results = compiler.CompileBatch(jobs);
+		uint32_t failures = 0;
+		for (uint32_t j = 0; j < results.size(); j++) {
+			if (!results[j].get().success) {
+				failures++;
+			}
+		}
+		double milliseconds = elapsed_microseconds(start, benchmark_clock::now()) / 1000.0;
+		if (i == 0) {
+			serial_milliseconds = milliseconds;
+		}
+		std::cout << "	" << thread_counts[i] << " threads: " << milliseconds << "ms, " << serial_milliseconds / milliseconds << "x";
+		if (failures > 0) {
+			std::cout << " (" << failures << " failed)";
+		}
+		std::cout << std::endl;
+	}
+}
+
+void BenchmarkVertexFormats() {
+	const uint32_t vertex_count = 1000000;
+	const uint32_t rounds = 5;
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::uniform_real_distribution<float> signed_unit(-1.0f, 1.0f);
+	std::vector<glm::vec3> positions(vertex_count);
+	std::vector<glm::vec3> colours(vertex_count);
+	std::vector<glm::vec3> normals(vertex_count);
+	std::vector<glm::vec2> uvs(vertex_count);
+	for (uint32_t i = 0; i < vertex_count; i++) {
+		positions[i] = glm::vec3(signed_unit(rng), signed_unit(rng), signed_unit(rng)) * 100.0f;
+		colours[i] = glm::vec3(unit(rng), unit(rng), unit(rng));
+		normals[i] = glm::vec3(signed_unit(rng), signed_unit(rng), signed_unit(rng));
+		uvs[i] = glm::vec2(unit(rng), unit(rng));
+	}
+	VertexStreams streams{};
+	streams.positions = positions.data();
+	streams.colours = colours.data();
+	streams.normals = normals.data();
+	streams.uvs = uvs.data();
+
+	struct Case {
+		const char * name;
+		VertexLayout layout;
+		//the same attributes as plain floats
+		uint32_t float_stride;
+	};
+	const Case cases[] = {
+		{ "float position, rgba8 colour", { VERTEX_POSITION_FLOAT, true, false, false }, sizeof(vertex_data) },
+		{ "half position, rgba8 colour", { VERTEX_POSITION_HALF, true, false, false }, sizeof(vertex_data) },
+		{ "snorm16 position, rgba8 colour", { VERTEX_POSITION_SNORM16, true, false, false }, sizeof(vertex_data) },
+		{ "snorm16 position, oct normal, half uv", { VERTEX_POSITION_SNORM16, false, true, true }, sizeof(glm::vec3) * 2 + sizeof(glm::vec2) },
+		{ "all packed attributes", { VERTEX_POSITION_SNORM16, true, true, true }, sizeof(glm::vec3) * 3 + sizeof(glm::vec2) },
+	};
+
+	std::cout << "vertex format benchmark: " << vertex_count << " vertices" << std::endl;
+	for (uint32_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+		const VertexLayout & layout = cases[c].layout;
+		uint32_t stride = VertexFormat::GetStride(layout);
+		VertexQuantization quantization = VertexFormat::ComputeQuantization(layout, positions.data(), vertex_count);
+		std::vector<uint8_t> scalar_output(vertex_count * stride);
+		std::vector<uint8_t> simd_output(vertex_count * stride);
+
+		//best of a few rounds, the first one also pays for faulting in the output
+		double scalar_microseconds = 1e30;
+		double simd_microseconds = 1e30;
+		for (uint32_t round = 0; round < rounds; round++) {
+			benchmark_clock::time_point start = benchmark_clock::now();
+			VertexFormat::EncodeScalar(layout, streams, vertex_count, quantization, scalar_output.data());
+			benchmark_clock::time_point middle = benchmark_clock::now();
+			VertexFormat::Encode(layout, streams, vertex_count, quantization, simd_output.data());
+			benchmark_clock::time_point end = benchmark_clock::now();
+			scalar_microseconds = std::min(scalar_microseconds, elapsed_microseconds(start, middle));
+			simd_microseconds = std::min(simd_microseconds, elapsed_microseconds(middle, end));
+		}
+
+		std::cout << "\t" << cases[c].name << ": " << stride << " bytes per vertex (" << cases[c].float_stride << " as floats, "
+			<< 100.0 * stride / cases[c].float_stride << "%), encode " << vertex_count / scalar_microseconds << "M vertices/s scalar, "
+			<< vertex_count / simd_microseconds << "M vertices/s simd" << (scalar_output == simd_output ? "" : " MISMATCH") << std::endl;
+	}
+}
+
+void BenchmarkTransforms(Renderer * renderer) {
+	VkDevice device = renderer->GetVulkanDevice();
+	const uint32_t object_counts[] = { 10000, 100000 };
+	const uint32_t max_objects = 100000;
+	const uint32_t rounds = 10;
+
+	//the mvps go where a draw would read them: a host visible buffer, device local too if there is such a type
+	VkBufferCreateInfo buffer_create_info{};
+	buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_create_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	buffer_create_info.size = max_objects * sizeof(glm::mat4);
+	buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	VkBuffer buffer;
+	ErrorCheck(vkCreateBuffer(device, &buffer_create_info, VK_NULL_HANDLE, &buffer));
+	Allocation allocation = renderer->GetAllocator()->AllocateForBuffer(buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	glm::mat4 * mapped = (glm::mat4 *)allocation.mapped;
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> signed_unit(-1.0f, 1.0f);
+	std::vector<glm::vec3> positions(max_objects);
+	std::vector<glm::quat> rotations(max_objects);
+	std::vector<glm::vec3> scales(max_objects);
+	for (uint32_t i = 0; i < max_objects; i++) {
+		positions[i] = glm::vec3(signed_unit(rng), signed_unit(rng), signed_unit(rng)) * 100.0f;
+		rotations[i] = glm::angleAxis(signed_unit(rng) * 3.14159f, glm::normalize(glm::vec3(signed_unit(rng), signed_unit(rng), 1.0f)));
+		scales[i] = glm::vec3(1.0f + signed_unit(rng) * 0.5f);
+	}
+	const glm::mat4 & view_projection_matrix = renderer->GetPipeline()->GetViewProjectionMatrix();
+	const glm::mat4 identity(1.0f);
+	std::vector<glm::mat4> reference(max_objects);
+
+	const char * names[] = { "glm", "scalar soa", "sse2", "avx2", "parallel" };
+	const SimdLevel levels[] = { SIMD_LEVEL_SCALAR, SIMD_LEVEL_SCALAR, SIMD_LEVEL_SSE2, SIMD_LEVEL_AVX2, Simd::GetLevel() };
+	for (uint32_t o = 0; o < sizeof(object_counts) / sizeof(object_counts[0]); o++) {
+		uint32_t object_count = object_counts[o];
+		//Resize resets whatever it grows back to identity, so each count gets a store of its own
+		TransformStore transforms(object_count);
+		for (uint32_t i = 0; i < object_count; i++) {
+			transforms.Set(i, positions[i], rotations[i], scales[i]);
+		}
+		std::cout << "transform benchmark: " << object_count << " objects, " << renderer->GetThreadPool()->GetThreadCount() << " threads, "
+			<< Simd::GetLevelName(Simd::GetLevel()) << " available" << std::endl;
+
+		double baseline_microseconds = 0.0;
+		for (uint32_t k = 0; k < sizeof(names) / sizeof(names[0]); k++) {
+			if (levels[k] > Simd::GetLevel()) {
+				continue;
+			}
+
+			double microseconds = 1e30;
+			for (uint32_t round = 0; round < rounds; round++) {
+				benchmark_clock::time_point start = benchmark_clock::now();
+				if (k == 0) {
+					for (uint32_t i = 0; i < object_count; i++) {
+						glm::mat4 model_matrix = glm::translate(identity, positions[i]) * glm::mat4_cast(rotations[i]) * glm::scale(identity, scales[i]);
+						mapped[i] = view_projection_matrix * model_matrix;
+					}
+				} else if (k + 1 < sizeof(names) / sizeof(names[0])) {
+					transforms.Compute(levels[k], view_projection_matrix, identity, 0, object_count, nullptr, 0, mapped, sizeof(glm::mat4));
+				} else {
+					transforms.ComputeParallel(renderer->GetThreadPool(), levels[k], view_projection_matrix, identity, nullptr, 0, mapped, sizeof(glm::mat4));
+				}
+				microseconds = std::min(microseconds, elapsed_microseconds(start, benchmark_clock::now()));
+			}
+
+			//every kernel has to land on the same matrices as glm, give or take rounding
+			if (k == 0) {
+				memcpy(reference.data(), mapped, object_count * sizeof(glm::mat4));
+				baseline_microseconds = microseconds;
+			}
+			float max_error = 0.0f;
+			for (uint32_t i = 0; i < object_count; i++) {
+				for (uint32_t c = 0; c < 4; c++) {
+					for (uint32_t r = 0; r < 4; r++) {
+						max_error = std::max(max_error, std::fabs(mapped[i][c][r] - reference[i][c][r]) / (1.0f + std::fabs(reference[i][c][r])));
+					}
+				}
+			}
+
+			std::cout << "\t" << std::left << std::setw(12) << names[k] << std::right << microseconds / 1000.0 << "ms, "
+				<< object_count / microseconds << "M objects/s, " << baseline_microseconds / microseconds << "x, max relative error " << max_error << std::endl;
+		}
+	}
+
+	vkDestroyBuffer(device, buffer, VK_NULL_HANDLE);
+	renderer->GetAllocator()->Free(allocation);
+}
+
+void BenchmarkCulling(Renderer * renderer) {
+	const uint32_t object_counts[] = { 10000, 100000, 1000000 };
+	const uint32_t max_objects = 1000000;
+	const uint32_t rounds = 10;
+
+	//objects scattered through a cube around the camera's target, so most of them fall outside the frustum
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> signed_unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> size(0.25f, 2.0f);
+	std::vector<glm::vec3> centres(max_objects);
+	std::vector<glm::vec3> extents(max_objects);
+	for (uint32_t i = 0; i < max_objects; i++) {
+		centres[i] = glm::vec3(signed_unit(rng), signed_unit(rng), signed_unit(rng)) * 100.0f;
+		extents[i] = glm::vec3(size(rng), size(rng), size(rng));
+	}
+
+	Frustum frustum = FrustumCuller::ExtractFrustum(renderer->GetPipeline()->GetViewProjectionMatrix());
+	std::vector<uint32_t> visible(max_objects);
+	std::vector<uint32_t> reference(max_objects);
+
+	const char * shape_names[] = { "spheres", "boxes" };
+	const char * names[] = { "scalar", "sse2", "avx2", "parallel" };
+	const SimdLevel levels[] = { SIMD_LEVEL_SCALAR, SIMD_LEVEL_SSE2, SIMD_LEVEL_AVX2, Simd::GetLevel() };
+	for (uint32_t o = 0; o < sizeof(object_counts) / sizeof(object_counts[0]); o++) {
+		uint32_t object_count = object_counts[o];
+		FrustumCuller culler(object_count);
+
+		for (uint32_t shape = CULL_SHAPE_SPHERE; shape <= CULL_SHAPE_BOX; shape++) {
+			for (uint32_t i = 0; i < object_count; i++) {
+				if (shape == CULL_SHAPE_SPHERE) {
+					culler.SetSphere(i, centres[i], extents[i].x);
+				} else {
+					culler.SetBox(i, centres[i], extents[i]);
+				}
+			}
+			std::cout << "culling benchmark: " << object_count << " " << shape_names[shape] << ", " << renderer->GetThreadPool()->GetThreadCount() << " threads, "
+				<< Simd::GetLevelName(Simd::GetLevel()) << " available" << std::endl;
+
+			double baseline_microseconds = 0.0;
+			uint32_t reference_count = 0;
+			for (uint32_t k = 0; k < sizeof(names) / sizeof(names[0]); k++) {
+				if (levels[k] > Simd::GetLevel()) {
+					continue;
+				}
+
+				double microseconds = 1e30;
+				uint32_t visible_count = 0;
+				for (uint32_t round = 0; round < rounds; round++) {
+					benchmark_clock::time_point start = benchmark_clock::now();
+					if (k + 1 < sizeof(names) / sizeof(names[0])) {
+						visible_count = culler.Cull(levels[k], frustum, (CullShape)shape, 0, object_count, visible.data());
+					} else {
+						visible_count = culler.CullParallel(renderer->GetThreadPool(), levels[k], frustum, (CullShape)shape, visible.data());
+					}
+					microseconds = std::min(microseconds, elapsed_microseconds(start, benchmark_clock::now()));
+				}
+
+				//every level does the same arithmetic, so the visible lists have to match exactly
+				if (k == 0) {
+					memcpy(reference.data(), visible.data(), visible_count * sizeof(uint32_t));
+					reference_count = visible_count;
+					baseline_microseconds = microseconds;
+				}
+				bool matches = visible_count == reference_count && std::equal(visible.begin(), visible.begin() + visible_count, reference.begin());
+
+				std::cout << "\t" << std::left << std::setw(12) << names[k] << std::right << microseconds / 1000.0 << "ms, "
+					<< object_count / microseconds << "M objects/s, " << baseline_microseconds / microseconds << "x, "
+					<< visible_count << " visible" << (matches ? "" : " MISMATCH") << std::endl;
+			}
+		}
+	}
+}
+
+//what a material with two uniform blocks and a texture binds, written from infos[binding]
+static void write_descriptor_set(VkDevice device, VkDescriptorSet set, const VkDescriptorSetLayoutBinding * bindings, const DescriptorInfo * infos) {
+	VkWriteDescriptorSet write_descriptor_sets[3];
+	for (uint32_t b = 0; b < 3; b++) {
+		write_descriptor_sets[b] = {};
+		write_descriptor_sets[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write_descriptor_sets[b].dstSet = set;
+		write_descriptor_sets[b].dstBinding = bindings[b].binding;
+		write_descriptor_sets[b].descriptorCount = 1;
+		write_descriptor_sets[b].descriptorType = bindings[b].descriptorType;
+		if (bindings[b].descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) {
+			write_descriptor_sets[b].pImageInfo = &infos[b].image;
+		} else {
+			write_descriptor_sets[b].pBufferInfo = &infos[b].buffer;
+		}
+	}
+	vkUpdateDescriptorSets(device, 3, write_descriptor_sets, 0, VK_NULL_HANDLE);
+}
+
+void BenchmarkDescriptors(Renderer * renderer) {
+	const uint32_t sets_per_frame = 10000;
+	const uint32_t frames = 8;
+	const uint32_t persistent_count = 1000;
+	VkDevice device = renderer->GetVulkanDevice();
+	DescriptorAllocator * allocator = renderer->GetDescriptorAllocator();
+
+	VkDescriptorSetLayoutBinding bindings[3];
+	for (uint32_t b = 0; b < 3; b++) {
+		bindings[b] = {};
+		bindings[b].binding = b;
+		bindings[b].descriptorType = b < 2 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		bindings[b].descriptorCount = 1;
+		bindings[b].stageFlags = b < 2 ? VK_SHADER_STAGE_VERTEX_BIT : VK_SHADER_STAGE_FRAGMENT_BIT;
+	}
+	VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info{};
+	descriptor_set_layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	descriptor_set_layout_create_info.bindingCount = 3;
+	descriptor_set_layout_create_info.pBindings = bindings;
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	ErrorCheck(vkCreateDescriptorSetLayout(device, &descriptor_set_layout_create_info, VK_NULL_HANDLE, &layout));
+	uint32_t registered = allocator->RegisterLayout(layout, bindings, 3);
+
+	std::vector<uint32_t> pixels = noise_pixels(16 * 16);
+	Texture texture(renderer, 16, 16, VK_FORMAT_R8G8B8A8_UNORM, pixels.data(), pixels.size() * sizeof(uint32_t), false);
+	texture.Wait();
+
+	//every set points somewhere different in the uniform ring, like per draw uniforms would
+	VkDeviceSize alignment = renderer->GetVulkanPhysicalDeviceProperties().limits.minUniformBufferOffsetAlignment;
+	VkDeviceSize stride = std::max(alignment, (VkDeviceSize)sizeof(glm::mat4));
+	std::vector<DescriptorInfo> infos(sets_per_frame * 3);
+	for (uint32_t i = 0; i < sets_per_frame; i++) {
+		infos[i * 3 + 0].buffer = { renderer->GetUniformRing()->GetBuffer(), (i % 1024) * stride, sizeof(glm::mat4) };
+		infos[i * 3 + 1].buffer = { renderer->GetUniformRing()->GetBuffer(), ((i + 1) % 1024) * stride, sizeof(glm::mat4) };
+		infos[i * 3 + 2].image = {};
+		infos[i * 3 + 2].image.sampler = renderer->GetSampler();
+		infos[i * 3 + 2].image.imageView = texture.GetImageView();
+		infos[i * 3 + 2].image.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	}
+	//nothing the benchmark allocates is ever bound, but the transient chains it resets are the renderer's own
+	renderer->WaitIdle();
+
+	std::cout << "descriptor benchmark: " << sets_per_frame << " sets a frame, update templates " << (allocator->HasUpdateTemplates() ? "yes" : "no") << std::endl;
+
+	//a pool sized for exactly one set each time, the way Pipeline used to make its only one
+	{
+		std::vector<VkDescriptorPool> pools(sets_per_frame);
+		VkDescriptorPoolSize descriptor_pool_sizes[2];
+		descriptor_pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		descriptor_pool_sizes[0].descriptorCount = 2;
+		descriptor_pool_sizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptor_pool_sizes[1].descriptorCount = 1;
+		VkDescriptorPoolCreateInfo descriptor_pool_create_info{};
+		descriptor_pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		descriptor_pool_create_info.maxSets = 1;
+		descriptor_pool_create_info.poolSizeCount = 2;
+		descriptor_pool_create_info.pPoolSizes = descriptor_pool_sizes;
+
+		benchmark_clock::time_point start = benchmark_clock::now();
+		for (uint32_t i = 0; i < sets_per_frame; i++) {
+			ErrorCheck(vkCreateDescriptorPool(device, &descriptor_pool_create_info, VK_NULL_HANDLE, &pools[i]));
+			VkDescriptorSetAllocateInfo descriptor_set_allocate_info{};
+			descriptor_set_allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			descriptor_set_allocate_info.descriptorPool = pools[i];
+			descriptor_set_allocate_info.descriptorSetCount = 1;
+			descriptor_set_allocate_info.pSetLayouts = &layout;
+			VkDescriptorSet set = VK_NULL_HANDLE;
+			ErrorCheck(vkAllocateDescriptorSets(device, &descriptor_set_allocate_info, &set));
+			write_descriptor_set(device, set, bindings, &infos[i * 3]);
+		}
+		double microseconds = elapsed_microseconds(start, benchmark_clock::now());
+		for (uint32_t i = 0; i < sets_per_frame; i++) {
+			vkDestroyDescriptorPool(device, pools[i], VK_NULL_HANDLE);
+		}
+		std::cout << "\tpool per set:                " << microseconds * 1000.0 / sets_per_frame << "ns a set" << std::endl;
+	}
+
+	//the same transient allocations either side of how the sets are written; the first frames also grow the chains
+	uint32_t pools_before = allocator->GetPoolCount();
+	const char * write_names[2] = { "transient, vkUpdateDescriptorSets", allocator->HasUpdateTemplates() ? "transient, update template" : "transient, allocator writes" };
+	for (uint32_t method = 0; method < 2; method++) {
+		double microseconds = 1e30;
+		for (uint32_t frame = 0; frame < frames; frame++) {
+			benchmark_clock::time_point start = benchmark_clock::now();
+			allocator->BeginFrame(frame % renderer->GetFramesInFlight());
+			for (uint32_t i = 0; i < sets_per_frame; i++) {
+				if (method == 0) {
+					write_descriptor_set(device, allocator->AllocateTransient(registered), bindings, &infos[i * 3]);
+				} else {
+					allocator->AllocateTransient(registered, &infos[i * 3]);
+				}
+			}
+			microseconds = std::min(microseconds, elapsed_microseconds(start, benchmark_clock::now()));
+		}
+		std::cout << "\t" << write_names[method] << ": " << microseconds * 1000.0 / sets_per_frame << "ns a set, best frame" << std::endl;
+	}
+	std::cout << "\t" << allocator->GetPoolCount() - pools_before << " pools added across " << renderer->GetFramesInFlight() << " frames in flight" << std::endl;
+
+	//the first pass allocates and writes each set, the second only finds them
+	double cache_microseconds[2];
+	for (uint32_t pass = 0; pass < 2; pass++) {
+		benchmark_clock::time_point start = benchmark_clock::now();
+		for (uint32_t i = 0; i < persistent_count; i++) {
+			allocator->GetPersistent(registered, &infos[i * 3]);
+		}
+		cache_microseconds[pass] = elapsed_microseconds(start, benchmark_clock::now());
+	}
+	std::cout << "\tpersistent miss: " << cache_microseconds[0] * 1000.0 / persistent_count << "ns a set" << std::endl;
+	std::cout << "\tpersistent hit:  " << cache_microseconds[1] * 1000.0 / persistent_count << "ns a set, "
+		<< allocator->GetCachedSetCount() << " sets cached" << std::endl;
+
+	//the texture's destructor evicts every cached set that points at it, which is all of the benchmark's
+	renderer->WaitIdle();
+	allocator->UnregisterLayout(registered);
+	vkDestroyDescriptorSetLayout(device, layout, VK_NULL_HANDLE);
+}
+
+void BenchmarkCommandRecording(Renderer * renderer) {
+	const uint32_t draw_counts[] = { 10000, 100000 };
+	const uint32_t frames = 8;
+	//draws cycle through this many matrices, the ring isn't sized for 100k per frame
+	const uint32_t matrix_count = 1024;
+
+	VkDeviceSize alignment = renderer->GetVulkanPhysicalDeviceProperties().limits.minUniformBufferOffsetAlignment;
+	uint32_t stride = (uint32_t)((sizeof(glm::mat4) + alignment - 1) / alignment * alignment);
+	VkPipeline graphics_pipeline = renderer->GetGraphicsPipeline();
+	VkPipelineLayout pipeline_layout = renderer->GetPipeline()->GetPipelineLayout();
+	const VkDescriptorSet * descriptor_sets = renderer->GetPipeline()->GetDescriptorSets();
+	VkBuffer vertex_buffer = renderer->GetVertexBuffer();
+	VkBuffer index_buffer = renderer->GetIndexBuffer();
+	uint32_t index_count = renderer->GetIndexCount();
+	VkIndexType index_type = renderer->GetIndexType();
+
+	uint32_t max_threads = renderer->GetThreadPool()->GetThreadCount();
+	std::vector<uint32_t> thread_counts;
+	for (uint32_t threads = 1; threads < max_threads; threads *= 2) {
+		thread_counts.push_back(threads);
+	}
+	thread_counts.push_back(max_threads);
+
+	for (uint32_t d = 0; d < sizeof(draw_counts) / sizeof(draw_counts[0]); d++) {
+		uint32_t draw_count = draw_counts[d];
+		std::cout << "command recording benchmark: " << draw_count << " draws" << std::endl;
+		double serial_milliseconds = 0.0;
+		for (uint32_t t = 0; t < thread_counts.size(); t++) {
+			double milliseconds = 0.0;
+			for (uint32_t frame = 0; frame < frames; frame++) {
+				renderer->BeginFrame(VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+				//only the recording is timed, not the fence wait in BeginFrame or the submit
+				benchmark_clock::time_point start = benchmark_clock::now();
+				uint32_t base_offset = 0;
+				uint8_t * matrices = (uint8_t *)renderer->GetUniformRing()->Allocate(matrix_count * stride, base_offset);
+				for (uint32_t i = 0; i < matrix_count; i++) {
+					glm::mat4 model_matrix = glm::translate(glm::mat4(1.0f), glm::vec3((float)(i % 32) - 16.0f, (float)(i / 32) - 16.0f, 0.0f));
+					glm::mat4 model_view_projection_matrix = renderer->GetPipeline()->GetViewProjectionMatrix() * model_matrix * renderer->GetDequantizationMatrix();
+					memcpy(matrices + i * stride, &model_view_projection_matrix, sizeof(model_view_projection_matrix));
+				}
+				renderer->RecordParallel(draw_count, [&](VkCommandBuffer command_buffer, uint32_t first, uint32_t count) {
+					const VkDeviceSize device_size_offsets[1] = { 0 };
+					vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline);
+					vkCmdBindVertexBuffers(command_buffer, 0, 1, &vertex_buffer, device_size_offsets);
+					vkCmdBindIndexBuffer(command_buffer, index_buffer, 0, index_type);
+					for (uint32_t i = first; i < first + count; i++) {
+						uint32_t dynamic_offset = base_offset + (i % matrix_count) * stride;
+						vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, NUM_DESCRIPTOR_SETS, descriptor_sets, 1, &dynamic_offset);
+						vkCmdDrawIndexed(command_buffer, index_count, 1, 0, 0, 0);
+					}
+				}, thread_counts[t]);
+				milliseconds += elapsed_microseconds(start, benchmark_clock::now()) / 1000.0;
+
+				renderer->EndFrame();
+			}
+			milliseconds /= frames;
+			if (t == 0) {
+				serial_milliseconds = milliseconds;
+			}
+			std::cout << "\t" << thread_counts[t] << " threads: " << milliseconds << "ms per frame, " << serial_milliseconds / milliseconds << "x" << std::endl;
+		}
+	}
+	renderer->WaitIdle();
+}
+
+void BenchmarkInstancing(Renderer * renderer) {
+	const uint32_t object_counts[] = { 1000, 10000 };
+	const uint32_t frames = 16;
+
+	VkDeviceSize alignment = renderer->GetVulkanPhysicalDeviceProperties().limits.minUniformBufferOffsetAlignment;
+	uint32_t stride = (uint32_t)((sizeof(glm::mat4) + alignment - 1) / alignment * alignment);
+	VkPipeline graphics_pipeline = renderer->GetGraphicsPipeline();
+	VkPipelineLayout pipeline_layout = renderer->GetPipeline()->GetPipelineLayout();
+	const VkDescriptorSet * descriptor_sets = renderer->GetPipeline()->GetDescriptorSets();
+	VkBuffer vertex_buffer = renderer->GetVertexBuffer();
+	VkBuffer index_buffer = renderer->GetIndexBuffer();
+	uint32_t index_count = renderer->GetIndexCount();
+	VkIndexType index_type = renderer->GetIndexType();
+	const glm::mat4 & view_projection_matrix = renderer->GetPipeline()->GetViewProjectionMatrix();
+	//DrawInstanced folds it into every instance, so the per-object path pays for the same multiply
+	const glm::mat4 & dequantization_matrix = renderer->GetDequantizationMatrix();
+
+	for (uint32_t o = 0; o < sizeof(object_counts) / sizeof(object_counts[0]); o++) {
+		uint32_t object_count = object_counts[o];
+		uint32_t side = (uint32_t)std::ceil(std::sqrt((double)object_count));
+		std::vector<glm::mat4> model_matrices(object_count);
+		for (uint32_t i = 0; i < object_count; i++) {
+			glm::vec3 position(((float)(i % side) / side - 0.5f) * 8.0f, ((float)(i / side) / side - 0.5f) * 8.0f, 0.0f);
+			model_matrices[i] = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(4.0f / side));
+		}
+
+		std::cout << "instancing benchmark: " << object_count << " objects" << std::endl;
+		double baseline_rate = 0.0;
+		for (uint32_t instanced = 0; instanced < 2; instanced++) {
+			renderer->WaitIdle();
+
+			//recording is timed on its own, the whole loop including the gpu gives the draw rate
+			double record_milliseconds = 0.0;
+			benchmark_clock::time_point start = benchmark_clock::now();
+			for (uint32_t frame = 0; frame < frames; frame++) {
+				VkCommandBuffer command_buffer = renderer->BeginFrame();
+
+				benchmark_clock::time_point record_start = benchmark_clock::now();
+				if (instanced) {
+					renderer->DrawInstanced(command_buffer, model_matrices.data(), object_count);
+				} else {
+					const VkDeviceSize device_size_offsets[1] = { 0 };
+					uint32_t base_offset = 0;
+					uint8_t * matrices = (uint8_t *)renderer->GetUniformRing()->Allocate(object_count * stride, base_offset);
+					vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline);
+					vkCmdBindVertexBuffers(command_buffer, 0, 1, &vertex_buffer, device_size_offsets);
+					vkCmdBindIndexBuffer(command_buffer, index_buffer, 0, index_type);
+					for (uint32_t i = 0; i < object_count; i++) {
+						glm::mat4 model_view_projection_matrix = view_projection_matrix * (model_matrices[i] * dequantization_matrix);
+						memcpy(matrices + i * stride, &model_view_projection_matrix, sizeof(model_view_projection_matrix));
+						uint32_t dynamic_offset = base_offset + i * stride;
+						vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, NUM_DESCRIPTOR_SETS, descriptor_sets, 1, &dynamic_offset);
+						vkCmdDrawIndexed(command_buffer, index_count, 1, 0, 0, 0);
+					}
+				}
+				record_milliseconds += elapsed_microseconds(record_start, benchmark_clock::now()) / 1000.0;
+
+				renderer->EndFrame();
+			}
+			renderer->WaitIdle();
+			double seconds = elapsed_microseconds(start, benchmark_clock::now()) / 1000000.0;
+
+			double rate = (double)object_count * frames / seconds;
+			if (!instanced) {
+				baseline_rate = rate;
+			}
+			std::cout << "\t" << (instanced ? "one instanced draw:  " : "one draw per object: ") << record_milliseconds / frames << "ms recording per frame, "
+				<< rate / 1000000.0 << "M objects/s, " << rate / baseline_rate << "x" << std::endl;
+		}
+	}
+}
+
+void BenchmarkTextureSampling(Renderer * renderer) {
+	const uint32_t texture_size = 2048;
+	const uint32_t object_count = 2500;
+	const uint32_t frames = 16;
+
+	std::vector<uint32_t> pixels = noise_pixels(texture_size * texture_size);
+	Texture mipmapped(renderer, texture_size, texture_size, VK_FORMAT_R8G8B8A8_UNORM, pixels.data(), pixels.size() * sizeof(uint32_t));
+	Texture base_level(renderer, texture_size, texture_size, VK_FORMAT_R8G8B8A8_UNORM, pixels.data(), pixels.size() * sizeof(uint32_t), false);
+	mipmapped.Wait();
+	base_level.Wait();
+
+	//each cube covers a few dozen pixels, so every fragment steps over many texels of level 0 and only the chain keeps
+	//the footprint, and the cache misses, small
+	uint32_t side = (uint32_t)std::ceil(std::sqrt((double)object_count));
+	std::vector<glm::mat4> model_matrices(object_count);
+	for (uint32_t i = 0; i < object_count; i++) {
+		glm::vec3 position(((float)(i % side) / side - 0.5f) * 8.0f, ((float)(i / side) / side - 0.5f) * 8.0f, 0.0f);
+		model_matrices[i] = glm::rotate(glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(2.0f / side)), (float)i, glm::vec3(0.3f, 1.0f, 0.0f));
+	}
+
+	const Texture * textures[2] = { &base_level, &mipmapped };
+	const char * scopes[2] = { "textured base level", "textured mipmapped" };
+	std::cout << "texture sampling benchmark: " << object_count << " cubes, " << texture_size << "x" << texture_size << " rgba8 noise" << std::endl;
+	for (uint32_t t = 0; t < 2; t++) {
+		renderer->WaitIdle();
+		renderer->SetTexture(textures[t]);
+		for (uint32_t frame = 0; frame < frames; frame++) {
+			VkCommandBuffer command_buffer = renderer->BeginFrame();
+			{
+				GpuProfiler::Scope scope(renderer->GetGpuProfiler(), command_buffer, scopes[t]);
+				for (uint32_t i = 0; i < object_count; i++) {
+					renderer->DrawTextured(command_buffer, model_matrices[i]);
+				}
+			}
+			renderer->EndFrame();
+		}
+		renderer->WaitIdle();
+
+		GpuScopeStats stats{};
+		if (renderer->GetGpuProfiler()->GetStats(scopes[t], stats)) {
+			std::cout << "	" << scopes[t] << ": " << stats.average_milliseconds << "ms on the gpu, p99 " << stats.p99_milliseconds << "ms" << std::endl;
+		} else {
+			std::cout << "	" << scopes[t] << ": no gpu timestamps on this device" << std::endl;
+		}
+	}
+	renderer->SetTexture(nullptr);
+}
+
+void BenchmarkBindless(Renderer * renderer) {
+	const uint32_t texture_count = 64;
+	const uint32_t texture_size = 16;
+	const uint32_t object_count = 10000;
+	const uint32_t frames = 16;
+
+	std::vector<Texture *> textures(texture_count);
+	for (uint32_t t = 0; t < texture_count; t++) {
+		std::vector<uint32_t> pixels = noise_pixels(texture_size * texture_size);
+		textures[t] = new Texture(renderer, texture_size, texture_size, VK_FORMAT_R8G8B8A8_UNORM, pixels.data(), pixels.size() * sizeof(uint32_t), false);
+	}
+	for (uint32_t t = 0; t < texture_count; t++) {
+		textures[t]->Wait();
+	}
+
+	//every draw changes texture, the worst case for a set per draw
+	uint32_t side = (uint32_t)std::ceil(std::sqrt((double)object_count));
+	std::vector<glm::mat4> model_matrices(object_count);
+	std::vector<const Texture *> draw_textures(object_count);
+	for (uint32_t i = 0; i < object_count; i++) {
+		glm::vec3 position(((float)(i % side) / side - 0.5f) * 8.0f, ((float)(i / side) / side - 0.5f) * 8.0f, 0.0f);
+		model_matrices[i] = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(2.0f / side));
+		draw_textures[i] = textures[i % texture_count];
+	}
+
+	std::cout << "bindless benchmark: " << object_count << " cubes, " << texture_count << " textures, descriptor indexing "
+		<< (renderer->GetPipeline()->IsBindless() ? "yes" : "no") << std::endl;
+	const char * scopes[2] = { "textured set per draw", "textured bindless" };
+	for (uint32_t bindless = 0; bindless < 2; bindless++) {
+		if (bindless && !renderer->GetPipeline()->IsBindless()) {
+			break;
+		}
+		renderer->WaitIdle();
+		double microseconds = 1e30;
+		for (uint32_t frame = 0; frame < frames; frame++) {
+			VkCommandBuffer command_buffer = renderer->BeginFrame();
+			{
+				GpuProfiler::Scope scope(renderer->GetGpuProfiler(), command_buffer, scopes[bindless]);
+				benchmark_clock::time_point start = benchmark_clock::now();
+				renderer->DrawTexturedBatch(command_buffer, model_matrices.data(), draw_textures.data(), object_count, bindless != 0);
+				microseconds = std::min(microseconds, elapsed_microseconds(start, benchmark_clock::now()));
+			}
+			renderer->EndFrame();
+		}
+		renderer->WaitIdle();
+
+		std::cout << "\t" << scopes[bindless] << ": " << microseconds / 1000.0 << "ms to record";
+		GpuScopeStats stats{};
+		if (renderer->GetGpuProfiler()->GetStats(scopes[bindless], stats)) {
+			std::cout << ", " << stats.average_milliseconds << "ms on the gpu" << std::endl;
+		} else {
+			std::cout << ", no gpu timestamps on this device" << std::endl;
+		}
+	}
+
+	for (uint32_t t = 0; t < texture_count; t++) {
+		delete textures[t];
+	}
+}
+
+void BenchmarkPushConstants(Renderer * renderer) {
+	const uint32_t draw_count = 100000;
+	const uint32_t material_count = 4;
+
+	VkDeviceSize alignment = renderer->GetVulkanPhysicalDeviceProperties().limits.minUniformBufferOffsetAlignment;
+	uint32_t stride = (uint32_t)((sizeof(glm::mat4) + alignment - 1) / alignment * alignment);
+	//the ring can't hold a matrix per draw for all of them in one frame, so both paths spread the draws over as many
+	//frames as it takes with each frame using at most half the ring
+	uint32_t draws_per_frame = std::min(draw_count, (uint32_t)(renderer->GetUniformRing()->GetSize() / stride / 2));
+	uint32_t frames = (draw_count + draws_per_frame - 1) / draws_per_frame;
+	//whatever doesn't divide evenly goes first, while there are frames after it to read its timestamps back
+	uint32_t first_frame_draws = draw_count - (frames - 1) * draws_per_frame;
+	bool short_first_frame = first_frame_draws < draws_per_frame;
+	VkPipeline graphics_pipeline = renderer->GetGraphicsPipeline();
+	VkPipelineLayout pipeline_layout = renderer->GetPipeline()->GetPipelineLayout();
+	const VkDescriptorSet * descriptor_sets = renderer->GetPipeline()->GetDescriptorSets();
+	VkBuffer vertex_buffer = renderer->GetVertexBuffer();
+	VkBuffer index_buffer = renderer->GetIndexBuffer();
+	uint32_t index_count = renderer->GetIndexCount();
+	VkIndexType index_type = renderer->GetIndexType();
+	const glm::mat4 & view_projection_matrix = renderer->GetPipeline()->GetViewProjectionMatrix();
+	const glm::mat4 & dequantization_matrix = renderer->GetDequantizationMatrix();
+
+	uint32_t side = (uint32_t)std::ceil(std::sqrt((double)draw_count));
+	std::vector<glm::mat4> model_matrices(draw_count);
+	std::vector<uint32_t> materials(draw_count);
+	for (uint32_t i = 0; i < draw_count; i++) {
+		glm::vec3 position(((float)(i % side) / side - 0.5f) * 8.0f, ((float)(i / side) / side - 0.5f) * 8.0f, 0.0f);
+		model_matrices[i] = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(4.0f / side));
+		materials[i] = i % material_count;
+	}
+
+	std::cout << "push constant benchmark: " << draw_count << " draws over " << frames << " frames, " << renderer->GetPipeline()->GetPushConstantSize()
+		<< " bytes of push constants, " << sizeof(DrawConstants) << " pushed per draw" << std::endl;
+	//the short frame is timed under a name of its own so the full frames' average stays the cost of a full frame
+	const char * scopes[2] = { "dynamic uniform per draw", "push constants per draw" };
+	const char * short_scopes[2] = { "dynamic uniform per draw, short frame", "push constants per draw, short frame" };
+	for (uint32_t push = 0; push < 2; push++) {
+		renderer->WaitIdle();
+
+		double record_milliseconds = 0.0;
+		for (uint32_t frame = 0; frame < frames; frame++) {
+			uint32_t first = frame == 0 ? 0 : first_frame_draws + (frame - 1) * draws_per_frame;
+			uint32_t count = frame == 0 ? first_frame_draws : draws_per_frame;
+			VkCommandBuffer command_buffer = renderer->BeginFrame();
+			{
+				GpuProfiler::Scope scope(renderer->GetGpuProfiler(), command_buffer, count < draws_per_frame ? short_scopes[push] : scopes[push]);
+				benchmark_clock::time_point start = benchmark_clock::now();
+				if (push) {
+					renderer->DrawPushConstants(command_buffer, model_matrices.data() + first, materials.data() + first, count);
+				} else {
+					const VkDeviceSize device_size_offsets[1] = { 0 };
+					uint32_t base_offset = 0;
+					uint8_t * matrices = (uint8_t *)renderer->GetUniformRing()->Allocate(count * stride, base_offset);
+					vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline);
+					vkCmdBindVertexBuffers(command_buffer, 0, 1, &vertex_buffer, device_size_offsets);
+					vkCmdBindIndexBuffer(command_buffer, index_buffer, 0, index_type);
+					for (uint32_t i = 0; i < count; i++) {
+						glm::mat4 model_view_projection_matrix = view_projection_matrix * model_matrices[first + i] * dequantization_matrix;
+						memcpy(matrices + i * stride, &model_view_projection_matrix, sizeof(model_view_projection_matrix));
+						uint32_t dynamic_offset = base_offset + i * stride;
+						vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, NUM_DESCRIPTOR_SETS, descriptor_sets, 1, &dynamic_offset);
+						vkCmdDrawIndexed(command_buffer, index_count, 1, 0, 0, 0);
+					}
+				}
+				record_milliseconds += elapsed_microseconds(start, benchmark_clock::now()) / 1000.0;
+			}
+			renderer->EndFrame();
+		}
+		renderer->WaitIdle();
+
+		//the scopes average over frames, so they're scaled back up to all of the draws
+		std::cout << "\t" << scopes[push] << ": " << record_milliseconds << "ms to record";
+		GpuScopeStats stats{};
+		GpuScopeStats short_stats{};
+		if (renderer->GetGpuProfiler()->GetStats(scopes[push], stats) && (!short_first_frame || renderer->GetGpuProfiler()->GetStats(short_scopes[push], short_stats))) {
+			double gpu_milliseconds = stats.average_milliseconds * (frames - (short_first_frame ? 1 : 0)) + short_stats.average_milliseconds;
+			std::cout << ", " << gpu_milliseconds << "ms on the gpu, " << gpu_milliseconds * 1000000.0 / draw_count << "ns a draw" << std::endl;
+		} else {
+			std::cout << ", no gpu timestamps on this device" << std::endl;
+		}
+	}
+}
+
+//orders matrices by their bits, so two lists of them can be compared as sets
+static bool matrix_bits_less(const glm::mat4 & a, const glm::mat4 & b) {
+	return memcmp(&a, &b, sizeof(glm::mat4)) < 0;
+}
+
+void BenchmarkGpuCulling(Renderer * renderer) {
+	const uint32_t object_counts[] = { 10000, 100000, 1000000 };
+	const uint32_t max_objects = 1000000;
+	const uint32_t frames = 16;
+	uint32_t frames_in_flight = renderer->GetFramesInFlight();
+
+	//the same scattering as the cpu culling benchmark, with the mesh's unit cube scaled to each object's size
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> signed_unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> size(0.25f, 2.0f);
+	std::vector<glm::mat4> model_matrices(max_objects);
+	std::vector<glm::vec4> spheres(max_objects);
+	for (uint32_t i = 0; i < max_objects; i++) {
+		glm::vec3 centre = glm::vec3(signed_unit(rng), signed_unit(rng), signed_unit(rng)) * 100.0f;
+		float half_size = size(rng);
+		model_matrices[i] = glm::scale(glm::translate(glm::mat4(1.0f), centre), glm::vec3(half_size));
+		spheres[i] = glm::vec4(centre, half_size * std::sqrt(3.0f));
+	}
+
+	Frustum frustum = FrustumCuller::ExtractFrustum(renderer->GetPipeline()->GetViewProjectionMatrix());
+	const glm::mat4 & dequantization_matrix = renderer->GetDequantizationMatrix();
+	GpuCuller gpu_culler(renderer, max_objects);
+	std::vector<uint32_t> visible(max_objects);
+
+	for (uint32_t o = 0; o < sizeof(object_counts) / sizeof(object_counts[0]); o++) {
+		uint32_t object_count = object_counts[o];
+		FrustumCuller culler(object_count);
+		for (uint32_t i = 0; i < object_count; i++) {
+			culler.SetSphere(i, glm::vec3(spheres[i]), spheres[i].w);
+		}
+		renderer->WaitIdle();
+		renderer->GetUploader()->Wait(gpu_culler.SetObjects(model_matrices.data(), spheres.data(), object_count));
+
+		std::cout << "gpu culling benchmark: " << object_count << " objects, "
+			<< (renderer->HasDrawIndirectCount() ? "indirect count draws" : "one indirect instanced draw") << std::endl;
+
+		//the cpu path culls on the pool and gathers the survivors into the instance ring; the gpu path only records a dispatch and a draw
+		uint32_t cpu_visible_count = 0;
+		double cpu_milliseconds = 0.0;
+		for (uint32_t frame = 0; frame < frames; frame++) {
+			VkCommandBuffer command_buffer = renderer->BeginFrame();
+			benchmark_clock::time_point start = benchmark_clock::now();
+			cpu_visible_count = culler.CullParallel(renderer->GetThreadPool(), Simd::GetLevel(), frustum, CULL_SHAPE_SPHERE, visible.data());
+			renderer->DrawInstanced(command_buffer, model_matrices.data(), visible.data(), cpu_visible_count);
+			cpu_milliseconds += elapsed_microseconds(start, benchmark_clock::now()) / 1000.0;
+			renderer->EndFrame();
+		}
+
+		double gpu_record_milliseconds = 0.0;
+		uint32_t last_frame_index = 0;
+		for (uint32_t frame = 0; frame < frames; frame++) {
+			benchmark_clock::time_point start;
+			last_frame_index = renderer->GetFrameIndex();
+			VkCommandBuffer command_buffer = renderer->BeginFrame(VK_SUBPASS_CONTENTS_INLINE, [&](VkCommandBuffer cull_command_buffer) {
+				start = benchmark_clock::now();
+				GpuProfiler::Scope scope(renderer->GetGpuProfiler(), cull_command_buffer, "gpu cull");
+				gpu_culler.Cull(cull_command_buffer, frustum);
+			});
+			gpu_culler.Draw(command_buffer);
+			gpu_record_milliseconds += elapsed_microseconds(start, benchmark_clock::now()) / 1000.0;
+			renderer->EndFrame();
+		}
+		renderer->WaitIdle();
+
+		GpuScopeStats stats{};
+		bool timed = renderer->GetGpuProfiler()->GetStats("gpu cull", stats);
+		std::cout << "	cpu cull and gather: " << cpu_milliseconds / frames << "ms per frame" << std::endl;
+		std::cout << "	gpu cull recording:  " << gpu_record_milliseconds / frames << "ms per frame";
+		if (timed) {
+			std::cout << ", " << stats.average_milliseconds << "ms on the gpu";
+		}
+		std::cout << std::endl;
+
+		//the gpu copies the matrices it was given, so a visible object's matrix comes back bit for bit. the shader
+		//makes the cpu's test in the cpu's order without contraction, so spheres touching a plane go the same way on both
+		std::vector<glm::mat4> gpu_visible;
+		if (!gpu_culler.ReadBack(last_frame_index % frames_in_flight, gpu_visible)) {
+			std::cout << "	validation skipped, the cull output isn't host visible" << std::endl;
+			continue;
+		}
+		std::vector<glm::mat4> cpu_visible(cpu_visible_count);
+		for (uint32_t i = 0; i < cpu_visible_count; i++) {
+			cpu_visible[i] = model_matrices[visible[i]] * dequantization_matrix;
+		}
+		std::sort(gpu_visible.begin(), gpu_visible.end(), matrix_bits_less);
+		std::sort(cpu_visible.begin(), cpu_visible.end(), matrix_bits_less);
+		std::vector<glm::mat4> differences;
+		std::set_symmetric_difference(gpu_visible.begin(), gpu_visible.end(), cpu_visible.begin(), cpu_visible.end(), std::back_inserter(differences), matrix_bits_less);
+		std::cout << "	validation: " << gpu_visible.size() << " visible on the gpu, " << cpu_visible_count << " on the cpu, " << differences.size() << " differ" << std::endl;
+	}
+}
+
+static void print_distribution(const char * name, std::vector<double> samples) {
+	if (samples.empty()) {
+		return;
+	}
+	std::sort(samples.begin(), samples.end());
+	size_t p90 = std::min(samples.size() - 1, samples.size() * 9 / 10);
+	std::cout << "\t" << std::left << std::setw(30) << name << std::right << std::fixed << std::setprecision(3)
+		<< " min " << std::setw(9) << samples.front()
+		<< " median " << std::setw(9) << samples[samples.size() / 2]
+		<< " p90 " << std::setw(9) << samples[p90]
+		<< " max " << std::setw(9) << samples.back() << " ms" << std::endl;
+	std::cout.unsetf(std::ios_base::floatfield);
+	std::cout << std::setprecision(6);
+}
+
+void BenchmarkStartup(uint32_t cycles) {
+	//phases are matched up by position; every cycle runs the same ones in the same order
+	std::vector<const char *> names;
+	std::vector<std::vector<double>> phases;
+	std::vector<double> totals(cycles);
+	std::vector<double> teardowns(cycles);
+
+	for (uint32_t cycle = 0; cycle < cycles; cycle++) {
+		benchmark_clock::time_point start = benchmark_clock::now();
+		Renderer * renderer = new Renderer(BUILD_OPTIONS_FRAMES_IN_FLIGHT, true);
+		renderer->CreateHeadlessTarget(512, 512);
+		benchmark_clock::time_point middle = benchmark_clock::now();
+		const std::vector<StartupPhase> & startup_phases = renderer->GetStartupPhases();
+		if (cycle == 0) {
+			for (uint32_t i = 0; i < startup_phases.size(); i++) {
+				names.push_back(startup_phases[i].name);
+			}
+			phases.resize(names.size(), std::vector<double>(cycles));
+		}
+		for (uint32_t i = 0; i < names.size(); i++) {
+			phases[i][cycle] = startup_phases[i].milliseconds;
+		}
+		delete renderer;
+		benchmark_clock::time_point end = benchmark_clock::now();
+		totals[cycle] = elapsed_microseconds(start, middle) / 1000.0;
+		teardowns[cycle] = elapsed_microseconds(middle, end) / 1000.0;
+	}
+
+	//the first cycle fills the shader and pipeline caches, the rest start warm
+	std::cout << "startup benchmark: " << cycles << " init/teardown cycles (first one cold)" << std::endl;
+	for (uint32_t i = 0; i < names.size(); i++) {
+		print_distribution(names[i], phases[i]);
+	}
+	print_distribution("total startup", totals);
+	print_distribution("teardown", teardowns);
+}
\ No newline at end of file
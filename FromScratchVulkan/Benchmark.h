@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+
+class Renderer;
+
+//microbenchmarks, run instead of the window loop when BUILD_OPTIONS_BENCHMARK is set
+void RunBenchmarks();
+
+//creates and destroys a headless renderer cycles times and reports each startup phase
+void BenchmarkStartup(uint32_t cycles = 20);
+
+void BenchmarkAllocator(Renderer * renderer);
+void BenchmarkUploader(Renderer * renderer);
+//a few hundred MB mesh file mapped and handed to the uploader, against just reading the same bytes
+void BenchmarkMeshLoading(Renderer * renderer);
+//level 0 upload plus mip chain generation against the upload alone, per size and format
+void BenchmarkTextures(Renderer * renderer);
+//bc decoding at each simd level, then a bc1 ktx2 file loaded against the same texture as rgba8 with generated mips
+void BenchmarkCompressedTextures(Renderer * renderer);
+void BenchmarkShaderCache();
+void BenchmarkShaderCompiler();
+//bytes per vertex and encode throughput of the packed layouts against plain floats
+void BenchmarkVertexFormats();
+//glm one object at a time against the structure of arrays kernels, writing into mapped gpu memory
+void BenchmarkTransforms(Renderer * renderer);
+//the frustum test over spheres and boxes at each simd level, single threaded and on the pool
+void BenchmarkCulling(Renderer * renderer);
+//allocating and writing a set through the descriptor allocator against a pool per set, and cache hits against misses
+void BenchmarkDescriptors(Renderer * renderer);
+void BenchmarkCommandRecording(Renderer * renderer);
+//one draw per object against a single instanced draw of the same objects
+void BenchmarkInstancing(Renderer * renderer);
+//gpu time of many minified textured cubes sampling a full mip chain against sampling only the base level
+void BenchmarkTextureSampling(Renderer * renderer);
+//recording and drawing cubes that each change texture, with a set bound per draw against the bindless set
+void BenchmarkBindless(Renderer * renderer);
+//100k draws with the mvp in the uniform ring behind a dynamic offset against pushed as constants
+void BenchmarkPushConstants(Renderer * renderer);
+//compute culling into indirect draws against culling on the cpu and gathering the survivors, checked against each other
+void BenchmarkGpuCulling(Renderer * renderer);
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include "BlockCompression.h"
+#include "Simd.h"
+#include <string.h>
+
+enum BlockFormat {
+	//the fourth colour of a three colour block is opaque black
+	BLOCK_FORMAT_BC1 = 0,
+	//the fourth colour of a three colour block is transparent black
+	BLOCK_FORMAT_BC1_ALPHA = 1,
+	//always four colours, alpha from its own block
+	BLOCK_FORMAT_BC3 = 2
+};
+
+uint32_t BlockCompression::GetBlockCount(uint32_t width, uint32_t height) {
+	return ((width + BLOCK_COMPRESSION_BLOCK_SIZE - 1) / BLOCK_COMPRESSION_BLOCK_SIZE) * ((height + BLOCK_COMPRESSION_BLOCK_SIZE - 1) / BLOCK_COMPRESSION_BLOCK_SIZE);
+}
+
+static uint32_t read_uint32(const uint8_t * bytes) {
+	return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+//r, g and b of a 565 endpoint widened to 8 bits by repeating their top bits
+static void expand_565(uint16_t colour, uint32_t rgb[3]) {
+	uint32_t r = (colour >> 11) & 31;
+	uint32_t g = (colour >> 5) & 63;
+	uint32_t b = colour & 31;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+static uint32_t pack_rgba(uint32_t r, uint32_t g, uint32_t b, uint32_t a) {
+	return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+static bool is_three_colour(const uint8_t * colour, BlockFormat format) {
+	uint16_t c0 = (uint16_t)(colour[0] | (colour[1] << 8));
+	uint16_t c1 = (uint16_t)(colour[2] | (colour[3] << 8));
+	return format != BLOCK_FORMAT_BC3 && c0 <= c1;
+}
+
+static void alpha_palette(const uint8_t * block, uint32_t alpha[8]) {
+	uint32_t a0 = block[0];
+	uint32_t a1 = block[1];
+	alpha[0] = a0;
+	alpha[1] = a1;
+	if (a0 > a1) {
+		for (uint32_t i = 1; i <= 6; i++) {
+			alpha[1 + i] = ((7 - i) * a0 + i * a1 + 3) / 7;
+		}
+	} else {
+		for (uint32_t i = 1; i <= 4; i++) {
+			alpha[1 + i] = ((5 - i) * a0 + i * a1 + 2) / 5;
+		}
+		alpha[6] = 0;
+		alpha[7] = 255;
+	}
+}
+
+//the 16 alpha values of a bc3 block, from its 48 bits of 3 bit indices
+static void decode_alpha(const uint8_t * block, uint8_t texels[16]) {
+	uint32_t alpha[8];
+	alpha_palette(block, alpha);
+	uint64_t bits = 0;
+	for (uint32_t i = 0; i < 6; i++) {
+		bits |= (uint64_t)block[2 + i] << (8 * i);
+	}
+	for (uint32_t i = 0; i < 16; i++) {
+		texels[i] = (uint8_t)alpha[(bits >> (3 * i)) & 7];
+	}
+}
+
+//copies the part of a decoded block that lies inside the image
+static void write_block(const uint32_t texels[16], uint32_t block_x, uint32_t block_y, uint32_t width, uint32_t height, uint8_t * out) {
+	uint32_t x = block_x * BLOCK_COMPRESSION_BLOCK_SIZE;
+	uint32_t y = block_y * BLOCK_COMPRESSION_BLOCK_SIZE;
+	uint32_t columns = width - x < BLOCK_COMPRESSION_BLOCK_SIZE ? width - x : BLOCK_COMPRESSION_BLOCK_SIZE;
+	uint32_t rows = height - y < BLOCK_COMPRESSION_BLOCK_SIZE ? height - y : BLOCK_COMPRESSION_BLOCK_SIZE;
+	for (uint32_t row = 0; row < rows; row++) {
+		memcpy(out + ((size_t)(y + row) * width + x) * 4, texels + row * BLOCK_COMPRESSION_BLOCK_SIZE, columns * 4);
+	}
+}
+
+static void decode_block_scalar(const uint8_t * block, BlockFormat format, uint32_t texels[16]) {
+	const uint8_t * colour = format == BLOCK_FORMAT_BC3 ? block + 8 : block;
+	uint32_t e0[3];
+	uint32_t e1[3];
+	expand_565((uint16_t)(colour[0] | (colour[1] << 8)), e0);
+	expand_565((uint16_t)(colour[2] | (colour[3] << 8)), e1);
+
+	uint32_t palette[4];
+	palette[0] = pack_rgba(e0[0], e0[1], e0[2], 255);
+	palette[1] = pack_rgba(e1[0], e1[1], e1[2], 255);
+	if (!is_three_colour(colour, format)) {
+		palette[2] = pack_rgba((2 * e0[0] + e1[0] + 1) / 3, (2 * e0[1] + e1[1] + 1) / 3, (2 * e0[2] + e1[2] + 1) / 3, 255);
+		palette[3] = pack_rgba((e0[0] + 2 * e1[0] + 1) / 3, (e0[1] + 2 * e1[1] + 1) / 3, (e0[2] + 2 * e1[2] + 1) / 3, 255);
+	} else {
+		palette[2] = pack_rgba((e0[0] + e1[0] + 1) / 2, (e0[1] + e1[1] + 1) / 2, (e0[2] + e1[2] + 1) / 2, 255);
+		palette[3] = format == BLOCK_FORMAT_BC1_ALPHA ? 0 : pack_rgba(0, 0, 0, 255);
+	}
+
+	uint32_t indices = read_uint32(colour + 4);
+	for (uint32_t i = 0; i < 16; i++) {
+		texels[i] = palette[(indices >> (2 * i)) & 3];
+	}
+
+	if (format == BLOCK_FORMAT_BC3) {
+		uint8_t alpha[16];
+		decode_alpha(block, alpha);
+		for (uint32_t i = 0; i < 16; i++) {
+			texels[i] = (texels[i] & 0x00ffffffu) | ((uint32_t)alpha[i] << 24);
+		}
+	}
+}
+
+static void decode_scalar(const uint8_t * blocks, uint32_t width, uint32_t height, BlockFormat format, uint8_t * out) {
+	uint32_t blocks_x = (width + BLOCK_COMPRESSION_BLOCK_SIZE - 1) / BLOCK_COMPRESSION_BLOCK_SIZE;
+	uint32_t blocks_y = (height + BLOCK_COMPRESSION_BLOCK_SIZE - 1) / BLOCK_COMPRESSION_BLOCK_SIZE;
+	uint32_t block_bytes = format == BLOCK_FORMAT_BC3 ? BLOCK_COMPRESSION_BC3_BLOCK_BYTES : BLOCK_COMPRESSION_BC1_BLOCK_BYTES;
+	for (uint32_t block_y = 0; block_y < blocks_y; block_y++) {
+		for (uint32_t block_x = 0; block_x < blocks_x; block_x++) {
+			uint32_t texels[16];
+			decode_block_scalar(blocks + ((size_t)block_y * blocks_x + block_x) * block_bytes, format, texels);
+			write_block(texels, block_x, block_y, width, height, out);
+		}
+	}
+}
+
+#if SIMD_SSE2
+
+//the four colours of a block as rgba8 in the four lanes, alpha left at 0 for bc3. the two interpolated colours
+//are worked out for all three channels at once in 16 bit lanes; the divide by 3 is a multiply by 65536 / 3,
+//exact for every sum the endpoints can make
+static __m128i colour_palette_sse2(const uint8_t * colour, BlockFormat format) {
+	uint32_t e0[3];
+	uint32_t e1[3];
+	expand_565((uint16_t)(colour[0] | (colour[1] << 8)), e0);
+	expand_565((uint16_t)(colour[2] | (colour[3] << 8)), e1);
+	__m128i endpoints = _mm_setr_epi16((short)e0[0], (short)e0[1], (short)e0[2], 0, (short)e1[0], (short)e1[1], (short)e1[2], 0);
+	__m128i swapped = _mm_shuffle_epi32(endpoints, _MM_SHUFFLE(1, 0, 3, 2));
+
+	bool three_colour = is_three_colour(colour, format);
+	__m128i interpolated;
+	if (!three_colour) {
+		__m128i sums = _mm_add_epi16(_mm_add_epi16(_mm_add_epi16(endpoints, endpoints), swapped), _mm_set1_epi16(1));
+		interpolated = _mm_mulhi_epu16(sums, _mm_set1_epi16(21846));
+	} else {
+		//the midpoint, and black in the upper half
+		interpolated = _mm_move_epi64(_mm_avg_epu16(endpoints, swapped));
+	}
+	__m128i palette = _mm_packus_epi16(endpoints, interpolated);
+
+	if (format == BLOCK_FORMAT_BC3) {
+		return palette;
+	}
+	__m128i alpha = three_colour && format == BLOCK_FORMAT_BC1_ALPHA ? _mm_setr_epi32((int)0xff000000u, (int)0xff000000u, (int)0xff000000u, 0) : _mm_set1_epi32((int)0xff000000u);
+	return _mm_or_si128(palette, alpha);
+}
+
+//rows of four texels are picked from the palette by comparing each lane's 2 bit index against every value it can have
+static void decode_block_sse2(const uint8_t * block, BlockFormat format, uint8_t * out, size_t row_pitch) {
+	const uint8_t * colour = format == BLOCK_FORMAT_BC3 ? block + 8 : block;
+	__m128i palette = colour_palette_sse2(colour, format);
+	__m128i p0 = _mm_shuffle_epi32(palette, _MM_SHUFFLE(0, 0, 0, 0));
+	__m128i p1 = _mm_shuffle_epi32(palette, _MM_SHUFFLE(1, 1, 1, 1));
+	__m128i p2 = _mm_shuffle_epi32(palette, _MM_SHUFFLE(2, 2, 2, 2));
+	__m128i p3 = _mm_shuffle_epi32(palette, _MM_SHUFFLE(3, 3, 3, 3));
+
+	const __m128i lane_ones = _mm_setr_epi32(1, 1 << 2, 1 << 4, 1 << 6);
+	const __m128i lane_twos = _mm_setr_epi32(2, 2 << 2, 2 << 4, 2 << 6);
+	const __m128i lane_mask = _mm_setr_epi32(3, 3 << 2, 3 << 4, 3 << 6);
+	const __m128i zero = _mm_setzero_si128();
+
+	uint8_t alpha[16];
+	if (format == BLOCK_FORMAT_BC3) {
+		decode_alpha(block, alpha);
+	}
+
+	__m128i indices = _mm_set1_epi32((int)read_uint32(colour + 4));
+	for (uint32_t row = 0; row < BLOCK_COMPRESSION_BLOCK_SIZE; row++) {
+		__m128i index = _mm_and_si128(indices, lane_mask);
+		__m128i texels = _mm_or_si128(
+			_mm_or_si128(_mm_and_si128(_mm_cmpeq_epi32(index, zero), p0), _mm_and_si128(_mm_cmpeq_epi32(index, lane_ones), p1)),
+			_mm_or_si128(_mm_and_si128(_mm_cmpeq_epi32(index, lane_twos), p2), _mm_and_si128(_mm_cmpeq_epi32(index, lane_mask), p3)));
+		if (format == BLOCK_FORMAT_BC3) {
+			int row_alpha;
+			memcpy(&row_alpha, alpha + row * BLOCK_COMPRESSION_BLOCK_SIZE, sizeof(row_alpha));
+			__m128i widened = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(row_alpha), zero), zero);
+			texels = _mm_or_si128(texels, _mm_slli_epi32(widened, 24));
+		}
+		_mm_storeu_si128((__m128i *)(out + row * row_pitch), texels);
+		indices = _mm_srli_epi32(indices, 8);
+	}
+}
+
+static void decode_sse2(const uint8_t * blocks, uint32_t width, uint32_t height, BlockFormat format, uint8_t * out) {
+	uint32_t blocks_x = (width + BLOCK_COMPRESSION_BLOCK_SIZE - 1) / BLOCK_COMPRESSION_BLOCK_SIZE;
+	uint32_t blocks_y = (height + BLOCK_COMPRESSION_BLOCK_SIZE - 1) / BLOCK_COMPRESSION_BLOCK_SIZE;
+	uint32_t block_bytes = format == BLOCK_FORMAT_BC3 ? BLOCK_COMPRESSION_BC3_BLOCK_BYTES : BLOCK_COMPRESSION_BC1_BLOCK_BYTES;
+	size_t row_pitch = (size_t)width * 4;
+	for (uint32_t block_y = 0; block_y < blocks_y; block_y++) {
+		for (uint32_t block_x = 0; block_x < blocks_x; block_x++) {
+			const uint8_t * block = blocks + ((size_t)block_y * blocks_x + block_x) * block_bytes;
+			uint32_t x = block_x * BLOCK_COMPRESSION_BLOCK_SIZE;
+			uint32_t y = block_y * BLOCK_COMPRESSION_BLOCK_SIZE;
+			//whole blocks go straight into the image, the ones hanging over its edge through a copy
+			if (x + BLOCK_COMPRESSION_BLOCK_SIZE <= width && y + BLOCK_COMPRESSION_BLOCK_SIZE <= height) {
+				decode_block_sse2(block, format, out + y * row_pitch + (size_t)x * 4, row_pitch);
+			} else {
+				uint32_t texels[16];
+				decode_block_sse2(block, format, (uint8_t *)texels, BLOCK_COMPRESSION_BLOCK_SIZE * 4);
+				write_block(texels, block_x, block_y, width, height, out);
+			}
+		}
+	}
+}
+
+#endif
+
+void BlockCompression::DecodeBC1(const void * blocks, uint32_t width, uint32_t height, bool alpha, void * out) {
+#if SIMD_SSE2
+	decode_sse2((const uint8_t *)blocks, width, height, alpha ? BLOCK_FORMAT_BC1_ALPHA : BLOCK_FORMAT_BC1, (uint8_t *)out);
+#else
+	decode_scalar((const uint8_t *)blocks, width, height, alpha ? BLOCK_FORMAT_BC1_ALPHA : BLOCK_FORMAT_BC1, (uint8_t *)out);
+#endif
+}
+
+void BlockCompression::DecodeBC3(const void * blocks, uint32_t width, uint32_t height, void * out) {
+#if SIMD_SSE2
+	decode_sse2((const uint8_t *)blocks, width, height, BLOCK_FORMAT_BC3, (uint8_t *)out);
+#else
+	decode_scalar((const uint8_t *)blocks, width, height, BLOCK_FORMAT_BC3, (uint8_t *)out);
+#endif
+}
+
+void BlockCompression::DecodeBC1Scalar(const void * blocks, uint32_t width, uint32_t height, bool alpha, void * out) {
+	decode_scalar((const uint8_t *)blocks, width, height, alpha ? BLOCK_FORMAT_BC1_ALPHA : BLOCK_FORMAT_BC1, (uint8_t *)out);
+}
+
+void BlockCompression::DecodeBC3Scalar(const void * blocks, uint32_t width, uint32_t height, void * out) {
+	decode_scalar((const uint8_t *)blocks, width, height, BLOCK_FORMAT_BC3, (uint8_t *)out);
+}
\ No newline at end of file
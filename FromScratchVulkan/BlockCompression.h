@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+
+//texels per side of a bc block
+#define BLOCK_COMPRESSION_BLOCK_SIZE 4
+#define BLOCK_COMPRESSION_BC1_BLOCK_BYTES 8
+#define BLOCK_COMPRESSION_BC3_BLOCK_BYTES 16
+
+//software decoding of the bc formats to rgba8, for devices that can't sample them. blocks are read row by row,
+//(width + 3) / 4 of them per row; out is width * height tightly packed rgba8 texels, with the parts of the
+//edge blocks past the image dropped
+namespace BlockCompression {
+	uint32_t GetBlockCount(uint32_t width, uint32_t height);
+
+	//with alpha, a block whose first endpoint is not above its second has transparent black as its fourth colour
+	void DecodeBC1(const void * blocks, uint32_t width, uint32_t height, bool alpha, void * out);
+	//bc1 colour without the transparent mode, behind an interpolated alpha block
+	void DecodeBC3(const void * blocks, uint32_t width, uint32_t height, void * out);
+
+	//reference versions, same output bit for bit
+	void DecodeBC1Scalar(const void * blocks, uint32_t width, uint32_t height, bool alpha, void * out);
+	void DecodeBC3Scalar(const void * blocks, uint32_t width, uint32_t height, void * out);
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include "CommandRecorder.h"
+#include "Renderer.h"
+#include "ThreadPool.h"
+#include "Shared.h"
+
+CommandRecorder::CommandRecorder(Renderer * renderer, uint32_t thread_count) :
+	m_renderer(renderer),
+	m_device(renderer->GetVulkanDevice()),
+	m_slot_count(thread_count),
+	m_frame_index(0)
+{
+	m_pools.resize(m_renderer->GetFramesInFlight() * m_slot_count);
+	for (uint32_t i = 0; i < m_pools.size(); i++) {
+		CreatePool(m_pools[i]);
+	}
+}
+
+CommandRecorder::~CommandRecorder() {
+	//destroying a pool frees its command buffers
+	for (uint32_t i = 0; i < m_pools.size(); i++) {
+		vkDestroyCommandPool(m_device, m_pools[i].pool, VK_NULL_HANDLE);
+	}
+	for (auto & external : m_external_pools) {
+		for (uint32_t i = 0; i < external.second.size(); i++) {
+			vkDestroyCommandPool(m_device, external.second[i].pool, VK_NULL_HANDLE);
+		}
+	}
+}
+
+void CommandRecorder::BeginFrame(uint32_t frame_index) {
+	m_frame_index = frame_index;
+	for (uint32_t i = 0; i < m_slot_count; i++) {
+		ResetPool(m_pools[m_frame_index * m_slot_count + i]);
+	}
+	std::lock_guard<std::mutex> lock(m_external_mutex);
+	for (auto & external : m_external_pools) {
+		ResetPool(external.second[m_frame_index]);
+	}
+}
+
+VkCommandBuffer CommandRecorder::BeginSecondary(const VkCommandBufferInheritanceInfo & inheritance) {
+	uint32_t slot = ThreadPool::GetWorkerIndex();
+	ThreadCommandPool * slot_pool;
+	if (slot < m_slot_count) {
+		slot_pool = &m_pools[m_frame_index * m_slot_count + slot];
+	}
+	else {
+		std::lock_guard<std::mutex> lock(m_external_mutex);
+		std::vector<ThreadCommandPool> & external = m_external_pools[std::this_thread::get_id()];
+		if (external.empty()) {
+			external.resize(m_renderer->GetFramesInFlight());
+			for (uint32_t i = 0; i < external.size(); i++) {
+				CreatePool(external[i]);
+			}
+		}
+		slot_pool = &external[m_frame_index];
+	}
+	ThreadCommandPool & pool = *slot_pool;
+
+	//command buffers are kept across frames, the pool reset only rewinds them
+	if (pool.used == pool.command_buffers.size()) {
+		VkCommandBufferAllocateInfo command_buffer_info{};
+		command_buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		command_buffer_info.commandPool = pool.pool;
+		command_buffer_info.commandBufferCount = 1;
+		command_buffer_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		VkCommandBuffer command_buffer;
+		ErrorCheck(vkAllocateCommandBuffers(m_device, &command_buffer_info, &command_buffer));
+		pool.command_buffers.push_back(command_buffer);
+	}
+	VkCommandBuffer command_buffer = pool.command_buffers[pool.used++];
+
+	VkCommandBufferBeginInfo command_buffer_begin_info{};
+	command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	command_buffer_begin_info.pInheritanceInfo = &inheritance;
+	ErrorCheck(vkBeginCommandBuffer(command_buffer, &command_buffer_begin_info));
+	return command_buffer;
+}
+
+void CommandRecorder::CreatePool(ThreadCommandPool & pool) {
+	VkCommandPoolCreateInfo pool_info{};
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.queueFamilyIndex = m_renderer->GetQueueFamilyIndex(QUEUE_GRAPHICS);
+	//only ever reset as a whole
+	pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	ErrorCheck(vkCreateCommandPool(m_device, &pool_info, VK_NULL_HANDLE, &pool.pool));
+	pool.used = 0;
+}
+
+void CommandRecorder::ResetPool(ThreadCommandPool & pool) {
+	if (pool.used > 0) {
+		ErrorCheck(vkResetCommandPool(m_device, pool.pool, 0));
+		pool.used = 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Platform.h"
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//below this many draws a job costs more to hand out than it saves
+#define COMMAND_RECORDER_MIN_DRAWS_PER_JOB 256
+
+class Renderer;
+
+//secondary command buffers for recording on several threads at once. every worker thread gets its own
+//command pool per frame in flight, so no pool is ever touched by two threads and a whole frame's worth
+//is recycled with one vkResetCommandPool. threads outside the pool get a set of pools each the first time they record
+class CommandRecorder {
+public:
+	CommandRecorder(Renderer * renderer, uint32_t thread_count);
+	~CommandRecorder();
+
+	//call once the frame's fence has been waited on, before anything is recorded for it
+	void BeginFrame(uint32_t frame_index);
+
+	//returns a secondary command buffer from the calling thread's pool, already begun to continue inheritance's subpass
+	VkCommandBuffer BeginSecondary(const VkCommandBufferInheritanceInfo & inheritance);
+private:
+	struct ThreadCommandPool {
+		VkCommandPool pool;
+		std::vector<VkCommandBuffer> command_buffers;
+		uint32_t used;
+	};
+
+	void CreatePool(ThreadCommandPool & pool);
+	void ResetPool(ThreadCommandPool & pool);
+
+	Renderer * m_renderer;
+	VkDevice m_device;
+	uint32_t m_slot_count;
+	uint32_t m_frame_index;
+	//m_slot_count pools per frame in flight, one for each worker
+	std::vector<ThreadCommandPool> m_pools;
+	//a pool per frame in flight for every other thread that has recorded. the map only changes under the mutex and
+	//never moves its elements, so a thread can keep using its own pools without holding it. entries outlive their thread
+	std::unordered_map<std::thread::id, std::vector<ThreadCommandPool>> m_external_pools;
+	std::mutex m_external_mutex;
+};
\ No newline at end of file
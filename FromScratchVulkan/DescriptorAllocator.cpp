@@ -0,0 +1,436 @@
+#include "DescriptorAllocator.h"
+#include "Renderer.h"
+#include "Shared.h"
+#include <algorithm>
+#include <assert.h>
+#include <string.h>
+
+static bool is_image_descriptor(VkDescriptorType type) {
+	return type == VK_DESCRIPTOR_TYPE_SAMPLER || type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER || type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE
+		|| type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE || type == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+}
+
+static bool is_texel_buffer_descriptor(VkDescriptorType type) {
+	return type == VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER;
+}
+
+//the fields of info the type reads, so whatever a caller leaves in the others never splits the cache
+static void descriptor_key(VkDescriptorType type, const DescriptorInfo & info, uint64_t key[3]) {
+	key[0] = 0;
+	key[1] = 0;
+	key[2] = 0;
+	if (is_image_descriptor(type)) {
+		if (type == VK_DESCRIPTOR_TYPE_SAMPLER || type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) {
+			key[0] = (uint64_t)info.image.sampler;
+		}
+		if (type != VK_DESCRIPTOR_TYPE_SAMPLER) {
+			key[1] = (uint64_t)info.image.imageView;
+			key[2] = (uint64_t)info.image.imageLayout;
+		}
+	} else if (is_texel_buffer_descriptor(type)) {
+		key[0] = (uint64_t)info.texel_buffer_view;
+	} else {
+		key[0] = (uint64_t)info.buffer.buffer;
+		key[1] = info.buffer.offset;
+		key[2] = info.buffer.range;
+	}
+}
+
+DescriptorAllocator::DescriptorAllocator(Renderer * renderer) :
+	m_renderer(renderer),
+	m_device(renderer->GetVulkanDevice()),
+	m_frame_index(0),
+	m_cached_set_count(0),
+	m_allocated_set_count(0)
+{
+	memset(m_max_descriptor_counts, 0, sizeof(m_max_descriptor_counts));
+
+	//transient pools are only ever reset whole, which lets the driver skip tracking individual sets
+	m_transient_chains.resize(m_renderer->GetFramesInFlight());
+	for (uint32_t i = 0; i < m_transient_chains.size(); i++) {
+		m_transient_chains[i].current = 0;
+		m_transient_chains[i].flags = 0;
+	}
+	m_persistent_chain.current = 0;
+	m_persistent_chain.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+
+#ifdef VK_KHR_descriptor_update_template
+	m_fvkCreateDescriptorUpdateTemplateKHR = nullptr;
+	m_fvkDestroyDescriptorUpdateTemplateKHR = nullptr;
+	m_fvkUpdateDescriptorSetWithTemplateKHR = nullptr;
+	if (m_renderer->HasDescriptorUpdateTemplates()) {
+		m_fvkCreateDescriptorUpdateTemplateKHR = (PFN_vkCreateDescriptorUpdateTemplateKHR)vkGetDeviceProcAddr(m_device, "vkCreateDescriptorUpdateTemplateKHR");
+		m_fvkDestroyDescriptorUpdateTemplateKHR = (PFN_vkDestroyDescriptorUpdateTemplateKHR)vkGetDeviceProcAddr(m_device, "vkDestroyDescriptorUpdateTemplateKHR");
+		m_fvkUpdateDescriptorSetWithTemplateKHR = (PFN_vkUpdateDescriptorSetWithTemplateKHR)vkGetDeviceProcAddr(m_device, "vkUpdateDescriptorSetWithTemplateKHR");
+	}
+#endif
+}
+
+DescriptorAllocator::~DescriptorAllocator() {
+	for (uint32_t i = 0; i < m_transient_chains.size(); i++) {
+		for (uint32_t j = 0; j < m_transient_chains[i].pools.size(); j++) {
+			vkDestroyDescriptorPool(m_device, m_transient_chains[i].pools[j].pool, VK_NULL_HANDLE);
+		}
+	}
+	for (uint32_t i = 0; i < m_persistent_chain.pools.size(); i++) {
+		vkDestroyDescriptorPool(m_device, m_persistent_chain.pools[i].pool, VK_NULL_HANDLE);
+	}
+#ifdef VK_KHR_descriptor_update_template
+	for (uint32_t i = 0; i < m_layouts.size(); i++) {
+		if (m_layouts[i].update_template != VK_NULL_HANDLE) {
+			m_fvkDestroyDescriptorUpdateTemplateKHR(m_device, m_layouts[i].update_template, VK_NULL_HANDLE);
+		}
+	}
+#endif
+}
+
+uint32_t DescriptorAllocator::RegisterLayout(VkDescriptorSetLayout layout, const VkDescriptorSetLayoutBinding * bindings, uint32_t binding_count) {
+	Layout registered;
+	registered.layout = layout;
+	registered.bindings.assign(bindings, bindings + binding_count);
+	registered.info_count = 0;
+	memset(registered.descriptor_counts, 0, sizeof(registered.descriptor_counts));
+
+#ifdef VK_KHR_descriptor_update_template
+	std::vector<VkDescriptorUpdateTemplateEntryKHR> entries(binding_count);
+#endif
+	for (uint32_t i = 0; i < binding_count; i++) {
+		if ((uint32_t)bindings[i].descriptorType >= DESCRIPTOR_ALLOCATOR_TYPE_COUNT) {
+			assert(0 && "DescriptorAllocator only sizes pools for the vulkan 1.0 descriptor types");
+		}
+#ifdef VK_KHR_descriptor_update_template
+		//the infos for every binding's descriptors follow each other, so one stride covers them all
+		entries[i] = {};
+		entries[i].dstBinding = bindings[i].binding;
+		entries[i].dstArrayElement = 0;
+		entries[i].descriptorCount = bindings[i].descriptorCount;
+		entries[i].descriptorType = bindings[i].descriptorType;
+		entries[i].offset = registered.info_count * sizeof(DescriptorInfo);
+		entries[i].stride = sizeof(DescriptorInfo);
+#endif
+		registered.descriptor_counts[bindings[i].descriptorType] += bindings[i].descriptorCount;
+		registered.info_count += bindings[i].descriptorCount;
+	}
+	for (uint32_t type = 0; type < DESCRIPTOR_ALLOCATOR_TYPE_COUNT; type++) {
+		m_max_descriptor_counts[type] = std::max(m_max_descriptor_counts[type], registered.descriptor_counts[type]);
+	}
+
+#ifdef VK_KHR_descriptor_update_template
+	registered.update_template = VK_NULL_HANDLE;
+	if (m_fvkCreateDescriptorUpdateTemplateKHR != nullptr && binding_count > 0) {
+		VkDescriptorUpdateTemplateCreateInfoKHR update_template_create_info{};
+		update_template_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO_KHR;
+		update_template_create_info.descriptorUpdateEntryCount = binding_count;
+		update_template_create_info.pDescriptorUpdateEntries = entries.data();
+		update_template_create_info.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET_KHR;
+		update_template_create_info.descriptorSetLayout = layout;
+		ErrorCheck(m_fvkCreateDescriptorUpdateTemplateKHR(m_device, &update_template_create_info, VK_NULL_HANDLE, &registered.update_template));
+	}
+#endif
+
+	m_layouts.push_back(registered);
+	return (uint32_t)m_layouts.size() - 1;
+}
+
+void DescriptorAllocator::UnregisterLayout(uint32_t layout) {
+	EvictWhere([layout](const CachedSet & cached) {
+		return cached.layout == layout;
+	});
+
+	Layout & registered = m_layouts[layout];
+#ifdef VK_KHR_descriptor_update_template
+	if (registered.update_template != VK_NULL_HANDLE) {
+		m_fvkDestroyDescriptorUpdateTemplateKHR(m_device, registered.update_template, VK_NULL_HANDLE);
+		registered.update_template = VK_NULL_HANDLE;
+	}
+#endif
+	registered.layout = VK_NULL_HANDLE;
+	registered.bindings.clear();
+	registered.info_count = 0;
+	memset(registered.descriptor_counts, 0, sizeof(registered.descriptor_counts));
+
+	memset(m_max_descriptor_counts, 0, sizeof(m_max_descriptor_counts));
+	for (uint32_t i = 0; i < m_layouts.size(); i++) {
+		for (uint32_t type = 0; type < DESCRIPTOR_ALLOCATOR_TYPE_COUNT; type++) {
+			m_max_descriptor_counts[type] = std::max(m_max_descriptor_counts[type], m_layouts[i].descriptor_counts[type]);
+		}
+	}
+}
+
+uint32_t DescriptorAllocator::GetInfoCount(uint32_t layout) const {
+	return m_layouts[layout].info_count;
+}
+
+void DescriptorAllocator::BeginFrame(uint32_t frame_index) {
+	m_frame_index = frame_index;
+	PoolChain & chain = m_transient_chains[frame_index];
+	for (uint32_t i = 0; i < chain.pools.size(); i++) {
+		Pool & pool = chain.pools[i];
+		if (pool.sets > 0) {
+			ErrorCheck(vkResetDescriptorPool(m_device, pool.pool, 0));
+			pool.sets = 0;
+			memset(pool.used, 0, sizeof(pool.used));
+		}
+	}
+	chain.current = 0;
+}
+
+VkDescriptorSet DescriptorAllocator::AllocateTransient(uint32_t layout) {
+	uint32_t pool_index;
+	return Allocate(m_transient_chains[m_frame_index], layout, pool_index);
+}
+
+VkDescriptorSet DescriptorAllocator::AllocateTransient(uint32_t layout, const DescriptorInfo * infos) {
+	VkDescriptorSet set = AllocateTransient(layout);
+	Write(set, layout, infos);
+	return set;
+}
+
+VkDescriptorSet DescriptorAllocator::GetPersistent(uint32_t layout, const DescriptorInfo * infos) {
+	std::vector<CachedSet> & bucket = m_cache[Hash(layout, infos)];
+	for (uint32_t i = 0; i < bucket.size(); i++) {
+		if (Matches(bucket[i], layout, infos)) {
+			return bucket[i].set;
+		}
+	}
+
+	CachedSet cached;
+	cached.layout = layout;
+	cached.infos.assign(infos, infos + m_layouts[layout].info_count);
+	cached.set = Allocate(m_persistent_chain, layout, cached.pool);
+	Write(cached.set, layout, infos);
+	bucket.push_back(cached);
+	m_cached_set_count++;
+	return cached.set;
+}
+
+void DescriptorAllocator::Evict(VkImageView image_view) {
+	EvictWhere([this, image_view](const CachedSet & cached) {
+		const Layout & layout = m_layouts[cached.layout];
+		bool references = false;
+		uint32_t info = 0;
+		for (uint32_t b = 0; b < layout.bindings.size(); b++) {
+			for (uint32_t d = 0; d < layout.bindings[b].descriptorCount; d++, info++) {
+				VkDescriptorType type = layout.bindings[b].descriptorType;
+				references = references || (is_image_descriptor(type) && type != VK_DESCRIPTOR_TYPE_SAMPLER && cached.infos[info].image.imageView == image_view);
+			}
+		}
+		return references;
+	});
+}
+
+template <typename F>
+void DescriptorAllocator::EvictWhere(F evict) {
+	for (auto bucket = m_cache.begin(); bucket != m_cache.end(); ) {
+		std::vector<CachedSet> & sets = bucket->second;
+		for (uint32_t i = 0; i < sets.size(); ) {
+			if (!evict(sets[i])) {
+				i++;
+				continue;
+			}
+
+			const Layout & layout = m_layouts[sets[i].layout];
+			Pool & pool = m_persistent_chain.pools[sets[i].pool];
+			ErrorCheck(vkFreeDescriptorSets(m_device, pool.pool, 1, &sets[i].set));
+			pool.sets--;
+			for (uint32_t type = 0; type < DESCRIPTOR_ALLOCATOR_TYPE_COUNT; type++) {
+				pool.used[type] -= layout.descriptor_counts[type];
+			}
+			m_persistent_chain.current = std::min(m_persistent_chain.current, sets[i].pool);
+			sets[i] = sets.back();
+			sets.pop_back();
+			m_cached_set_count--;
+		}
+		if (sets.empty()) {
+			bucket = m_cache.erase(bucket);
+		} else {
+			++bucket;
+		}
+	}
+}
+
+void DescriptorAllocator::Write(VkDescriptorSet set, uint32_t layout, const DescriptorInfo * infos) {
+	const Layout & registered = m_layouts[layout];
+#ifdef VK_KHR_descriptor_update_template
+	if (registered.update_template != VK_NULL_HANDLE) {
+		m_fvkUpdateDescriptorSetWithTemplateKHR(m_device, set, registered.update_template, infos);
+		return;
+	}
+#endif
+	//one write per descriptor, since the infos are further apart than the arrays a write points at expect
+	m_writes.resize(registered.info_count);
+	uint32_t info = 0;
+	for (uint32_t b = 0; b < registered.bindings.size(); b++) {
+		const VkDescriptorSetLayoutBinding & binding = registered.bindings[b];
+		for (uint32_t d = 0; d < binding.descriptorCount; d++, info++) {
+			VkWriteDescriptorSet & write_descriptor_set = m_writes[info];
+			write_descriptor_set = {};
+			write_descriptor_set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write_descriptor_set.dstSet = set;
+			write_descriptor_set.dstBinding = binding.binding;
+			write_descriptor_set.dstArrayElement = d;
+			write_descriptor_set.descriptorCount = 1;
+			write_descriptor_set.descriptorType = binding.descriptorType;
+			if (is_image_descriptor(binding.descriptorType)) {
+				write_descriptor_set.pImageInfo = &infos[info].image;
+			} else if (is_texel_buffer_descriptor(binding.descriptorType)) {
+				write_descriptor_set.pTexelBufferView = &infos[info].texel_buffer_view;
+			} else {
+				write_descriptor_set.pBufferInfo = &infos[info].buffer;
+			}
+		}
+	}
+	vkUpdateDescriptorSets(m_device, registered.info_count, m_writes.data(), 0, VK_NULL_HANDLE);
+}
+
+bool DescriptorAllocator::HasUpdateTemplates() const {
+#ifdef VK_KHR_descriptor_update_template
+	return m_fvkUpdateDescriptorSetWithTemplateKHR != nullptr;
+#else
+	return false;
+#endif
+}
+
+uint64_t DescriptorAllocator::GetAllocatedSetCount() const {
+	return m_allocated_set_count;
+}
+
+uint32_t DescriptorAllocator::GetPoolCount() const {
+	uint32_t count = (uint32_t)m_persistent_chain.pools.size();
+	for (uint32_t i = 0; i < m_transient_chains.size(); i++) {
+		count += (uint32_t)m_transient_chains[i].pools.size();
+	}
+	return count;
+}
+
+uint32_t DescriptorAllocator::GetCachedSetCount() const {
+	return m_cached_set_count;
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate(PoolChain & chain, uint32_t layout, uint32_t & pool_index) {
+	const Layout & registered = m_layouts[layout];
+	if (registered.layout == VK_NULL_HANDLE) {
+		assert(0 && "DescriptorAllocator: allocating from an unregistered layout");
+	}
+	for (uint32_t i = chain.current; ; i++) {
+		if (i == chain.pools.size()) {
+			CreatePool(chain);
+		}
+		Pool & pool = chain.pools[i];
+
+		bool fits = Fits(pool, registered);
+		if (fits) {
+			VkDescriptorSetAllocateInfo descriptor_set_allocate_info{};
+			descriptor_set_allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+			descriptor_set_allocate_info.descriptorPool = pool.pool;
+			descriptor_set_allocate_info.descriptorSetCount = 1;
+			descriptor_set_allocate_info.pSetLayouts = &registered.layout;
+
+			VkDescriptorSet set = VK_NULL_HANDLE;
+			VkResult result = vkAllocateDescriptorSets(m_device, &descriptor_set_allocate_info, &set);
+			if (result == VK_SUCCESS) {
+				pool.sets++;
+				for (uint32_t type = 0; type < DESCRIPTOR_ALLOCATOR_TYPE_COUNT; type++) {
+					pool.used[type] += registered.descriptor_counts[type];
+				}
+				m_allocated_set_count++;
+				pool_index = i;
+				return set;
+			}
+			//a pool sets are freed from can be too fragmented for one with room left in it, but an empty one can't
+			if (pool.sets == 0) {
+				ErrorCheck(result);
+				return VK_NULL_HANDLE;
+			}
+		}
+		//a pool that is only too small for this layout is left current for the smaller ones, and passed over for good
+		//once nothing fits in it or it is too fragmented to allocate from
+		if (i == chain.current && (fits || !FitsAny(pool))) {
+			chain.current++;
+		}
+	}
+}
+
+bool DescriptorAllocator::Fits(const Pool & pool, const Layout & layout) const {
+	//counted here rather than left to the driver, because running a pool out is undefined before maintenance1
+	bool fits = pool.sets < pool.max_sets;
+	for (uint32_t type = 0; fits && type < DESCRIPTOR_ALLOCATOR_TYPE_COUNT; type++) {
+		fits = pool.used[type] + layout.descriptor_counts[type] <= pool.capacity[type];
+	}
+	return fits;
+}
+
+bool DescriptorAllocator::FitsAny(const Pool & pool) const {
+	for (uint32_t i = 0; i < m_layouts.size(); i++) {
+		if (m_layouts[i].layout != VK_NULL_HANDLE && Fits(pool, m_layouts[i])) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void DescriptorAllocator::CreatePool(PoolChain & chain) {
+	Pool pool;
+	pool.max_sets = chain.pools.empty() ? DESCRIPTOR_ALLOCATOR_INITIAL_SETS : std::min(chain.pools.back().max_sets * 2, (uint32_t)DESCRIPTOR_ALLOCATOR_MAX_SETS);
+	pool.sets = 0;
+	memset(pool.used, 0, sizeof(pool.used));
+
+	//room for max_sets of the largest layout, whichever layouts end up in it
+	std::vector<VkDescriptorPoolSize> descriptor_pool_sizes;
+	for (uint32_t type = 0; type < DESCRIPTOR_ALLOCATOR_TYPE_COUNT; type++) {
+		pool.capacity[type] = pool.max_sets * m_max_descriptor_counts[type];
+		if (pool.capacity[type] > 0) {
+			VkDescriptorPoolSize descriptor_pool_size;
+			descriptor_pool_size.type = (VkDescriptorType)type;
+			descriptor_pool_size.descriptorCount = pool.capacity[type];
+			descriptor_pool_sizes.push_back(descriptor_pool_size);
+		}
+	}
+	if (descriptor_pool_sizes.empty()) {
+		assert(0 && "Register a layout with descriptors in it before allocating sets");
+	}
+
+	VkDescriptorPoolCreateInfo descriptor_pool_create_info{};
+	descriptor_pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	descriptor_pool_create_info.flags = chain.flags;
+	descriptor_pool_create_info.maxSets = pool.max_sets;
+	descriptor_pool_create_info.poolSizeCount = (uint32_t)descriptor_pool_sizes.size();
+	descriptor_pool_create_info.pPoolSizes = descriptor_pool_sizes.data();
+	ErrorCheck(vkCreateDescriptorPool(m_device, &descriptor_pool_create_info, VK_NULL_HANDLE, &pool.pool));
+
+	chain.pools.push_back(pool);
+}
+
+uint64_t DescriptorAllocator::Hash(uint32_t layout, const DescriptorInfo * infos) const {
+	const Layout & registered = m_layouts[layout];
+	uint64_t hash = fnv1a_64(&layout, sizeof(layout));
+	uint32_t info = 0;
+	for (uint32_t b = 0; b < registered.bindings.size(); b++) {
+		for (uint32_t d = 0; d < registered.bindings[b].descriptorCount; d++, info++) {
+			uint64_t key[3];
+			descriptor_key(registered.bindings[b].descriptorType, infos[info], key);
+			hash = fnv1a_64(key, sizeof(key), hash);
+		}
+	}
+	return hash;
+}
+
+bool DescriptorAllocator::Matches(const CachedSet & cached, uint32_t layout, const DescriptorInfo * infos) const {
+	if (cached.layout != layout) {
+		return false;
+	}
+	const Layout & registered = m_layouts[layout];
+	uint32_t info = 0;
+	for (uint32_t b = 0; b < registered.bindings.size(); b++) {
+		for (uint32_t d = 0; d < registered.bindings[b].descriptorCount; d++, info++) {
+			uint64_t cached_key[3];
+			uint64_t key[3];
+			descriptor_key(registered.bindings[b].descriptorType, cached.infos[info], cached_key);
+			descriptor_key(registered.bindings[b].descriptorType, infos[info], key);
+			if (memcmp(cached_key, key, sizeof(key)) != 0) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
\ No newline at end of file
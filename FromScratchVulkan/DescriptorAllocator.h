@@ -0,0 +1,133 @@
+#pragma once
+
+#include "Platform.h"
+#include <unordered_map>
+#include <vector>
+
+//the first pool of a chain holds this many sets of the largest registered layout, each one after it twice as many as
+//the last, up to the max
+#define DESCRIPTOR_ALLOCATOR_INITIAL_SETS 64
+#define DESCRIPTOR_ALLOCATOR_MAX_SETS 4096
+//the descriptor types of vulkan 1.0, VK_DESCRIPTOR_TYPE_SAMPLER through VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT
+#define DESCRIPTOR_ALLOCATOR_TYPE_COUNT 11
+#define DESCRIPTOR_LAYOUT_INVALID UINT32_MAX
+
+class Renderer;
+
+//what one descriptor points at, which member depending on its binding's type. a set is written from an array of
+//them, one per descriptor, in binding order
+union DescriptorInfo {
+	VkDescriptorBufferInfo buffer;
+	VkDescriptorImageInfo image;
+	VkBufferView texel_buffer_view;
+};
+
+//descriptor sets out of chains of pools that grow as they fill, so nothing needs to know up front how many sets it
+//will have. transient sets come from a chain per frame in flight that BeginFrame resets as a whole; persistent ones
+//are cached by what they point at, so asking twice for the same descriptors gives back the same set without writing
+//it again. sets are written with an update template when the device has them. like the rings, it isn't thread safe
+class DescriptorAllocator {
+public:
+	DescriptorAllocator(Renderer * renderer);
+	~DescriptorAllocator();
+
+	//the layout stays owned by the caller. returns the handle the rest of the calls take
+	uint32_t RegisterLayout(VkDescriptorSetLayout layout, const VkDescriptorSetLayoutBinding * bindings, uint32_t binding_count);
+	//call before destroying the layout. its cached sets are freed, so none of them may be in flight, and pools created
+	//after it are sized for the layouts still registered. the handle isn't handed out again
+	void UnregisterLayout(uint32_t layout);
+	//the number of DescriptorInfos a set of layout is written from
+	uint32_t GetInfoCount(uint32_t layout) const;
+
+	//call once the frame's fence has been waited on, before anything is allocated for it. every transient set
+	//handed out the last time frame_index came round is gone after it
+	void BeginFrame(uint32_t frame_index);
+
+	//valid until the current frame's slot comes round again. without infos the set is left for the caller to write
+	VkDescriptorSet AllocateTransient(uint32_t layout);
+	VkDescriptorSet AllocateTransient(uint32_t layout, const DescriptorInfo * infos);
+	//the cached set for exactly these descriptors, allocated and written the first time it is asked for
+	VkDescriptorSet GetPersistent(uint32_t layout, const DescriptorInfo * infos);
+	//frees every cached set pointing at image_view, for when it is about to be destroyed; none of them may be in flight
+	void Evict(VkImageView image_view);
+
+	void Write(VkDescriptorSet set, uint32_t layout, const DescriptorInfo * infos);
+	bool HasUpdateTemplates() const;
+
+	//sets allocated over the allocator's life, and pools created for them, transient and persistent together
+	uint64_t GetAllocatedSetCount() const;
+	uint32_t GetPoolCount() const;
+	uint32_t GetCachedSetCount() const;
+private:
+	DescriptorAllocator(const DescriptorAllocator &);
+	DescriptorAllocator & operator=(const DescriptorAllocator &);
+
+	//layout is null once unregistered
+	struct Layout {
+		VkDescriptorSetLayout layout;
+		std::vector<VkDescriptorSetLayoutBinding> bindings;
+		uint32_t info_count;
+		uint32_t descriptor_counts[DESCRIPTOR_ALLOCATOR_TYPE_COUNT];
+#ifdef VK_KHR_descriptor_update_template
+		VkDescriptorUpdateTemplateKHR update_template;
+#endif
+	};
+
+	struct Pool {
+		VkDescriptorPool pool;
+		uint32_t max_sets;
+		uint32_t sets;
+		uint32_t capacity[DESCRIPTOR_ALLOCATOR_TYPE_COUNT];
+		uint32_t used[DESCRIPTOR_ALLOCATOR_TYPE_COUNT];
+	};
+
+	//pools before current have been found full since the chain was last reset
+	struct PoolChain {
+		std::vector<Pool> pools;
+		uint32_t current;
+		VkDescriptorPoolCreateFlags flags;
+	};
+
+	struct CachedSet {
+		uint32_t layout;
+		std::vector<DescriptorInfo> infos;
+		VkDescriptorSet set;
+		uint32_t pool;
+	};
+
+	VkDescriptorSet Allocate(PoolChain & chain, uint32_t layout, uint32_t & pool_index);
+	bool Fits(const Pool & pool, const Layout & layout) const;
+	//whether any registered layout has room left in pool
+	bool FitsAny(const Pool & pool) const;
+	//frees every cached set evict returns true for
+	template <typename F>
+	void EvictWhere(F evict);
+	void CreatePool(PoolChain & chain);
+	uint64_t Hash(uint32_t layout, const DescriptorInfo * infos) const;
+	bool Matches(const CachedSet & cached, uint32_t layout, const DescriptorInfo * infos) const;
+
+	Renderer * m_renderer;
+	VkDevice m_device;
+
+	std::vector<Layout> m_layouts;
+	//the most descriptors of each type any registered layout has, what new pools are sized from
+	uint32_t m_max_descriptor_counts[DESCRIPTOR_ALLOCATOR_TYPE_COUNT];
+
+	std::vector<PoolChain> m_transient_chains;
+	uint32_t m_frame_index;
+	//created with VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT, so Evict can hand sets back one at a time
+	PoolChain m_persistent_chain;
+	std::unordered_map<uint64_t, std::vector<CachedSet>> m_cache;
+	uint32_t m_cached_set_count;
+
+	uint64_t m_allocated_set_count;
+	//what Write fills in when there's no template to write with
+	std::vector<VkWriteDescriptorSet> m_writes;
+
+#ifdef VK_KHR_descriptor_update_template
+	//null unless the device has the extension
+	PFN_vkCreateDescriptorUpdateTemplateKHR m_fvkCreateDescriptorUpdateTemplateKHR;
+	PFN_vkDestroyDescriptorUpdateTemplateKHR m_fvkDestroyDescriptorUpdateTemplateKHR;
+	PFN_vkUpdateDescriptorSetWithTemplateKHR m_fvkUpdateDescriptorSetWithTemplateKHR;
+#endif
+};
\ No newline at end of file
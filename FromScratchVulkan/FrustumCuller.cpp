@@ -0,0 +1,271 @@
+#include "FrustumCuller.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <string.h>
+
+//chunk boundaries stay on whole avx2 registers
+#define FRUSTUM_CULLER_MAX_LANES 8
+
+FrustumCuller::FrustumCuller(uint32_t count) {
+	m_count = 0;
+	Resize(count);
+}
+
+void FrustumCuller::Resize(uint32_t count) {
+	//new objects are points at the origin
+	m_centre_x.resize(count, 0.0f);
+	m_centre_y.resize(count, 0.0f);
+	m_centre_z.resize(count, 0.0f);
+	m_radius.resize(count, 0.0f);
+	m_extent_x.resize(count, 0.0f);
+	m_extent_y.resize(count, 0.0f);
+	m_extent_z.resize(count, 0.0f);
+	m_count = count;
+}
+
+uint32_t FrustumCuller::GetCount() const {
+	return m_count;
+}
+
+void FrustumCuller::SetSphere(uint32_t index, const glm::vec3 & centre, float radius) {
+	m_centre_x[index] = centre.x;
+	m_centre_y[index] = centre.y;
+	m_centre_z[index] = centre.z;
+	m_radius[index] = radius;
+	m_extent_x[index] = radius;
+	m_extent_y[index] = radius;
+	m_extent_z[index] = radius;
+}
+
+void FrustumCuller::SetBox(uint32_t index, const glm::vec3 & centre, const glm::vec3 & extents) {
+	m_centre_x[index] = centre.x;
+	m_centre_y[index] = centre.y;
+	m_centre_z[index] = centre.z;
+	m_radius[index] = std::sqrt(extents.x * extents.x + extents.y * extents.y + extents.z * extents.z);
+	m_extent_x[index] = extents.x;
+	m_extent_y[index] = extents.y;
+	m_extent_z[index] = extents.z;
+}
+
+Frustum FrustumCuller::ExtractFrustum(const glm::mat4 & view_projection) {
+	//gribb and hartmann: clip space is -w <= x, y <= w and 0 <= z <= w, and each bound is a plane made of rows of the matrix
+	glm::vec4 rows[4];
+	for (uint32_t r = 0; r < 4; r++) {
+		rows[r] = glm::vec4(view_projection[0][r], view_projection[1][r], view_projection[2][r], view_projection[3][r]);
+	}
+
+	Frustum frustum;
+	frustum.planes[0] = rows[3] + rows[0];
+	frustum.planes[1] = rows[3] - rows[0];
+	frustum.planes[2] = rows[3] + rows[1];
+	frustum.planes[3] = rows[3] - rows[1];
+	frustum.planes[4] = rows[2];
+	frustum.planes[5] = rows[3] - rows[2];
+
+	//normalised so the plane distance is in world units and can be compared with a radius
+	for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; p++) {
+		glm::vec4 & plane = frustum.planes[p];
+		float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		plane = plane / length;
+	}
+	return frustum;
+}
+
+uint32_t FrustumCuller::Cull(SimdLevel level, const Frustum & frustum, CullShape shape, uint32_t first, uint32_t count, uint32_t * out) const {
+	//the vector kernels only take whole registers, the scalar one mops up what is left
+	uint32_t done = 0;
+	uint32_t visible = 0;
+#if SIMD_AVX2
+	if (level >= SIMD_LEVEL_AVX2) {
+		done = count / 8 * 8;
+		visible = CullAVX2(frustum, shape, first, done, out);
+	}
+#endif
+#if SIMD_SSE2
+	if (done == 0 && level >= SIMD_LEVEL_SSE2) {
+		done = count / 4 * 4;
+		visible = CullSSE2(frustum, shape, first, done, out);
+	}
+#endif
+	return visible + CullScalar(frustum, shape, first + done, count - done, out + visible);
+}
+
+uint32_t FrustumCuller::CullParallel(ThreadPool * thread_pool, SimdLevel level, const Frustum & frustum, CullShape shape, uint32_t * out) const {
+	uint32_t job_count = (m_count + FRUSTUM_CULLER_MIN_OBJECTS_PER_JOB - 1) / FRUSTUM_CULLER_MIN_OBJECTS_PER_JOB;
+	job_count = std::min(job_count, thread_pool->GetThreadCount());
+	if (job_count <= 1) {
+		return Cull(level, frustum, shape, 0, m_count, out);
+	}
+
+	//each chunk compacts into its own stretch of out, starting where its objects do, so no two jobs share a write
+	std::vector<uint32_t> firsts(job_count);
+	std::vector<std::future<uint32_t>> jobs(job_count);
+	for (uint32_t i = 0; i < job_count; i++) {
+		uint32_t first = (uint32_t)((uint64_t)m_count * i / job_count) / FRUSTUM_CULLER_MAX_LANES * FRUSTUM_CULLER_MAX_LANES;
+		uint32_t last = i + 1 == job_count ? m_count : (uint32_t)((uint64_t)m_count * (i + 1) / job_count) / FRUSTUM_CULLER_MAX_LANES * FRUSTUM_CULLER_MAX_LANES;
+		firsts[i] = first;
+		jobs[i] = thread_pool->Submit([=, &frustum]() {
+			return Cull(level, frustum, shape, first, last - first, out + first);
+		});
+	}
+
+	//then the stretches are closed up in order. the first is already in place, and every later one only moves down
+	uint32_t visible = 0;
+	for (uint32_t i = 0; i < job_count; i++) {
+		uint32_t chunk_visible = jobs[i].get();
+		if (visible != firsts[i]) {
+			memmove(out + visible, out + firsts[i], chunk_visible * sizeof(uint32_t));
+		}
+		visible += chunk_visible;
+	}
+	return visible;
+}
+
+uint32_t FrustumCuller::CullScalar(const Frustum & frustum, CullShape shape, uint32_t first, uint32_t count, uint32_t * out) const {
+	uint32_t visible = 0;
+	for (uint32_t o = 0; o < count; o++) {
+		uint32_t i = first + o;
+		bool inside = true;
+		for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT && inside; p++) {
+			const glm::vec4 & plane = frustum.planes[p];
+			float distance = plane.x * m_centre_x[i] + plane.y * m_centre_y[i] + plane.z * m_centre_z[i] + plane.w;
+			//a box reaches furthest towards the plane along the normal's signs
+			float reach = shape == CULL_SHAPE_SPHERE ? m_radius[i] :
+				std::fabs(plane.x) * m_extent_x[i] + std::fabs(plane.y) * m_extent_y[i] + std::fabs(plane.z) * m_extent_z[i];
+			inside = distance + reach > 0.0f;
+		}
+		if (inside) {
+			out[visible++] = i;
+		}
+	}
+	return visible;
+}
+
+#if SIMD_SSE2
+
+uint32_t FrustumCuller::CullSSE2(const Frustum & frustum, CullShape shape, uint32_t first, uint32_t count, uint32_t * out) const {
+	__m128 plane_x[FRUSTUM_PLANE_COUNT], plane_y[FRUSTUM_PLANE_COUNT], plane_z[FRUSTUM_PLANE_COUNT], plane_w[FRUSTUM_PLANE_COUNT];
+	__m128 abs_x[FRUSTUM_PLANE_COUNT], abs_y[FRUSTUM_PLANE_COUNT], abs_z[FRUSTUM_PLANE_COUNT];
+	for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; p++) {
+		const glm::vec4 & plane = frustum.planes[p];
+		plane_x[p] = _mm_set1_ps(plane.x);
+		plane_y[p] = _mm_set1_ps(plane.y);
+		plane_z[p] = _mm_set1_ps(plane.z);
+		plane_w[p] = _mm_set1_ps(plane.w);
+		abs_x[p] = _mm_set1_ps(std::fabs(plane.x));
+		abs_y[p] = _mm_set1_ps(std::fabs(plane.y));
+		abs_z[p] = _mm_set1_ps(std::fabs(plane.z));
+	}
+	const __m128 zero = _mm_setzero_ps();
+
+	//same operations in the same order as the scalar version, so every level agrees on which objects are visible
+	uint32_t visible = 0;
+	for (uint32_t o = 0; o < count; o += 4) {
+		uint32_t i = first + o;
+		__m128 centre_x = _mm_loadu_ps(&m_centre_x[i]);
+		__m128 centre_y = _mm_loadu_ps(&m_centre_y[i]);
+		__m128 centre_z = _mm_loadu_ps(&m_centre_z[i]);
+		__m128 radius = zero, extent_x = zero, extent_y = zero, extent_z = zero;
+		if (shape == CULL_SHAPE_SPHERE) {
+			radius = _mm_loadu_ps(&m_radius[i]);
+		}
+		else {
+			extent_x = _mm_loadu_ps(&m_extent_x[i]);
+			extent_y = _mm_loadu_ps(&m_extent_y[i]);
+			extent_z = _mm_loadu_ps(&m_extent_z[i]);
+		}
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; p++) {
+			__m128 distance = _mm_mul_ps(plane_x[p], centre_x);
+			distance = _mm_add_ps(distance, _mm_mul_ps(plane_y[p], centre_y));
+			distance = _mm_add_ps(distance, _mm_mul_ps(plane_z[p], centre_z));
+			distance = _mm_add_ps(distance, plane_w[p]);
+			__m128 reach;
+			if (shape == CULL_SHAPE_SPHERE) {
+				reach = radius;
+			}
+			else {
+				reach = _mm_mul_ps(abs_x[p], extent_x);
+				reach = _mm_add_ps(reach, _mm_mul_ps(abs_y[p], extent_y));
+				reach = _mm_add_ps(reach, _mm_mul_ps(abs_z[p], extent_z));
+			}
+			inside = _mm_and_ps(inside, _mm_cmpgt_ps(_mm_add_ps(distance, reach), zero));
+		}
+
+		//one bit per visible lane, walked lowest first to keep the indices in order
+		uint32_t mask = (uint32_t)_mm_movemask_ps(inside);
+		while (mask != 0) {
+			out[visible++] = i + Simd::CountTrailingZeros(mask);
+			mask &= mask - 1;
+		}
+	}
+	return visible;
+}
+
+#endif
+
+#if SIMD_AVX2
+
+SIMD_TARGET_AVX2 uint32_t FrustumCuller::CullAVX2(const Frustum & frustum, CullShape shape, uint32_t first, uint32_t count, uint32_t * out) const {
+	__m256 plane_x[FRUSTUM_PLANE_COUNT], plane_y[FRUSTUM_PLANE_COUNT], plane_z[FRUSTUM_PLANE_COUNT], plane_w[FRUSTUM_PLANE_COUNT];
+	__m256 abs_x[FRUSTUM_PLANE_COUNT], abs_y[FRUSTUM_PLANE_COUNT], abs_z[FRUSTUM_PLANE_COUNT];
+	for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; p++) {
+		const glm::vec4 & plane = frustum.planes[p];
+		plane_x[p] = _mm256_set1_ps(plane.x);
+		plane_y[p] = _mm256_set1_ps(plane.y);
+		plane_z[p] = _mm256_set1_ps(plane.z);
+		plane_w[p] = _mm256_set1_ps(plane.w);
+		abs_x[p] = _mm256_set1_ps(std::fabs(plane.x));
+		abs_y[p] = _mm256_set1_ps(std::fabs(plane.y));
+		abs_z[p] = _mm256_set1_ps(std::fabs(plane.z));
+	}
+	const __m256 zero = _mm256_setzero_ps();
+
+	//no fma here: its single rounding would let objects touching a plane come out differently from the other levels
+	uint32_t visible = 0;
+	for (uint32_t o = 0; o < count; o += 8) {
+		uint32_t i = first + o;
+		__m256 centre_x = _mm256_loadu_ps(&m_centre_x[i]);
+		__m256 centre_y = _mm256_loadu_ps(&m_centre_y[i]);
+		__m256 centre_z = _mm256_loadu_ps(&m_centre_z[i]);
+		__m256 radius = zero, extent_x = zero, extent_y = zero, extent_z = zero;
+		if (shape == CULL_SHAPE_SPHERE) {
+			radius = _mm256_loadu_ps(&m_radius[i]);
+		}
+		else {
+			extent_x = _mm256_loadu_ps(&m_extent_x[i]);
+			extent_y = _mm256_loadu_ps(&m_extent_y[i]);
+			extent_z = _mm256_loadu_ps(&m_extent_z[i]);
+		}
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; p++) {
+			__m256 distance = _mm256_mul_ps(plane_x[p], centre_x);
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(plane_y[p], centre_y));
+			distance = _mm256_add_ps(distance, _mm256_mul_ps(plane_z[p], centre_z));
+			distance = _mm256_add_ps(distance, plane_w[p]);
+			__m256 reach;
+			if (shape == CULL_SHAPE_SPHERE) {
+				reach = radius;
+			}
+			else {
+				reach = _mm256_mul_ps(abs_x[p], extent_x);
+				reach = _mm256_add_ps(reach, _mm256_mul_ps(abs_y[p], extent_y));
+				reach = _mm256_add_ps(reach, _mm256_mul_ps(abs_z[p], extent_z));
+			}
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), zero, _CMP_GT_OQ));
+		}
+
+		uint32_t mask = (uint32_t)_mm256_movemask_ps(inside);
+		while (mask != 0) {
+			out[visible++] = i + Simd::CountTrailingZeros(mask);
+			mask &= mask - 1;
+		}
+	}
+	return visible;
+}
+
+#endif
\ No newline at end of file
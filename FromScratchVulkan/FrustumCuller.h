@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Platform.h"
+#include "Simd.h"
+#include <vector>
+
+//left, right, bottom, top, near, far
+#define FRUSTUM_PLANE_COUNT 6
+//below this a chunk is over before the job that runs it is scheduled
+#define FRUSTUM_CULLER_MIN_OBJECTS_PER_JOB 8192
+
+class ThreadPool;
+
+//normalised planes, xyz pointing into the frustum: a point p is inside a plane when dot(xyz, p) + w > 0, so a shape
+//that only touches a plane is culled. the gpu cull shader makes the same test in the same order
+struct Frustum {
+	glm::vec4 planes[FRUSTUM_PLANE_COUNT];
+};
+
+enum CullShape {
+	//centre and radius
+	CULL_SHAPE_SPHERE = 0,
+	//centre and half extents, axis aligned in the space the frustum came from
+	CULL_SHAPE_BOX = 1
+};
+
+//object bounds as structure of arrays, so each plane test runs on eight objects at once. every object
+//carries both a sphere and a box; the shape passed to Cull picks which one is tested
+class FrustumCuller {
+public:
+	FrustumCuller(uint32_t count = 0);
+
+	void Resize(uint32_t count);
+	uint32_t GetCount() const;
+
+	//the box becomes the sphere's bounding cube
+	void SetSphere(uint32_t index, const glm::vec3 & centre, float radius);
+	//the sphere becomes the box's bounding sphere
+	void SetBox(uint32_t index, const glm::vec3 & centre, const glm::vec3 & extents);
+
+	//the planes of the clip volume of view_projection, with vulkan's 0..w depth range
+	static Frustum ExtractFrustum(const glm::mat4 & view_projection);
+
+	//writes the indices of the visible objects in [first, first + count) to out in ascending order and returns
+	//how many there were. out needs room for count indices. an object is visible unless it is wholly outside a plane
+	uint32_t Cull(SimdLevel level, const Frustum & frustum, CullShape shape, uint32_t first, uint32_t count, uint32_t * out) const;
+	//the same over every object, split into chunks across the pool. out needs room for GetCount() indices.
+	//blocks until done, so call it from off the pool
+	uint32_t CullParallel(ThreadPool * thread_pool, SimdLevel level, const Frustum & frustum, CullShape shape, uint32_t * out) const;
+
+private:
+	uint32_t CullScalar(const Frustum & frustum, CullShape shape, uint32_t first, uint32_t count, uint32_t * out) const;
+#if SIMD_SSE2
+	uint32_t CullSSE2(const Frustum & frustum, CullShape shape, uint32_t first, uint32_t count, uint32_t * out) const;
+#endif
+#if SIMD_AVX2
+	SIMD_TARGET_AVX2 uint32_t CullAVX2(const Frustum & frustum, CullShape shape, uint32_t first, uint32_t count, uint32_t * out) const;
+#endif
+
+	uint32_t m_count;
+	std::vector<float> m_centre_x;
+	std::vector<float> m_centre_y;
+	std::vector<float> m_centre_z;
+	std::vector<float> m_radius;
+	std::vector<float> m_extent_x;
+	std::vector<float> m_extent_y;
+	std::vector<float> m_extent_z;
+};
\ No newline at end of file
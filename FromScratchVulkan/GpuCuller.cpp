@@ -0,0 +1,170 @@
+#include "GpuCuller.h"
+#include "Renderer.h"
+#include "Uploader.h"
+#include "Shared.h"
+#include <assert.h>
+#include <string.h>
+
+GpuCuller::GpuCuller(Renderer * renderer, uint32_t max_objects) {
+	m_renderer = renderer;
+	m_device = renderer->GetVulkanDevice();
+	m_max_objects = max_objects > 0 ? max_objects : 1;
+	m_object_count = 0;
+
+	m_object_buffer = CreateBuffer(m_max_objects * sizeof(GpuCullObject), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, UPLOADER_MEMORY_PREFERRED, m_object_allocation);
+
+	uint32_t frames_in_flight = m_renderer->GetFramesInFlight();
+
+	VkDescriptorPoolSize descriptor_pool_size{};
+	descriptor_pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptor_pool_size.descriptorCount = GPU_CULLER_BINDING_COUNT * frames_in_flight;
+
+	VkDescriptorPoolCreateInfo descriptor_pool_create_info{};
+	descriptor_pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	descriptor_pool_create_info.maxSets = frames_in_flight;
+	descriptor_pool_create_info.poolSizeCount = 1;
+	descriptor_pool_create_info.pPoolSizes = &descriptor_pool_size;
+
+	ErrorCheck(vkCreateDescriptorPool(m_device, &descriptor_pool_create_info, VK_NULL_HANDLE, &m_descriptor_pool));
+
+	//the outputs are written every frame while an older frame may still be drawing from its own, so each frame gets a set.
+	//they are left host visible when that's free, which is what lets ReadBack check them
+	VkDeviceSize indirect_size = INDIRECT_DRAW_COMMANDS_OFFSET + (VkDeviceSize)m_max_objects * sizeof(VkDrawIndexedIndirectCommand);
+	VkDescriptorSetLayout descriptor_set_layout = m_renderer->GetCullDescriptorSetLayout();
+	m_frames.resize(frames_in_flight);
+	for (uint32_t i = 0; i < frames_in_flight; i++) {
+		FrameBuffers & frame = m_frames[i];
+		frame.instance_buffer = CreateBuffer(m_max_objects * sizeof(glm::mat4), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			UPLOADER_MEMORY_PREFERRED, frame.instance_allocation);
+		frame.indirect_buffer = CreateBuffer(indirect_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			UPLOADER_MEMORY_PREFERRED, frame.indirect_allocation);
+
+		VkDescriptorSetAllocateInfo descriptor_set_allocate_info{};
+		descriptor_set_allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		descriptor_set_allocate_info.descriptorPool = m_descriptor_pool;
+		descriptor_set_allocate_info.descriptorSetCount = 1;
+		descriptor_set_allocate_info.pSetLayouts = &descriptor_set_layout;
+
+		ErrorCheck(vkAllocateDescriptorSets(m_device, &descriptor_set_allocate_info, &frame.descriptor_set));
+
+		VkDescriptorBufferInfo buffer_infos[GPU_CULLER_BINDING_COUNT];
+		buffer_infos[0] = { m_object_buffer, 0, VK_WHOLE_SIZE };
+		buffer_infos[1] = { frame.instance_buffer, 0, VK_WHOLE_SIZE };
+		buffer_infos[2] = { frame.indirect_buffer, 0, VK_WHOLE_SIZE };
+
+		VkWriteDescriptorSet write_descriptor_sets[GPU_CULLER_BINDING_COUNT];
+		for (uint32_t binding = 0; binding < GPU_CULLER_BINDING_COUNT; binding++) {
+			write_descriptor_sets[binding] = {};
+			write_descriptor_sets[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write_descriptor_sets[binding].dstSet = frame.descriptor_set;
+			write_descriptor_sets[binding].dstBinding = binding;
+			write_descriptor_sets[binding].dstArrayElement = 0;
+			write_descriptor_sets[binding].descriptorCount = 1;
+			write_descriptor_sets[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			write_descriptor_sets[binding].pBufferInfo = &buffer_infos[binding];
+		}
+
+		vkUpdateDescriptorSets(m_device, GPU_CULLER_BINDING_COUNT, write_descriptor_sets, 0, VK_NULL_HANDLE);
+	}
+}
+
+GpuCuller::~GpuCuller() {
+	for (uint32_t i = 0; i < m_frames.size(); i++) {
+		vkDestroyBuffer(m_device, m_frames[i].indirect_buffer, VK_NULL_HANDLE);
+		m_renderer->GetAllocator()->Free(m_frames[i].indirect_allocation);
+		vkDestroyBuffer(m_device, m_frames[i].instance_buffer, VK_NULL_HANDLE);
+		m_renderer->GetAllocator()->Free(m_frames[i].instance_allocation);
+	}
+	vkDestroyDescriptorPool(m_device, m_descriptor_pool, VK_NULL_HANDLE);
+	vkDestroyBuffer(m_device, m_object_buffer, VK_NULL_HANDLE);
+	m_renderer->GetAllocator()->Free(m_object_allocation);
+}
+
+VkBuffer GpuCuller::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags preferred, Allocation & allocation) {
+	VkBufferCreateInfo buffer_create_info{};
+	buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_create_info.usage = usage;
+	buffer_create_info.size = size;
+	buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VkBuffer buffer = VK_NULL_HANDLE;
+	ErrorCheck(vkCreateBuffer(m_device, &buffer_create_info, VK_NULL_HANDLE, &buffer));
+	allocation = m_renderer->GetAllocator()->AllocateForBuffer(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, preferred);
+	return buffer;
+}
+
+uint64_t GpuCuller::SetObjects(const glm::mat4 * model_matrices, const glm::vec4 * spheres, uint32_t count) {
+	if (count > m_max_objects) {
+		assert(0 && "GpuCuller ERROR: more objects than the culler was created for");
+		count = m_max_objects;
+	}
+
+	const glm::mat4 & dequantization_matrix = m_renderer->GetDequantizationMatrix();
+	std::vector<GpuCullObject> objects(count);
+	for (uint32_t i = 0; i < count; i++) {
+		objects[i].model = model_matrices[i] * dequantization_matrix;
+		objects[i].sphere = spheres[i];
+	}
+	m_object_count = count;
+	if (count == 0) {
+		return 0;
+	}
+	return m_renderer->GetUploader()->UploadBuffer(m_object_buffer, m_object_allocation, 0, objects.data(), count * sizeof(GpuCullObject));
+}
+
+uint32_t GpuCuller::GetObjectCount() const {
+	return m_object_count;
+}
+
+void GpuCuller::Cull(VkCommandBuffer command_buffer, const Frustum & frustum) {
+	FrameBuffers & frame = m_frames[m_renderer->GetFrameIndex()];
+
+	//the command covering every instance starts from nothing; the shader fills in its index count and bumps its instance count
+	vkCmdFillBuffer(command_buffer, frame.indirect_buffer, 0, INDIRECT_DRAW_COMMANDS_OFFSET, 0);
+
+	VkMemoryBarrier memory_barrier{};
+	memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memory_barrier, 0, VK_NULL_HANDLE, 0, VK_NULL_HANDLE);
+
+	GpuCullConstants constants;
+	for (uint32_t p = 0; p < FRUSTUM_PLANE_COUNT; p++) {
+		constants.planes[p] = frustum.planes[p];
+	}
+	constants.object_count = m_object_count;
+	constants.index_count = m_renderer->GetIndexCount();
+
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_renderer->GetCullPipeline());
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_renderer->GetCullPipelineLayout(), 0, 1, &frame.descriptor_set, 0, VK_NULL_HANDLE);
+	vkCmdPushConstants(command_buffer, m_renderer->GetCullPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+	vkCmdDispatch(command_buffer, (m_object_count + GPU_CULLER_WORKGROUP_SIZE - 1) / GPU_CULLER_WORKGROUP_SIZE, 1, 1);
+
+	//the draw reads the commands and count as indirect parameters and the matrices as vertex attributes; ReadBack reads both from the host
+	memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	memory_barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+		0, 1, &memory_barrier, 0, VK_NULL_HANDLE, 0, VK_NULL_HANDLE);
+}
+
+void GpuCuller::Draw(VkCommandBuffer command_buffer) {
+	const FrameBuffers & frame = m_frames[m_renderer->GetFrameIndex()];
+	m_renderer->DrawInstancedIndirect(command_buffer, frame.instance_buffer, frame.indirect_buffer, m_object_count);
+}
+
+bool GpuCuller::ReadBack(uint32_t frame_index, std::vector<glm::mat4> & visible_model_matrices) const {
+	const FrameBuffers & frame = m_frames[frame_index];
+	if (frame.instance_allocation.mapped == nullptr || frame.indirect_allocation.mapped == nullptr) {
+		return false;
+	}
+
+	const VkDrawIndexedIndirectCommand * all_instances = (const VkDrawIndexedIndirectCommand *)frame.indirect_allocation.mapped;
+	uint32_t count = all_instances->instanceCount;
+	if (count > m_object_count) {
+		assert(0 && "GpuCuller ERROR: the cull wrote more instances than there are objects");
+		count = m_object_count;
+	}
+	visible_model_matrices.resize(count);
+	memcpy(visible_model_matrices.data(), frame.instance_allocation.mapped, count * sizeof(glm::mat4));
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Platform.h"
+#include "Allocator.h"
+#include "FrustumCuller.h"
+#include <vector>
+
+//invocations per workgroup, has to match local_size_x in the cull shader
+#define GPU_CULLER_WORKGROUP_SIZE 64
+//objects, instances, indirect commands
+#define GPU_CULLER_BINDING_COUNT 3
+
+class Renderer;
+
+//one object as the cull shader reads it, std430
+struct GpuCullObject {
+	glm::mat4 model;
+	//world space bounding sphere, radius in w
+	glm::vec4 sphere;
+};
+
+//push constants of the cull shader
+struct GpuCullConstants {
+	glm::vec4 planes[FRUSTUM_PLANE_COUNT];
+	uint32_t object_count;
+	uint32_t index_count;
+};
+
+//frustum culling on the gpu. the objects live in a device local storage buffer; each frame a compute pass tests
+//their spheres and appends the survivors' model matrices, and the indirect commands that draw them, to buffers
+//of that frame's own. the draw then reads the count the gpu left behind, so the cpu cost of a frame doesn't grow
+//with the number of objects. everything is recorded into the renderer's frame command buffer
+class GpuCuller {
+public:
+	GpuCuller(Renderer * renderer, uint32_t max_objects);
+	~GpuCuller();
+
+	//the scene mesh's dequantisation is folded into each model matrix on the way in. no frame in flight may
+	//be culling when the objects are replaced; returns the uploader token
+	uint64_t SetObjects(const glm::mat4 * model_matrices, const glm::vec4 * spheres, uint32_t count);
+	uint32_t GetObjectCount() const;
+
+	//records the cull for the current frame; outside the render pass, from BeginFrame's before_render_pass
+	void Cull(VkCommandBuffer command_buffer, const Frustum & frustum);
+	//draws whatever the cull in the same command buffer left visible, inside the render pass
+	void Draw(VkCommandBuffer command_buffer);
+
+	//for checking against the cpu: what the cull recorded into frame_index left, once that frame's fence has signalled.
+	//false when the buffers landed in memory the host can't see
+	bool ReadBack(uint32_t frame_index, std::vector<glm::mat4> & visible_model_matrices) const;
+
+private:
+	struct FrameBuffers {
+		VkBuffer instance_buffer;
+		Allocation instance_allocation;
+		VkBuffer indirect_buffer;
+		Allocation indirect_allocation;
+		VkDescriptorSet descriptor_set;
+	};
+
+	VkBuffer CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags preferred, Allocation & allocation);
+
+	Renderer * m_renderer;
+	VkDevice m_device;
+	uint32_t m_max_objects;
+	uint32_t m_object_count;
+	VkBuffer m_object_buffer;
+	Allocation m_object_allocation;
+	VkDescriptorPool m_descriptor_pool;
+	std::vector<FrameBuffers> m_frames;
+};
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "GpuProfiler.h"
+#include "Renderer.h"
+#include "Shared.h"
+#include <algorithm>
+#include <iostream>
+
+GpuProfiler::GpuProfiler(Renderer * renderer) :
+	m_renderer(renderer),
+	m_device(renderer->GetVulkanDevice()),
+	m_enabled(false),
+	m_nanoseconds_per_tick(renderer->GetVulkanPhysicalDeviceProperties().limits.timestampPeriod),
+	m_timestamp_mask(0),
+	m_frame_index(0)
+{
+	uint32_t family_count = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(m_renderer->GetVulkanPhysicalDevice(), &family_count, nullptr);
+	std::vector<VkQueueFamilyProperties> family_properties(family_count);
+	vkGetPhysicalDeviceQueueFamilyProperties(m_renderer->GetVulkanPhysicalDevice(), &family_count, family_properties.data());
+
+	uint32_t valid_bits = family_properties[m_renderer->GetQueueFamilyIndex(QUEUE_GRAPHICS)].timestampValidBits;
+	if (valid_bits == 0 || m_nanoseconds_per_tick <= 0.0) {
+		std::cout << "gpu profiler: the graphics queue has no timestamps, gpu timings are disabled" << std::endl;
+		return;
+	}
+	m_enabled = true;
+	//only the low valid_bits are meaningful, and the counter wraps there
+	m_timestamp_mask = valid_bits >= 64 ? UINT64_MAX : (1ull << valid_bits) - 1;
+
+	VkQueryPoolCreateInfo query_pool_create_info{};
+	query_pool_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	query_pool_create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	query_pool_create_info.queryCount = GPU_PROFILER_MAX_SCOPES * 2;
+
+	m_frames.resize(m_renderer->GetFramesInFlight());
+	for (uint32_t i = 0; i < m_frames.size(); i++) {
+		ErrorCheck(vkCreateQueryPool(m_device, &query_pool_create_info, VK_NULL_HANDLE, &m_frames[i].query_pool));
+	}
+}
+
+GpuProfiler::~GpuProfiler() {
+	for (uint32_t i = 0; i < m_frames.size(); i++) {
+		vkDestroyQueryPool(m_device, m_frames[i].query_pool, VK_NULL_HANDLE);
+	}
+}
+
+void GpuProfiler::BeginFrame(uint32_t frame_index, VkCommandBuffer command_buffer) {
+	if (!m_enabled) {
+		return;
+	}
+	m_frame_index = frame_index;
+	FrameQueries & frame = m_frames[m_frame_index];
+	ReadBack(frame);
+	frame.names.clear();
+	vkCmdResetQueryPool(command_buffer, frame.query_pool, 0, GPU_PROFILER_MAX_SCOPES * 2);
+}
+
+uint32_t GpuProfiler::BeginScope(VkCommandBuffer command_buffer, const char * name) {
+	if (!m_enabled) {
+		return UINT32_MAX;
+	}
+	FrameQueries & frame = m_frames[m_frame_index];
+	if (frame.names.size() >= GPU_PROFILER_MAX_SCOPES) {
+		assert(0 && "Too many gpu profiler scopes in one frame");
+		return UINT32_MAX;
+	}
+	uint32_t scope = (uint32_t)frame.names.size();
+	frame.names.push_back(name);
+	vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.query_pool, scope * 2);
+	return scope;
+}
+
+void GpuProfiler::EndScope(VkCommandBuffer command_buffer, uint32_t scope) {
+	if (scope == UINT32_MAX) {
+		return;
+	}
+	vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_frames[m_frame_index].query_pool, scope * 2 + 1);
+}
+
+bool GpuProfiler::IsEnabled() const {
+	return m_enabled;
+}
+
+bool GpuProfiler::GetStats(const std::string & name, GpuScopeStats & stats) const {
+	std::map<std::string, History>::const_iterator iter = m_histories.find(name);
+	if (iter == m_histories.end() || iter->second.samples.empty()) {
+		return false;
+	}
+
+	std::vector<double> samples = iter->second.samples;
+	stats.samples = (uint32_t)samples.size();
+	stats.min_milliseconds = *std::min_element(samples.begin(), samples.end());
+	double sum = 0.0;
+	for (uint32_t i = 0; i < samples.size(); i++) {
+		sum += samples[i];
+	}
+	stats.average_milliseconds = sum / samples.size();
+	size_t p99 = std::min(samples.size() - 1, samples.size() * 99 / 100);
+	std::nth_element(samples.begin(), samples.begin() + p99, samples.end());
+	stats.p99_milliseconds = samples[p99];
+	return true;
+}
+
+void GpuProfiler::Print() const {
+	std::map<std::string, History>::const_iterator iter;
+	for (iter = m_histories.begin(); iter != m_histories.end(); ++iter) {
+		GpuScopeStats stats;
+		if (GetStats(iter->first, stats)) {
+			std::cout << "gpu " << iter->first << ": avg " << stats.average_milliseconds << "ms, min " << stats.min_milliseconds << "ms, p99 " << stats.p99_milliseconds << "ms" << std::endl;
+		}
+	}
+}
+
+void GpuProfiler::ReadBack(FrameQueries & frame) {
+	if (frame.names.empty()) {
+		return;
+	}
+
+	//the fence for this frame has been waited on, so anything short of every result means a scope was never ended
+	uint32_t query_count = (uint32_t)frame.names.size() * 2;
+	std::vector<uint64_t> timestamps(query_count);
+	VkResult result = vkGetQueryPoolResults(m_device, frame.query_pool, 0, query_count, timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if (result != VK_SUCCESS) {
+		return;
+	}
+
+	for (uint32_t i = 0; i < frame.names.size(); i++) {
+		uint64_t ticks = (timestamps[i * 2 + 1] - timestamps[i * 2]) & m_timestamp_mask;
+		History & history = m_histories[frame.names[i]];
+		double milliseconds = ticks * m_nanoseconds_per_tick / 1000000.0;
+		if (history.samples.size() < GPU_PROFILER_HISTORY) {
+			history.samples.push_back(milliseconds);
+			history.next = 0;
+		}
+		else {
+			history.samples[history.next] = milliseconds;
+			history.next = (history.next + 1) % GPU_PROFILER_HISTORY;
+		}
+	}
+}
+
+GpuProfiler::Scope::Scope(GpuProfiler * profiler, VkCommandBuffer command_buffer, const char * name) :
+	m_profiler(profiler),
+	m_command_buffer(command_buffer),
+	m_scope(profiler->BeginScope(command_buffer, name))
+{
+}
+
+GpuProfiler::Scope::~Scope() {
+	m_profiler->EndScope(m_command_buffer, m_scope);
+}
\ No newline at end of file
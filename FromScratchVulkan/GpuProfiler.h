@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Platform.h"
+#include <map>
+#include <string>
+#include <vector>
+
+//timestamp pairs one frame can record
+#define GPU_PROFILER_MAX_SCOPES 64
+//samples per scope the rolling statistics are taken over
+#define GPU_PROFILER_HISTORY 256
+
+class Renderer;
+
+struct GpuScopeStats {
+	double min_milliseconds;
+	double average_milliseconds;
+	double p99_milliseconds;
+	uint32_t samples;
+};
+
+//gpu timings from timestamp queries. every frame in flight has its own query pool, and a pool is only
+//read back once that frame's fence has been waited on again, so reading never stalls. scopes are
+//matched up by name across frames and kept as a rolling window of samples.
+//scopes are recorded into the frame's primary command buffer, from the thread that owns it.
+//when the graphics queue has no timestamp support every call is a no-op
+class GpuProfiler {
+public:
+	GpuProfiler(Renderer * renderer);
+	~GpuProfiler();
+
+	//call once the frame's fence has been waited on and its command buffer begun, outside any render pass
+	void BeginFrame(uint32_t frame_index, VkCommandBuffer command_buffer);
+
+	//returns a handle for EndScope; name must outlive the frame (a string literal)
+	uint32_t BeginScope(VkCommandBuffer command_buffer, const char * name);
+	void EndScope(VkCommandBuffer command_buffer, uint32_t scope);
+
+	bool IsEnabled() const;
+	bool GetStats(const std::string & name, GpuScopeStats & stats) const;
+	void Print() const;
+
+	//times everything recorded into command_buffer over its lifetime
+	class Scope {
+	public:
+		Scope(GpuProfiler * profiler, VkCommandBuffer command_buffer, const char * name);
+		~Scope();
+	private:
+		Scope(const Scope &);
+		Scope & operator=(const Scope &);
+
+		GpuProfiler * m_profiler;
+		VkCommandBuffer m_command_buffer;
+		uint32_t m_scope;
+	};
+private:
+	struct FrameQueries {
+		VkQueryPool query_pool;
+		std::vector<const char *> names;
+	};
+
+	struct History {
+		std::vector<double> samples;
+		uint32_t next;
+	};
+
+	void ReadBack(FrameQueries & frame);
+
+	Renderer * m_renderer;
+	VkDevice m_device;
+	bool m_enabled;
+	double m_nanoseconds_per_tick;
+	uint64_t m_timestamp_mask;
+	uint32_t m_frame_index;
+	std::vector<FrameQueries> m_frames;
+	std::map<std::string, History> m_histories;
+};
\ No newline at end of file
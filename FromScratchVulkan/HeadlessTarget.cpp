@@ -0,0 +1,189 @@
+#include "HeadlessTarget.h"
+#include "Renderer.h"
+#include "Shared.h"
+
+HeadlessTarget::HeadlessTarget(Renderer * renderer, uint32_t size_x, uint32_t size_y, uint32_t frame_limit) :
+	m_renderer(renderer),
+	m_surface_size_x(size_x),
+	m_surface_size_y(size_y),
+	m_frame_limit(frame_limit),
+	m_frame_count(0),
+	m_next_image(0),
+	m_running(true),
+	m_depth_image(VK_NULL_HANDLE),
+	m_depth_image_view(VK_NULL_HANDLE)
+{
+	InitColourImages();
+	InitDepthBuffer();
+}
+
+HeadlessTarget::~HeadlessTarget() {
+	DeInitDepthBuffer();
+	DeInitColourImages();
+}
+
+void HeadlessTarget::Close() {
+	m_running = false;
+}
+
+bool HeadlessTarget::Update() {
+	if (m_frame_limit > 0 && m_frame_count >= m_frame_limit) {
+		m_running = false;
+	}
+	m_frame_count++;
+	return m_running;
+}
+
+bool HeadlessTarget::AcquireImage(VkSemaphore image_acquired_semaphore, uint32_t & image_index) {
+	image_index = m_next_image;
+	m_next_image = (m_next_image + 1) % (uint32_t)m_colour_images.size();
+	//nothing external produces the image, so there is nothing to wait on
+	return false;
+}
+
+bool HeadlessTarget::IsPresentable() {
+	return false;
+}
+
+void HeadlessTarget::Present(uint32_t image_index, VkSemaphore render_finished_semaphore) {
+}
+
+VkFormat HeadlessTarget::GetColourFormat() {
+	return HEADLESS_TARGET_COLOUR_FORMAT;
+}
+
+VkImageLayout HeadlessTarget::GetFinalLayout() {
+	return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+}
+
+uint32_t HeadlessTarget::GetImageCount() {
+	return (uint32_t)m_colour_images.size();
+}
+
+VkImageView HeadlessTarget::GetImageView(uint32_t index) {
+	return m_colour_image_views[index];
+}
+
+VkImageView HeadlessTarget::GetDepthBuffer() {
+	return m_depth_image_view;
+}
+
+uint32_t HeadlessTarget::GetSurfaceSizeX() {
+	return m_surface_size_x;
+}
+
+uint32_t HeadlessTarget::GetSurfaceSizeY() {
+	return m_surface_size_y;
+}
+
+VkImage HeadlessTarget::GetImage(uint32_t index) {
+	return m_colour_images[index];
+}
+
+void HeadlessTarget::InitColourImages() {
+	uint32_t image_count = m_renderer->GetFramesInFlight();
+	m_colour_images.resize(image_count);
+	m_colour_image_views.resize(image_count);
+	m_colour_allocations.resize(image_count);
+
+	VkImageCreateInfo image_create_info{};
+	image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_create_info.pNext = VK_NULL_HANDLE;
+	image_create_info.imageType = VK_IMAGE_TYPE_2D;
+	image_create_info.format = HEADLESS_TARGET_COLOUR_FORMAT;
+	image_create_info.extent.width = m_surface_size_x;
+	image_create_info.extent.height = m_surface_size_y;
+	image_create_info.extent.depth = 1;
+	image_create_info.mipLevels = 1;
+	image_create_info.arrayLayers = 1;
+	image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	//transfer src so frames can be read back for inspection
+	image_create_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	image_create_info.queueFamilyIndexCount = 0;
+	image_create_info.pQueueFamilyIndices = nullptr;
+	image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_create_info.flags = 0;
+
+	for (uint32_t i = 0; i < image_count; i++) {
+		ErrorCheck(vkCreateImage(m_renderer->GetVulkanDevice(), &image_create_info, VK_NULL_HANDLE, &m_colour_images[i]));
+		m_colour_allocations[i] = m_renderer->GetAllocator()->AllocateForImage(m_colour_images[i], 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		VkImageViewCreateInfo image_view_create_info{};
+		image_view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		image_view_create_info.image = m_colour_images[i];
+		image_view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		image_view_create_info.format = HEADLESS_TARGET_COLOUR_FORMAT;
+		image_view_create_info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+		image_view_create_info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+		image_view_create_info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+		image_view_create_info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+		image_view_create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		image_view_create_info.subresourceRange.baseMipLevel = 0;
+		image_view_create_info.subresourceRange.levelCount = 1;
+		image_view_create_info.subresourceRange.baseArrayLayer = 0;
+		image_view_create_info.subresourceRange.layerCount = 1;
+
+		ErrorCheck(vkCreateImageView(m_renderer->GetVulkanDevice(), &image_view_create_info, nullptr, &m_colour_image_views[i]));
+	}
+}
+
+void HeadlessTarget::DeInitColourImages() {
+	for (uint32_t i = 0; i < m_colour_images.size(); i++) {
+		vkDestroyImageView(m_renderer->GetVulkanDevice(), m_colour_image_views[i], nullptr);
+		vkDestroyImage(m_renderer->GetVulkanDevice(), m_colour_images[i], nullptr);
+		m_renderer->GetAllocator()->Free(m_colour_allocations[i]);
+	}
+	m_colour_images.clear();
+	m_colour_image_views.clear();
+	m_colour_allocations.clear();
+}
+
+void HeadlessTarget::InitDepthBuffer() {
+	VkImageCreateInfo image_create_info{};
+	image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_create_info.pNext = VK_NULL_HANDLE;
+	image_create_info.imageType = VK_IMAGE_TYPE_2D;
+	image_create_info.format = VK_FORMAT_D16_UNORM;
+	image_create_info.extent.width = m_surface_size_x;
+	image_create_info.extent.height = m_surface_size_y;
+	image_create_info.extent.depth = 1;
+	image_create_info.mipLevels = 1;
+	image_create_info.arrayLayers = 1;
+	image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	image_create_info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	image_create_info.queueFamilyIndexCount = 0;
+	image_create_info.pQueueFamilyIndices = nullptr;
+	image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_create_info.flags = 0;
+
+	ErrorCheck(vkCreateImage(m_renderer->GetVulkanDevice(), &image_create_info, VK_NULL_HANDLE, &m_depth_image));
+	m_depth_allocation = m_renderer->GetAllocator()->AllocateForImage(m_depth_image, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	VkImageViewCreateInfo image_view_create_info{};
+	image_view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	image_view_create_info.image = m_depth_image;
+	image_view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	image_view_create_info.format = VK_FORMAT_D16_UNORM;
+	image_view_create_info.components.r = VK_COMPONENT_SWIZZLE_R;
+	image_view_create_info.components.g = VK_COMPONENT_SWIZZLE_G;
+	image_view_create_info.components.b = VK_COMPONENT_SWIZZLE_B;
+	image_view_create_info.components.a = VK_COMPONENT_SWIZZLE_A;
+	image_view_create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+	image_view_create_info.subresourceRange.baseMipLevel = 0;
+	image_view_create_info.subresourceRange.levelCount = 1;
+	image_view_create_info.subresourceRange.baseArrayLayer = 0;
+	image_view_create_info.subresourceRange.layerCount = 1;
+	image_view_create_info.flags = 0;
+
+	ErrorCheck(vkCreateImageView(m_renderer->GetVulkanDevice(), &image_view_create_info, nullptr, &m_depth_image_view));
+}
+
+void HeadlessTarget::DeInitDepthBuffer() {
+	vkDestroyImageView(m_renderer->GetVulkanDevice(), m_depth_image_view, nullptr);
+	vkDestroyImage(m_renderer->GetVulkanDevice(), m_depth_image, nullptr);
+	m_renderer->GetAllocator()->Free(m_depth_allocation);
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Platform.h"
+#include "Allocator.h"
+#include "RenderTarget.h"
+#include <vector>
+
+#define HEADLESS_TARGET_COLOUR_FORMAT VK_FORMAT_R8G8B8A8_UNORM
+
+class Renderer;
+
+//offscreen colour and depth attachments standing in for a swapchain, so the same frame loop runs on
+//machines with no display or surface extensions. there is one colour image per frame in flight, handed
+//out round robin, so an image is only reused once the frame that last drew into it has been waited on
+class HeadlessTarget : public RenderTarget {
+public:
+	//frame_limit of 0 keeps running until Close
+	HeadlessTarget(Renderer * renderer, uint32_t size_x, uint32_t size_y, uint32_t frame_limit = 0);
+	~HeadlessTarget();
+
+	void Close();
+
+	bool Update();
+	bool AcquireImage(VkSemaphore image_acquired_semaphore, uint32_t & image_index);
+	bool IsPresentable();
+	void Present(uint32_t image_index, VkSemaphore render_finished_semaphore);
+
+	VkFormat GetColourFormat();
+	VkImageLayout GetFinalLayout();
+	uint32_t GetImageCount();
+	VkImageView GetImageView(uint32_t index);
+	VkImageView GetDepthBuffer();
+	uint32_t GetSurfaceSizeX();
+	uint32_t GetSurfaceSizeY();
+
+	//left in GetFinalLayout once its frame's fence has signalled, ready to be copied out
+	VkImage GetImage(uint32_t index);
+private:
+	void InitColourImages();
+	void DeInitColourImages();
+
+	void InitDepthBuffer();
+	void DeInitDepthBuffer();
+
+	Renderer * m_renderer;
+	uint32_t m_surface_size_x;
+	uint32_t m_surface_size_y;
+	uint32_t m_frame_limit;
+	uint32_t m_frame_count;
+	uint32_t m_next_image;
+	bool m_running;
+
+	std::vector<VkImage> m_colour_images;
+	std::vector<VkImageView> m_colour_image_views;
+	std::vector<Allocation> m_colour_allocations;
+
+	VkImage m_depth_image;
+	VkImageView m_depth_image_view;
+	Allocation m_depth_allocation;
+};
\ No newline at end of file
@@ -0,0 +1,244 @@
+#include "Ktx2File.h"
+#include "Texture.h"
+#include "Shared.h"
+#include <string.h>
+#include <algorithm>
+
+//«KTX 20»\r\n\x1A\n
+static const uint8_t ktx2_identifier[KTX2_IDENTIFIER_SIZE] = { 0xab, 0x4b, 0x54, 0x58, 0x20, 0x32, 0x30, 0xbb, 0x0d, 0x0a, 0x1a, 0x0a };
+
+Ktx2File::Ktx2File() :
+	m_header(nullptr),
+	m_levels(nullptr),
+	m_levels_begin(0),
+	m_levels_end(0)
+{
+}
+
+Ktx2File::~Ktx2File() {
+	Close();
+}
+
+//every astc block is 16 bytes, over a footprint that depends on the format
+struct AstcFootprint {
+	VkFormat unorm;
+	VkFormat srgb;
+	uint32_t width;
+	uint32_t height;
+};
+
+static const AstcFootprint astc_footprints[] = {
+	{ VK_FORMAT_ASTC_4x4_UNORM_BLOCK, VK_FORMAT_ASTC_4x4_SRGB_BLOCK, 4, 4 },
+	{ VK_FORMAT_ASTC_5x4_UNORM_BLOCK, VK_FORMAT_ASTC_5x4_SRGB_BLOCK, 5, 4 },
+	{ VK_FORMAT_ASTC_5x5_UNORM_BLOCK, VK_FORMAT_ASTC_5x5_SRGB_BLOCK, 5, 5 },
+	{ VK_FORMAT_ASTC_6x5_UNORM_BLOCK, VK_FORMAT_ASTC_6x5_SRGB_BLOCK, 6, 5 },
+	{ VK_FORMAT_ASTC_6x6_UNORM_BLOCK, VK_FORMAT_ASTC_6x6_SRGB_BLOCK, 6, 6 },
+	{ VK_FORMAT_ASTC_8x5_UNORM_BLOCK, VK_FORMAT_ASTC_8x5_SRGB_BLOCK, 8, 5 },
+	{ VK_FORMAT_ASTC_8x6_UNORM_BLOCK, VK_FORMAT_ASTC_8x6_SRGB_BLOCK, 8, 6 },
+	{ VK_FORMAT_ASTC_8x8_UNORM_BLOCK, VK_FORMAT_ASTC_8x8_SRGB_BLOCK, 8, 8 },
+	{ VK_FORMAT_ASTC_10x5_UNORM_BLOCK, VK_FORMAT_ASTC_10x5_SRGB_BLOCK, 10, 5 },
+	{ VK_FORMAT_ASTC_10x6_UNORM_BLOCK, VK_FORMAT_ASTC_10x6_SRGB_BLOCK, 10, 6 },
+	{ VK_FORMAT_ASTC_10x8_UNORM_BLOCK, VK_FORMAT_ASTC_10x8_SRGB_BLOCK, 10, 8 },
+	{ VK_FORMAT_ASTC_10x10_UNORM_BLOCK, VK_FORMAT_ASTC_10x10_SRGB_BLOCK, 10, 10 },
+	{ VK_FORMAT_ASTC_12x10_UNORM_BLOCK, VK_FORMAT_ASTC_12x10_SRGB_BLOCK, 12, 10 },
+	{ VK_FORMAT_ASTC_12x12_UNORM_BLOCK, VK_FORMAT_ASTC_12x12_SRGB_BLOCK, 12, 12 },
+};
+
+//the size in bytes of one texel block of format, and the block's width and height in texels. 0 for formats the
+//loader doesn't know, which keeps it from trusting any level size it can't check
+static uint32_t get_block_size(VkFormat format, uint32_t & block_width, uint32_t & block_height) {
+	block_width = 1;
+	block_height = 1;
+	switch (format) {
+	case VK_FORMAT_R8_UNORM:
+	case VK_FORMAT_R8_SRGB:
+		return 1;
+	case VK_FORMAT_R8G8_UNORM:
+	case VK_FORMAT_R8G8_SNORM:
+	case VK_FORMAT_R8G8_SRGB:
+	case VK_FORMAT_R5G6B5_UNORM_PACK16:
+	case VK_FORMAT_R16_UNORM:
+	case VK_FORMAT_R16_SFLOAT:
+		return 2;
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+	case VK_FORMAT_B8G8R8A8_UNORM:
+	case VK_FORMAT_B8G8R8A8_SRGB:
+	case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+	case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+	case VK_FORMAT_E5B9G9R9_UFLOAT_PACK32:
+	case VK_FORMAT_R16G16_UNORM:
+	case VK_FORMAT_R16G16_SNORM:
+	case VK_FORMAT_R16G16_SFLOAT:
+	case VK_FORMAT_R32_UINT:
+	case VK_FORMAT_R32_SFLOAT:
+		return 4;
+	case VK_FORMAT_R16G16B16A16_UNORM:
+	case VK_FORMAT_R16G16B16A16_SNORM:
+	case VK_FORMAT_R16G16B16A16_SFLOAT:
+	case VK_FORMAT_R32G32_SFLOAT:
+		return 8;
+	case VK_FORMAT_R32G32B32A32_SFLOAT:
+		return 16;
+	default:
+		break;
+	}
+
+	block_width = 4;
+	block_height = 4;
+	switch (format) {
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+	case VK_FORMAT_BC4_SNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+	case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+	case VK_FORMAT_EAC_R11_SNORM_BLOCK:
+		return 8;
+	case VK_FORMAT_BC2_UNORM_BLOCK:
+	case VK_FORMAT_BC2_SRGB_BLOCK:
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC5_SNORM_BLOCK:
+	case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+	case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+	case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+	case VK_FORMAT_EAC_R11G11_SNORM_BLOCK:
+		return 16;
+	default:
+		break;
+	}
+
+	for (uint32_t i = 0; i < sizeof(astc_footprints) / sizeof(astc_footprints[0]); i++) {
+		if (format == astc_footprints[i].unorm || format == astc_footprints[i].srgb) {
+			block_width = astc_footprints[i].width;
+			block_height = astc_footprints[i].height;
+			return 16;
+		}
+	}
+	return 0;
+}
+
+bool Ktx2File::Open(const std::string & path) {
+	Close();
+	if (!m_file.Open(path)) {
+		return false;
+	}
+
+	uint64_t file_size = m_file.GetSize();
+	const Ktx2Header * header = (const Ktx2Header *)m_file.GetData();
+	const Ktx2Level * levels = (const Ktx2Level *)(m_file.GetData() + sizeof(Ktx2Header));
+	uint32_t level_count = 1;
+	uint32_t block_width = 1;
+	uint32_t block_height = 1;
+	uint32_t block_bytes = 0;
+	const char * problem = nullptr;
+	if (file_size < sizeof(Ktx2Header) || memcmp(header->identifier, ktx2_identifier, KTX2_IDENTIFIER_SIZE) != 0) {
+		problem = "is not a ktx2 file";
+	} else {
+		level_count = header->level_count > 0 ? header->level_count : 1;
+		block_bytes = get_block_size((VkFormat)header->vk_format, block_width, block_height);
+		//arrays, cube maps, volumes and basis universal are all valid ktx2, but nothing here draws with them
+		if (file_size < sizeof(Ktx2Header) + (uint64_t)level_count * sizeof(Ktx2Level)) {
+			problem = "has a level index running past the end of the file";
+		} else if (header->pixel_width == 0 || header->pixel_height == 0 || header->pixel_depth != 0 || header->layer_count > 1 || header->face_count != 1) {
+			problem = "is not a single 2d texture";
+		} else if (header->supercompression_scheme != KTX2_SUPERCOMPRESSION_NONE) {
+			problem = "is supercompressed";
+		} else if (block_bytes == 0) {
+			problem = "is in a format the loader doesn't know the block size of";
+		} else if (level_count > Texture::GetMipLevelCount(header->pixel_width, header->pixel_height)) {
+			problem = "has more levels than its size has mips";
+		}
+	}
+
+	//every level has to hold at least its whole extent, since that is what gets copied out of it, and start where the
+	//spec puts it: on a multiple of lcm(block size, 4), which is what vkCmdCopyBufferToImage needs of its offsets too
+	uint64_t level_alignment = block_bytes;
+	while (level_alignment % 4 != 0) {
+		level_alignment += block_bytes;
+	}
+	m_levels_begin = file_size;
+	m_levels_end = 0;
+	for (uint32_t i = 0; problem == nullptr && i < level_count; i++) {
+		uint64_t blocks_x = (std::max(header->pixel_width >> i, 1u) + block_width - 1) / block_width;
+		uint64_t blocks_y = (std::max(header->pixel_height >> i, 1u) + block_height - 1) / block_height;
+		if (levels[i].byte_offset > file_size || levels[i].byte_length > file_size - levels[i].byte_offset) {
+			problem = "has a level running past the end of the file";
+		} else if (levels[i].byte_offset % level_alignment != 0) {
+			problem = "has a level not aligned to its block size";
+		} else if (levels[i].byte_length < blocks_x * blocks_y * block_bytes) {
+			problem = "has a level too short for its size";
+		} else {
+			m_levels_begin = std::min(m_levels_begin, levels[i].byte_offset);
+			m_levels_end = std::max(m_levels_end, levels[i].byte_offset + levels[i].byte_length);
+		}
+	}
+	if (problem != nullptr) {
+		std::cout << "Ktx2File: " << path << " " << problem << std::endl;
+		Close();
+		return false;
+	}
+	m_header = header;
+	m_levels = levels;
+	return true;
+}
+
+void Ktx2File::Close() {
+	m_header = nullptr;
+	m_levels = nullptr;
+	m_levels_begin = 0;
+	m_levels_end = 0;
+	m_file.Close();
+}
+
+VkFormat Ktx2File::GetFormat() const {
+	return (VkFormat)m_header->vk_format;
+}
+
+uint32_t Ktx2File::GetWidth() const {
+	return m_header->pixel_width;
+}
+
+uint32_t Ktx2File::GetHeight() const {
+	return m_header->pixel_height;
+}
+
+uint32_t Ktx2File::GetLevelCount() const {
+	return m_header->level_count > 0 ? m_header->level_count : 1;
+}
+
+bool Ktx2File::GetGenerateMips() const {
+	return m_header->level_count == 0;
+}
+
+const void * Ktx2File::GetLevelData(uint32_t level) const {
+	return m_file.GetData() + m_levels[level].byte_offset;
+}
+
+VkDeviceSize Ktx2File::GetLevelSize(uint32_t level) const {
+	return m_levels[level].byte_length;
+}
+
+const void * Ktx2File::GetLevelsData() const {
+	return m_file.GetData() + m_levels_begin;
+}
+
+VkDeviceSize Ktx2File::GetLevelsSize() const {
+	return m_levels_end - m_levels_begin;
+}
+
+VkDeviceSize Ktx2File::GetLevelOffset(uint32_t level) const {
+	return m_levels[level].byte_offset - m_levels_begin;
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Platform.h"
+#include "MappedFile.h"
+#include <string>
+
+#define KTX2_IDENTIFIER_SIZE 12
+//the KHR_DF supercompression schemes; only uncompressed payloads can go to the gpu as they are
+#define KTX2_SUPERCOMPRESSION_NONE 0
+
+//the fixed part of a ktx2 file, as laid out in the container spec. the level index follows it directly
+struct Ktx2Header {
+	uint8_t identifier[KTX2_IDENTIFIER_SIZE];
+	//a VkFormat, VK_FORMAT_UNDEFINED for basis universal payloads
+	uint32_t vk_format;
+	uint32_t type_size;
+	uint32_t pixel_width;
+	uint32_t pixel_height;
+	uint32_t pixel_depth;
+	uint32_t layer_count;
+	uint32_t face_count;
+	//0 asks the loader to generate the chain
+	uint32_t level_count;
+	uint32_t supercompression_scheme;
+	uint32_t dfd_byte_offset;
+	uint32_t dfd_byte_length;
+	uint32_t kvd_byte_offset;
+	uint32_t kvd_byte_length;
+	uint64_t sgd_byte_offset;
+	uint64_t sgd_byte_length;
+};
+
+static_assert(sizeof(Ktx2Header) == 80, "Ktx2Header must have no padding");
+
+struct Ktx2Level {
+	uint64_t byte_offset;
+	uint64_t byte_length;
+	uint64_t uncompressed_byte_length;
+};
+
+//a ktx2 file mapped into memory, limited to what the renderer can sample: single 2d images, with or without a
+//mip chain, and no supercompression. like MeshFile, Open only validates and the level pointers point into the mapping.
+//a file that opens has no more levels than its size has mips, each at least as long as its extent in the format's blocks
+class Ktx2File {
+public:
+	Ktx2File();
+	~Ktx2File();
+
+	bool Open(const std::string & path);
+	void Close();
+
+	VkFormat GetFormat() const;
+	uint32_t GetWidth() const;
+	uint32_t GetHeight() const;
+	//at least 1, even when the file asks for the chain to be generated
+	uint32_t GetLevelCount() const;
+	//the file only holds level 0 and leaves the rest of the chain to the loader
+	bool GetGenerateMips() const;
+	const void * GetLevelData(uint32_t level) const;
+	VkDeviceSize GetLevelSize(uint32_t level) const;
+	//the span of the file every level lies in, to hand to the uploader in one piece
+	const void * GetLevelsData() const;
+	VkDeviceSize GetLevelsSize() const;
+	//of level's data from GetLevelsData
+	VkDeviceSize GetLevelOffset(uint32_t level) const;
+private:
+	Ktx2File(const Ktx2File &);
+	Ktx2File & operator=(const Ktx2File &);
+
+	MappedFile m_file;
+	const Ktx2Header * m_header;
+	const Ktx2Level * m_levels;
+	uint64_t m_levels_begin;
+	uint64_t m_levels_end;
+};
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "MappedFile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() :
+	m_data(nullptr),
+	m_size(0)
+{
+#ifdef _WIN32
+	m_file = INVALID_HANDLE_VALUE;
+	m_mapping = NULL;
+#else
+	m_file = -1;
+#endif
+}
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string & path) {
+	Close();
+	m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (m_file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0) {
+		Close();
+		return false;
+	}
+	m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (m_mapping == NULL) {
+		Close();
+		return false;
+	}
+	m_data = (const uint8_t *)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (m_data == nullptr) {
+		Close();
+		return false;
+	}
+	m_size = (size_t)size.QuadPart;
+	return true;
+}
+
+void MappedFile::Close() {
+	if (m_data != nullptr) {
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mapping != NULL) {
+		CloseHandle(m_mapping);
+	}
+	if (m_file != INVALID_HANDLE_VALUE) {
+		CloseHandle(m_file);
+	}
+	m_data = nullptr;
+	m_size = 0;
+	m_mapping = NULL;
+	m_file = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool MappedFile::Open(const std::string & path) {
+	Close();
+	m_file = open(path.c_str(), O_RDONLY);
+	if (m_file < 0) {
+		return false;
+	}
+	struct stat file_stat;
+	if (fstat(m_file, &file_stat) != 0 || file_stat.st_size == 0) {
+		Close();
+		return false;
+	}
+	void * data = mmap(nullptr, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+	if (data == MAP_FAILED) {
+		Close();
+		return false;
+	}
+	m_data = (const uint8_t *)data;
+	m_size = (size_t)file_stat.st_size;
+	return true;
+}
+
+void MappedFile::Close() {
+	if (m_data != nullptr) {
+		munmap((void *)m_data, m_size);
+	}
+	if (m_file >= 0) {
+		close(m_file);
+	}
+	m_data = nullptr;
+	m_size = 0;
+	m_file = -1;
+}
+
+#endif
+
+const uint8_t * MappedFile::GetData() const {
+	return m_data;
+}
+
+size_t MappedFile::GetSize() const {
+	return m_size;
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Platform.h"
+#include <string>
+
+//read-only memory mapping of a whole file; the pages are only read in when touched
+class MappedFile {
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const std::string & path);
+	void Close();
+
+	const uint8_t * GetData() const;
+	size_t GetSize() const;
+private:
+	MappedFile(const MappedFile &);
+	MappedFile & operator=(const MappedFile &);
+
+	const uint8_t * m_data;
+	size_t m_size;
+
+#ifdef _WIN32
+	HANDLE m_file;
+	HANDLE m_mapping;
+#else
+	int m_file;
+#endif
+};
\ No newline at end of file
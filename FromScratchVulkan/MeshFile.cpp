@@ -0,0 +1,144 @@
+#include "MeshFile.h"
+#include "Shared.h"
+#include <string.h>
+#include <vector>
+
+static uint64_t align_up(uint64_t value, uint64_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+MeshFile::MeshFile() :
+	m_header(nullptr)
+{
+}
+
+MeshFile::~MeshFile() {
+	Close();
+}
+
+bool MeshFile::Open(const std::string & path) {
+	Close();
+	if (!m_file.Open(path)) {
+		return false;
+	}
+
+	//a file that doesn't check out is treated like a missing one, the caller falls back to whatever it had
+	uint64_t file_size = m_file.GetSize();
+	const MeshFileHeader * header = (const MeshFileHeader *)m_file.GetData();
+	bool valid = file_size >= sizeof(MeshFileHeader) && header->magic == MESH_FILE_MAGIC && header->version == MESH_FILE_VERSION
+		&& header->position_encoding <= VERTEX_POSITION_SNORM16 && (header->index_size == 2 || header->index_size == 4)
+		&& header->lod_count >= 1 && header->lod_count <= MESH_FILE_MAX_LODS
+		&& header->vertex_offset % MESH_FILE_ALIGNMENT == 0 && header->index_offset % MESH_FILE_ALIGNMENT == 0
+		&& header->vertex_offset <= file_size && header->vertex_size <= file_size - header->vertex_offset
+		&& header->index_offset <= file_size && header->index_size_bytes <= file_size - header->index_offset
+		&& header->vertex_size == (uint64_t)header->vertex_count * header->vertex_stride
+		&& header->index_size_bytes == (uint64_t)header->index_count * header->index_size;
+	if (valid) {
+		m_header = header;
+		valid = header->vertex_stride == VertexFormat::GetStride(GetLayout());
+		//lod 0 is the whole mesh and is drawn from the start of the index blob
+		valid = valid && header->lods[0].first_index == 0;
+		for (uint32_t i = 0; valid && i < header->lod_count; i++) {
+			valid = header->lods[i].first_index <= header->index_count && header->lods[i].index_count <= header->index_count - header->lods[i].first_index;
+		}
+	}
+	if (!valid) {
+		std::cout << "MeshFile: " << path << " is not a valid version " << MESH_FILE_VERSION << " mesh" << std::endl;
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MeshFile::Close() {
+	m_header = nullptr;
+	m_file.Close();
+}
+
+const MeshFileHeader & MeshFile::GetHeader() const {
+	return *m_header;
+}
+
+VertexLayout MeshFile::GetLayout() const {
+	VertexLayout layout{};
+	layout.position = (VertexPositionEncoding)m_header->position_encoding;
+	layout.colour = (m_header->attributes & MESH_FILE_ATTRIBUTE_COLOUR) != 0;
+	layout.normal = (m_header->attributes & MESH_FILE_ATTRIBUTE_NORMAL) != 0;
+	layout.uv = (m_header->attributes & MESH_FILE_ATTRIBUTE_UV) != 0;
+	return layout;
+}
+
+VertexQuantization MeshFile::GetQuantization() const {
+	VertexQuantization quantization;
+	quantization.offset = glm::vec3(m_header->quantization_offset[0], m_header->quantization_offset[1], m_header->quantization_offset[2]);
+	quantization.scale = glm::vec3(m_header->quantization_scale[0], m_header->quantization_scale[1], m_header->quantization_scale[2]);
+	return quantization;
+}
+
+VkIndexType MeshFile::GetIndexType() const {
+	return m_header->index_size == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+const void * MeshFile::GetVertexData() const {
+	return m_file.GetData() + m_header->vertex_offset;
+}
+
+VkDeviceSize MeshFile::GetVertexDataSize() const {
+	return m_header->vertex_size;
+}
+
+const void * MeshFile::GetIndexData() const {
+	return m_file.GetData() + m_header->index_offset;
+}
+
+VkDeviceSize MeshFile::GetIndexDataSize() const {
+	return m_header->index_size_bytes;
+}
+
+uint32_t MeshFile::GetLodCount() const {
+	return m_header->lod_count;
+}
+
+const MeshFileLod & MeshFile::GetLod(uint32_t lod) const {
+	return m_header->lods[lod];
+}
+
+bool MeshFile::Write(const std::string & path, const MeshFileContents & contents) {
+	if (contents.lod_count < 1 || contents.lod_count > MESH_FILE_MAX_LODS || (contents.index_size != 2 && contents.index_size != 4)) {
+		assert(0 && "MeshFile ERROR: a mesh needs 1 to MESH_FILE_MAX_LODS lods and 16 or 32 bit indices");
+		return false;
+	}
+
+	MeshFileHeader header{};
+	header.magic = MESH_FILE_MAGIC;
+	header.version = MESH_FILE_VERSION;
+	header.vertex_count = contents.vertex_count;
+	header.index_count = contents.index_count;
+	header.vertex_stride = VertexFormat::GetStride(contents.layout);
+	header.index_size = contents.index_size;
+	header.position_encoding = contents.layout.position;
+	header.attributes = (contents.layout.colour ? MESH_FILE_ATTRIBUTE_COLOUR : 0) | (contents.layout.normal ? MESH_FILE_ATTRIBUTE_NORMAL : 0) | (contents.layout.uv ? MESH_FILE_ATTRIBUTE_UV : 0);
+	for (uint32_t i = 0; i < 3; i++) {
+		header.quantization_offset[i] = contents.quantization.offset[i];
+		header.quantization_scale[i] = contents.quantization.scale[i];
+		header.bounds_min[i] = contents.bounds_min[i];
+		header.bounds_max[i] = contents.bounds_max[i];
+	}
+	for (uint32_t i = 0; i < 4; i++) {
+		header.bounding_sphere[i] = contents.bounding_sphere[i];
+	}
+	header.lod_count = contents.lod_count;
+	memcpy(header.lods, contents.lods, contents.lod_count * sizeof(MeshFileLod));
+
+	header.vertex_offset = align_up(sizeof(MeshFileHeader), MESH_FILE_ALIGNMENT);
+	header.vertex_size = (uint64_t)contents.vertex_count * header.vertex_stride;
+	header.index_offset = align_up(header.vertex_offset + header.vertex_size, MESH_FILE_ALIGNMENT);
+	header.index_size_bytes = (uint64_t)contents.index_count * contents.index_size;
+
+	//the padding is zeroed so the same mesh always converts to the same bytes
+	std::vector<uint8_t> data((size_t)(header.index_offset + header.index_size_bytes), 0);
+	memcpy(data.data(), &header, sizeof(header));
+	memcpy(data.data() + header.vertex_offset, contents.vertices, (size_t)header.vertex_size);
+	memcpy(data.data() + header.index_offset, contents.indices, (size_t)header.index_size_bytes);
+	return write_file_atomic(path, data.data(), data.size());
+}
\ No newline at end of file
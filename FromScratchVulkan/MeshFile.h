@@ -0,0 +1,106 @@
+#pragma once
+
+#include "Platform.h"
+#include "MappedFile.h"
+#include "VertexFormat.h"
+#include <string>
+
+//"FSVM" read as a little endian uint32
+#define MESH_FILE_MAGIC 0x4d565346u
+#define MESH_FILE_VERSION 1
+//blobs start on this boundary so they can be handed to the uploader, or memcpy'd, straight out of the mapping
+#define MESH_FILE_ALIGNMENT 256
+#define MESH_FILE_MAX_LODS 8
+//MeshFileHeader::attributes, the vertex layout beyond its position
+#define MESH_FILE_ATTRIBUTE_COLOUR 0x1u
+#define MESH_FILE_ATTRIBUTE_NORMAL 0x2u
+#define MESH_FILE_ATTRIBUTE_UV 0x4u
+
+//a range of the index blob drawn at one level of detail. lod 0 is the full mesh and starts at index 0
+struct MeshFileLod {
+	uint32_t first_index;
+	uint32_t index_count;
+	//largest distance, in mesh units, a vertex moved to get here from lod 0
+	float error;
+	uint32_t reserved;
+};
+
+//everything a loader needs sits in this one block at the start of the file; the blobs follow at the offsets
+//it gives. all fields are little endian and the struct is laid out with no implicit padding
+struct MeshFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertex_count;
+	uint32_t index_count;
+	uint32_t vertex_stride;
+	//2 or 4
+	uint32_t index_size;
+	//VertexPositionEncoding
+	uint32_t position_encoding;
+	//MESH_FILE_ATTRIBUTE_ bits
+	uint32_t attributes;
+	float quantization_offset[3];
+	float quantization_scale[3];
+	float bounds_min[3];
+	float bounds_max[3];
+	//xyz centre, w radius
+	float bounding_sphere[4];
+	uint32_t lod_count;
+	uint32_t reserved;
+	uint64_t vertex_offset;
+	uint64_t vertex_size;
+	uint64_t index_offset;
+	uint64_t index_size_bytes;
+	MeshFileLod lods[MESH_FILE_MAX_LODS];
+};
+
+static_assert(sizeof(MeshFileHeader) == 136 + MESH_FILE_MAX_LODS * sizeof(MeshFileLod), "MeshFileHeader must have no padding");
+
+//what a writer hands over; the blobs must already be encoded in layout
+struct MeshFileContents {
+	VertexLayout layout;
+	VertexQuantization quantization;
+	glm::vec3 bounds_min;
+	glm::vec3 bounds_max;
+	glm::vec4 bounding_sphere;
+	const void * vertices;
+	uint32_t vertex_count;
+	//uint16_t when index_size is 2, uint32_t when it is 4
+	const void * indices;
+	uint32_t index_count;
+	uint32_t index_size;
+	const MeshFileLod * lods;
+	uint32_t lod_count;
+};
+
+//a mesh file mapped into memory. Open only checks that the header is sane and its ranges lie inside the file;
+//nothing is parsed or copied, the blob pointers point into the mapping and stay valid until Close
+class MeshFile {
+public:
+	MeshFile();
+	~MeshFile();
+
+	bool Open(const std::string & path);
+	void Close();
+
+	const MeshFileHeader & GetHeader() const;
+	VertexLayout GetLayout() const;
+	VertexQuantization GetQuantization() const;
+	VkIndexType GetIndexType() const;
+
+	const void * GetVertexData() const;
+	VkDeviceSize GetVertexDataSize() const;
+	const void * GetIndexData() const;
+	VkDeviceSize GetIndexDataSize() const;
+
+	uint32_t GetLodCount() const;
+	const MeshFileLod & GetLod(uint32_t lod) const;
+
+	static bool Write(const std::string & path, const MeshFileContents & contents);
+private:
+	MeshFile(const MeshFile &);
+	MeshFile & operator=(const MeshFile &);
+
+	MappedFile m_file;
+	const MeshFileHeader * m_header;
+};
\ No newline at end of file
@@ -0,0 +1,249 @@
+#include "MeshProcessing.h"
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+//forsyth scores every vertex by where it sits in the simulated cache and how many triangles still need it,
+//the lookup tables cover every cache position and the common valences
+#define MESH_FORSYTH_VALENCE_TABLE_SIZE 64
+
+struct ForsythTables {
+	float cache[MESH_FORSYTH_CACHE_SIZE];
+	float valence[MESH_FORSYTH_VALENCE_TABLE_SIZE];
+
+	ForsythTables() {
+		for (uint32_t i = 0; i < MESH_FORSYTH_CACHE_SIZE; i++) {
+			//the three vertices of the triangle just emitted get a fixed score so the next one doesn't just reuse them
+			if (i < 3) {
+				cache[i] = MESH_FORSYTH_LAST_TRIANGLE_SCORE;
+			} else {
+				float scale = 1.0f / (MESH_FORSYTH_CACHE_SIZE - 3);
+				cache[i] = std::pow(1.0f - (i - 3) * scale, MESH_FORSYTH_CACHE_DECAY_POWER);
+			}
+		}
+		valence[0] = 0.0f;
+		for (uint32_t i = 1; i < MESH_FORSYTH_VALENCE_TABLE_SIZE; i++) {
+			valence[i] = MESH_FORSYTH_VALENCE_BOOST_SCALE * std::pow((float)i, -MESH_FORSYTH_VALENCE_BOOST_POWER);
+		}
+	}
+};
+
+static float forsyth_vertex_score(const ForsythTables & tables, int32_t cache_position, uint32_t active_triangles) {
+	if (active_triangles == 0) {
+		return -1.0f;
+	}
+	float score = cache_position < 0 ? 0.0f : tables.cache[cache_position];
+	if (active_triangles < MESH_FORSYTH_VALENCE_TABLE_SIZE) {
+		score += tables.valence[active_triangles];
+	} else {
+		score += MESH_FORSYTH_VALENCE_BOOST_SCALE * std::pow((float)active_triangles, -MESH_FORSYTH_VALENCE_BOOST_POWER);
+	}
+	return score;
+}
+
+IndexedMesh MeshProcessing::Weld(const vertex_data * vertices, uint32_t vertex_count) {
+	IndexedMesh mesh;
+	mesh.indices.resize(vertex_count);
+
+	//open addressing on the fnv hash of the raw bytes, the table holds indices into mesh.vertices
+	uint32_t table_size = 1;
+	while (table_size < vertex_count * 2) {
+		table_size *= 2;
+	}
+	std::vector<uint32_t> table(table_size, UINT32_MAX);
+
+	for (uint32_t i = 0; i < vertex_count; i++) {
+		uint32_t slot = (uint32_t)fnv1a_64(&vertices[i], sizeof(vertex_data)) & (table_size - 1);
+		while (table[slot] != UINT32_MAX && memcmp(&mesh.vertices[table[slot]], &vertices[i], sizeof(vertex_data)) != 0) {
+			slot = (slot + 1) & (table_size - 1);
+		}
+		if (table[slot] == UINT32_MAX) {
+			table[slot] = (uint32_t)mesh.vertices.size();
+			mesh.vertices.push_back(vertices[i]);
+		}
+		mesh.indices[i] = table[slot];
+	}
+	return mesh;
+}
+
+void MeshProcessing::OptimizeVertexCache(std::vector<uint32_t> & indices, uint32_t vertex_count) {
+	static const ForsythTables tables;
+	uint32_t triangle_count = (uint32_t)(indices.size() / 3);
+	if (triangle_count == 0) {
+		return;
+	}
+
+	//each vertex's live triangles sit in its own slice of adjacency; emitted ones are swapped past the end
+	std::vector<uint32_t> active_triangles(vertex_count, 0);
+	for (uint32_t i = 0; i < triangle_count * 3; i++) {
+		active_triangles[indices[i]]++;
+	}
+	std::vector<uint32_t> offsets(vertex_count + 1, 0);
+	for (uint32_t v = 0; v < vertex_count; v++) {
+		offsets[v + 1] = offsets[v] + active_triangles[v];
+	}
+	std::vector<uint32_t> adjacency(triangle_count * 3);
+	std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+	for (uint32_t i = 0; i < triangle_count * 3; i++) {
+		adjacency[fill[indices[i]]++] = i / 3;
+	}
+
+	std::vector<int32_t> cache_positions(vertex_count, -1);
+	std::vector<float> vertex_scores(vertex_count);
+	for (uint32_t v = 0; v < vertex_count; v++) {
+		vertex_scores[v] = forsyth_vertex_score(tables, -1, active_triangles[v]);
+	}
+
+	std::vector<float> triangle_scores(triangle_count);
+	std::vector<bool> emitted(triangle_count, false);
+	uint32_t best_triangle = UINT32_MAX;
+	float best_score = -1.0f;
+	for (uint32_t t = 0; t < triangle_count; t++) {
+		triangle_scores[t] = vertex_scores[indices[t * 3 + 0]] + vertex_scores[indices[t * 3 + 1]] + vertex_scores[indices[t * 3 + 2]];
+		if (triangle_scores[t] > best_score) {
+			best_score = triangle_scores[t];
+			best_triangle = t;
+		}
+	}
+
+	//the triangle's vertices go in at the front, so the cache can briefly hold three more than its size
+	uint32_t cache[MESH_FORSYTH_CACHE_SIZE + 3];
+	uint32_t new_cache[MESH_FORSYTH_CACHE_SIZE + 3];
+	uint32_t cache_count = 0;
+	uint32_t scan_cursor = 0;
+	std::vector<uint32_t> output;
+	output.reserve(triangle_count * 3);
+
+	for (uint32_t emitted_count = 0; emitted_count < triangle_count; emitted_count++) {
+		//nothing in the cache touches a live triangle any more, restart from the first one left
+		if (best_triangle == UINT32_MAX) {
+			while (emitted[scan_cursor]) {
+				scan_cursor++;
+			}
+			best_triangle = scan_cursor;
+		}
+
+		const uint32_t * triangle = &indices[best_triangle * 3];
+		output.insert(output.end(), triangle, triangle + 3);
+		emitted[best_triangle] = true;
+
+		uint32_t new_count = 0;
+		for (uint32_t k = 0; k < 3; k++) {
+			uint32_t v = triangle[k];
+			uint32_t * list = &adjacency[offsets[v]];
+			for (uint32_t j = 0; j < active_triangles[v]; j++) {
+				if (list[j] == best_triangle) {
+					std::swap(list[j], list[active_triangles[v] - 1]);
+					break;
+				}
+			}
+			active_triangles[v]--;
+
+			//degenerate triangles name a vertex twice, it only goes in the cache once
+			if (std::find(new_cache, new_cache + new_count, v) == new_cache + new_count) {
+				new_cache[new_count++] = v;
+			}
+		}
+		uint32_t triangle_vertices = new_count;
+		for (uint32_t i = 0; i < cache_count; i++) {
+			if (std::find(new_cache, new_cache + triangle_vertices, cache[i]) == new_cache + triangle_vertices) {
+				new_cache[new_count++] = cache[i];
+			}
+		}
+
+		//anything pushed past the end was evicted and scores as if it was never loaded
+		for (uint32_t i = 0; i < new_count; i++) {
+			uint32_t v = new_cache[i];
+			cache_positions[v] = i < MESH_FORSYTH_CACHE_SIZE ? (int32_t)i : -1;
+			vertex_scores[v] = forsyth_vertex_score(tables, cache_positions[v], active_triangles[v]);
+		}
+		cache_count = std::min(new_count, (uint32_t)MESH_FORSYTH_CACHE_SIZE);
+		memcpy(cache, new_cache, cache_count * sizeof(uint32_t));
+
+		//only triangles around vertices whose score just changed can become the best
+		best_triangle = UINT32_MAX;
+		best_score = -1.0f;
+		for (uint32_t i = 0; i < new_count; i++) {
+			uint32_t v = new_cache[i];
+			for (uint32_t j = 0; j < active_triangles[v]; j++) {
+				uint32_t t = adjacency[offsets[v] + j];
+				triangle_scores[t] = vertex_scores[indices[t * 3 + 0]] + vertex_scores[indices[t * 3 + 1]] + vertex_scores[indices[t * 3 + 2]];
+				if (triangle_scores[t] > best_score) {
+					best_score = triangle_scores[t];
+					best_triangle = t;
+				}
+			}
+		}
+	}
+
+	indices.swap(output);
+}
+
+void MeshProcessing::OptimizeVertexFetch(IndexedMesh & mesh) {
+	std::vector<uint32_t> remap;
+	std::vector<uint32_t> order(OptimizeVertexFetchRemap(mesh.indices, (uint32_t)mesh.vertices.size(), remap));
+	for (uint32_t i = 0; i < mesh.vertices.size(); i++) {
+		if (remap[i] != UINT32_MAX) {
+			order[remap[i]] = i;
+		}
+	}
+
+	std::vector<vertex_data> vertices;
+	vertices.reserve(order.size());
+	for (uint32_t i = 0; i < order.size(); i++) {
+		vertices.push_back(mesh.vertices[order[i]]);
+	}
+	mesh.vertices.swap(vertices);
+}
+
+uint32_t MeshProcessing::OptimizeVertexFetchRemap(std::vector<uint32_t> & indices, uint32_t vertex_count, std::vector<uint32_t> & remap) {
+	remap.assign(vertex_count, UINT32_MAX);
+	uint32_t next = 0;
+	for (uint32_t i = 0; i < indices.size(); i++) {
+		uint32_t & index = indices[i];
+		if (remap[index] == UINT32_MAX) {
+			remap[index] = next++;
+		}
+		index = remap[index];
+	}
+	return next;
+}
+
+double MeshProcessing::ComputeACMR(const uint32_t * indices, uint32_t index_count, uint32_t vertex_count, uint32_t cache_size) {
+	if (index_count < 3) {
+		return 0.0;
+	}
+
+	//a vertex is still in the fifo when fewer than cache_size misses happened since it was loaded
+	std::vector<uint32_t> load_times(vertex_count, 0);
+	uint32_t time = cache_size + 1;
+	uint32_t misses = 0;
+	for (uint32_t i = 0; i < index_count; i++) {
+		uint32_t v = indices[i];
+		if (time - load_times[v] > cache_size) {
+			load_times[v] = time++;
+			misses++;
+		}
+	}
+	return (double)misses / (index_count / 3);
+}
+
+IndexedMesh MeshProcessing::Optimize(const vertex_data * vertices, uint32_t vertex_count, double * acmr_before, double * acmr_after) {
+	IndexedMesh mesh = Weld(vertices, vertex_count);
+	if (acmr_before != nullptr) {
+		*acmr_before = ComputeACMR(mesh.indices.data(), (uint32_t)mesh.indices.size(), (uint32_t)mesh.vertices.size());
+	}
+
+	OptimizeVertexCache(mesh.indices, (uint32_t)mesh.vertices.size());
+	//fetch order follows the new triangle order, so it has to come second
+	OptimizeVertexFetch(mesh);
+
+	if (acmr_after != nullptr) {
+		*acmr_after = ComputeACMR(mesh.indices.data(), (uint32_t)mesh.indices.size(), (uint32_t)mesh.vertices.size());
+	}
+	return mesh;
+}
+
+bool MeshProcessing::FitsUint16(const IndexedMesh & mesh) {
+	return mesh.vertices.size() < 0xffff;
+}
\ No newline at end of file
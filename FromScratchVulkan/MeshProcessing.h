@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Platform.h"
+#include "Shared.h"
+#include <vector>
+
+//size of the lru cache forsyth's scoring models; larger than real hardware so it also suits newer gpus
+#define MESH_FORSYTH_CACHE_SIZE 32
+#define MESH_FORSYTH_CACHE_DECAY_POWER 1.5f
+#define MESH_FORSYTH_LAST_TRIANGLE_SCORE 0.75f
+#define MESH_FORSYTH_VALENCE_BOOST_SCALE 2.0f
+#define MESH_FORSYTH_VALENCE_BOOST_POWER 0.5f
+//fifo size ComputeACMR simulates by default
+#define MESH_ACMR_CACHE_SIZE 16
+
+struct IndexedMesh {
+	std::vector<vertex_data> vertices;
+	std::vector<uint32_t> indices;
+};
+
+//turns triangle soup into an indexed mesh laid out for the post-transform cache and vertex fetch
+namespace MeshProcessing {
+	//collapses bitwise identical vertices, keeping them in the order they were first seen
+	IndexedMesh Weld(const vertex_data * vertices, uint32_t vertex_count);
+	//reorders triangles with tom forsyth's linear-speed vertex cache optimisation
+	void OptimizeVertexCache(std::vector<uint32_t> & indices, uint32_t vertex_count);
+	//renumbers vertices in the order the indices first use them and drops unreferenced ones
+	void OptimizeVertexFetch(IndexedMesh & mesh);
+	//the same for vertices kept elsewhere: renumbers indices in place and sets remap[old] to each vertex's new index,
+	//UINT32_MAX for unreferenced ones. returns how many vertices are left
+	uint32_t OptimizeVertexFetchRemap(std::vector<uint32_t> & indices, uint32_t vertex_count, std::vector<uint32_t> & remap);
+	//average cache miss ratio: vertices transformed per triangle through a fifo of cache_size entries. 3 is the worst, ~0.5 the best a regular grid gets
+	double ComputeACMR(const uint32_t * indices, uint32_t index_count, uint32_t vertex_count, uint32_t cache_size = MESH_ACMR_CACHE_SIZE);
+	//weld, cache and fetch optimisation in one go. acmr_before is measured on the welded mesh in its original triangle order
+	IndexedMesh Optimize(const vertex_data * vertices, uint32_t vertex_count, double * acmr_before = nullptr, double * acmr_after = nullptr);
+	//16 bit indices are enough when no index reaches 0xffff, which is kept free for primitive restart
+	bool FitsUint16(const IndexedMesh & mesh);
+}
\ No newline at end of file
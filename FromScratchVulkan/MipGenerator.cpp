@@ -0,0 +1,461 @@
+#include "MipGenerator.h"
+#include "Renderer.h"
+#include "Uploader.h"
+#include "ShaderCompiler.h"
+#include "Shared.h"
+#include "Trace.h"
+#include <algorithm>
+
+//each invocation averages the 2x2 texels of the level above that land on its texel; odd sizes clamp, so the
+//last row and column of the source are counted twice
+static const char * mip_shader_text =
+	"#version 450\n"
+	"layout (local_size_x = 8, local_size_y = 8) in;\n"
+	"layout (binding = 0, FORMAT) uniform readonly image2D source;\n"
+	"layout (binding = 1, FORMAT) uniform writeonly image2D destination;\n"
+	"void main() {\n"
+	"   ivec2 texel = ivec2(gl_GlobalInvocationID.xy);\n"
+	"   ivec2 size = imageSize(destination);\n"
+	"   if (texel.x >= size.x || texel.y >= size.y) {\n"
+	"       return;\n"
+	"   }\n"
+	"   ivec2 last = imageSize(source) - ivec2(1);\n"
+	"   ivec2 base = texel * 2;\n"
+	"   vec4 sum = imageLoad(source, min(base, last)) + imageLoad(source, min(base + ivec2(1, 0), last))\n"
+	"       + imageLoad(source, min(base + ivec2(0, 1), last)) + imageLoad(source, min(base + ivec2(1, 1), last));\n"
+	"   imageStore(destination, texel, sum * 0.25);\n"
+	"}\n";
+
+MipGenerator::MipGenerator(Renderer * renderer) :
+	m_renderer(renderer),
+	m_device(renderer->GetVulkanDevice()),
+	m_descriptor_set_layout(VK_NULL_HANDLE),
+	m_pipeline_layout(VK_NULL_HANDLE),
+	m_command_pool(VK_NULL_HANDLE),
+	m_next_token(1),
+	m_completed_token(0)
+{
+	InitComputePipelines();
+
+	VkCommandPoolCreateInfo pool_info{};
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.queueFamilyIndex = m_renderer->GetQueueFamilyIndex(QUEUE_GRAPHICS);
+	pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	ErrorCheck(vkCreateCommandPool(m_device, &pool_info, VK_NULL_HANDLE, &m_command_pool));
+
+	VkCommandBuffer command_buffers[MIP_GENERATOR_MAX_BATCHES];
+	VkCommandBufferAllocateInfo command_buffer_info{};
+	command_buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	command_buffer_info.commandPool = m_command_pool;
+	command_buffer_info.commandBufferCount = MIP_GENERATOR_MAX_BATCHES;
+	command_buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	ErrorCheck(vkAllocateCommandBuffers(m_device, &command_buffer_info, command_buffers));
+
+	VkFenceCreateInfo fence_create_info{};
+	fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	for (uint32_t i = 0; i < MIP_GENERATOR_MAX_BATCHES; i++) {
+		m_batches[i].command_buffer = command_buffers[i];
+		m_batches[i].token = 0;
+		m_batches[i].descriptor_pool = VK_NULL_HANDLE;
+		ErrorCheck(vkCreateFence(m_device, &fence_create_info, VK_NULL_HANDLE, &m_batches[i].fence));
+	}
+}
+
+MipGenerator::~MipGenerator() {
+	//anything queued but never flushed is dropped
+	RetireUntil(m_next_token - 1);
+	for (uint32_t i = 0; i < MIP_GENERATOR_MAX_BATCHES; i++) {
+		vkDestroyFence(m_device, m_batches[i].fence, VK_NULL_HANDLE);
+	}
+	vkDestroyCommandPool(m_device, m_command_pool, VK_NULL_HANDLE);
+	DeInitComputePipelines();
+}
+
+void MipGenerator::InitComputePipelines() {
+	//the formats the fallback knows a qualifier for, kept to the ones this device can store to
+	const ComputeFormat candidates[] = {
+		{ VK_FORMAT_R8G8B8A8_UNORM, "rgba8", VK_NULL_HANDLE, VK_NULL_HANDLE },
+		{ VK_FORMAT_R16G16B16A16_SFLOAT, "rgba16f", VK_NULL_HANDLE, VK_NULL_HANDLE },
+		{ VK_FORMAT_R32G32B32A32_SFLOAT, "rgba32f", VK_NULL_HANDLE, VK_NULL_HANDLE },
+	};
+	std::vector<ShaderCompileJob> jobs;
+	for (uint32_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++) {
+		VkFormatProperties format_properties;
+		vkGetPhysicalDeviceFormatProperties(m_renderer->GetVulkanPhysicalDevice(), candidates[i].format, &format_properties);
+		if ((format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) != 0) {
+			m_compute_formats.push_back(candidates[i]);
+			ShaderCompileJob job;
+			job.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+			job.source = mip_shader_text;
+			job.defines.push_back(std::string("FORMAT ") + candidates[i].qualifier);
+			jobs.push_back(job);
+		}
+	}
+	if (jobs.empty()) {
+		return;
+	}
+
+	VkDescriptorSetLayoutBinding descriptor_set_layout_bindings[MIP_GENERATOR_BINDING_COUNT];
+	for (uint32_t i = 0; i < MIP_GENERATOR_BINDING_COUNT; i++) {
+		descriptor_set_layout_bindings[i] = {};
+		descriptor_set_layout_bindings[i].binding = i;
+		descriptor_set_layout_bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		descriptor_set_layout_bindings[i].descriptorCount = 1;
+		descriptor_set_layout_bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info{};
+	descriptor_set_layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	descriptor_set_layout_create_info.bindingCount = MIP_GENERATOR_BINDING_COUNT;
+	descriptor_set_layout_create_info.pBindings = descriptor_set_layout_bindings;
+
+	ErrorCheck(vkCreateDescriptorSetLayout(m_device, &descriptor_set_layout_create_info, VK_NULL_HANDLE, &m_descriptor_set_layout));
+
+	VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
+	pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipeline_layout_create_info.setLayoutCount = 1;
+	pipeline_layout_create_info.pSetLayouts = &m_descriptor_set_layout;
+
+	ErrorCheck(vkCreatePipelineLayout(m_device, &pipeline_layout_create_info, VK_NULL_HANDLE, &m_pipeline_layout));
+
+	std::vector<std::future<ShaderCompileResult>> results = m_renderer->GetShaderCompiler()->CompileBatch(jobs);
+	for (uint32_t i = 0; i < jobs.size(); i++) {
+		ShaderCompileResult result = results[i].get();
+		if (!result.success) {
+			std::cout << result.log << std::endl;
+			assert(0 && "MipGenerator ERROR: the mip shader could not be converted from GLSL to SPIR_V");
+			continue;
+		}
+
+		VkShaderModuleCreateInfo shader_module_create_info{};
+		shader_module_create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		shader_module_create_info.codeSize = result.spirv.size() * sizeof(unsigned int);
+		shader_module_create_info.pCode = result.spirv.data();
+
+		ErrorCheck(vkCreateShaderModule(m_device, &shader_module_create_info, VK_NULL_HANDLE, &m_compute_formats[i].module));
+
+		VkComputePipelineCreateInfo compute_pipeline_create_info{};
+		compute_pipeline_create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		compute_pipeline_create_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		compute_pipeline_create_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		compute_pipeline_create_info.stage.module = m_compute_formats[i].module;
+		compute_pipeline_create_info.stage.pName = "main";
+		compute_pipeline_create_info.layout = m_pipeline_layout;
+		compute_pipeline_create_info.basePipelineHandle = VK_NULL_HANDLE;
+		compute_pipeline_create_info.basePipelineIndex = -1;
+
+		ErrorCheck(vkCreateComputePipelines(m_device, m_renderer->GetPipelineCache(), 1, &compute_pipeline_create_info, VK_NULL_HANDLE, &m_compute_formats[i].pipeline));
+	}
+}
+
+void MipGenerator::DeInitComputePipelines() {
+	for (uint32_t i = 0; i < m_compute_formats.size(); i++) {
+		if (m_compute_formats[i].pipeline != VK_NULL_HANDLE) {
+			vkDestroyPipeline(m_device, m_compute_formats[i].pipeline, VK_NULL_HANDLE);
+			vkDestroyShaderModule(m_device, m_compute_formats[i].module, VK_NULL_HANDLE);
+		}
+	}
+	m_compute_formats.clear();
+	if (m_pipeline_layout != VK_NULL_HANDLE) {
+		vkDestroyPipelineLayout(m_device, m_pipeline_layout, VK_NULL_HANDLE);
+		vkDestroyDescriptorSetLayout(m_device, m_descriptor_set_layout, VK_NULL_HANDLE);
+	}
+}
+
+MipGenerationMethod MipGenerator::GetMethod(VkFormat format) const {
+	VkFormatProperties format_properties;
+	vkGetPhysicalDeviceFormatProperties(m_renderer->GetVulkanPhysicalDevice(), format, &format_properties);
+	VkFormatFeatureFlags blit_features = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	if ((format_properties.optimalTilingFeatures & blit_features) == blit_features) {
+		return MIP_GENERATION_BLIT;
+	}
+	for (uint32_t i = 0; i < m_compute_formats.size(); i++) {
+		if (m_compute_formats[i].format == format && m_compute_formats[i].pipeline != VK_NULL_HANDLE) {
+			return MIP_GENERATION_COMPUTE;
+		}
+	}
+	return MIP_GENERATION_NONE;
+}
+
+VkImageUsageFlags MipGenerator::GetUsage(MipGenerationMethod method) {
+	switch (method) {
+	case MIP_GENERATION_BLIT:
+		return VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	case MIP_GENERATION_COMPUTE:
+		return VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	default:
+		return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	}
+}
+
+VkImageLayout MipGenerator::GetUploadLayout(MipGenerationMethod method) {
+	switch (method) {
+	case MIP_GENERATION_BLIT:
+		return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	case MIP_GENERATION_COMPUTE:
+		return VK_IMAGE_LAYOUT_GENERAL;
+	default:
+		return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	}
+}
+
+uint64_t MipGenerator::Generate(VkImage image, VkFormat format, uint32_t width, uint32_t height, uint32_t mip_levels) {
+	Request request;
+	request.image = image;
+	request.format = format;
+	request.width = width;
+	request.height = height;
+	request.mip_levels = mip_levels;
+	request.method = GetMethod(format);
+	if (request.method == MIP_GENERATION_NONE) {
+		assert(0 && "MipGenerator ERROR: the format can be neither blitted nor stored to, create the texture without mipmaps");
+		return 0;
+	}
+	m_requests.push_back(request);
+	return m_next_token;
+}
+
+uint64_t MipGenerator::Flush() {
+	//the copies into level 0 have to be ahead of the blits in the graphics queue
+	m_renderer->GetUploader()->Flush();
+	Poll();
+	if (m_requests.empty()) {
+		return m_next_token - 1;
+	}
+	TRACE_ZONE("flush mip generation");
+
+	uint64_t token = m_next_token;
+	Batch & batch = m_batches[token % MIP_GENERATOR_MAX_BATCHES];
+	if (batch.token != 0) {
+		RetireUntil(batch.token);
+	}
+	ErrorCheck(vkResetFences(m_device, 1, &batch.fence));
+
+	//one set per compute step, each naming a level and the one above it
+	uint32_t set_count = 0;
+	for (uint32_t i = 0; i < m_requests.size(); i++) {
+		if (m_requests[i].method == MIP_GENERATION_COMPUTE) {
+			set_count += m_requests[i].mip_levels - 1;
+		}
+	}
+	if (set_count > 0) {
+		VkDescriptorPoolSize descriptor_pool_size{};
+		descriptor_pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		descriptor_pool_size.descriptorCount = set_count * MIP_GENERATOR_BINDING_COUNT;
+
+		VkDescriptorPoolCreateInfo descriptor_pool_create_info{};
+		descriptor_pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		descriptor_pool_create_info.maxSets = set_count;
+		descriptor_pool_create_info.poolSizeCount = 1;
+		descriptor_pool_create_info.pPoolSizes = &descriptor_pool_size;
+
+		ErrorCheck(vkCreateDescriptorPool(m_device, &descriptor_pool_create_info, VK_NULL_HANDLE, &batch.descriptor_pool));
+	}
+
+	VkCommandBufferBeginInfo command_buffer_begin_info{};
+	command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	ErrorCheck(vkBeginCommandBuffer(batch.command_buffer, &command_buffer_begin_info));
+	for (uint32_t i = 0; i < m_requests.size(); i++) {
+		if (m_requests[i].method == MIP_GENERATION_BLIT) {
+			RecordBlit(batch.command_buffer, m_requests[i]);
+		} else {
+			RecordCompute(batch.command_buffer, batch, m_requests[i]);
+		}
+	}
+	ErrorCheck(vkEndCommandBuffer(batch.command_buffer));
+
+	VkSubmitInfo submit_info{};
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &batch.command_buffer;
+	m_renderer->Submit(QUEUE_GRAPHICS, 1, &submit_info, batch.fence);
+
+	batch.token = token;
+	m_requests.clear();
+	m_next_token++;
+	return token;
+}
+
+bool MipGenerator::IsComplete(uint64_t token) {
+	Poll();
+	return token <= m_completed_token;
+}
+
+void MipGenerator::Wait(uint64_t token) {
+	if (token >= m_next_token) {
+		Flush();
+	}
+	RetireUntil(token);
+}
+
+void MipGenerator::RecordBlit(VkCommandBuffer command_buffer, const Request & request) {
+	VkImageMemoryBarrier image_barrier{};
+	image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	image_barrier.image = request.image;
+	image_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	image_barrier.subresourceRange.levelCount = 1;
+	image_barrier.subresourceRange.layerCount = 1;
+
+	//each level is read back as the source of the next as soon as it is written, so level 0 is the only one
+	//that ever comes from memory
+	int32_t width = (int32_t)request.width;
+	int32_t height = (int32_t)request.height;
+	for (uint32_t level = 1; level < request.mip_levels; level++) {
+		//nothing was uploaded into this level, its contents can be thrown away
+		image_barrier.subresourceRange.baseMipLevel = level;
+		image_barrier.srcAccessMask = 0;
+		image_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		image_barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		image_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, VK_NULL_HANDLE, 0, VK_NULL_HANDLE, 1, &image_barrier);
+
+		VkImageBlit blit{};
+		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.srcSubresource.mipLevel = level - 1;
+		blit.srcSubresource.layerCount = 1;
+		blit.srcOffsets[1] = { width, height, 1 };
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.dstSubresource.mipLevel = level;
+		blit.dstSubresource.layerCount = 1;
+		blit.dstOffsets[1] = { width, height, 1 };
+		vkCmdBlitImage(command_buffer, request.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, request.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+		image_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		image_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		image_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		image_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, VK_NULL_HANDLE, 0, VK_NULL_HANDLE, 1, &image_barrier);
+	}
+
+	image_barrier.subresourceRange.baseMipLevel = 0;
+	image_barrier.subresourceRange.levelCount = request.mip_levels;
+	image_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	image_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	image_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	image_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 0, VK_NULL_HANDLE, 0, VK_NULL_HANDLE, 1, &image_barrier);
+}
+
+void MipGenerator::RecordCompute(VkCommandBuffer command_buffer, Batch & batch, const Request & request) {
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	for (uint32_t i = 0; i < m_compute_formats.size(); i++) {
+		if (m_compute_formats[i].format == request.format) {
+			pipeline = m_compute_formats[i].pipeline;
+		}
+	}
+
+	//a storage image binds a single level, so every level gets a view of its own
+	size_t first_view = batch.image_views.size();
+	for (uint32_t level = 0; level < request.mip_levels; level++) {
+		VkImageViewCreateInfo image_view_create_info{};
+		image_view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		image_view_create_info.image = request.image;
+		image_view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		image_view_create_info.format = request.format;
+		image_view_create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		image_view_create_info.subresourceRange.baseMipLevel = level;
+		image_view_create_info.subresourceRange.levelCount = 1;
+		image_view_create_info.subresourceRange.layerCount = 1;
+
+		VkImageView image_view;
+		ErrorCheck(vkCreateImageView(m_device, &image_view_create_info, VK_NULL_HANDLE, &image_view));
+		batch.image_views.push_back(image_view);
+	}
+
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+
+	VkImageMemoryBarrier image_barrier{};
+	image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	image_barrier.image = request.image;
+	image_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	image_barrier.subresourceRange.levelCount = 1;
+	image_barrier.subresourceRange.layerCount = 1;
+	image_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	image_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	image_barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+	image_barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	uint32_t width = request.width;
+	uint32_t height = request.height;
+	for (uint32_t level = 1; level < request.mip_levels; level++) {
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+
+		VkDescriptorSetAllocateInfo descriptor_set_allocate_info{};
+		descriptor_set_allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		descriptor_set_allocate_info.descriptorPool = batch.descriptor_pool;
+		descriptor_set_allocate_info.descriptorSetCount = 1;
+		descriptor_set_allocate_info.pSetLayouts = &m_descriptor_set_layout;
+
+		VkDescriptorSet descriptor_set;
+		ErrorCheck(vkAllocateDescriptorSets(m_device, &descriptor_set_allocate_info, &descriptor_set));
+
+		VkDescriptorImageInfo image_infos[MIP_GENERATOR_BINDING_COUNT];
+		image_infos[0] = { VK_NULL_HANDLE, batch.image_views[first_view + level - 1], VK_IMAGE_LAYOUT_GENERAL };
+		image_infos[1] = { VK_NULL_HANDLE, batch.image_views[first_view + level], VK_IMAGE_LAYOUT_GENERAL };
+
+		VkWriteDescriptorSet write_descriptor_sets[MIP_GENERATOR_BINDING_COUNT];
+		for (uint32_t binding = 0; binding < MIP_GENERATOR_BINDING_COUNT; binding++) {
+			write_descriptor_sets[binding] = {};
+			write_descriptor_sets[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write_descriptor_sets[binding].dstSet = descriptor_set;
+			write_descriptor_sets[binding].dstBinding = binding;
+			write_descriptor_sets[binding].descriptorCount = 1;
+			write_descriptor_sets[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			write_descriptor_sets[binding].pImageInfo = &image_infos[binding];
+		}
+		vkUpdateDescriptorSets(m_device, MIP_GENERATOR_BINDING_COUNT, write_descriptor_sets, 0, VK_NULL_HANDLE);
+
+		vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline_layout, 0, 1, &descriptor_set, 0, VK_NULL_HANDLE);
+		vkCmdDispatch(command_buffer, (width + MIP_GENERATOR_WORKGROUP_SIZE - 1) / MIP_GENERATOR_WORKGROUP_SIZE, (height + MIP_GENERATOR_WORKGROUP_SIZE - 1) / MIP_GENERATOR_WORKGROUP_SIZE, 1);
+
+		//the next step reads what this one wrote
+		image_barrier.subresourceRange.baseMipLevel = level;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, VK_NULL_HANDLE, 0, VK_NULL_HANDLE, 1, &image_barrier);
+	}
+
+	image_barrier.subresourceRange.baseMipLevel = 0;
+	image_barrier.subresourceRange.levelCount = request.mip_levels;
+	image_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 0, VK_NULL_HANDLE, 0, VK_NULL_HANDLE, 1, &image_barrier);
+}
+
+void MipGenerator::RetireBatch(Batch & batch) {
+	for (uint32_t i = 0; i < batch.image_views.size(); i++) {
+		vkDestroyImageView(m_device, batch.image_views[i], VK_NULL_HANDLE);
+	}
+	batch.image_views.clear();
+	if (batch.descriptor_pool != VK_NULL_HANDLE) {
+		vkDestroyDescriptorPool(m_device, batch.descriptor_pool, VK_NULL_HANDLE);
+		batch.descriptor_pool = VK_NULL_HANDLE;
+	}
+	m_completed_token = batch.token;
+	batch.token = 0;
+}
+
+void MipGenerator::RetireUntil(uint64_t token) {
+	while (m_completed_token < token && m_completed_token + 1 < m_next_token) {
+		Batch & batch = m_batches[(m_completed_token + 1) % MIP_GENERATOR_MAX_BATCHES];
+		ErrorCheck(vkWaitForFences(m_device, 1, &batch.fence, VK_TRUE, UINT64_MAX));
+		RetireBatch(batch);
+	}
+}
+
+void MipGenerator::Poll() {
+	while (m_completed_token + 1 < m_next_token) {
+		Batch & batch = m_batches[(m_completed_token + 1) % MIP_GENERATOR_MAX_BATCHES];
+		if (vkGetFenceStatus(m_device, batch.fence) != VK_SUCCESS) {
+			break;
+		}
+		RetireBatch(batch);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Platform.h"
+#include <vector>
+
+//invocations per side of a workgroup of the compute fallback, has to match local_size in its shader
+#define MIP_GENERATOR_WORKGROUP_SIZE 8
+#define MIP_GENERATOR_MAX_BATCHES 4
+//source and destination level of one compute step
+#define MIP_GENERATOR_BINDING_COUNT 2
+
+class Renderer;
+
+enum MipGenerationMethod {
+	//the format can be neither blitted with a linear filter nor stored to, so only level 0 is ever filled
+	MIP_GENERATION_NONE = 0,
+	//vkCmdBlitImage from each level into the next
+	MIP_GENERATION_BLIT = 1,
+	//a 2x2 box filter in a compute shader, for formats that can be stored to but not blitted
+	MIP_GENERATION_COMPUTE = 2
+};
+
+//fills in mip chains on the graphics queue once level 0 has been uploaded. images queued with Generate are
+//recorded together into one command buffer per Flush(), which goes out right behind the uploader's batch
+//so the copies into level 0 are ordered before it. tokens work like the uploader's
+class MipGenerator {
+public:
+	MipGenerator(Renderer * renderer);
+	~MipGenerator();
+
+	MipGenerationMethod GetMethod(VkFormat format) const;
+	//usage bits an image needs on top of sampling for the method to work on it
+	static VkImageUsageFlags GetUsage(MipGenerationMethod method);
+	//the layout every level has to be uploaded into before Generate
+	static VkImageLayout GetUploadLayout(MipGenerationMethod method);
+
+	//fills levels 1 to mip_levels - 1 from level 0; afterwards every level is in SHADER_READ_ONLY_OPTIMAL
+	uint64_t Generate(VkImage image, VkFormat format, uint32_t width, uint32_t height, uint32_t mip_levels);
+
+	//flushes the uploader, then submits everything queued since the last flush in one go
+	uint64_t Flush();
+	bool IsComplete(uint64_t token);
+	void Wait(uint64_t token);
+private:
+	struct Request {
+		VkImage image;
+		VkFormat format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t mip_levels;
+		MipGenerationMethod method;
+	};
+
+	struct ComputeFormat {
+		VkFormat format;
+		//the glsl image format qualifier
+		const char * qualifier;
+		VkShaderModule module;
+		VkPipeline pipeline;
+	};
+
+	//per level views and the descriptor sets that point at them have to outlive the batch that uses them
+	struct Batch {
+		VkCommandBuffer command_buffer;
+		VkFence fence;
+		uint64_t token;
+		VkDescriptorPool descriptor_pool;
+		std::vector<VkImageView> image_views;
+	};
+
+	void InitComputePipelines();
+	void DeInitComputePipelines();
+	void RecordBlit(VkCommandBuffer command_buffer, const Request & request);
+	void RecordCompute(VkCommandBuffer command_buffer, Batch & batch, const Request & request);
+	void RetireBatch(Batch & batch);
+	void RetireUntil(uint64_t token);
+	void Poll();
+
+	Renderer * m_renderer;
+	VkDevice m_device;
+
+	std::vector<ComputeFormat> m_compute_formats;
+	VkDescriptorSetLayout m_descriptor_set_layout;
+	VkPipelineLayout m_pipeline_layout;
+
+	VkCommandPool m_command_pool;
+	Batch m_batches[MIP_GENERATOR_MAX_BATCHES];
+	uint64_t m_next_token;
+	uint64_t m_completed_token;
+
+	std::vector<Request> m_requests;
+};
\ No newline at end of file
@@ -1,160 +1,297 @@
 #include "Pipeline.h"
 #include "Renderer.h"
+#include "RingBuffer.h"
+#include <algorithm>
 
 Pipeline::Pipeline(Renderer * renderer) :
-	m_renderer(renderer)
+	m_renderer(renderer),
+	m_push_constant_size(0),
+	m_descriptor_layout(DESCRIPTOR_LAYOUT_INVALID),
+	m_bindless_set_layout(VK_NULL_HANDLE),
+	m_bindless_pipeline_layout(VK_NULL_HANDLE),
+	m_bindless_pool(VK_NULL_HANDLE),
+	m_bindless_set(VK_NULL_HANDLE)
 {
-	InitUniformBuffer();
+	InitCamera();
 	InitPipeline();
+	if (m_renderer->HasBindless()) {
+		InitBindless();
+	}
 }
 
 Pipeline::~Pipeline() {
+	DeInitBindless();
 	DeInitPipeline();
 }
 
-VkBuffer Pipeline::GetUniformBuffer() {
-	return m_buffer;
+const glm::mat4 & Pipeline::GetViewProjectionMatrix() {
+	return m_view_projection_matrix;
 }
 
 VkPipelineLayout Pipeline::GetPipelineLayout() {
 	return m_pipeline_layout;
 }
 
-void Pipeline::InitUniformBuffer() {
-	glm::mat4 projection_matrix = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
-	glm::mat4 view_matrix = glm::lookAt(
+uint32_t Pipeline::GetPushConstantSize() const {
+	return m_push_constant_size;
+}
+
+const VkDescriptorSet * Pipeline::GetDescriptorSets() {
+	return m_descriptor_sets.data();
+}
+
+void Pipeline::InitCamera() {
+	m_projection_matrix = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
+	m_view_matrix = glm::lookAt(
 		glm::vec3(0.0f, 3.0f, 10.0f),
 		glm::vec3(0.0f, 0.0f, 0.0f),
 		glm::vec3(0.0f, -1.0f, 0.0f)
 	);
-	glm::mat4 model_matrix = glm::mat4(1.0f);
-	glm::mat4 clip_matrix = glm::mat4(
+	m_clip_matrix = glm::mat4(
 		1.0f, 0.0f, 0.0f, 0.0f,
 		0.0f, -1.0f, 0.0f, 0.0f,
 		0.0f, 0.0f, 0.5f, 0.0f,
 		0.0f, 0.0f, 0.5f, 1.0f
 	);
-	glm::mat4 model_view_projection_matrix = clip_matrix * projection_matrix * view_matrix * model_matrix;
-
-	VkBufferCreateInfo buffer_create_info{};
-	buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	buffer_create_info.pNext = VK_NULL_HANDLE;
-	buffer_create_info.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-	buffer_create_info.size = sizeof(model_view_projection_matrix);
-	buffer_create_info.queueFamilyIndexCount = 0;
-	buffer_create_info.pQueueFamilyIndices = VK_NULL_HANDLE;
-	buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	buffer_create_info.flags = 0;
-	ErrorCheck(vkCreateBuffer(m_renderer->GetVulkanDevice(), &buffer_create_info, VK_NULL_HANDLE, &m_buffer));
-
-	VkMemoryRequirements memory_requirements;
-	vkGetBufferMemoryRequirements(m_renderer->GetVulkanDevice(), m_buffer, &memory_requirements);
-
-	VkMemoryAllocateInfo memory_allocate_info{};
-	memory_allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	memory_allocate_info.pNext = VK_NULL_HANDLE;
-	memory_allocate_info.memoryTypeIndex = 0;
-	memory_allocate_info.allocationSize = memory_requirements.size;
-
-	if (!memory_types_from_properties(memory_requirements.memoryTypeBits,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		&memory_allocate_info.memoryTypeIndex,
-		m_renderer->GetPhysicalDeviceMemoryProperties())) {
-
-		assert(0 && "memory assignment error");
-	}
-	else {
-		ErrorCheck(vkAllocateMemory(m_renderer->GetVulkanDevice(), &memory_allocate_info, VK_NULL_HANDLE, &m_uniform_buffer_memory));
-	}
-
-	uint32_t *pData;
-	//map memory
-	ErrorCheck(vkMapMemory(m_renderer->GetVulkanDevice(), m_uniform_buffer_memory, 0, memory_requirements.size, 0, (void **)&pData));
-	//copy model view projection matrix to uniform buffer
-	memcpy(pData, &model_view_projection_matrix, sizeof(model_view_projection_matrix));
-	//unmap memory
-	vkUnmapMemory(m_renderer->GetVulkanDevice(), m_uniform_buffer_memory);
-	//bind buffer to gpu
-	vkBindBufferMemory(m_renderer->GetVulkanDevice(), m_buffer, m_uniform_buffer_memory, 0);
+	//the model matrix is applied per draw, the rest only changes with the camera
+	m_view_projection_matrix = m_clip_matrix * m_projection_matrix * m_view_matrix;
 
+	//the descriptor covers one mvp; which one is picked by the dynamic offset at bind time
 	m_buffer_info = {};
-	m_buffer_info.buffer = m_buffer;
+	m_buffer_info.buffer = m_renderer->GetUniformRing()->GetBuffer();
 	m_buffer_info.offset = 0;
-	m_buffer_info.range = sizeof(model_view_projection_matrix);
+	m_buffer_info.range = sizeof(glm::mat4);
 }
 
 void Pipeline::InitPipeline() {
-	VkDescriptorSetLayoutBinding descriptor_set_layout_binding{};
-	descriptor_set_layout_binding.binding = 0;
-	descriptor_set_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	descriptor_set_layout_binding.descriptorCount = 1;
-	descriptor_set_layout_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	//the mvp for every scene shader, and the texture for the textured one
+	VkDescriptorSetLayoutBinding descriptor_set_layout_bindings[2];
+	descriptor_set_layout_bindings[0] = {};
+	descriptor_set_layout_bindings[0].binding = 0;
+	descriptor_set_layout_bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	descriptor_set_layout_bindings[0].descriptorCount = 1;
+	descriptor_set_layout_bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	descriptor_set_layout_bindings[1] = {};
+	descriptor_set_layout_bindings[1].binding = 1;
+	descriptor_set_layout_bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptor_set_layout_bindings[1].descriptorCount = 1;
+	descriptor_set_layout_bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
 	VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info{};
 	descriptor_set_layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 	descriptor_set_layout_create_info.pNext = VK_NULL_HANDLE;
-	descriptor_set_layout_create_info.bindingCount = 1;
-	descriptor_set_layout_create_info.pBindings = &descriptor_set_layout_binding;
+	descriptor_set_layout_create_info.bindingCount = 2;
+	descriptor_set_layout_create_info.pBindings = descriptor_set_layout_bindings;
 
 	m_descriptor_set_layouts.resize(NUM_DESCRIPTOR_SETS);
 
 	ErrorCheck(vkCreateDescriptorSetLayout(m_renderer->GetVulkanDevice(), &descriptor_set_layout_create_info, VK_NULL_HANDLE, m_descriptor_set_layouts.data()));
 
+	//per-draw data small enough to record straight into the command buffer, for shaders that would rather not go
+	//through the uniform ring. the shaders that don't declare it are unaffected
+	m_push_constant_size = std::min(m_renderer->GetVulkanPhysicalDeviceProperties().limits.maxPushConstantsSize, (uint32_t)PUSH_CONSTANTS_MAX_SIZE);
+	VkPushConstantRange push_constant_range{};
+	push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	push_constant_range.offset = 0;
+	push_constant_range.size = m_push_constant_size;
+
 	VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
 	pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 	pipeline_layout_create_info.pNext = VK_NULL_HANDLE;
-	pipeline_layout_create_info.pushConstantRangeCount = 0;
-	pipeline_layout_create_info.pPushConstantRanges = VK_NULL_HANDLE;
+	pipeline_layout_create_info.pushConstantRangeCount = 1;
+	pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
 	pipeline_layout_create_info.setLayoutCount = NUM_DESCRIPTOR_SETS;
 	pipeline_layout_create_info.pSetLayouts = m_descriptor_set_layouts.data();
 
 	ErrorCheck(vkCreatePipelineLayout(m_renderer->GetVulkanDevice(), &pipeline_layout_create_info, VK_NULL_HANDLE, &m_pipeline_layout));
 
-	VkDescriptorPoolSize descriptor_pool_size[1];
-	descriptor_pool_size[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	descriptor_pool_size[0].descriptorCount = 1;
+	m_descriptor_sets.resize(NUM_DESCRIPTOR_SETS, VK_NULL_HANDLE);
+	m_descriptor_layout = m_renderer->GetDescriptorAllocator()->RegisterLayout(m_descriptor_set_layouts[0], descriptor_set_layout_bindings, 2);
+}
+
+VkDescriptorSet Pipeline::GetTextureSet(VkImageView image_view, VkSampler sampler) {
+	DescriptorInfo infos[2];
+	infos[0].buffer = m_buffer_info;
+	infos[1].image = {};
+	infos[1].image.sampler = sampler;
+	infos[1].image.imageView = image_view;
+	infos[1].image.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	//only the first time a texture is asked for is its set allocated and written; after that it is a lookup
+	return m_renderer->GetDescriptorAllocator()->GetPersistent(m_descriptor_layout, infos);
+}
+
+void Pipeline::SetTexture(VkImageView image_view, VkSampler sampler) {
+	m_descriptor_sets[0] = GetTextureSet(image_view, sampler);
+}
+
+bool Pipeline::IsBindless() const {
+	return m_bindless_set != VK_NULL_HANDLE;
+}
+
+VkPipelineLayout Pipeline::GetBindlessPipelineLayout() {
+	return m_bindless_pipeline_layout;
+}
+
+VkDescriptorSet Pipeline::GetBindlessSet() {
+	return m_bindless_set;
+}
+
+uint32_t Pipeline::AddBindlessBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+	DescriptorInfo info;
+	info.buffer = { buffer, offset, range };
+	return AddBindlessDescriptor(BINDLESS_BINDING_BUFFERS, info);
+}
+
+uint32_t Pipeline::AddBindlessImage(VkImageView image_view) {
+	DescriptorInfo info;
+	info.image = {};
+	info.image.imageView = image_view;
+	info.image.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	return AddBindlessDescriptor(BINDLESS_BINDING_IMAGES, info);
+}
+
+uint32_t Pipeline::AddBindlessSampler(VkSampler sampler) {
+	DescriptorInfo info;
+	info.image = {};
+	info.image.sampler = sampler;
+	return AddBindlessDescriptor(BINDLESS_BINDING_SAMPLERS, info);
+}
+
+void Pipeline::RemoveBindlessBuffer(uint32_t index) {
+	RemoveBindlessDescriptor(BINDLESS_BINDING_BUFFERS, index);
+}
+
+void Pipeline::RemoveBindlessImage(uint32_t index) {
+	RemoveBindlessDescriptor(BINDLESS_BINDING_IMAGES, index);
+}
+
+void Pipeline::RemoveBindlessSampler(uint32_t index) {
+	RemoveBindlessDescriptor(BINDLESS_BINDING_SAMPLERS, index);
+}
+
+uint32_t Pipeline::AddBindlessDescriptor(uint32_t binding, const DescriptorInfo & info) {
+	BindlessSlots & slots = m_bindless_slots[binding];
+	uint32_t index;
+	if (!slots.free.empty()) {
+		index = slots.free.back();
+		slots.free.pop_back();
+	} else if (slots.next < slots.capacity) {
+		index = slots.next++;
+	} else {
+		assert(0 && "Every slot of the bindless array is in use");
+		return BINDLESS_INDEX_INVALID;
+	}
+
+	VkWriteDescriptorSet write_descriptor_set{};
+	write_descriptor_set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write_descriptor_set.dstSet = m_bindless_set;
+	write_descriptor_set.dstBinding = binding;
+	write_descriptor_set.dstArrayElement = index;
+	write_descriptor_set.descriptorCount = 1;
+	if (binding == BINDLESS_BINDING_BUFFERS) {
+		write_descriptor_set.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		write_descriptor_set.pBufferInfo = &info.buffer;
+	} else {
+		write_descriptor_set.descriptorType = binding == BINDLESS_BINDING_IMAGES ? VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLER;
+		write_descriptor_set.pImageInfo = &info.image;
+	}
+	vkUpdateDescriptorSets(m_renderer->GetVulkanDevice(), 1, &write_descriptor_set, 0, VK_NULL_HANDLE);
+	return index;
+}
+
+void Pipeline::RemoveBindlessDescriptor(uint32_t binding, uint32_t index) {
+	//the slot's old descriptor stays in the set until it is handed out again; being partially bound, nothing
+	//cares as long as no draw indexes it
+	if (index != BINDLESS_INDEX_INVALID) {
+		m_bindless_slots[binding].free.push_back(index);
+	}
+}
+
+void Pipeline::InitBindless() {
+#ifdef VK_EXT_descriptor_indexing
+	VkShaderStageFlags stages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	VkDescriptorType types[BINDLESS_BINDING_COUNT] = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_DESCRIPTOR_TYPE_SAMPLER };
+	uint32_t counts[BINDLESS_BINDING_COUNT] = { BINDLESS_MAX_BUFFERS, BINDLESS_MAX_IMAGES, BINDLESS_MAX_SAMPLERS };
+
+	//images and samplers are separate arrays, so any texture can be paired with any sampler in the shader
+	VkDescriptorSetLayoutBinding descriptor_set_layout_bindings[BINDLESS_BINDING_COUNT];
+	VkDescriptorBindingFlagsEXT binding_flags[BINDLESS_BINDING_COUNT];
+	VkDescriptorPoolSize descriptor_pool_sizes[BINDLESS_BINDING_COUNT];
+	for (uint32_t i = 0; i < BINDLESS_BINDING_COUNT; i++) {
+		descriptor_set_layout_bindings[i] = {};
+		descriptor_set_layout_bindings[i].binding = i;
+		descriptor_set_layout_bindings[i].descriptorType = types[i];
+		descriptor_set_layout_bindings[i].descriptorCount = counts[i];
+		descriptor_set_layout_bindings[i].stageFlags = stages;
+		//slots nothing has been written to yet are fine as long as no draw indexes them, and slots no pending
+		//command buffer uses can be written while the set is bound
+		binding_flags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+		descriptor_pool_sizes[i].type = types[i];
+		descriptor_pool_sizes[i].descriptorCount = counts[i];
+
+		m_bindless_slots[i].next = 0;
+		m_bindless_slots[i].capacity = counts[i];
+	}
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT binding_flags_create_info{};
+	binding_flags_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+	binding_flags_create_info.bindingCount = BINDLESS_BINDING_COUNT;
+	binding_flags_create_info.pBindingFlags = binding_flags;
+
+	VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info{};
+	descriptor_set_layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	descriptor_set_layout_create_info.pNext = &binding_flags_create_info;
+	descriptor_set_layout_create_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+	descriptor_set_layout_create_info.bindingCount = BINDLESS_BINDING_COUNT;
+	descriptor_set_layout_create_info.pBindings = descriptor_set_layout_bindings;
+
+	ErrorCheck(vkCreateDescriptorSetLayout(m_renderer->GetVulkanDevice(), &descriptor_set_layout_create_info, VK_NULL_HANDLE, &m_bindless_set_layout));
+
+	VkPushConstantRange push_constant_range{};
+	push_constant_range.stageFlags = stages;
+	push_constant_range.offset = 0;
+	push_constant_range.size = sizeof(BindlessDrawConstants);
+
+	VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
+	pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipeline_layout_create_info.setLayoutCount = 1;
+	pipeline_layout_create_info.pSetLayouts = &m_bindless_set_layout;
+	pipeline_layout_create_info.pushConstantRangeCount = 1;
+	pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+
+	ErrorCheck(vkCreatePipelineLayout(m_renderer->GetVulkanDevice(), &pipeline_layout_create_info, VK_NULL_HANDLE, &m_bindless_pipeline_layout));
 
 	VkDescriptorPoolCreateInfo descriptor_pool_create_info{};
 	descriptor_pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	descriptor_pool_create_info.pNext = VK_NULL_HANDLE;
+	descriptor_pool_create_info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
 	descriptor_pool_create_info.maxSets = 1;
-	descriptor_pool_create_info.poolSizeCount = 1;
-	descriptor_pool_create_info.pPoolSizes = descriptor_pool_size;
-
-	ErrorCheck(vkCreateDescriptorPool(m_renderer->GetVulkanDevice(), &descriptor_pool_create_info, VK_NULL_HANDLE, &m_descriptor_pool));
+	descriptor_pool_create_info.poolSizeCount = BINDLESS_BINDING_COUNT;
+	descriptor_pool_create_info.pPoolSizes = descriptor_pool_sizes;
 
-	VkDescriptorSetAllocateInfo descriptor_set_allocate_info[1];
-	descriptor_set_allocate_info[0].sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	descriptor_set_allocate_info[0].pNext = VK_NULL_HANDLE;
-	descriptor_set_allocate_info[0].descriptorPool = m_descriptor_pool;
-	descriptor_set_allocate_info[0].descriptorSetCount = NUM_DESCRIPTOR_SETS;
-	descriptor_set_allocate_info[0].pSetLayouts = m_descriptor_set_layouts.data();
-	m_descriptor_set_layouts.resize(1);
+	ErrorCheck(vkCreateDescriptorPool(m_renderer->GetVulkanDevice(), &descriptor_pool_create_info, VK_NULL_HANDLE, &m_bindless_pool));
 
-	std::vector<VkDescriptorSet> descriptor_sets;
-	descriptor_sets.resize(NUM_DESCRIPTOR_SETS);
+	VkDescriptorSetAllocateInfo descriptor_set_allocate_info{};
+	descriptor_set_allocate_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	descriptor_set_allocate_info.descriptorPool = m_bindless_pool;
+	descriptor_set_allocate_info.descriptorSetCount = 1;
+	descriptor_set_allocate_info.pSetLayouts = &m_bindless_set_layout;
 
-	ErrorCheck( vkAllocateDescriptorSets(m_renderer->GetVulkanDevice(), descriptor_set_allocate_info, descriptor_sets.data()));
-
-	VkWriteDescriptorSet write_descriptor_set[1];
-	write_descriptor_set[0] = {};
-	write_descriptor_set[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	write_descriptor_set[0].pNext = VK_NULL_HANDLE;
-	write_descriptor_set[0].dstSet = descriptor_sets[0];
-	write_descriptor_set[0].descriptorCount = 1;
-	write_descriptor_set[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	write_descriptor_set[0].pBufferInfo = &m_buffer_info;
-	write_descriptor_set[0].dstArrayElement = 0;
-	write_descriptor_set[0].dstBinding = 0;
+	ErrorCheck(vkAllocateDescriptorSets(m_renderer->GetVulkanDevice(), &descriptor_set_allocate_info, &m_bindless_set));
+#endif
+}
 
-	vkUpdateDescriptorSets(m_renderer->GetVulkanDevice(), 1, write_descriptor_set, 0, VK_NULL_HANDLE);
+void Pipeline::DeInitBindless() {
+	if (m_bindless_set == VK_NULL_HANDLE) {
+		return;
+	}
+	vkDestroyDescriptorPool(m_renderer->GetVulkanDevice(), m_bindless_pool, VK_NULL_HANDLE);
+	vkDestroyPipelineLayout(m_renderer->GetVulkanDevice(), m_bindless_pipeline_layout, VK_NULL_HANDLE);
+	vkDestroyDescriptorSetLayout(m_renderer->GetVulkanDevice(), m_bindless_set_layout, VK_NULL_HANDLE);
 }
 
 void Pipeline::DeInitPipeline() {
-	vkDestroyDescriptorPool(m_renderer->GetVulkanDevice(), m_descriptor_pool, NULL);
-	vkDestroyBuffer(m_renderer->GetVulkanDevice(), m_buffer, VK_NULL_HANDLE);
-	vkFreeMemory(m_renderer->GetVulkanDevice(), m_uniform_buffer_memory, nullptr);
-	
+	m_renderer->GetDescriptorAllocator()->UnregisterLayout(m_descriptor_layout);
 	for (int i = 0; i < NUM_DESCRIPTOR_SETS; i++) {
 		vkDestroyDescriptorSetLayout(m_renderer->GetVulkanDevice(), m_descriptor_set_layouts[i], VK_NULL_HANDLE);
 	}
@@ -2,9 +2,42 @@
 
 #include "Shared.h"
 #include "Platform.h"
+#include "DescriptorAllocator.h"
 #include <vector>
 
 #define NUM_DESCRIPTOR_SETS 1
+//the push constant range of the scene layout is this, or maxPushConstantsSize when the device allows less. 128 is
+//the least any device allows
+#define PUSH_CONSTANTS_MAX_SIZE 128
+
+//array sizes of the bindless set, which the shaders are compiled with too. the device has to allow this many update
+//after bind descriptors of each kind per stage, or the renderer stays on per-draw sets
+#define BINDLESS_MAX_BUFFERS 4096
+#define BINDLESS_MAX_IMAGES 4096
+#define BINDLESS_MAX_SAMPLERS 64
+#define BINDLESS_BINDING_BUFFERS 0
+#define BINDLESS_BINDING_IMAGES 1
+#define BINDLESS_BINDING_SAMPLERS 2
+#define BINDLESS_BINDING_COUNT 3
+#define BINDLESS_INDEX_INVALID UINT32_MAX
+
+//what DrawPushConstants pushes for each draw, in place of a dynamic uniform buffer offset
+struct DrawConstants {
+	glm::mat4 mvp;
+	uint32_t material;
+	uint32_t padding[3];
+};
+
+static_assert(sizeof(DrawConstants) <= PUSH_CONSTANTS_MAX_SIZE, "DrawConstants must fit the smallest push constant range");
+
+//what a bindless draw pushes: its mvp, and which slots of the set's arrays it reads
+struct BindlessDrawConstants {
+	glm::mat4 mvp;
+	uint32_t image;
+	uint32_t sampler;
+	uint32_t buffer;
+	uint32_t padding;
+};
 
 class Window;
 class Renderer;
@@ -14,25 +47,72 @@ public:
 	Pipeline(Renderer * renderer);
 	~Pipeline();
 
-	VkBuffer GetUniformBuffer();
+	const glm::mat4 & GetViewProjectionMatrix();
+	//set 0 is the scene set, and the vertex and fragment stages share GetPushConstantSize bytes of push constants from offset 0
 	VkPipelineLayout GetPipelineLayout();
+	uint32_t GetPushConstantSize() const;
+	const VkDescriptorSet * GetDescriptorSets();
+	//the cached set sampling view, without making it the one GetDescriptorSets returns
+	VkDescriptorSet GetTextureSet(VkImageView image_view, VkSampler sampler);
+	//switches to the set whose binding 1, the textured shaders' sampler, points at view. sets are cached by the
+	//descriptor allocator and never rewritten, so frames in flight keep the one they were recorded with. there is
+	//no set until the first call, which the renderer makes before anything draws
+	void SetTexture(VkImageView image_view, VkSampler sampler);
+
+	//whether the renderer enabled descriptor indexing, and with it the bindless layout and set below
+	bool IsBindless() const;
+	//one set of partially bound arrays of storage buffers, images and samplers, bound once and indexed by the slots in
+	//BindlessDrawConstants, which every stage can read from push constants
+	VkPipelineLayout GetBindlessPipelineLayout();
+	VkDescriptorSet GetBindlessSet();
+	//write the descriptor into a free slot of its array and return the slot. the set is update after bind, so slots can
+	//be added while it is bound in frames in flight; a slot being removed must not be used by any of them
+	uint32_t AddBindlessBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+	uint32_t AddBindlessImage(VkImageView image_view);
+	uint32_t AddBindlessSampler(VkSampler sampler);
+	void RemoveBindlessBuffer(uint32_t index);
+	void RemoveBindlessImage(uint32_t index);
+	void RemoveBindlessSampler(uint32_t index);
 private:
+	//slots handed out from the end of an array, and the ones given back
+	struct BindlessSlots {
+		uint32_t next;
+		uint32_t capacity;
+		std::vector<uint32_t> free;
+	};
+
 	//methods
-	void InitUniformBuffer();
+	void InitCamera();
 	void InitPipeline();
+	void InitBindless();
 
 	void DeInitPipeline();
+	void DeInitBindless();
+
+	uint32_t AddBindlessDescriptor(uint32_t binding, const DescriptorInfo & info);
+	void RemoveBindlessDescriptor(uint32_t binding, uint32_t index);
 
 	//variables
 	Renderer * m_renderer;
 
-	VkBuffer m_buffer;
-
-	VkDeviceMemory m_uniform_buffer_memory;
+	glm::mat4 m_projection_matrix;
+	glm::mat4 m_view_matrix;
+	glm::mat4 m_clip_matrix;
+	glm::mat4 m_view_projection_matrix;
 
 	VkDescriptorBufferInfo m_buffer_info;
 
 	std::vector<VkDescriptorSetLayout> m_descriptor_set_layouts;
 	VkPipelineLayout m_pipeline_layout;
-	VkDescriptorPool m_descriptor_pool;
+	uint32_t m_push_constant_size;
+	//m_descriptor_set_layouts[0] as registered with the descriptor allocator
+	uint32_t m_descriptor_layout;
+	std::vector<VkDescriptorSet> m_descriptor_sets;
+
+	VkDescriptorSetLayout m_bindless_set_layout;
+	VkPipelineLayout m_bindless_pipeline_layout;
+	//update after bind sets need a pool created for them, which the descriptor allocator's aren't
+	VkDescriptorPool m_bindless_pool;
+	VkDescriptorSet m_bindless_set;
+	BindlessSlots m_bindless_slots[BINDLESS_BINDING_COUNT];
 };
\ No newline at end of file
@@ -9,7 +9,7 @@
 #elif defined(__linux)
 
 #define VK_USE_PLATFORM_XCB_KHR 1
-#define	PLATFORM_SURFACE_EXTENTION_NAME VK_KHR_XCB_SURFACE_EXTENTION_NAME
+#define	PLATFORM_SURFACE_EXTENTION_NAME VK_KHR_XCB_SURFACE_EXTENSION_NAME
 #include <xcb/xcb.h>
 
 #else
@@ -17,13 +17,13 @@
 
 #endif
 
-#include <vulkan\vulkan.h>
-#include <glm\glm.hpp>
-#include <glm\matrix.hpp>
-#include <glm\mat4x4.hpp>
-#include <glm\vec2.hpp>
-#include <glm\vec3.hpp>
-#include <glm\vec4.hpp>
-#include <glm\gtc\matrix_transform.hpp>
-#include <SPIRV\spirv.hpp>
-#include <SPIRV\GlslangToSpv.h>
\ No newline at end of file
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <glm/matrix.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <SPIRV/spirv.hpp>
+#include <SPIRV/GlslangToSpv.h>
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Platform.h"
+
+//what the frame loop renders into: a window's swapchain, or offscreen images when there is no display
+class RenderTarget {
+public:
+	virtual ~RenderTarget() {}
+
+	//false once the frame loop should stop
+	virtual bool Update() = 0;
+
+	//picks the image the next frame renders into. returns whether image_acquired_semaphore will be
+	//signalled, i.e. whether the frame has to wait on it
+	virtual bool AcquireImage(VkSemaphore image_acquired_semaphore, uint32_t & image_index) = 0;
+	//whether Present waits on the render finished semaphore, so the submit only signals it when needed
+	virtual bool IsPresentable() = 0;
+	virtual void Present(uint32_t image_index, VkSemaphore render_finished_semaphore) = 0;
+
+	virtual VkFormat GetColourFormat() = 0;
+	//the layout the render pass leaves the colour attachment in
+	virtual VkImageLayout GetFinalLayout() = 0;
+	virtual uint32_t GetImageCount() = 0;
+	virtual VkImageView GetImageView(uint32_t index) = 0;
+	virtual VkImageView GetDepthBuffer() = 0;
+	virtual uint32_t GetSurfaceSizeX() = 0;
+	virtual uint32_t GetSurfaceSizeY() = 0;
+};
\ No newline at end of file
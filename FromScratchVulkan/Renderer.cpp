@@ -4,16 +4,42 @@
 #include <cstdlib>
 #include <iostream>
 #include <sstream>
+#include <string.h>
 #include <assert.h>
 #include "Shared.h"
 #include "Window.h"
+#include "HeadlessTarget.h"
 #include "Pipeline.h"
-
-Renderer::Renderer() {
+#include "Allocator.h"
+#include "RingBuffer.h"
+#include "Uploader.h"
+#include "ShaderCache.h"
+#include "ShaderCompiler.h"
+#include "ThreadPool.h"
+#include "CommandRecorder.h"
+#include "GpuProfiler.h"
+#include "Trace.h"
+#include <algorithm>
+#include <future>
+#include "MappedFile.h"
+#include "MeshProcessing.h"
+#include "TransformStore.h"
+#include "GpuCuller.h"
+#include "MeshFile.h"
+#include "MipGenerator.h"
+#include "Texture.h"
+#include "DescriptorAllocator.h"
+#include <stddef.h>
+
+Renderer::Renderer(uint32_t frames_in_flight, bool headless) {
 	m_instance = VK_NULL_HANDLE;
 	m_gpu = VK_NULL_HANDLE;
 	m_device = VK_NULL_HANDLE;
 	m_queue = VK_NULL_HANDLE;
+	for (uint32_t i = 0; i < QUEUE_TYPE_COUNT; i++) {
+		m_queues[i] = VK_NULL_HANDLE;
+		m_queue_family_indices[i] = 0;
+	}
 	m_gpu_properties = {};
 	m_gpu_memory_properties = {};
 	m_graphics_family_index = 0;
@@ -21,85 +47,338 @@ Renderer::Renderer() {
 	m_instance_extention_list = {};
 	m_device_layer_list = {};
 	m_device_extention_list = {};
+#ifdef VK_KHR_draw_indirect_count
+	m_fvkCmdDrawIndexedIndirectCountKHR = nullptr;
+#endif
+	m_descriptor_update_templates = false;
+	m_physical_device_properties2 = false;
+	m_bindless = false;
 	m_debug_report = VK_NULL_HANDLE;
 	m_debug_report_callback_create_info = {};
-	m_window = nullptr;
-
+	m_render_target = nullptr;
+	m_headless = headless;
+	m_allocator = nullptr;
+	m_uniform_ring = nullptr;
+	m_instance_ring = nullptr;
+	m_uploader = nullptr;
+	m_descriptor_allocator = nullptr;
+	m_shader_cache = nullptr;
+	m_thread_pool = nullptr;
+	m_shader_compiler = nullptr;
+	m_command_recorder = nullptr;
+	m_gpu_profiler = nullptr;
+	m_mip_generator = nullptr;
+	m_render_pass_scope = UINT32_MAX;
+	m_pipeline_cache = VK_NULL_HANDLE;
+	m_pipeline_cache_loaded = false;
+	m_frames_in_flight = frames_in_flight > 0 ? frames_in_flight : 1;
+	m_frame_index = 0;
+	m_current_buffer = 0;
+	m_image_acquired = false;
+	m_fps_frame_count = 0;
+	//the scene's shaders read a position and a colour
+	m_vertex_layout = {};
+	m_vertex_layout.position = VERTEX_POSITION_SNORM16;
+	m_vertex_layout.colour = true;
+	m_vertex_attribute_count = 0;
+	m_dequantization_matrix = glm::mat4(1.0f);
+	m_cull_descriptor_set_layout = VK_NULL_HANDLE;
+	m_cull_pipeline_layout = VK_NULL_HANDLE;
+	m_cull_pipeline = VK_NULL_HANDLE;
+	m_sampler_anisotropy = false;
+	m_sampler = VK_NULL_HANDLE;
+	m_default_texture = nullptr;
+	m_textured_vertex_count = 0;
+	m_textured_attribute_count = 0;
+	m_textured_pipeline = VK_NULL_HANDLE;
+	m_bindless_textured_pipeline = VK_NULL_HANDLE;
+	m_push_constant_pipeline = VK_NULL_HANDLE;
+	m_bindless_sampler = BINDLESS_INDEX_INVALID;
+
+	m_phase_start = std::chrono::steady_clock::now();
 	SetupLayersAndExtentions();
 	SetupDebug();
 	InitInstance();
+	EndStartupPhase("instance");
 	InitDebug();
+	EndStartupPhase("debug callback");
 	InitDevice();
+	EndStartupPhase("device");
+	m_thread_pool = new ThreadPool();
+	EndStartupPhase("thread pool");
+	m_allocator = new Allocator(this);
+	InitPipelineCache();
+	EndStartupPhase("pipeline cache");
 	InitCommandBuffer();
+	m_command_recorder = new CommandRecorder(this, m_thread_pool->GetThreadCount());
+	m_gpu_profiler = new GpuProfiler(this);
+	EndStartupPhase("command buffers");
+	m_uniform_ring = new RingBuffer(this, RING_BUFFER_DEFAULT_SIZE, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, m_gpu_properties.limits.minUniformBufferOffsetAlignment);
+	m_instance_ring = new RingBuffer(this, INSTANCE_RING_DEFAULT_SIZE, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, sizeof(glm::vec4));
+	m_uploader = new Uploader(this);
+	EndStartupPhase("uniform ring and uploader");
+	m_descriptor_allocator = new DescriptorAllocator(this);
 	m_pipeline = new Pipeline(this);
+	EndStartupPhase("descriptors");
+	m_shader_cache = new ShaderCache();
+	m_shader_compiler = new ShaderCompiler(m_thread_pool, m_shader_cache);
 	InitShaders();
-	
+	EndStartupPhase("shaders");
+	m_mip_generator = new MipGenerator(this);
+	InitTextures();
+	EndStartupPhase("textures");
 }
 
 Renderer::~Renderer() {
-	DeInitPipeline();
-	DeInitVertexBuffer();
-	DeInitFrameBuffer();
+	WaitIdle();
+	if (m_render_target != nullptr) {
+		DeInitPipeline();
+		DeInitVertexBuffer();
+		DeInitFrameBuffer();
+		DeInitRenderPass();
+	}
 	DeInitShaders();
-	DeInitRenderPass();
+	DeInitTextures();
+	delete m_mip_generator;
+	delete m_shader_compiler;
+	delete m_shader_cache;
 	delete m_pipeline;
+	delete m_descriptor_allocator;
+	delete m_uploader;
+	delete m_instance_ring;
+	delete m_uniform_ring;
+	delete m_gpu_profiler;
+	delete m_command_recorder;
 	DeInitCommandBuffer();
-	delete m_window;
+	delete m_render_target;
+	delete m_allocator;
+	DeInitPipelineCache();
 	DeInitDevice();
 	DeInitDebug();
 	DeInitInstance();
+	delete m_thread_pool;
 }
 
 Window * Renderer::CreateVulkanWindow(uint32_t size_x, uint32_t size_y, std::string name) {
-	m_window = new Window(this, size_x, size_y, name);
+	if (m_headless) {
+		assert(0 && "A headless renderer has no surface extensions to create a window with");
+		return nullptr;
+	}
+	m_phase_start = std::chrono::steady_clock::now();
+	Window * window = new Window(this, size_x, size_y, name);
+	m_render_target = window;
+	EndStartupPhase("window and swapchain");
+	InitRenderTarget();
+	return window;
+}
+
+HeadlessTarget * Renderer::CreateHeadlessTarget(uint32_t size_x, uint32_t size_y, uint32_t frame_limit) {
+	m_phase_start = std::chrono::steady_clock::now();
+	HeadlessTarget * target = new HeadlessTarget(this, size_x, size_y, frame_limit);
+	m_render_target = target;
+	EndStartupPhase("offscreen images");
+	InitRenderTarget();
+	return target;
+}
+
+void Renderer::InitRenderTarget() {
 	InitRenderPass();
 	InitFrameBuffer();
+	EndStartupPhase("render pass and framebuffers");
 	InitVertexBuffer();
+	EndStartupPhase("vertex buffer");
 	InitPipeline();
-	return m_window;
+	EndStartupPhase("pipeline");
+	m_start_time = std::chrono::steady_clock::now();
+	m_fps_timer = m_start_time;
+}
+
+void Renderer::EndStartupPhase(const char * name) {
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	StartupPhase phase;
+	phase.name = name;
+	phase.milliseconds = std::chrono::duration<double, std::milli>(now - m_phase_start).count();
+	m_startup_phases.push_back(phase);
+	m_phase_start = now;
 }
 
 bool Renderer::Run() {
-	if (m_window != nullptr) {
-		return m_window->Update();
+	if (m_render_target == nullptr) {
+		return true;
+	}
+	TRACE_ZONE("frame");
+	if (!m_render_target->Update()) {
+		return false;
+	}
+
+	VkCommandBuffer command_buffer = BeginFrame();
+	{
+		TRACE_ZONE("record");
+		DrawScene(command_buffer);
+	}
+	EndFrame();
+
+	m_fps_frame_count++;
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	double elapsed = std::chrono::duration<double>(now - m_fps_timer).count();
+	if (elapsed >= 1.0) {
+		std::cout << "fps: " << m_fps_frame_count / elapsed << " (" << m_frames_in_flight << " frames in flight)" << std::endl;
+		m_gpu_profiler->Print();
+		m_fps_frame_count = 0;
+		m_fps_timer = now;
 	}
 	return true;
 }
 
-void Renderer::BeginCommandBuffer(uint32_t buffer_number) {
+VkCommandBuffer Renderer::BeginFrame(VkSubpassContents contents, const std::function<void(VkCommandBuffer)> & before_render_pass) {
+	FrameData & frame = m_frames[m_frame_index];
+
+	//the only time the cpu blocks: when it has got m_frames_in_flight frames ahead of the gpu
+	{
+		TRACE_ZONE("wait for frame fence");
+		ErrorCheck(vkWaitForFences(m_device, 1, &frame.fence, VK_TRUE, UINT64_MAX));
+	}
+	m_image_acquired = m_render_target->AcquireImage(frame.image_acquired_semaphore, m_current_buffer);
+	ErrorCheck(vkResetFences(m_device, 1, &frame.fence));
+	m_uniform_ring->BeginFrame(m_frame_index);
+	m_instance_ring->BeginFrame(m_frame_index);
+	m_descriptor_allocator->BeginFrame(m_frame_index);
+	m_command_recorder->BeginFrame(m_frame_index);
+
 	VkCommandBufferBeginInfo command_buffer_begin_info{};
 	command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	ErrorCheck(vkBeginCommandBuffer(m_command_buffer[buffer_number], &command_buffer_begin_info));
+	command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	ErrorCheck(vkBeginCommandBuffer(frame.command_buffer, &command_buffer_begin_info));
+	m_gpu_profiler->BeginFrame(m_frame_index, frame.command_buffer);
+	if (before_render_pass) {
+		before_render_pass(frame.command_buffer);
+	}
+
+	VkClearValue clear_values[2];
+	clear_values[0].color.float32[0] = 0.2f;
+	clear_values[0].color.float32[1] = 0.2f;
+	clear_values[0].color.float32[2] = 0.2f;
+	clear_values[0].color.float32[3] = 0.2f;
+	clear_values[1].depthStencil.depth = 1.0f;
+	clear_values[1].depthStencil.stencil = 0;
+
+	VkRenderPassBeginInfo render_pass_begin_info{};
+	render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	render_pass_begin_info.pNext = VK_NULL_HANDLE;
+	render_pass_begin_info.renderPass = m_render_pass;
+	render_pass_begin_info.framebuffer = m_frame_buffers[m_current_buffer];
+	render_pass_begin_info.renderArea.offset.x = 0;
+	render_pass_begin_info.renderArea.offset.y = 0;
+	render_pass_begin_info.renderArea.extent.width = m_render_target->GetSurfaceSizeX();
+	render_pass_begin_info.renderArea.extent.height = m_render_target->GetSurfaceSizeY();
+	render_pass_begin_info.clearValueCount = 2;
+	render_pass_begin_info.pClearValues = clear_values;
+
+	m_render_pass_scope = m_gpu_profiler->BeginScope(frame.command_buffer, "render pass");
+	vkCmdBeginRenderPass(frame.command_buffer, &render_pass_begin_info, contents);
+
+	//secondary command buffers inherit no dynamic state, RecordParallel sets it in each of them instead
+	if (contents == VK_SUBPASS_CONTENTS_INLINE) {
+		SetViewportAndScissor(frame.command_buffer);
+	}
+
+	return frame.command_buffer;
 }
 
-void Renderer::EndCommandBuffer(uint32_t buffer_number) {
-	ErrorCheck(vkEndCommandBuffer(m_command_buffer[buffer_number]));
+void Renderer::RecordParallel(uint32_t draw_count, const std::function<void(VkCommandBuffer, uint32_t, uint32_t)> & record, uint32_t max_jobs) {
+	uint32_t job_count = (draw_count + COMMAND_RECORDER_MIN_DRAWS_PER_JOB - 1) / COMMAND_RECORDER_MIN_DRAWS_PER_JOB;
+	job_count = std::min(job_count, std::min(m_thread_pool->GetThreadCount(), max_jobs));
+	if (job_count == 0) {
+		return;
+	}
+
+	VkCommandBufferInheritanceInfo inheritance_info{};
+	inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritance_info.renderPass = m_render_pass;
+	inheritance_info.subpass = 0;
+	inheritance_info.framebuffer = m_frame_buffers[m_current_buffer];
+
+	std::vector<std::future<VkCommandBuffer>> jobs(job_count);
+	for (uint32_t i = 0; i < job_count; i++) {
+		uint32_t first = (uint32_t)((uint64_t)draw_count * i / job_count);
+		uint32_t count = (uint32_t)((uint64_t)draw_count * (i + 1) / job_count) - first;
+		jobs[i] = m_thread_pool->Submit([this, &inheritance_info, &record, first, count]() {
+			TRACE_ZONE("record secondary");
+			VkCommandBuffer command_buffer = m_command_recorder->BeginSecondary(inheritance_info);
+			SetViewportAndScissor(command_buffer);
+			record(command_buffer, first, count);
+			ErrorCheck(vkEndCommandBuffer(command_buffer));
+			return command_buffer;
+		});
+	}
+
+	//executed in job order, so the draws land in the primary in the order they were asked for
+	std::vector<VkCommandBuffer> command_buffers(job_count);
+	for (uint32_t i = 0; i < job_count; i++) {
+		command_buffers[i] = jobs[i].get();
+	}
+	vkCmdExecuteCommands(m_frames[m_frame_index].command_buffer, job_count, command_buffers.data());
 }
 
-void Renderer::QueueCommandBuffer(uint32_t buffer_number) {
-	VkSubmitInfo submit_info{};
-	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &m_command_buffer[buffer_number];
-	submit_info.signalSemaphoreCount = 1;
-	submit_info.pSignalSemaphores = &m_semaphore;
-	
-	ErrorCheck(vkQueueSubmit(m_queue, 1, &submit_info, VK_NULL_HANDLE));
+void Renderer::SetViewportAndScissor(VkCommandBuffer command_buffer) {
+	VkViewport viewport{};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = (float)m_render_target->GetSurfaceSizeX();
+	viewport.height = (float)m_render_target->GetSurfaceSizeY();
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+
+	VkRect2D scissor{};
+	scissor.extent.width = m_render_target->GetSurfaceSizeX();
+	scissor.extent.height = m_render_target->GetSurfaceSizeY();
+	vkCmdSetScissor(command_buffer, 0, 1, &scissor);
 }
 
-void Renderer::QueueCommandBuffer(uint32_t buffer_number, VkPipelineStageFlags flags[]) {
+void Renderer::EndFrame() {
+	FrameData & frame = m_frames[m_frame_index];
+
+	vkCmdEndRenderPass(frame.command_buffer);
+	m_gpu_profiler->EndScope(frame.command_buffer, m_render_pass_scope);
+	ErrorCheck(vkEndCommandBuffer(frame.command_buffer));
+	m_uniform_ring->EndFrame();
+	m_instance_ring->EndFrame();
+
+	//anything uploaded while recording has to reach the queue ahead of the frame that reads it; the mip
+	//generator flushes the uploader before its own batch, which needs level 0 in place
+	m_mip_generator->Flush();
+
+	//a headless target has no acquire to wait on and no present to signal
+	bool presentable = m_render_target->IsPresentable();
+	VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
 	VkSubmitInfo submit_info{};
 	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.waitSemaphoreCount = m_image_acquired ? 1 : 0;
+	submit_info.pWaitSemaphores = &frame.image_acquired_semaphore;
+	submit_info.pWaitDstStageMask = wait_stages;
 	submit_info.commandBufferCount = 1;
-	submit_info.pCommandBuffers = &m_command_buffer[buffer_number];
-	submit_info.waitSemaphoreCount = 1;
-	submit_info.pWaitSemaphores = &m_semaphore;
-	submit_info.pWaitDstStageMask = flags;
-	ErrorCheck(vkQueueSubmit(m_queue, 1, &submit_info, VK_NULL_HANDLE));
+	submit_info.pCommandBuffers = &frame.command_buffer;
+	submit_info.signalSemaphoreCount = presentable ? 1 : 0;
+	submit_info.pSignalSemaphores = &frame.render_finished_semaphore;
+	{
+		TRACE_ZONE("submit");
+		Submit(QUEUE_GRAPHICS, 1, &submit_info, frame.fence);
+	}
+
+	m_render_target->Present(m_current_buffer, frame.render_finished_semaphore);
+
+	m_frame_index = (m_frame_index + 1) % m_frames_in_flight;
 }
 
-void Renderer::WaitCommandBuffer() {
-	ErrorCheck(vkQueueWaitIdle(m_queue));
+void Renderer::Submit(QueueType type, uint32_t submit_count, const VkSubmitInfo * submits, VkFence fence) {
+	ErrorCheck(vkQueueSubmit(m_queues[type], submit_count, submits, fence));
+}
+
+void Renderer::WaitIdle() {
+	if (m_device != VK_NULL_HANDLE) {
+		ErrorCheck(vkDeviceWaitIdle(m_device));
+	}
 }
 
 const VkInstance Renderer::GetVulkanInstance() const {
@@ -130,8 +409,182 @@ const uint32_t Renderer::GetVulkanGraphicsQueueFamilyIndex() const {
 	return m_graphics_family_index;
 }
 
+const VkQueue Renderer::GetQueue(QueueType type) const {
+	return m_queues[type];
+}
+
+const uint32_t Renderer::GetQueueFamilyIndex(QueueType type) const {
+	return m_queue_family_indices[type];
+}
+
+const uint32_t Renderer::GetFramesInFlight() const {
+	return m_frames_in_flight;
+}
+
+const uint32_t Renderer::GetFrameIndex() const {
+	return m_frame_index;
+}
+
+Allocator * Renderer::GetAllocator() {
+	return m_allocator;
+}
+
+RingBuffer * Renderer::GetUniformRing() {
+	return m_uniform_ring;
+}
+
+RingBuffer * Renderer::GetInstanceRing() {
+	return m_instance_ring;
+}
+
+Uploader * Renderer::GetUploader() {
+	return m_uploader;
+}
+
+DescriptorAllocator * Renderer::GetDescriptorAllocator() {
+	return m_descriptor_allocator;
+}
+
+ShaderCache * Renderer::GetShaderCache() {
+	return m_shader_cache;
+}
+
+ThreadPool * Renderer::GetThreadPool() {
+	return m_thread_pool;
+}
+
+ShaderCompiler * Renderer::GetShaderCompiler() {
+	return m_shader_compiler;
+}
+
+Pipeline * Renderer::GetPipeline() {
+	return m_pipeline;
+}
+
+RenderTarget * Renderer::GetRenderTarget() {
+	return m_render_target;
+}
+
+GpuProfiler * Renderer::GetGpuProfiler() {
+	return m_gpu_profiler;
+}
+
+MipGenerator * Renderer::GetMipGenerator() {
+	return m_mip_generator;
+}
+
+VkSampler Renderer::GetSampler() const {
+	return m_sampler;
+}
+
+const std::vector<StartupPhase> & Renderer::GetStartupPhases() const {
+	return m_startup_phases;
+}
+
+bool Renderer::IsHeadless() const {
+	return m_headless;
+}
+
+VkPipeline Renderer::GetGraphicsPipeline() const {
+	return m_graphics_pipeline;
+}
+
+VkPipeline Renderer::GetInstancedPipeline() const {
+	return m_instanced_pipeline;
+}
+
+VkPipeline Renderer::GetTexturedPipeline() const {
+	return m_textured_pipeline;
+}
+
+VkPipeline Renderer::GetCullPipeline() const {
+	return m_cull_pipeline;
+}
+
+VkPipelineLayout Renderer::GetCullPipelineLayout() const {
+	return m_cull_pipeline_layout;
+}
+
+VkDescriptorSetLayout Renderer::GetCullDescriptorSetLayout() const {
+	return m_cull_descriptor_set_layout;
+}
+
+bool Renderer::HasBindless() const {
+	return m_bindless;
+}
+
+bool Renderer::HasDescriptorUpdateTemplates() const {
+	return m_descriptor_update_templates;
+}
+
+bool Renderer::HasDrawIndirectCount() const {
+#ifdef VK_KHR_draw_indirect_count
+	return m_fvkCmdDrawIndexedIndirectCountKHR != nullptr;
+#else
+	return false;
+#endif
+}
+
+VkBuffer Renderer::GetVertexBuffer() const {
+	return m_vertex_buffer;
+}
+
+const glm::mat4 & Renderer::GetDequantizationMatrix() const {
+	return m_dequantization_matrix;
+}
+
+VkBuffer Renderer::GetIndexBuffer() const {
+	return m_index_buffer;
+}
+
+uint32_t Renderer::GetIndexCount() const {
+	return m_index_count;
+}
+
+VkIndexType Renderer::GetIndexType() const {
+	return m_index_type;
+}
+
+uint32_t Renderer::GetVertexCount() const {
+	return m_vertex_count;
+}
+
+VkPipelineCache Renderer::GetPipelineCache() const {
+	return m_pipeline_cache;
+}
+
+VkFence Renderer::GetFrameFence(uint32_t frame_index) const {
+	return m_frames[frame_index].fence;
+}
+
+static bool has_extension(const std::vector<VkExtensionProperties> & extension_properties, const char * name) {
+	for (uint32_t i = 0; i < extension_properties.size(); i++) {
+		if (strcmp(extension_properties[i].extensionName, name) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
 void Renderer::SetupLayersAndExtentions() {
 //	m_instance_extention_list.push_back(VK_KHR_DISPLAY_EXTENSION_NAME);
+#if defined(VK_KHR_get_physical_device_properties2) && defined(VK_EXT_descriptor_indexing)
+	//a 1.0 instance can only ask about the descriptor indexing features through features2
+	if (BUILD_OPTIONS_BINDLESS) {
+		uint32_t extension_count = 0;
+		vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, nullptr);
+		std::vector<VkExtensionProperties> extension_properties(extension_count);
+		vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, extension_properties.data());
+		if (has_extension(extension_properties, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)) {
+			m_instance_extention_list.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+			m_physical_device_properties2 = true;
+		}
+	}
+#endif
+	//software and compute-only icds on display-less machines may not expose these at all
+	if (m_headless) {
+		return;
+	}
 	m_instance_extention_list.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
 	m_instance_extention_list.push_back(PLATFORM_SURFACE_EXTENTION_NAME);
 	m_device_extention_list.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
@@ -153,7 +606,8 @@ void Renderer::InitInstance()
 	vkInfo.ppEnabledLayerNames = m_instance_layer_list.data();
 	vkInfo.enabledExtensionCount = m_instance_extention_list.size();
 	vkInfo.ppEnabledExtensionNames = m_instance_extention_list.data();
-	vkInfo.pNext = &m_debug_report_callback_create_info;
+	//only chained when SetupDebug has filled it in
+	vkInfo.pNext = m_debug_report_callback_create_info.sType == VK_STRUCTURE_TYPE_DEBUG_REPORT_CREATE_INFO_EXT ? &m_debug_report_callback_create_info : VK_NULL_HANDLE;
 
 	ErrorCheck(vkCreateInstance(&vkInfo, nullptr, &m_instance));
 }
@@ -164,6 +618,10 @@ void Renderer::DeInitInstance() {
 }
 
 void Renderer::InitDevice() {
+	//every queue gets the same priority; a family holds at most QUEUE_TYPE_COUNT of them
+	float queue_priorities[QUEUE_TYPE_COUNT]{ 1.0f, 1.0f, 1.0f };
+	std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
+	uint32_t queue_indices[QUEUE_TYPE_COUNT]{};
 	{
 		uint32_t gpu_count = 0;
 		vkEnumeratePhysicalDevices(m_instance, &gpu_count, nullptr);
@@ -192,6 +650,61 @@ void Renderer::InitDevice() {
 			assert(0 && "Vulkan ERROR: Queue Family supporting graphics not found");
 			std::exit(-1);
 		}
+
+		//a family without graphics that can copy is a dma engine; prefer the one that can't compute either.
+		//only take it if it copies at texel granularity, otherwise image uploads would need special casing
+		m_queue_family_indices[QUEUE_GRAPHICS] = m_graphics_family_index;
+		m_queue_family_indices[QUEUE_TRANSFER] = m_graphics_family_index;
+		m_queue_family_indices[QUEUE_COMPUTE] = m_graphics_family_index;
+		int best_transfer_score = 0;
+		for (uint32_t i = 0; i < family_property_list.size(); i++) {
+			VkQueueFlags flags = family_property_list[i].queueFlags;
+			VkExtent3D granularity = family_property_list[i].minImageTransferGranularity;
+			if ((flags & VK_QUEUE_GRAPHICS_BIT) || !(flags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT))) {
+				continue;
+			}
+			if (granularity.width != 1 || granularity.height != 1 || granularity.depth != 1) {
+				continue;
+			}
+			int score = (flags & VK_QUEUE_COMPUTE_BIT) ? 1 : 2;
+			if (score > best_transfer_score) {
+				best_transfer_score = score;
+				m_queue_family_indices[QUEUE_TRANSFER] = i;
+			}
+		}
+		for (uint32_t i = 0; i < family_property_list.size(); i++) {
+			VkQueueFlags flags = family_property_list[i].queueFlags;
+			if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT)) {
+				m_queue_family_indices[QUEUE_COMPUTE] = i;
+				break;
+			}
+		}
+
+		//one queue per role, sharing queues within a family only when it runs out
+		for (uint32_t type = 0; type < QUEUE_TYPE_COUNT; type++) {
+			uint32_t family = m_queue_family_indices[type];
+			VkDeviceQueueCreateInfo * family_queue_info = nullptr;
+			for (uint32_t j = 0; j < queue_create_infos.size(); j++) {
+				if (queue_create_infos[j].queueFamilyIndex == family) {
+					family_queue_info = &queue_create_infos[j];
+				}
+			}
+			if (family_queue_info == nullptr) {
+				VkDeviceQueueCreateInfo device_queue_info{};
+				device_queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+				device_queue_info.queueFamilyIndex = family;
+				device_queue_info.queueCount = 1;
+				device_queue_info.pQueuePriorities = queue_priorities;
+				queue_create_infos.push_back(device_queue_info);
+				queue_indices[type] = 0;
+			}
+			else if (family_queue_info->queueCount < family_property_list[family].queueCount) {
+				queue_indices[type] = family_queue_info->queueCount++;
+			}
+			else {
+				queue_indices[type] = family_queue_info->queueCount - 1;
+			}
+		}
 	}
 
 	{
@@ -218,25 +731,115 @@ void Renderer::InitDevice() {
 		std::cout << std::endl;
 	}
 
-	float queue_priorities[]{ 1.0f };
-	VkDeviceQueueCreateInfo device_queue_info{};
-	device_queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-	device_queue_info.queueFamilyIndex = m_graphics_family_index;
-	device_queue_info.queueCount = 1;
-	device_queue_info.pQueuePriorities = queue_priorities;
+	//gpu culling can hand the draw count to the gpu too, but only with non-zero first instances and more than one
+	//command per indirect draw, which are features of their own. without them it draws one command with many instances
+	VkPhysicalDeviceFeatures supported_features{};
+	vkGetPhysicalDeviceFeatures(m_gpu, &supported_features);
+	VkPhysicalDeviceFeatures enabled_features{};
+	uint32_t extension_count = 0;
+	vkEnumerateDeviceExtensionProperties(m_gpu, nullptr, &extension_count, nullptr);
+	std::vector<VkExtensionProperties> extension_properties(extension_count);
+	vkEnumerateDeviceExtensionProperties(m_gpu, nullptr, &extension_count, extension_properties.data());
+	bool draw_indirect_count = false;
+#ifdef VK_KHR_draw_indirect_count
+	draw_indirect_count = has_extension(extension_properties, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME)
+		&& supported_features.multiDrawIndirect && supported_features.drawIndirectFirstInstance;
+	if (draw_indirect_count) {
+		enabled_features.multiDrawIndirect = VK_TRUE;
+		enabled_features.drawIndirectFirstInstance = VK_TRUE;
+		m_device_extention_list.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+	}
+#endif
+#ifdef VK_KHR_descriptor_update_template
+	//writes a whole set in one call from a packed struct, instead of the driver walking an array of writes
+	if (has_extension(extension_properties, VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME)) {
+		m_descriptor_update_templates = true;
+		m_device_extention_list.push_back(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+	}
+#endif
+	const void * device_create_next = VK_NULL_HANDLE;
+#ifdef VK_EXT_descriptor_indexing
+	//bindless needs arrays it can leave holes in and write to while they're bound, indexed by a push constant, which is
+	//dynamically uniform and so only needs the core dynamic indexing features. the arrays' sizes are fixed in the shaders
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptor_indexing_features{};
+	descriptor_indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	if (m_physical_device_properties2 && has_extension(extension_properties, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)
+		&& has_extension(extension_properties, VK_KHR_MAINTENANCE3_EXTENSION_NAME)) {
+		PFN_vkGetPhysicalDeviceFeatures2KHR get_features2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceFeatures2KHR");
+		PFN_vkGetPhysicalDeviceProperties2KHR get_properties2 = (PFN_vkGetPhysicalDeviceProperties2KHR)vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceProperties2KHR");
+		VkPhysicalDeviceDescriptorIndexingFeaturesEXT supported_indexing_features{};
+		supported_indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+		VkPhysicalDeviceFeatures2KHR features2{};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+		features2.pNext = &supported_indexing_features;
+		VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexing_properties{};
+		indexing_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+		VkPhysicalDeviceProperties2KHR properties2{};
+		properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+		properties2.pNext = &indexing_properties;
+		if (get_features2 != nullptr && get_properties2 != nullptr) {
+			get_features2(m_gpu, &features2);
+			get_properties2(m_gpu, &properties2);
+			m_bindless = supported_indexing_features.descriptorBindingPartiallyBound && supported_indexing_features.descriptorBindingUpdateUnusedWhilePending
+				&& supported_indexing_features.descriptorBindingSampledImageUpdateAfterBind && supported_indexing_features.descriptorBindingStorageBufferUpdateAfterBind
+				&& supported_features.shaderSampledImageArrayDynamicIndexing && supported_features.shaderStorageBufferArrayDynamicIndexing
+				&& indexing_properties.maxPerStageDescriptorUpdateAfterBindStorageBuffers >= BINDLESS_MAX_BUFFERS
+				&& indexing_properties.maxPerStageDescriptorUpdateAfterBindSampledImages >= BINDLESS_MAX_IMAGES
+				&& indexing_properties.maxPerStageDescriptorUpdateAfterBindSamplers >= BINDLESS_MAX_SAMPLERS
+				&& indexing_properties.maxDescriptorSetUpdateAfterBindStorageBuffers >= BINDLESS_MAX_BUFFERS
+				&& indexing_properties.maxDescriptorSetUpdateAfterBindSampledImages >= BINDLESS_MAX_IMAGES
+				&& indexing_properties.maxDescriptorSetUpdateAfterBindSamplers >= BINDLESS_MAX_SAMPLERS
+				&& indexing_properties.maxUpdateAfterBindDescriptorsInAllPools >= BINDLESS_MAX_BUFFERS + BINDLESS_MAX_IMAGES + BINDLESS_MAX_SAMPLERS;
+		}
+	}
+	if (m_bindless) {
+		descriptor_indexing_features.descriptorBindingPartiallyBound = VK_TRUE;
+		descriptor_indexing_features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+		descriptor_indexing_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+		descriptor_indexing_features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+		enabled_features.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+		enabled_features.shaderStorageBufferArrayDynamicIndexing = VK_TRUE;
+		m_device_extention_list.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+		m_device_extention_list.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+		device_create_next = &descriptor_indexing_features;
+	}
+#endif
+	//anisotropy is what keeps minified textures at a grazing angle sharp without walking further down the chain
+	if (supported_features.samplerAnisotropy) {
+		enabled_features.samplerAnisotropy = VK_TRUE;
+		m_sampler_anisotropy = true;
+	}
 
 	VkDeviceCreateInfo device_info{};
 	device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-	device_info.queueCreateInfoCount = 1;
-	device_info.pQueueCreateInfos = &device_queue_info;
+	device_info.pNext = device_create_next;
+	device_info.queueCreateInfoCount = (uint32_t)queue_create_infos.size();
+	device_info.pQueueCreateInfos = queue_create_infos.data();
 	device_info.enabledLayerCount = m_device_layer_list.size();
 	device_info.ppEnabledLayerNames = m_device_layer_list.data();
 	device_info.enabledExtensionCount = m_device_extention_list.size();
 	device_info.ppEnabledExtensionNames = m_device_extention_list.data();
+	device_info.pEnabledFeatures = &enabled_features;
 
 	ErrorCheck(vkCreateDevice(m_gpu, &device_info, nullptr, &m_device));
 
-	vkGetDeviceQueue(m_device, m_graphics_family_index, 0, &m_queue);
+	for (uint32_t type = 0; type < QUEUE_TYPE_COUNT; type++) {
+		vkGetDeviceQueue(m_device, m_queue_family_indices[type], queue_indices[type], &m_queues[type]);
+	}
+	m_queue = m_queues[QUEUE_GRAPHICS];
+
+#ifdef VK_KHR_draw_indirect_count
+	if (draw_indirect_count) {
+		m_fvkCmdDrawIndexedIndirectCountKHR = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(m_device, "vkCmdDrawIndexedIndirectCountKHR");
+	}
+#endif
+
+	std::cout << "Queue families: graphics " << m_queue_family_indices[QUEUE_GRAPHICS]
+		<< ", transfer " << m_queue_family_indices[QUEUE_TRANSFER]
+		<< ", compute " << m_queue_family_indices[QUEUE_COMPUTE] << std::endl;
+	std::cout << "Indirect draw count: " << (HasDrawIndirectCount() ? "yes" : "no") << std::endl;
+	std::cout << "Descriptor update templates: " << (HasDescriptorUpdateTemplates() ? "yes" : "no") << std::endl;
+	std::cout << "Bindless: " << (HasBindless() ? "yes" : "no") << std::endl;
 }
 
 void Renderer::DeInitDevice() {
@@ -245,193 +848,101 @@ void Renderer::DeInitDevice() {
 }
 
 void Renderer::InitCommandBuffer() {
-	VkFenceCreateInfo fence_create_info{};
-	fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	ErrorCheck(vkCreateFence(m_device, &fence_create_info, nullptr, &m_fence));
-	
-	VkSemaphoreCreateInfo semaphore_create_info{};
-	semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-	ErrorCheck(vkCreateSemaphore(m_device, &semaphore_create_info, nullptr, &m_semaphore));
-
 	VkCommandPoolCreateInfo pool_info{};
 	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 	pool_info.queueFamilyIndex = m_graphics_family_index;
 	pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 	ErrorCheck(vkCreateCommandPool(m_device, &pool_info, nullptr, &m_command_pool));
 
-	
+	std::vector<VkCommandBuffer> command_buffers(m_frames_in_flight);
 	VkCommandBufferAllocateInfo command_buffer_info{};
 	command_buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	command_buffer_info.commandPool = m_command_pool;
-	command_buffer_info.commandBufferCount = 2;
+	command_buffer_info.commandBufferCount = m_frames_in_flight;
 	command_buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	ErrorCheck(vkAllocateCommandBuffers(m_device, &command_buffer_info, m_command_buffer));
-
-	//{
-	//	VkCommandBufferBeginInfo command_buffer_begin_info{};
-	//	command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	//	vkBeginCommandBuffer(command_buffer[0], &command_buffer_begin_info);
-
-	//	vkCmdPipelineBarrier(command_buffer[0],
-	//		VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-	//		VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-	//		0,
-	//		0, nullptr,
-	//		0, nullptr,
-	//		0, nullptr);
-
-	//	//command buffer... commands
-
-	//	VkViewport viewport{};
-	//	viewport.width = 1366.0f;
-	//	viewport.height = 768.0f;
-	//	viewport.x = 0.0f;
-	//	viewport.y = 0.0f;
-	//	viewport.maxDepth = 1.0f;
-	//	viewport.minDepth = 0.0f;
-	//	vkCmdSetViewport(command_buffer[0], 0, 1, &viewport);
-
-	//	vkEndCommandBuffer(command_buffer[0]);
-	//}
-
-	//{
-	//	VkCommandBufferBeginInfo command_buffer_begin_info{};
-	//	command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	//	vkBeginCommandBuffer(command_buffer[1], &command_buffer_begin_info);
-
-	//	//command buffer... commands
-
-	//	VkViewport viewport{};
-	//	viewport.width = 1366.0f;
-	//	viewport.height = 768.0f;
-	//	viewport.x = 0.0f;
-	//	viewport.y = 0.0f;
-	//	viewport.maxDepth = 1.0f;
-	//	viewport.minDepth = 0.0f;
-	//	vkCmdSetViewport(command_buffer[1], 0, 1, &viewport);
-
-	//	vkEndCommandBuffer(command_buffer[1]);
-	//}
-
-	//{
-	//	VkSubmitInfo submit_info{};
-	//	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	//	submit_info.commandBufferCount = 1;
-	//	submit_info.pCommandBuffers = &command_buffer[0];
-	//	submit_info.signalSemaphoreCount = 1;
-	//	submit_info.pSignalSemaphores = &semaphore;
-	//	vkQueueSubmit(queue, 1, &submit_info, VK_NULL_HANDLE);
-	//}
-
-	//{
-	//	VkPipelineStageFlags flags[]{ VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
-	//	VkSubmitInfo submit_info{};
-	//	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	//	submit_info.commandBufferCount = 1;
-	//	submit_info.pCommandBuffers = &command_buffer[1];
-	//	submit_info.waitSemaphoreCount = 1;
-	//	submit_info.pWaitSemaphores = &semaphore;
-	//	submit_info.pWaitDstStageMask = flags;
-	//	vkQueueSubmit(queue, 1, &submit_info, VK_NULL_HANDLE);
-	//}
-
-	////vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
-	//vkQueueWaitIdle(queue);
+	ErrorCheck(vkAllocateCommandBuffers(m_device, &command_buffer_info, command_buffers.data()));
 
-	
-}
-
-void Renderer::DeInitCommandBuffer() {
-	WaitCommandBuffer();
-	vkDestroyCommandPool(m_device, m_command_pool, nullptr);
-	vkDestroyFence(m_device, m_fence, nullptr);
-	vkDestroySemaphore(m_device, m_semaphore, nullptr);
-}
-
-void Renderer::InitRenderPass() {
-	ErrorCheck(vkAcquireNextImageKHR(m_device, m_window->GetSwapchain(), UINT64_MAX, m_semaphore, VK_NULL_HANDLE, &m_current_buffer));
-	//perform a bunch of random ass checks
-	if (m_command_buffer[0] == VK_NULL_HANDLE) {
-		assert(0 && "Command buffer not initialised");
-	}
-	if (m_queue == VK_NULL_HANDLE) {
-		assert(0 && "Device queue not found");
-	}
-
-	BeginCommandBuffer(0);
-
-	VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	VkImageLayout old_image_layout = VK_IMAGE_LAYOUT_UNDEFINED;
-	VkImageLayout new_image_layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkImageMemoryBarrier image_memory_barrier{};
-	image_memory_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	image_memory_barrier.pNext = VK_NULL_HANDLE;
-	image_memory_barrier.srcAccessMask = 0;
-	image_memory_barrier.dstAccessMask = 0;
-	image_memory_barrier.oldLayout = old_image_layout;
-	image_memory_barrier.newLayout = new_image_layout;
-	image_memory_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	image_memory_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	image_memory_barrier.image = m_window->GetSwapchainImages()[m_current_buffer];
-	image_memory_barrier.subresourceRange.aspectMask = aspectMask;
-	image_memory_barrier.subresourceRange.baseMipLevel = 0;
-	image_memory_barrier.subresourceRange.levelCount = 1;
-	image_memory_barrier.subresourceRange.baseArrayLayer = 0;
-	image_memory_barrier.subresourceRange.layerCount = 1;
-
-	if (old_image_layout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) {
-		image_memory_barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	}
-
-	if (new_image_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-		image_memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-	}
+	//fences start signalled so the first wait on each frame returns straight away
+	VkFenceCreateInfo fence_create_info{};
+	fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fence_create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-	if (new_image_layout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
-		image_memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-	}
+	VkSemaphoreCreateInfo semaphore_create_info{};
+	semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	if (old_image_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-		image_memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	m_frames.resize(m_frames_in_flight);
+	for (uint32_t i = 0; i < m_frames_in_flight; i++) {
+		m_frames[i].command_buffer = command_buffers[i];
+		ErrorCheck(vkCreateSemaphore(m_device, &semaphore_create_info, nullptr, &m_frames[i].image_acquired_semaphore));
+		ErrorCheck(vkCreateSemaphore(m_device, &semaphore_create_info, nullptr, &m_frames[i].render_finished_semaphore));
+		ErrorCheck(vkCreateFence(m_device, &fence_create_info, nullptr, &m_frames[i].fence));
 	}
+}
 
-	if (old_image_layout == VK_IMAGE_LAYOUT_PREINITIALIZED) {
-		image_memory_barrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
+void Renderer::DeInitCommandBuffer() {
+	WaitIdle();
+	for (uint32_t i = 0; i < m_frames.size(); i++) {
+		vkDestroyFence(m_device, m_frames[i].fence, nullptr);
+		vkDestroySemaphore(m_device, m_frames[i].render_finished_semaphore, nullptr);
+		vkDestroySemaphore(m_device, m_frames[i].image_acquired_semaphore, nullptr);
 	}
+	m_frames.clear();
+	vkDestroyCommandPool(m_device, m_command_pool, nullptr);
+}
 
-	if (new_image_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-		image_memory_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+void Renderer::InitPipelineCache() {
+	VkPipelineCacheCreateInfo pipeline_cache_create_info{};
+	pipeline_cache_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	pipeline_cache_create_info.pNext = VK_NULL_HANDLE;
+	pipeline_cache_create_info.flags = 0;
+
+	//the header is headerSize, headerVersion, vendorID, deviceID then the cache uuid. a blob from another
+	//gpu or driver version is at best ignored by the driver, so it is dropped here instead
+	MappedFile file;
+	if (file.Open(PIPELINE_CACHE_FILE) && file.GetSize() >= 4 * sizeof(uint32_t) + VK_UUID_SIZE) {
+		uint32_t header[4];
+		memcpy(header, file.GetData(), sizeof(header));
+		const uint8_t * uuid = file.GetData() + sizeof(header);
+		if (header[0] >= sizeof(header) + VK_UUID_SIZE && header[0] <= file.GetSize() &&
+			header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+			header[2] == m_gpu_properties.vendorID &&
+			header[3] == m_gpu_properties.deviceID &&
+			memcmp(uuid, m_gpu_properties.pipelineCacheUUID, VK_UUID_SIZE) == 0) {
+			pipeline_cache_create_info.initialDataSize = file.GetSize();
+			pipeline_cache_create_info.pInitialData = file.GetData();
+			m_pipeline_cache_loaded = true;
+		}
+		else {
+			std::cout << "Pipeline cache was written by a different device or driver, starting empty" << std::endl;
+		}
 	}
 
-	if (new_image_layout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) {
-		image_memory_barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	}
+	ErrorCheck(vkCreatePipelineCache(m_device, &pipeline_cache_create_info, VK_NULL_HANDLE, &m_pipeline_cache));
+}
 
-	if (new_image_layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
-		image_memory_barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+void Renderer::DeInitPipelineCache() {
+	size_t size = 0;
+	ErrorCheck(vkGetPipelineCacheData(m_device, m_pipeline_cache, &size, VK_NULL_HANDLE));
+	std::vector<uint8_t> data(size);
+	if (size > 0 && vkGetPipelineCacheData(m_device, m_pipeline_cache, &size, data.data()) == VK_SUCCESS) {
+		if (!write_file_atomic(PIPELINE_CACHE_FILE, data.data(), size)) {
+			std::cout << "Could not save the pipeline cache" << std::endl;
+		}
 	}
+	vkDestroyPipelineCache(m_device, m_pipeline_cache, VK_NULL_HANDLE);
+	m_pipeline_cache = VK_NULL_HANDLE;
+}
 
-	VkPipelineStageFlags source_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-	VkPipelineStageFlags destination_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-
-	vkCmdPipelineBarrier(m_command_buffer[0], source_stages, destination_stages, 0, 0, nullptr, 0, nullptr, 1, &image_memory_barrier);
-
-	EndCommandBuffer(0);
-	//WaitCommandBuffer();
-	VkPipelineStageFlags flags[] = { VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
-	QueueCommandBuffer(0, flags);
-	
-
+void Renderer::InitRenderPass() {
 	VkAttachmentDescription attachment_descriptions[2];
-	attachment_descriptions[0].format = m_window->GetSurfaceFormatKHR().format;
+	attachment_descriptions[0].format = m_render_target->GetColourFormat();
 	attachment_descriptions[0].samples = VK_SAMPLE_COUNT_1_BIT;
 	attachment_descriptions[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 	attachment_descriptions[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 	attachment_descriptions[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	attachment_descriptions[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	attachment_descriptions[0].initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	attachment_descriptions[0].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	attachment_descriptions[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	attachment_descriptions[0].finalLayout = m_render_target->GetFinalLayout();
 	attachment_descriptions[0].flags = 0;
 
 	attachment_descriptions[1].format = VK_FORMAT_D16_UNORM;
@@ -440,7 +951,7 @@ void Renderer::InitRenderPass() {
 	attachment_descriptions[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	attachment_descriptions[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	attachment_descriptions[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	attachment_descriptions[1].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	attachment_descriptions[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	attachment_descriptions[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 	attachment_descriptions[1].flags = 0;
 
@@ -464,6 +975,17 @@ void Renderer::InitRenderPass() {
 	subpass_description.preserveAttachmentCount = 0;
 	subpass_description.pPreserveAttachments = VK_NULL_HANDLE;
 
+	//the colour attachment must wait for the acquire semaphore, and with several frames in flight
+	//the shared depth buffer must not be cleared while the previous frame is still testing against it
+	VkSubpassDependency subpass_dependency{};
+	subpass_dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+	subpass_dependency.dstSubpass = 0;
+	subpass_dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	subpass_dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	subpass_dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	subpass_dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	subpass_dependency.dependencyFlags = 0;
+
 	VkRenderPassCreateInfo render_pass_create_info{};
 	render_pass_create_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
 	render_pass_create_info.pNext = VK_NULL_HANDLE;
@@ -471,8 +993,8 @@ void Renderer::InitRenderPass() {
 	render_pass_create_info.pAttachments = attachment_descriptions;
 	render_pass_create_info.subpassCount = 1;
 	render_pass_create_info.pSubpasses = &subpass_description;
-	render_pass_create_info.dependencyCount = 0;
-	render_pass_create_info.pDependencies = VK_NULL_HANDLE;
+	render_pass_create_info.dependencyCount = 1;
+	render_pass_create_info.pDependencies = &subpass_dependency;
 	ErrorCheck(vkCreateRenderPass(m_device, &render_pass_create_info, VK_NULL_HANDLE, &m_render_pass));
 }
 
@@ -480,8 +1002,89 @@ void Renderer::DeInitRenderPass() {
 	vkDestroyRenderPass(m_device, m_render_pass, VK_NULL_HANDLE);
 }
 
-void Renderer::InitShaders() {
-	static const char * vertex_shader_text =
+void Renderer::InitShaders() {
+	static const char * vertex_shader_text =
+		"#version 400\n"
+		"#extension GL_ARB_separate_shader_objects : enable\n"
+		"#extension GL_ARB_shading_language_420pack : enable\n"
+		"layout (std140, binding = 0) uniform bufferVals {\n"
+		"    mat4 mvp;\n"
+		"} myBufferVals;\n"
+		"layout (location = 0) in vec4 pos;\n"
+		"layout (location = 1) in vec4 inColor;\n"
+		"layout (location = 0) out vec4 outColor;\n"
+		"out gl_PerVertex { \n"
+		"    vec4 gl_Position;\n"
+		"};\n"
+		"void main() {\n"
+		"   outColor = inColor;\n"
+		"   gl_Position = myBufferVals.mvp * pos;\n"
+		"}\n";
+
+	//same interface, but the uniform only holds the view projection and the model matrix comes per instance
+	static const char * instanced_vertex_shader_text =
+		"#version 400\n"
+		"#extension GL_ARB_separate_shader_objects : enable\n"
+		"#extension GL_ARB_shading_language_420pack : enable\n"
+		"layout (std140, binding = 0) uniform bufferVals {\n"
+		"    mat4 view_projection;\n"
+		"} myBufferVals;\n"
+		"layout (location = 0) in vec4 pos;\n"
+		"layout (location = 1) in vec4 inColor;\n"
+		"layout (location = 2) in mat4 model;\n"
+		"layout (location = 0) out vec4 outColor;\n"
+		"out gl_PerVertex { \n"
+		"    vec4 gl_Position;\n"
+		"};\n"
+		"void main() {\n"
+		"   outColor = inColor;\n"
+		"   gl_Position = myBufferVals.view_projection * model * pos;\n"
+		"}\n";
+
+	static const char * fragment_shader_text =
+		"#version 400\n"
+		"#extension GL_ARB_separate_shader_objects : enable\n"
+		"#extension GL_ARB_shading_language_420pack : enable\n"
+		"layout (location = 0) in vec4 color;\n"
+		"layout (location = 0) out vec4 outColor;\n"
+		"void main() {\n"
+		"   outColor = color;\n"
+		"}\n";
+
+	//the scene shaders with the mvp pushed rather than read from the uniform, and a material index picking a tint. the
+	//block mirrors DrawConstants
+	static const char * push_constant_vertex_shader_text =
+		"#version 450\n"
+		"layout (push_constant) uniform Constants {\n"
+		"    mat4 mvp;\n"
+		"    uint material;\n"
+		"} constants;\n"
+		"layout (location = 0) in vec4 pos;\n"
+		"layout (location = 1) in vec4 inColor;\n"
+		"layout (location = 0) out vec4 outColor;\n"
+		"out gl_PerVertex { \n"
+		"    vec4 gl_Position;\n"
+		"};\n"
+		"void main() {\n"
+		"   outColor = inColor;\n"
+		"   gl_Position = constants.mvp * pos;\n"
+		"}\n";
+
+	static const char * push_constant_fragment_shader_text =
+		"#version 450\n"
+		"layout (push_constant) uniform Constants {\n"
+		"    mat4 mvp;\n"
+		"    uint material;\n"
+		"} constants;\n"
+		"const vec3 tints[4] = vec3[](vec3(1.0), vec3(1.0, 0.6, 0.6), vec3(0.6, 1.0, 0.6), vec3(0.6, 0.6, 1.0));\n"
+		"layout (location = 0) in vec4 color;\n"
+		"layout (location = 0) out vec4 outColor;\n"
+		"void main() {\n"
+		"   outColor = vec4(color.rgb * tints[constants.material % 4u], color.a);\n"
+		"}\n";
+
+	//position and uv, the texture sampled at binding 1 of the same set as the mvp
+	static const char * textured_vertex_shader_text =
 		"#version 400\n"
 		"#extension GL_ARB_separate_shader_objects : enable\n"
 		"#extension GL_ARB_shading_language_420pack : enable\n"
@@ -489,87 +1092,378 @@ void Renderer::InitShaders() {
 		"    mat4 mvp;\n"
 		"} myBufferVals;\n"
 		"layout (location = 0) in vec4 pos;\n"
-		"layout (location = 1) in vec4 inColor;\n"
-		"layout (location = 0) out vec4 outColor;\n"
+		"layout (location = 1) in vec2 inTexCoord;\n"
+		"layout (location = 0) out vec2 texCoord;\n"
 		"out gl_PerVertex { \n"
 		"    vec4 gl_Position;\n"
 		"};\n"
 		"void main() {\n"
-		"   outColor = inColor;\n"
+		"   texCoord = inTexCoord;\n"
 		"   gl_Position = myBufferVals.mvp * pos;\n"
 		"}\n";
 
-	static const char * fragment_shader_text =
+	static const char * textured_fragment_shader_text =
 		"#version 400\n"
 		"#extension GL_ARB_separate_shader_objects : enable\n"
 		"#extension GL_ARB_shading_language_420pack : enable\n"
-		"layout (location = 0) in vec4 color;\n"
+		"layout (binding = 1) uniform sampler2D tex;\n"
+		"layout (location = 0) in vec2 texCoord;\n"
 		"layout (location = 0) out vec4 outColor;\n"
 		"void main() {\n"
-		"   outColor = color;\n"
+		"   outColor = texture(tex, texCoord);\n"
+		"}\n";
+
+	//the textured shaders again, but reading the mvp and which image and sampler to pair from push constants. the index is
+	//the same for the whole draw, so the core dynamic indexing features cover it without nonuniformEXT
+	static const char * bindless_vertex_shader_text =
+		"#version 450\n"
+		"layout (push_constant) uniform Constants {\n"
+		"    mat4 mvp;\n"
+		"    uint image;\n"
+		"    uint sampler_index;\n"
+		"    uint buffer_index;\n"
+		"} constants;\n"
+		"layout (location = 0) in vec4 pos;\n"
+		"layout (location = 1) in vec2 inTexCoord;\n"
+		"layout (location = 0) out vec2 texCoord;\n"
+		"out gl_PerVertex { \n"
+		"    vec4 gl_Position;\n"
+		"};\n"
+		"void main() {\n"
+		"   texCoord = inTexCoord;\n"
+		"   gl_Position = constants.mvp * pos;\n"
+		"}\n";
+
+	static const char * bindless_fragment_shader_text =
+		"#version 450\n"
+		"layout (set = 0, binding = 1) uniform texture2D images[BINDLESS_MAX_IMAGES];\n"
+		"layout (set = 0, binding = 2) uniform sampler samplers[BINDLESS_MAX_SAMPLERS];\n"
+		"layout (push_constant) uniform Constants {\n"
+		"    mat4 mvp;\n"
+		"    uint image;\n"
+		"    uint sampler_index;\n"
+		"    uint buffer_index;\n"
+		"} constants;\n"
+		"layout (location = 0) in vec2 texCoord;\n"
+		"layout (location = 0) out vec4 outColor;\n"
+		"void main() {\n"
+		"   outColor = texture(sampler2D(images[constants.image], samplers[constants.sampler_index]), texCoord);\n"
+		"}\n";
+
+	//one invocation per object: survivors of the six plane tests get a slot from the atomic instance count, and their
+	//model matrix and a single-instance command are written there. the layouts mirror GpuCullObject and GpuCullConstants
+	static const char * cull_shader_text =
+		"#version 450\n"
+		"layout (local_size_x = 64) in;\n"
+		"struct Object {\n"
+		"    mat4 model;\n"
+		"    vec4 sphere;\n"
+		"};\n"
+		"struct DrawCommand {\n"
+		"    uint index_count;\n"
+		"    uint instance_count;\n"
+		"    uint first_index;\n"
+		"    int vertex_offset;\n"
+		"    uint first_instance;\n"
+		"};\n"
+		"layout (std430, binding = 0) readonly buffer Objects {\n"
+		"    Object objects[];\n"
+		"};\n"
+		"layout (std430, binding = 1) writeonly buffer Instances {\n"
+		"    mat4 instances[];\n"
+		"};\n"
+		"layout (std430, binding = 2) buffer Draws {\n"
+		"    DrawCommand all_instances;\n"
+		"    uint padding[3];\n"
+		"    DrawCommand commands[];\n"
+		"};\n"
+		"layout (push_constant) uniform Constants {\n"
+		"    vec4 planes[6];\n"
+		"    uint object_count;\n"
+		"    uint index_count;\n"
+		"} constants;\n"
+		"void main() {\n"
+		"   uint i = gl_GlobalInvocationID.x;\n"
+		"   if (i == 0) {\n"
+		"       all_instances.index_count = constants.index_count;\n"
+		"   }\n"
+		"   if (i >= constants.object_count) {\n"
+		"       return;\n"
+		"   }\n"
+		"   vec4 sphere = objects[i].sphere;\n"
+		"   for (int p = 0; p < 6; p++) {\n"
+		"       vec4 plane = constants.planes[p];\n"
+		"       precise float distance = plane.x * sphere.x + plane.y * sphere.y + plane.z * sphere.z + plane.w;\n"
+		"       if (!(distance + sphere.w > 0.0)) {\n"
+		"           return;\n"
+		"       }\n"
+		"   }\n"
+		"   uint slot = atomicAdd(all_instances.instance_count, 1u);\n"
+		"   instances[slot] = objects[i].model;\n"
+		"   commands[slot].index_count = constants.index_count;\n"
+		"   commands[slot].instance_count = 1u;\n"
+		"   commands[slot].first_index = 0u;\n"
+		"   commands[slot].vertex_offset = 0;\n"
+		"   commands[slot].first_instance = slot;\n"
 		"}\n";
 
-	std::vector<unsigned int> vertex_shader_SPIR_V;
-	m_pipeline_shader_stage_create_info[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	m_pipeline_shader_stage_create_info[0].pNext = VK_NULL_HANDLE;
-	m_pipeline_shader_stage_create_info[0].pSpecializationInfo = VK_NULL_HANDLE;
-	m_pipeline_shader_stage_create_info[0].flags = 0;
-	m_pipeline_shader_stage_create_info[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-	m_pipeline_shader_stage_create_info[0].pName = "main";
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	//all stages compile side by side on the worker pool
+	std::vector<ShaderCompileJob> jobs(8);
+	jobs[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	jobs[0].source = vertex_shader_text;
+	jobs[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	jobs[1].source = fragment_shader_text;
+	jobs[2].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	jobs[2].source = instanced_vertex_shader_text;
+	jobs[3].stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	jobs[3].source = cull_shader_text;
+	jobs[4].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	jobs[4].source = textured_vertex_shader_text;
+	jobs[5].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	jobs[5].source = textured_fragment_shader_text;
+	jobs[6].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	jobs[6].source = push_constant_vertex_shader_text;
+	jobs[7].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	jobs[7].source = push_constant_fragment_shader_text;
+	if (m_bindless) {
+		std::vector<std::string> bindless_defines;
+		bindless_defines.push_back("BINDLESS_MAX_IMAGES " + std::to_string(BINDLESS_MAX_IMAGES));
+		bindless_defines.push_back("BINDLESS_MAX_SAMPLERS " + std::to_string(BINDLESS_MAX_SAMPLERS));
+		jobs.resize(10);
+		jobs[8].stage = VK_SHADER_STAGE_VERTEX_BIT;
+		jobs[8].source = bindless_vertex_shader_text;
+		jobs[9].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+		jobs[9].source = bindless_fragment_shader_text;
+		jobs[9].defines = bindless_defines;
+	}
+	std::vector<std::future<ShaderCompileResult>> results = m_shader_compiler->CompileBatch(jobs);
+
+	VkPipelineShaderStageCreateInfo * stages[10] = { &m_pipeline_shader_stage_create_info[0], &m_pipeline_shader_stage_create_info[1], &m_instanced_shader_stage_create_info[0], &m_cull_shader_stage_create_info,
+		&m_textured_shader_stage_create_info[0], &m_textured_shader_stage_create_info[1], &m_push_constant_shader_stage_create_info[0], &m_push_constant_shader_stage_create_info[1],
+		&m_bindless_shader_stage_create_info[0], &m_bindless_shader_stage_create_info[1] };
+	for (uint32_t i = 0; i < jobs.size(); i++) {
+		ShaderCompileResult result = results[i].get();
+		if (!result.success) {
+			std::cout << result.log << std::endl;
+			assert(0 && "Shader could not be converted from GLSL to SPIR_V");
+		}
+
+		stages[i]->sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		stages[i]->pNext = VK_NULL_HANDLE;
+		stages[i]->pSpecializationInfo = VK_NULL_HANDLE;
+		stages[i]->flags = 0;
+		stages[i]->stage = jobs[i].stage;
+		stages[i]->pName = "main";
+
+		VkShaderModuleCreateInfo shader_module_create_info{};
+		shader_module_create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		shader_module_create_info.pNext = VK_NULL_HANDLE;
+		shader_module_create_info.flags = 0;
+		shader_module_create_info.codeSize = result.spirv.size() * sizeof(unsigned int);
+		shader_module_create_info.pCode = result.spirv.data();
+
+		ErrorCheck(vkCreateShaderModule(m_device, &shader_module_create_info, VK_NULL_HANDLE, &stages[i]->module));
+	}
+	m_instanced_shader_stage_create_info[1] = m_pipeline_shader_stage_create_info[1];
 
-	glslang::InitializeProcess();
+	//a cold cache pays for glslang, a warm one only for mapping the blobs
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "shaders: " << milliseconds << "ms (" << m_shader_cache->GetHitCount() << " cache hits, " << m_shader_cache->GetMissCount() << " misses)" << std::endl;
+}
 
-	bool vertex_shader_result = GLSLtoSPV(VK_SHADER_STAGE_VERTEX_BIT, vertex_shader_text, vertex_shader_SPIR_V);
-	if (!vertex_shader_result) {
-		assert(0 && "Shader could not be converted from GLSL to SPIR_V");
+void Renderer::DeInitShaders() {
+	for (int i = 0; i < 2; i++) {
+		vkDestroyShaderModule(m_device, m_pipeline_shader_stage_create_info[i].module, VK_NULL_HANDLE);
 	}
+	//the fragment stage is shared, only the instanced vertex module is its own
+	vkDestroyShaderModule(m_device, m_instanced_shader_stage_create_info[0].module, VK_NULL_HANDLE);
+	vkDestroyShaderModule(m_device, m_cull_shader_stage_create_info.module, VK_NULL_HANDLE);
+	for (int i = 0; i < 2; i++) {
+		vkDestroyShaderModule(m_device, m_textured_shader_stage_create_info[i].module, VK_NULL_HANDLE);
+		vkDestroyShaderModule(m_device, m_push_constant_shader_stage_create_info[i].module, VK_NULL_HANDLE);
+		if (m_bindless) {
+			vkDestroyShaderModule(m_device, m_bindless_shader_stage_create_info[i].module, VK_NULL_HANDLE);
+		}
+	}
+}
 
-	VkShaderModuleCreateInfo vertex_shader_module_create_info{};
-	vertex_shader_module_create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	vertex_shader_module_create_info.pNext = VK_NULL_HANDLE;
-	vertex_shader_module_create_info.flags = 0;
-	vertex_shader_module_create_info.codeSize = vertex_shader_SPIR_V.size() * sizeof(unsigned int);
-	vertex_shader_module_create_info.pCode = vertex_shader_SPIR_V.data();
+void Renderer::InitTextures() {
+	VkSamplerCreateInfo sampler_create_info{};
+	sampler_create_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	sampler_create_info.magFilter = VK_FILTER_LINEAR;
+	sampler_create_info.minFilter = VK_FILTER_LINEAR;
+	sampler_create_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	sampler_create_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	sampler_create_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	sampler_create_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	sampler_create_info.anisotropyEnable = m_sampler_anisotropy ? VK_TRUE : VK_FALSE;
+	sampler_create_info.maxAnisotropy = m_sampler_anisotropy ? std::min(TEXTURE_MAX_ANISOTROPY, m_gpu_properties.limits.maxSamplerAnisotropy) : 1.0f;
+	sampler_create_info.compareOp = VK_COMPARE_OP_ALWAYS;
+	sampler_create_info.minLod = 0.0f;
+	//whatever chain the texture has is used, down to 1x1
+	sampler_create_info.maxLod = VK_LOD_CLAMP_NONE;
+	sampler_create_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+
+	ErrorCheck(vkCreateSampler(m_device, &sampler_create_info, VK_NULL_HANDLE, &m_sampler));
+	if (m_pipeline->IsBindless()) {
+		m_bindless_sampler = m_pipeline->AddBindlessSampler(m_sampler);
+	}
 
-	ErrorCheck(vkCreateShaderModule(m_device, &vertex_shader_module_create_info, VK_NULL_HANDLE, &m_pipeline_shader_stage_create_info[0].module));
+	m_default_texture = Texture::LoadKtx2(this, SCENE_TEXTURE_FILE);
+	if (m_default_texture == nullptr) {
+		//a checkerboard aliases as badly as anything when minified, which makes a missing or broken chain obvious
+		std::vector<uint32_t> pixels(DEFAULT_TEXTURE_SIZE * DEFAULT_TEXTURE_SIZE);
+		for (uint32_t y = 0; y < DEFAULT_TEXTURE_SIZE; y++) {
+			for (uint32_t x = 0; x < DEFAULT_TEXTURE_SIZE; x++) {
+				pixels[y * DEFAULT_TEXTURE_SIZE + x] = ((x / 16 + y / 16) % 2 == 0) ? 0xffffffffu : 0xff404040u;
+			}
+		}
+		m_default_texture = new Texture(this, DEFAULT_TEXTURE_SIZE, DEFAULT_TEXTURE_SIZE, VK_FORMAT_R8G8B8A8_UNORM, pixels.data(), pixels.size() * sizeof(uint32_t));
+	}
+	SetTexture(nullptr);
 
-	std::vector<unsigned int> fragment_shader_SPIR_V;
-	m_pipeline_shader_stage_create_info[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	m_pipeline_shader_stage_create_info[1].pNext = VK_NULL_HANDLE;
-	m_pipeline_shader_stage_create_info[1].pSpecializationInfo = VK_NULL_HANDLE;
-	m_pipeline_shader_stage_create_info[1].flags = 0;
-	m_pipeline_shader_stage_create_info[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	m_pipeline_shader_stage_create_info[1].pName = "main";
+	const vertex_uv_data g_vb_texture_Data[] = {
+		//left face
+		vertex_uv_data(glm::vec3(-1, -1, -1), glm::vec2(1.f, 0.f)),
+		vertex_uv_data(glm::vec3(-1,  1,  1), glm::vec2(0.f, 1.f)),
+		vertex_uv_data(glm::vec3(-1, -1,  1), glm::vec2(0.f, 0.f)),
+		vertex_uv_data(glm::vec3(-1,  1,  1), glm::vec2(0.f, 1.f)),
+		vertex_uv_data(glm::vec3(-1, -1, -1), glm::vec2(1.f, 0.f)),
+		vertex_uv_data(glm::vec3(-1,  1, -1), glm::vec2(1.f, 1.f)),
+		// front face
+		vertex_uv_data(glm::vec3(-1, -1, -1), glm::vec2(0.f, 0.f)),
+		vertex_uv_data(glm::vec3(1, -1, -1), glm::vec2(1.f, 0.f)),
+		vertex_uv_data(glm::vec3(1,  1, -1), glm::vec2(1.f, 1.f)),
+		vertex_uv_data(glm::vec3(-1, -1, -1), glm::vec2(0.f, 0.f)),
+		vertex_uv_data(glm::vec3(1,  1, -1), glm::vec2(1.f, 1.f)),
+		vertex_uv_data(glm::vec3(-1,  1, -1), glm::vec2(0.f, 1.f)),
+		// top face
+		vertex_uv_data(glm::vec3(-1, -1, -1), glm::vec2(0.f, 1.f)),
+		vertex_uv_data(glm::vec3(1, -1,  1), glm::vec2(1.f, 0.f)),
+		vertex_uv_data(glm::vec3(1, -1, -1), glm::vec2(1.f, 1.f)),
+		vertex_uv_data(glm::vec3(-1, -1, -1), glm::vec2(0.f, 1.f)),
+		vertex_uv_data(glm::vec3(-1, -1,  1), glm::vec2(0.f, 0.f)),
+		vertex_uv_data(glm::vec3(1, -1,  1), glm::vec2(1.f, 0.f)),
+		// bottom face
+		vertex_uv_data(glm::vec3(-1,  1, -1), glm::vec2(0.f, 0.f)),
+		vertex_uv_data(glm::vec3(1,  1,  1), glm::vec2(1.f, 1.f)),
+		vertex_uv_data(glm::vec3(-1,  1,  1), glm::vec2(0.f, 1.f)),
+		vertex_uv_data(glm::vec3(-1,  1, -1), glm::vec2(0.f, 0.f)),
+		vertex_uv_data(glm::vec3(1,  1, -1), glm::vec2(1.f, 0.f)),
+		vertex_uv_data(glm::vec3(1,  1,  1), glm::vec2(1.f, 1.f)),
+		// right face
+		vertex_uv_data(glm::vec3(1,  1, -1), glm::vec2(0.f, 1.f)),
+		vertex_uv_data(glm::vec3(1, -1,  1), glm::vec2(1.f, 0.f)),
+		vertex_uv_data(glm::vec3(1,  1,  1), glm::vec2(1.f, 1.f)),
+		vertex_uv_data(glm::vec3(1, -1,  1), glm::vec2(1.f, 0.f)),
+		vertex_uv_data(glm::vec3(1,  1, -1), glm::vec2(0.f, 1.f)),
+		vertex_uv_data(glm::vec3(1, -1, -1), glm::vec2(0.f, 0.f)),
+		// back face
+		vertex_uv_data(glm::vec3(-1,  1,  1), glm::vec2(1.f, 1.f)),
+		vertex_uv_data(glm::vec3(1,  1,  1), glm::vec2(0.f, 1.f)),
+		vertex_uv_data(glm::vec3(-1, -1,  1), glm::vec2(1.f, 0.f)),
+		vertex_uv_data(glm::vec3(-1, -1,  1), glm::vec2(1.f, 0.f)),
+		vertex_uv_data(glm::vec3(1,  1,  1), glm::vec2(0.f, 1.f)),
+		vertex_uv_data(glm::vec3(1, -1,  1), glm::vec2(0.f, 0.f)),
+	};
 
-	bool fragment_shader_result = GLSLtoSPV(VK_SHADER_STAGE_FRAGMENT_BIT, fragment_shader_text, fragment_shader_SPIR_V);
-	if (!fragment_shader_result) {
-		assert(0 && "Shader could not be converted from GLSL to SPIR_V");
+	//small enough to stay unindexed; half floats hold the cube's corners exactly, so it needs no dequantisation
+	VertexLayout layout{};
+	layout.position = VERTEX_POSITION_HALF;
+	layout.uv = true;
+	m_textured_vertex_count = sizeof(g_vb_texture_Data) / sizeof(g_vb_texture_Data[0]);
+	std::vector<glm::vec3> positions(m_textured_vertex_count);
+	std::vector<glm::vec2> uvs(m_textured_vertex_count);
+	for (uint32_t i = 0; i < m_textured_vertex_count; i++) {
+		positions[i] = g_vb_texture_Data[i].position;
+		uvs[i] = g_vb_texture_Data[i].uv;
 	}
+	VertexStreams streams{};
+	streams.positions = positions.data();
+	streams.uvs = uvs.data();
+	VertexQuantization quantization = VertexFormat::ComputeQuantization(layout, positions.data(), m_textured_vertex_count);
+	uint32_t stride = VertexFormat::GetStride(layout);
+	std::vector<uint8_t> vertices(m_textured_vertex_count * stride);
+	VertexFormat::Encode(layout, streams, m_textured_vertex_count, quantization, vertices.data());
+
+	VkBufferCreateInfo buffer_create_info{};
+	buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_create_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	buffer_create_info.size = vertices.size();
+	buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	ErrorCheck(vkCreateBuffer(m_device, &buffer_create_info, VK_NULL_HANDLE, &m_textured_vertex_buffer));
 
-	VkShaderModuleCreateInfo fragment_shader_module_create_info{};
-	fragment_shader_module_create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	fragment_shader_module_create_info.pNext = VK_NULL_HANDLE;
-	fragment_shader_module_create_info.flags = 0;
-	fragment_shader_module_create_info.codeSize = fragment_shader_SPIR_V.size() * sizeof(unsigned int);
-	fragment_shader_module_create_info.pCode = fragment_shader_SPIR_V.data();
+	m_textured_vertex_buffer_allocation = m_allocator->AllocateForBuffer(m_textured_vertex_buffer, UPLOADER_MEMORY_REQUIRED, UPLOADER_MEMORY_PREFERRED);
 
-	ErrorCheck(vkCreateShaderModule(m_device, &fragment_shader_module_create_info, VK_NULL_HANDLE, &m_pipeline_shader_stage_create_info[1].module));
+	m_uploader->UploadBuffer(m_textured_vertex_buffer, m_textured_vertex_buffer_allocation, 0, vertices.data(), vertices.size());
 
-	glslang::FinalizeProcess();
+	m_textured_input_binding_description.binding = 0;
+	m_textured_input_binding_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	m_textured_input_binding_description.stride = stride;
+	m_textured_attribute_count = VertexFormat::GetAttributes(layout, 0, 0, m_textured_input_attribute_descriptions);
 }
 
-void Renderer::DeInitShaders() {
-	for (int i = 0; i < 2; i++) {
-		vkDestroyShaderModule(m_device, m_pipeline_shader_stage_create_info[i].module, VK_NULL_HANDLE);
+void Renderer::DeInitTextures() {
+	vkDestroyBuffer(m_device, m_textured_vertex_buffer, VK_NULL_HANDLE);
+	m_allocator->Free(m_textured_vertex_buffer_allocation);
+	delete m_default_texture;
+	if (m_pipeline->IsBindless()) {
+		m_pipeline->RemoveBindlessSampler(m_bindless_sampler);
 	}
+	vkDestroySampler(m_device, m_sampler, VK_NULL_HANDLE);
 }
 
-void Renderer::InitFrameBuffer() {
-	WaitCommandBuffer();
+void Renderer::SetTexture(const Texture * texture) {
+	if (texture == nullptr) {
+		texture = m_default_texture;
+	}
+	m_pipeline->SetTexture(texture->GetImageView(), m_sampler);
+}
+
+void Renderer::DrawTexturedBatch(VkCommandBuffer command_buffer, const glm::mat4 * model_matrices, const Texture * const * textures, uint32_t count, bool bindless) {
+	if (count == 0) {
+		return;
+	}
+	const VkDeviceSize device_size_offsets[1] = { 0 };
+	bindless = bindless && m_pipeline->IsBindless();
+
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, bindless ? m_bindless_textured_pipeline : m_textured_pipeline);
+	vkCmdBindVertexBuffers(command_buffer, 0, 1, &m_textured_vertex_buffer, device_size_offsets);
+	if (bindless) {
+		//the only bind for the whole batch; changing texture from one draw to the next is a different index in the push
+		VkDescriptorSet bindless_set = m_pipeline->GetBindlessSet();
+		vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->GetBindlessPipelineLayout(), 0, 1, &bindless_set, 0, VK_NULL_HANDLE);
+		BindlessDrawConstants constants{};
+		constants.sampler = m_bindless_sampler;
+		constants.buffer = BINDLESS_INDEX_INVALID;
+		for (uint32_t i = 0; i < count; i++) {
+			const Texture * texture = textures[i] != nullptr ? textures[i] : m_default_texture;
+			constants.mvp = m_pipeline->GetViewProjectionMatrix() * model_matrices[i];
+			constants.image = texture->GetBindlessIndex();
+			vkCmdPushConstants(command_buffer, m_pipeline->GetBindlessPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(constants), &constants);
+			vkCmdDraw(command_buffer, m_textured_vertex_count, 1, 0, 0);
+		}
+		return;
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		const Texture * texture = textures[i] != nullptr ? textures[i] : m_default_texture;
+		glm::mat4 model_view_projection_matrix = m_pipeline->GetViewProjectionMatrix() * model_matrices[i];
+		uint32_t dynamic_offset = 0;
+		memcpy(m_uniform_ring->Allocate(sizeof(model_view_projection_matrix), dynamic_offset), &model_view_projection_matrix, sizeof(model_view_projection_matrix));
 
-	BeginCommandBuffer(0);
+		VkDescriptorSet descriptor_set = m_pipeline->GetTextureSet(texture->GetImageView(), m_sampler);
+		vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->GetPipelineLayout(), 0, 1, &descriptor_set, 1, &dynamic_offset);
+		vkCmdDraw(command_buffer, m_textured_vertex_count, 1, 0, 0);
+	}
+}
+
+void Renderer::InitFrameBuffer() {
 	VkImageView frame_buffer_views[2];
-	frame_buffer_views[1] = m_window->GetDepthBuffer();
+	frame_buffer_views[1] = m_render_target->GetDepthBuffer();
 
 	VkFramebufferCreateInfo frame_buffer_create_info{};
 	frame_buffer_create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
@@ -577,36 +1471,85 @@ void Renderer::InitFrameBuffer() {
 	frame_buffer_create_info.renderPass = m_render_pass;
 	frame_buffer_create_info.attachmentCount = 2;
 	frame_buffer_create_info.pAttachments = frame_buffer_views;
-	frame_buffer_create_info.width = m_window->GetSurfaceSizeX();
-	frame_buffer_create_info.height = m_window->GetSurfaceSizeY();
+	frame_buffer_create_info.width = m_render_target->GetSurfaceSizeX();
+	frame_buffer_create_info.height = m_render_target->GetSurfaceSizeY();
 	frame_buffer_create_info.layers = 1;
 
-	m_frame_buffers = (VkFramebuffer *)malloc(m_window->GetSwapchainImageCount() * sizeof(VkFramebuffer));
+	m_frame_buffers = (VkFramebuffer *)malloc(m_render_target->GetImageCount() * sizeof(VkFramebuffer));
 	if (m_frame_buffers == 0) {
 		assert(0 && "Could not allocate memory for frame buffers; either they haven't been created or your OS is fucked");
 	}
 
-	for (int i = 0; i < m_window->GetSwapchainImageCount(); i++) {
-		frame_buffer_views[0] = m_window->GetSwapchainImageViews()[i];
+	for (int i = 0; i < m_render_target->GetImageCount(); i++) {
+		frame_buffer_views[0] = m_render_target->GetImageView(i);
 		ErrorCheck(vkCreateFramebuffer(m_device, &frame_buffer_create_info, VK_NULL_HANDLE, &m_frame_buffers[i]));
 	}
-
-	EndCommandBuffer(0);
-	//we aren't executing Cmd(s) so chill with the pipeline stage b0ss
-	//VkPipelineStageFlags flags[] = { VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
-	QueueCommandBuffer(0);
 }
 
 void Renderer::DeInitFrameBuffer() {
-	for (int i = 0; i < m_window->GetSwapchainImageCount(); i++) {
+	for (int i = 0; i < m_render_target->GetImageCount(); i++) {
 		vkDestroyFramebuffer(m_device, m_frame_buffers[i], VK_NULL_HANDLE);
 	}
 	free(m_frame_buffers);
 }
 
 void Renderer::InitVertexBuffer() {
-	BeginCommandBuffer(0);
+	if (!InitSceneMesh(SCENE_MESH_FILE)) {
+		InitBuiltInMesh();
+	}
+
+	m_vertex_input_binding_description.binding = 0;
+	m_vertex_input_binding_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	m_vertex_input_binding_description.stride = VertexFormat::GetStride(m_vertex_layout);
+
+	//the scene's shaders only read a position and a colour, which always come first; anything after them is skipped by the stride
+	VertexLayout drawn_layout = m_vertex_layout;
+	drawn_layout.normal = false;
+	drawn_layout.uv = false;
+	m_vertex_attribute_count = VertexFormat::GetAttributes(drawn_layout, 0, 0, m_vertex_input_attribute_descriptions);
+
+	m_instance_input_binding_description.binding = 1;
+	m_instance_input_binding_description.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+	m_instance_input_binding_description.stride = sizeof(glm::mat4);
+
+	for (uint32_t i = 0; i < 4; i++) {
+		m_instance_input_attribute_descriptions[i].binding = 1;
+		m_instance_input_attribute_descriptions[i].location = 2 + i;
+		m_instance_input_attribute_descriptions[i].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		m_instance_input_attribute_descriptions[i].offset = i * sizeof(glm::vec4);
+	}
+}
+
+bool Renderer::InitSceneMesh(const std::string & path) {
+	MeshFile mesh_file;
+	if (!mesh_file.Open(path)) {
+		return false;
+	}
+	if (!mesh_file.GetLayout().colour) {
+		std::cout << "mesh: " << path << " has no colours for the scene's shaders, using the built-in cube" << std::endl;
+		return false;
+	}
+
+	//the blobs are already in their gpu layout, so they go from the mapping to the uploader untouched; the
+	//uploader's copy into staging, or straight into host visible memory, is the only time the bytes are read
+	auto load_start = std::chrono::steady_clock::now();
+	const MeshFileHeader & header = mesh_file.GetHeader();
+	m_vertex_layout = mesh_file.GetLayout();
+	m_vertex_quantization = mesh_file.GetQuantization();
+	m_dequantization_matrix = VertexFormat::GetDequantizationMatrix(m_vertex_quantization);
+	m_vertex_count = header.vertex_count;
+	m_index_type = mesh_file.GetIndexType();
+	//every lod stays resident behind lod 0 in the index buffer
+	m_index_count = mesh_file.GetLod(0).index_count;
+	CreateMeshBuffers(mesh_file.GetVertexData(), mesh_file.GetVertexDataSize(), mesh_file.GetIndexData(), mesh_file.GetIndexDataSize());
+
+	float load_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - load_start).count();
+	std::cout << "mesh: " << path << ", " << header.vertex_count << " vertices, " << header.index_count / 3 << " triangles over " << header.lod_count
+		<< " lods, " << (header.vertex_size + header.index_size_bytes) / (1024 * 1024) << " MB queued in " << load_ms << " ms" << std::endl;
+	return true;
+}
 
+void Renderer::InitBuiltInMesh() {
 	const vertex_data g_vbData[] = {
 		vertex_data(glm::vec3(-1, -1, -1), glm::vec3(0.f, 0.f, 0.f)),
 		vertex_data(glm::vec3(1, -1, -1), glm::vec3(1.f, 0.f, 0.f)),
@@ -696,56 +1639,54 @@ void Renderer::InitVertexBuffer() {
 		vertex_data(glm::vec3(-1, -1, -1), glm::vec3(0.f, 1.f, 1.f))
 	};
 
-	const vertex_uv_data gg[] = {
-		//left face
-		vertex_uv_data(glm::vec3(-1, -1, -1), glm::vec2(1.f, 0.f)),
-		vertex_uv_data(glm::vec3(-1,  1,  1), glm::vec2(0.f, 1.f)),
-		vertex_uv_data(glm::vec3(-1, -1,  1), glm::vec2(0.f, 0.f)),
-		vertex_uv_data(glm::vec3(-1,  1,  1), glm::vec2(0.f, 1.f)),
-		vertex_uv_data(glm::vec3(-1, -1, -1), glm::vec2(1.f, 0.f)),
-		vertex_uv_data(glm::vec3(-1,  1, -1), glm::vec2(1.f, 1.f)),
-		// front face
-		vertex_uv_data(glm::vec3(-1, -1, -1), glm::vec2(0.f, 0.f)),
-		vertex_uv_data(glm::vec3(1, -1, -1), glm::vec2(1.f, 0.f)),
-		vertex_uv_data(glm::vec3(1,  1, -1), glm::vec2(1.f, 1.f)),
-		vertex_uv_data(glm::vec3(-1, -1, -1), glm::vec2(0.f, 0.f)),
-		vertex_uv_data(glm::vec3(1,  1, -1), glm::vec2(1.f, 1.f)),
-		vertex_uv_data(glm::vec3(-1,  1, -1), glm::vec2(0.f, 1.f)),
-		// top face
-		vertex_uv_data(glm::vec3(-1, -1, -1), glm::vec2(0.f, 1.f)),
-		vertex_uv_data(glm::vec3(1, -1,  1), glm::vec2(1.f, 0.f)),
-		vertex_uv_data(glm::vec3(1, -1, -1), glm::vec2(1.f, 1.f)),
-		vertex_uv_data(glm::vec3(-1, -1, -1), glm::vec2(0.f, 1.f)),
-		vertex_uv_data(glm::vec3(-1, -1,  1), glm::vec2(0.f, 0.f)),
-		vertex_uv_data(glm::vec3(1, -1,  1), glm::vec2(1.f, 0.f)),
-		// bottom face
-		vertex_uv_data(glm::vec3(-1,  1, -1), glm::vec2(0.f, 0.f)),
-		vertex_uv_data(glm::vec3(1,  1,  1), glm::vec2(1.f, 1.f)),
-		vertex_uv_data(glm::vec3(-1,  1,  1), glm::vec2(0.f, 1.f)),
-		vertex_uv_data(glm::vec3(-1,  1, -1), glm::vec2(0.f, 0.f)),
-		vertex_uv_data(glm::vec3(1,  1, -1), glm::vec2(1.f, 0.f)),
-		vertex_uv_data(glm::vec3(1,  1,  1), glm::vec2(1.f, 1.f)),
-		// right face
-		vertex_uv_data(glm::vec3(1,  1, -1), glm::vec2(0.f, 1.f)),
-		vertex_uv_data(glm::vec3(1, -1,  1), glm::vec2(1.f, 0.f)),
-		vertex_uv_data(glm::vec3(1,  1,  1), glm::vec2(1.f, 1.f)),
-		vertex_uv_data(glm::vec3(1, -1,  1), glm::vec2(1.f, 0.f)),
-		vertex_uv_data(glm::vec3(1,  1, -1), glm::vec2(0.f, 1.f)),
-		vertex_uv_data(glm::vec3(1, -1, -1), glm::vec2(0.f, 0.f)),
-		// back face
-		vertex_uv_data(glm::vec3(-1,  1,  1), glm::vec2(1.f, 1.f)),
-		vertex_uv_data(glm::vec3(1,  1,  1), glm::vec2(0.f, 1.f)),
-		vertex_uv_data(glm::vec3(-1, -1,  1), glm::vec2(1.f, 0.f)),
-		vertex_uv_data(glm::vec3(-1, -1,  1), glm::vec2(1.f, 0.f)),
-		vertex_uv_data(glm::vec3(1,  1,  1), glm::vec2(0.f, 1.f)),
-		vertex_uv_data(glm::vec3(1, -1,  1), glm::vec2(0.f, 0.f)),
-	};
+	//the tables above are triangle soup; weld them and lay them out for the post-transform cache and fetch
+	double acmr_before = 0.0;
+	double acmr_after = 0.0;
+	IndexedMesh mesh = MeshProcessing::Optimize(g_vb_solid_face_colors_Data, sizeof(g_vb_solid_face_colors_Data) / sizeof(g_vb_solid_face_colors_Data[0]), &acmr_before, &acmr_after);
+
+	//then packed into m_vertex_layout, with the quantisation undone by the model matrix
+	std::vector<glm::vec3> positions(mesh.vertices.size());
+	std::vector<glm::vec3> colours(mesh.vertices.size());
+	for (uint32_t i = 0; i < mesh.vertices.size(); i++) {
+		positions[i] = mesh.vertices[i].position;
+		colours[i] = mesh.vertices[i].colour;
+	}
+	VertexStreams streams{};
+	streams.positions = positions.data();
+	streams.colours = colours.data();
+	m_vertex_quantization = VertexFormat::ComputeQuantization(m_vertex_layout, positions.data(), (uint32_t)positions.size());
+	m_dequantization_matrix = VertexFormat::GetDequantizationMatrix(m_vertex_quantization);
+	uint32_t stride = VertexFormat::GetStride(m_vertex_layout);
+	std::vector<uint8_t> vertices(positions.size() * stride);
+	VertexFormat::Encode(m_vertex_layout, streams, (uint32_t)positions.size(), m_vertex_quantization, vertices.data());
+
+	std::cout << "mesh: " << sizeof(g_vb_solid_face_colors_Data) / sizeof(g_vb_solid_face_colors_Data[0]) << " -> " << mesh.vertices.size() << " vertices, "
+		<< sizeof(vertex_data) << " -> " << stride << " bytes per vertex, acmr " << acmr_before << " -> " << acmr_after << std::endl;
+
+	m_vertex_count = (uint32_t)mesh.vertices.size();
+
+	//16 bit indices halve the index fetch bandwidth whenever the mesh is small enough
+	std::vector<uint16_t> short_indices;
+	const void * index_data = mesh.indices.data();
+	m_index_count = (uint32_t)mesh.indices.size();
+	m_index_type = VK_INDEX_TYPE_UINT32;
+	VkDeviceSize index_size = m_index_count * sizeof(uint32_t);
+	if (MeshProcessing::FitsUint16(mesh)) {
+		short_indices.assign(mesh.indices.begin(), mesh.indices.end());
+		index_data = short_indices.data();
+		m_index_type = VK_INDEX_TYPE_UINT16;
+		index_size = m_index_count * sizeof(uint16_t);
+	}
+
+	CreateMeshBuffers(vertices.data(), vertices.size(), index_data, index_size);
+}
 
+void Renderer::CreateMeshBuffers(const void * vertices, VkDeviceSize vertex_size, const void * indices, VkDeviceSize index_size) {
 	VkBufferCreateInfo buffer_create_info{};
 	buffer_create_info.pNext = VK_NULL_HANDLE;
 	buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	buffer_create_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-	buffer_create_info.size = sizeof(g_vb_solid_face_colors_Data);
+	buffer_create_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	buffer_create_info.size = vertex_size;
 	buffer_create_info.queueFamilyIndexCount = 0;
 	buffer_create_info.pQueueFamilyIndices = VK_NULL_HANDLE;
 	buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
@@ -753,117 +1694,196 @@ void Renderer::InitVertexBuffer() {
 
 	ErrorCheck(vkCreateBuffer(m_device, &buffer_create_info, VK_NULL_HANDLE, &m_vertex_buffer));
 
-	VkMemoryRequirements memory_requirements;
-	vkGetBufferMemoryRequirements(m_device, m_vertex_buffer, &memory_requirements);
+	m_vertex_buffer_allocation = m_allocator->AllocateForBuffer(m_vertex_buffer, UPLOADER_MEMORY_REQUIRED, UPLOADER_MEMORY_PREFERRED);
 
-	VkMemoryAllocateInfo memory_allocate_info{};
-	memory_allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	memory_allocate_info.pNext = VK_NULL_HANDLE;
-	memory_allocate_info.memoryTypeIndex = 0;
-	memory_allocate_info.allocationSize = memory_requirements.size;
+	m_uploader->UploadBuffer(m_vertex_buffer, m_vertex_buffer_allocation, 0, vertices, vertex_size);
 
-	memory_types_from_properties(memory_requirements.memoryTypeBits, 0, &memory_allocate_info.memoryTypeIndex, m_gpu_memory_properties);
+	buffer_create_info.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	buffer_create_info.size = index_size;
 
-	ErrorCheck(vkAllocateMemory(m_device, &memory_allocate_info, VK_NULL_HANDLE, &m_vertex_buffer_memory));
+	ErrorCheck(vkCreateBuffer(m_device, &buffer_create_info, VK_NULL_HANDLE, &m_index_buffer));
 
-	uint8_t *pData;
+	m_index_buffer_allocation = m_allocator->AllocateForBuffer(m_index_buffer, UPLOADER_MEMORY_REQUIRED, UPLOADER_MEMORY_PREFERRED);
 
-	ErrorCheck(vkMapMemory(m_device, m_vertex_buffer_memory, 0, memory_requirements.size, 0, (void**)&pData));
+	m_uploader->UploadBuffer(m_index_buffer, m_index_buffer_allocation, 0, indices, index_size);
+}
+
+void Renderer::DeInitVertexBuffer() {
+	vkDestroyBuffer(m_device, m_index_buffer, VK_NULL_HANDLE);
+	m_allocator->Free(m_index_buffer_allocation);
+	vkDestroyBuffer(m_device, m_vertex_buffer, VK_NULL_HANDLE);
+	m_allocator->Free(m_vertex_buffer_allocation);
+}
 
-	memcpy(pData, g_vb_solid_face_colors_Data, sizeof(g_vb_solid_face_colors_Data));
+void Renderer::DrawScene(VkCommandBuffer command_buffer) {
+	const VkDeviceSize device_size_offsets[1] = { 0 };
 
-	vkUnmapMemory(m_device, m_vertex_buffer_memory);
+	//per-draw uniforms are a pointer bump in this frame's slice of the ring plus a dynamic offset
+	float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - m_start_time).count();
+	glm::mat4 model_matrix = glm::rotate(glm::mat4(1.0f), seconds, glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 model_view_projection_matrix = m_pipeline->GetViewProjectionMatrix() * model_matrix * m_dequantization_matrix;
+	uint32_t dynamic_offset = 0;
+	memcpy(m_uniform_ring->Allocate(sizeof(model_view_projection_matrix), dynamic_offset), &model_view_projection_matrix, sizeof(model_view_projection_matrix));
+
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphics_pipeline);
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->GetPipelineLayout(), 0, NUM_DESCRIPTOR_SETS, m_pipeline->GetDescriptorSets(), 1, &dynamic_offset);
+	vkCmdBindVertexBuffers(command_buffer, 0, 1, &m_vertex_buffer, device_size_offsets);
+	vkCmdBindIndexBuffer(command_buffer, m_index_buffer, 0, m_index_type);
+	vkCmdDrawIndexed(command_buffer, m_index_count, 1, 0, 0, 0);
+}
 
-	ErrorCheck(vkBindBufferMemory(m_device, m_vertex_buffer, m_vertex_buffer_memory, 0));
+void Renderer::DrawTextured(VkCommandBuffer command_buffer, const glm::mat4 & model_matrix) {
+	const VkDeviceSize device_size_offsets[1] = { 0 };
 
-	m_vertex_input_binding_description.binding = 0;
-	m_vertex_input_binding_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-	m_vertex_input_binding_description.stride = sizeof(g_vb_solid_face_colors_Data[0]);
+	glm::mat4 model_view_projection_matrix = m_pipeline->GetViewProjectionMatrix() * model_matrix;
+	uint32_t dynamic_offset = 0;
+	memcpy(m_uniform_ring->Allocate(sizeof(model_view_projection_matrix), dynamic_offset), &model_view_projection_matrix, sizeof(model_view_projection_matrix));
 
-	m_vertex_input_attribute_descriptions[0].binding = 0;
-	m_vertex_input_attribute_descriptions[0].location = 0;
-	m_vertex_input_attribute_descriptions[0].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-	m_vertex_input_attribute_descriptions[0].offset = 0;
-	m_vertex_input_attribute_descriptions[1].binding = 0;
-	m_vertex_input_attribute_descriptions[1].location = 1;
-	m_vertex_input_attribute_descriptions[1].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-	m_vertex_input_attribute_descriptions[1].offset = sizeof(glm::vec3);
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_textured_pipeline);
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->GetPipelineLayout(), 0, NUM_DESCRIPTOR_SETS, m_pipeline->GetDescriptorSets(), 1, &dynamic_offset);
+	vkCmdBindVertexBuffers(command_buffer, 0, 1, &m_textured_vertex_buffer, device_size_offsets);
+	vkCmdDraw(command_buffer, m_textured_vertex_count, 1, 0, 0);
+}
 
+void Renderer::DrawPushConstants(VkCommandBuffer command_buffer, const glm::mat4 * model_matrices, const uint32_t * materials, uint32_t count) {
+	if (count == 0) {
+		return;
+	}
 	const VkDeviceSize device_size_offsets[1] = { 0 };
 
-	VkClearValue clear_values[2];
-	clear_values[0].color.float32[0] = 0.2f;
-	clear_values[0].color.float32[1] = 0.2f;
-	clear_values[0].color.float32[2] = 0.2f;
-	clear_values[0].color.float32[3] = 0.2f;
-	clear_values[1].depthStencil.depth = 1.0f;
-	clear_values[1].depthStencil.stencil = 0;
+	//the shaders read nothing from the scene set, so there is nothing to bind per draw but the constants themselves
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_push_constant_pipeline);
+	vkCmdBindVertexBuffers(command_buffer, 0, 1, &m_vertex_buffer, device_size_offsets);
+	vkCmdBindIndexBuffer(command_buffer, m_index_buffer, 0, m_index_type);
+	DrawConstants constants{};
+	for (uint32_t i = 0; i < count; i++) {
+		constants.mvp = m_pipeline->GetViewProjectionMatrix() * model_matrices[i] * m_dequantization_matrix;
+		constants.material = materials != nullptr ? materials[i] : 0;
+		vkCmdPushConstants(command_buffer, m_pipeline->GetPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(constants), &constants);
+		vkCmdDrawIndexed(command_buffer, m_index_count, 1, 0, 0, 0);
+	}
+}
 
-	VkSemaphore image_aquired_semaphore;
-	VkSemaphoreCreateInfo image_aquired_semaphore_create_info{};
-	image_aquired_semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-	image_aquired_semaphore_create_info.pNext = VK_NULL_HANDLE;
-	image_aquired_semaphore_create_info.flags = 0;
+void Renderer::DrawInstanced(VkCommandBuffer command_buffer, const glm::mat4 * model_matrices, uint32_t count) {
+	if (count == 0) {
+		return;
+	}
 
-	ErrorCheck(vkCreateSemaphore(m_device, &image_aquired_semaphore_create_info, VK_NULL_HANDLE, &image_aquired_semaphore));
+	//the copy into the ring is also where the mesh's dequantisation gets folded into every model matrix
+	uint32_t instance_offset = 0;
+	glm::mat4 * instances = (glm::mat4 *)m_instance_ring->Allocate(count * sizeof(glm::mat4), instance_offset);
+	for (uint32_t i = 0; i < count; i++) {
+		instances[i] = model_matrices[i] * m_dequantization_matrix;
+	}
 
-	uint32_t current_image;
+	DrawInstancesFromRing(command_buffer, instance_offset, count);
+}
 
-	ErrorCheck(vkAcquireNextImageKHR(m_device, m_window->GetSwapchain(), UINT64_MAX, image_aquired_semaphore, VK_NULL_HANDLE, &current_image));
+void Renderer::DrawInstanced(VkCommandBuffer command_buffer, const glm::mat4 * model_matrices, const uint32_t * visible, uint32_t visible_count) {
+	if (visible_count == 0) {
+		return;
+	}
 
-	VkImageMemoryBarrier image_memory_barrier{};
-	image_memory_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	image_memory_barrier.pNext = VK_NULL_HANDLE;
-	image_memory_barrier.srcAccessMask = 0;
-	image_memory_barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	image_memory_barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	image_memory_barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	image_memory_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	image_memory_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	image_memory_barrier.image = m_window->GetSwapchainImages()[current_image];
-	image_memory_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	image_memory_barrier.subresourceRange.baseMipLevel = 0;
-	image_memory_barrier.subresourceRange.levelCount = 1;
-	image_memory_barrier.subresourceRange.baseArrayLayer = 0;
-	image_memory_barrier.subresourceRange.layerCount = 1;
+	//the gather is the compaction: the draw only ever sees the visible instances, packed together
+	uint32_t instance_offset = 0;
+	glm::mat4 * instances = (glm::mat4 *)m_instance_ring->Allocate(visible_count * sizeof(glm::mat4), instance_offset);
+	for (uint32_t i = 0; i < visible_count; i++) {
+		instances[i] = model_matrices[visible[i]] * m_dequantization_matrix;
+	}
 
-	VkPipelineStageFlags source_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-	VkPipelineStageFlags destination_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	DrawInstancesFromRing(command_buffer, instance_offset, visible_count);
+}
 
-	vkCmdPipelineBarrier(m_command_buffer[0], source_stages, destination_stages, 0, 0, VK_NULL_HANDLE, 0, VK_NULL_HANDLE, 1, &image_memory_barrier);
+void Renderer::DrawInstanced(VkCommandBuffer command_buffer, const TransformStore & transforms) {
+	uint32_t count = transforms.GetCount();
+	if (count == 0) {
+		return;
+	}
 
-	VkRenderPassBeginInfo render_pass_begin_info{};
-	render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	render_pass_begin_info.pNext = VK_NULL_HANDLE;
-	render_pass_begin_info.renderPass = m_render_pass;
-	render_pass_begin_info.framebuffer = m_frame_buffers[current_image];
-	render_pass_begin_info.renderArea.offset.x = 0;
-	render_pass_begin_info.renderArea.offset.y = 0;
-	render_pass_begin_info.renderArea.extent.width = m_window->GetSurfaceSizeX();
-	render_pass_begin_info.renderArea.extent.height = m_window->GetSurfaceSizeY();
-	render_pass_begin_info.clearValueCount = 2;
-	render_pass_begin_info.pClearValues = clear_values;
+	//the world matrices are built in parallel straight into the ring, with the dequantisation as the shared local transform
+	uint32_t instance_offset = 0;
+	void * instances = m_instance_ring->Allocate(count * sizeof(glm::mat4), instance_offset);
+	transforms.ComputeParallel(m_thread_pool, Simd::GetLevel(), glm::mat4(1.0f), m_dequantization_matrix, instances, sizeof(glm::mat4), nullptr, 0);
 
-	vkCmdBeginRenderPass(m_command_buffer[0], &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+	DrawInstancesFromRing(command_buffer, instance_offset, count);
+}
 
-	vkCmdBindVertexBuffers(m_command_buffer[0], 0, 1, &m_vertex_buffer, device_size_offsets);
+void Renderer::DrawInstancedIndirect(VkCommandBuffer command_buffer, VkBuffer instance_buffer, VkBuffer indirect_buffer, uint32_t max_instance_count) {
+	BindInstancedDraw(command_buffer, instance_buffer, 0);
+#ifdef VK_KHR_draw_indirect_count
+	if (m_fvkCmdDrawIndexedIndirectCountKHR != nullptr) {
+		m_fvkCmdDrawIndexedIndirectCountKHR(command_buffer, indirect_buffer, INDIRECT_DRAW_COMMANDS_OFFSET, indirect_buffer, offsetof(VkDrawIndexedIndirectCommand, instanceCount),
+			max_instance_count, sizeof(VkDrawIndexedIndirectCommand));
+		return;
+	}
+#endif
+	vkCmdDrawIndexedIndirect(command_buffer, indirect_buffer, 0, 1, sizeof(VkDrawIndexedIndirectCommand));
+}
 
-	vkCmdEndRenderPass(m_command_buffer[0]);
+void Renderer::DrawInstancesFromRing(VkCommandBuffer command_buffer, uint32_t instance_offset, uint32_t count) {
+	BindInstancedDraw(command_buffer, m_instance_ring->GetBuffer(), instance_offset);
+	vkCmdDrawIndexed(command_buffer, m_index_count, count, 0, 0, 0);
+}
 
-	EndCommandBuffer(0);
+void Renderer::BindInstancedDraw(VkCommandBuffer command_buffer, VkBuffer instance_buffer, VkDeviceSize instance_offset) {
+	uint32_t dynamic_offset = 0;
+	memcpy(m_uniform_ring->Allocate(sizeof(glm::mat4), dynamic_offset), &m_pipeline->GetViewProjectionMatrix(), sizeof(glm::mat4));
 
-	QueueCommandBuffer(0);
+	VkBuffer buffers[2] = { m_vertex_buffer, instance_buffer };
+	const VkDeviceSize device_size_offsets[2] = { 0, instance_offset };
 
-	vkDestroySemaphore(m_device, image_aquired_semaphore, VK_NULL_HANDLE);
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_instanced_pipeline);
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->GetPipelineLayout(), 0, NUM_DESCRIPTOR_SETS, m_pipeline->GetDescriptorSets(), 1, &dynamic_offset);
+	vkCmdBindVertexBuffers(command_buffer, 0, 2, buffers, device_size_offsets);
+	vkCmdBindIndexBuffer(command_buffer, m_index_buffer, 0, m_index_type);
 }
 
-void Renderer::DeInitVertexBuffer() {
-	vkDestroyBuffer(m_device, m_vertex_buffer, VK_NULL_HANDLE);
-	//free(&m_vertex_buffer);
-	vkFreeMemory(m_device, m_vertex_buffer_memory, VK_NULL_HANDLE);
+void Renderer::InitPipeline() {
+	VkPipelineVertexInputStateCreateInfo pipeline_vertex_input_state_create_info{};
+	pipeline_vertex_input_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	pipeline_vertex_input_state_create_info.pNext = VK_NULL_HANDLE;
+	pipeline_vertex_input_state_create_info.flags = 0;
+	pipeline_vertex_input_state_create_info.vertexBindingDescriptionCount = 1;
+	pipeline_vertex_input_state_create_info.pVertexBindingDescriptions = &m_vertex_input_binding_description;
+	pipeline_vertex_input_state_create_info.vertexAttributeDescriptionCount = m_vertex_attribute_count;
+	pipeline_vertex_input_state_create_info.pVertexAttributeDescriptions = m_vertex_input_attribute_descriptions;
+
+	//the instanced pipeline reads the mesh from binding 0 and a model matrix per instance from binding 1
+	VkVertexInputBindingDescription instanced_binding_descriptions[2] = { m_vertex_input_binding_description, m_instance_input_binding_description };
+	VkVertexInputAttributeDescription instanced_attribute_descriptions[VERTEX_LAYOUT_MAX_ATTRIBUTES + 4];
+	for (uint32_t i = 0; i < m_vertex_attribute_count; i++) {
+		instanced_attribute_descriptions[i] = m_vertex_input_attribute_descriptions[i];
+	}
+	for (uint32_t i = 0; i < 4; i++) {
+		instanced_attribute_descriptions[m_vertex_attribute_count + i] = m_instance_input_attribute_descriptions[i];
+	}
+
+	VkPipelineVertexInputStateCreateInfo instanced_vertex_input_state_create_info = pipeline_vertex_input_state_create_info;
+	instanced_vertex_input_state_create_info.vertexBindingDescriptionCount = 2;
+	instanced_vertex_input_state_create_info.pVertexBindingDescriptions = instanced_binding_descriptions;
+	instanced_vertex_input_state_create_info.vertexAttributeDescriptionCount = m_vertex_attribute_count + 4;
+	instanced_vertex_input_state_create_info.pVertexAttributeDescriptions = instanced_attribute_descriptions;
+
+	//vulkan doesn't say whether the cache was hit, so report against whether a valid one was loaded
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	m_graphics_pipeline = CreateGraphicsPipeline(m_pipeline_shader_stage_create_info, 2, pipeline_vertex_input_state_create_info, m_pipeline->GetPipelineLayout());
+	m_instanced_pipeline = CreateGraphicsPipeline(m_instanced_shader_stage_create_info, 2, instanced_vertex_input_state_create_info, m_pipeline->GetPipelineLayout());
+	m_push_constant_pipeline = CreateGraphicsPipeline(m_push_constant_shader_stage_create_info, 2, pipeline_vertex_input_state_create_info, m_pipeline->GetPipelineLayout());
+
+	VkPipelineVertexInputStateCreateInfo textured_vertex_input_state_create_info = pipeline_vertex_input_state_create_info;
+	textured_vertex_input_state_create_info.pVertexBindingDescriptions = &m_textured_input_binding_description;
+	textured_vertex_input_state_create_info.vertexAttributeDescriptionCount = m_textured_attribute_count;
+	textured_vertex_input_state_create_info.pVertexAttributeDescriptions = m_textured_input_attribute_descriptions;
+	m_textured_pipeline = CreateGraphicsPipeline(m_textured_shader_stage_create_info, 2, textured_vertex_input_state_create_info, m_pipeline->GetPipelineLayout());
+	if (m_bindless) {
+		m_bindless_textured_pipeline = CreateGraphicsPipeline(m_bindless_shader_stage_create_info, 2, textured_vertex_input_state_create_info, m_pipeline->GetBindlessPipelineLayout());
+	}
+	InitCullPipeline();
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "pipelines: " << milliseconds << "ms (" << (m_pipeline_cache_loaded ? "warm" : "cold") << " pipeline cache)" << std::endl;
 }
 
-void Renderer::InitPipeline() {
+VkPipeline Renderer::CreateGraphicsPipeline(const VkPipelineShaderStageCreateInfo * stages, uint32_t stage_count, const VkPipelineVertexInputStateCreateInfo & vertex_input_state, VkPipelineLayout layout) {
 	VkDynamicState dynamic_states[VK_DYNAMIC_STATE_RANGE_SIZE];
 	VkPipelineDynamicStateCreateInfo pipeline_dynamic_stage_create_info{};
 	memset(dynamic_states, 0, sizeof dynamic_states);
@@ -872,15 +1892,6 @@ void Renderer::InitPipeline() {
 	pipeline_dynamic_stage_create_info.pDynamicStates = dynamic_states;
 	pipeline_dynamic_stage_create_info.dynamicStateCount = 0;
 
-	VkPipelineVertexInputStateCreateInfo pipeline_vertex_input_state_create_info{};
-	pipeline_vertex_input_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	pipeline_vertex_input_state_create_info.pNext = VK_NULL_HANDLE;
-	pipeline_vertex_input_state_create_info.flags = 0;
-	pipeline_vertex_input_state_create_info.vertexBindingDescriptionCount = 1;
-	pipeline_vertex_input_state_create_info.pVertexBindingDescriptions = &m_vertex_input_binding_description;
-	pipeline_vertex_input_state_create_info.vertexAttributeDescriptionCount = 2;
-	pipeline_vertex_input_state_create_info.pVertexAttributeDescriptions = m_vertex_input_attribute_descriptions;
-
 	VkPipelineInputAssemblyStateCreateInfo pipeline_input_assembly_state_create_info{};
 	pipeline_input_assembly_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
 	pipeline_input_assembly_state_create_info.pNext = VK_NULL_HANDLE;
@@ -972,11 +1983,11 @@ void Renderer::InitPipeline() {
 	VkGraphicsPipelineCreateInfo graphics_pipeline_create_info{};
 	graphics_pipeline_create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
 	graphics_pipeline_create_info.pNext = VK_NULL_HANDLE;
-	graphics_pipeline_create_info.layout = m_pipeline->GetPipelineLayout();
+	graphics_pipeline_create_info.layout = layout;
 	graphics_pipeline_create_info.basePipelineHandle = VK_NULL_HANDLE;
 	graphics_pipeline_create_info.basePipelineIndex = 0;
 	graphics_pipeline_create_info.flags = 0;
-	graphics_pipeline_create_info.pVertexInputState = &pipeline_vertex_input_state_create_info;
+	graphics_pipeline_create_info.pVertexInputState = &vertex_input_state;
 	graphics_pipeline_create_info.pInputAssemblyState = &pipeline_input_assembly_state_create_info;
 	graphics_pipeline_create_info.pRasterizationState = &pipeline_rasterization_state_create_info;
 	graphics_pipeline_create_info.pColorBlendState = &pipeline_color_blend_state_create_info;
@@ -984,15 +1995,73 @@ void Renderer::InitPipeline() {
 	graphics_pipeline_create_info.pMultisampleState = &pipeline_multisample_state_create_info;
 	graphics_pipeline_create_info.pDynamicState = &pipeline_dynamic_stage_create_info;
 	graphics_pipeline_create_info.pDepthStencilState = &pipeline_depth_stencil_state_create_info;
-	graphics_pipeline_create_info.pStages = m_pipeline_shader_stage_create_info;
-	graphics_pipeline_create_info.stageCount = 2;
+	graphics_pipeline_create_info.pStages = stages;
+	graphics_pipeline_create_info.stageCount = stage_count;
 	graphics_pipeline_create_info.renderPass = m_render_pass;
 	graphics_pipeline_create_info.subpass = 0;
 
-	ErrorCheck(vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &graphics_pipeline_create_info, VK_NULL_HANDLE, &m_graphics_pipeline));
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	ErrorCheck(vkCreateGraphicsPipelines(m_device, m_pipeline_cache, 1, &graphics_pipeline_create_info, VK_NULL_HANDLE, &pipeline));
+	return pipeline;
+}
+
+void Renderer::InitCullPipeline() {
+	//objects in, instance matrices and indirect commands out
+	VkDescriptorSetLayoutBinding descriptor_set_layout_bindings[GPU_CULLER_BINDING_COUNT];
+	for (uint32_t i = 0; i < GPU_CULLER_BINDING_COUNT; i++) {
+		descriptor_set_layout_bindings[i] = {};
+		descriptor_set_layout_bindings[i].binding = i;
+		descriptor_set_layout_bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptor_set_layout_bindings[i].descriptorCount = 1;
+		descriptor_set_layout_bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info{};
+	descriptor_set_layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	descriptor_set_layout_create_info.bindingCount = GPU_CULLER_BINDING_COUNT;
+	descriptor_set_layout_create_info.pBindings = descriptor_set_layout_bindings;
+
+	ErrorCheck(vkCreateDescriptorSetLayout(m_device, &descriptor_set_layout_create_info, VK_NULL_HANDLE, &m_cull_descriptor_set_layout));
+
+	//the planes change every frame and are small enough to go in push constants
+	VkPushConstantRange push_constant_range{};
+	push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	push_constant_range.offset = 0;
+	push_constant_range.size = sizeof(GpuCullConstants);
+
+	VkPipelineLayoutCreateInfo pipeline_layout_create_info{};
+	pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipeline_layout_create_info.setLayoutCount = 1;
+	pipeline_layout_create_info.pSetLayouts = &m_cull_descriptor_set_layout;
+	pipeline_layout_create_info.pushConstantRangeCount = 1;
+	pipeline_layout_create_info.pPushConstantRanges = &push_constant_range;
+
+	ErrorCheck(vkCreatePipelineLayout(m_device, &pipeline_layout_create_info, VK_NULL_HANDLE, &m_cull_pipeline_layout));
+
+	VkComputePipelineCreateInfo compute_pipeline_create_info{};
+	compute_pipeline_create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	compute_pipeline_create_info.stage = m_cull_shader_stage_create_info;
+	compute_pipeline_create_info.layout = m_cull_pipeline_layout;
+	compute_pipeline_create_info.basePipelineHandle = VK_NULL_HANDLE;
+	compute_pipeline_create_info.basePipelineIndex = -1;
+
+	ErrorCheck(vkCreateComputePipelines(m_device, m_pipeline_cache, 1, &compute_pipeline_create_info, VK_NULL_HANDLE, &m_cull_pipeline));
+}
+
+void Renderer::DeInitCullPipeline() {
+	vkDestroyPipeline(m_device, m_cull_pipeline, VK_NULL_HANDLE);
+	vkDestroyPipelineLayout(m_device, m_cull_pipeline_layout, VK_NULL_HANDLE);
+	vkDestroyDescriptorSetLayout(m_device, m_cull_descriptor_set_layout, VK_NULL_HANDLE);
 }
 
 void Renderer::DeInitPipeline() {
+	DeInitCullPipeline();
+	if (m_bindless_textured_pipeline != VK_NULL_HANDLE) {
+		vkDestroyPipeline(m_device, m_bindless_textured_pipeline, VK_NULL_HANDLE);
+	}
+	vkDestroyPipeline(m_device, m_textured_pipeline, VK_NULL_HANDLE);
+	vkDestroyPipeline(m_device, m_push_constant_pipeline, VK_NULL_HANDLE);
+	vkDestroyPipeline(m_device, m_instanced_pipeline, VK_NULL_HANDLE);
 	vkDestroyPipeline(m_device, m_graphics_pipeline, VK_NULL_HANDLE);
 }
 
@@ -1058,8 +2127,19 @@ void Renderer::SetupDebug() {
 	std::vector<VkLayerProperties> availableLayers(layerCount);
 	vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
 
-	//m_instance_layer_list.push_back("VK_LAYER_LUNARG_standard_validation");
-	m_instance_layer_list.push_back("VK_LAYER_NV_optimus");
+	//asking for a layer that isn't installed fails instance creation, so only take what is there
+	const char * wanted_layers[] = {
+		//"VK_LAYER_LUNARG_standard_validation",
+		"VK_LAYER_NV_optimus",
+	};
+	for (uint32_t i = 0; i < sizeof(wanted_layers) / sizeof(wanted_layers[0]); i++) {
+		for (uint32_t j = 0; j < availableLayers.size(); j++) {
+			if (strcmp(wanted_layers[i], availableLayers[j].layerName) == 0) {
+				m_instance_layer_list.push_back(wanted_layers[i]);
+				break;
+			}
+		}
+	}
 	m_instance_extention_list.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
 	//m_instance_layer_list.push_back("VK_LAYER_LUNARG_api_dump");
 	//m_instance_layer_list.push_back("VK_LAYER_LUNARG_core_validation");
@@ -1098,8 +2178,8 @@ void Renderer::DeInitDebug() {
 
 #else
 
-void Renderer::_InitDebug() {}
-void Renderer::_SetupDebug() {}
-void Renderer::_DeInitDebug() {}
+void Renderer::InitDebug() {}
+void Renderer::SetupDebug() {}
+void Renderer::DeInitDebug() {}
 
 #endif // BUILD_OPTIONS_DEBUG
\ No newline at end of file
@@ -1,24 +1,109 @@
 #pragma once
 
+#include "BUILD_OPTIONS.h"
 #include "Platform.h"
+#include "Allocator.h"
+#include "VertexFormat.h"
+#include <chrono>
+#include <functional>
+#include <string>
 #include <vector>
 
+//saved at shutdown, reloaded at startup if it was written by the same driver and device
+#define PIPELINE_CACHE_FILE "pipeline_cache.bin"
+//per-instance model matrices for every DrawInstanced call in flight
+#define INSTANCE_RING_DEFAULT_SIZE (16 * 1024 * 1024)
+//where the per-instance commands start in a DrawInstancedIndirect buffer, after the 20 byte command covering every instance
+#define INDIRECT_DRAW_COMMANDS_OFFSET 32
+//converted by MeshConverter; drawn instead of the built-in cube when it is there
+#define SCENE_MESH_FILE "scene.mesh"
+//clamped to what the device allows; without the samplerAnisotropy feature the sampler doesn't filter anisotropically at all
+#define TEXTURE_MAX_ANISOTROPY 16.0f
+//shown on the textured cube when it is there, otherwise a checkerboard of DEFAULT_TEXTURE_SIZE
+#define SCENE_TEXTURE_FILE "scene.ktx2"
+#define DEFAULT_TEXTURE_SIZE 256
+
 class Window;
+class RenderTarget;
+class HeadlessTarget;
 class Pipeline;
+class Allocator;
+class RingBuffer;
+class Uploader;
+class DescriptorAllocator;
+class ShaderCache;
+class ThreadPool;
+class ShaderCompiler;
+class CommandRecorder;
+class GpuProfiler;
+class TransformStore;
+class MipGenerator;
+class Texture;
+
+//transfer and compute fall back to the graphics queue when the device has no better family for them
+enum QueueType {
+	QUEUE_GRAPHICS = 0,
+	QUEUE_TRANSFER = 1,
+	QUEUE_COMPUTE = 2,
+	QUEUE_TYPE_COUNT = 3
+};
+
+//how long one step of the constructor or render target creation took
+struct StartupPhase {
+	const char * name;
+	double milliseconds;
+};
+
+//everything the cpu needs to record one frame while the gpu is still busy with the others
+struct FrameData {
+	VkCommandBuffer command_buffer;
+	VkSemaphore image_acquired_semaphore;
+	VkSemaphore render_finished_semaphore;
+	VkFence fence;
+};
 
 class Renderer {
 public:
-	Renderer();
+	//a headless renderer doesn't load any surface or swapchain extensions, so it can only render into a HeadlessTarget
+	Renderer(uint32_t frames_in_flight = BUILD_OPTIONS_FRAMES_IN_FLIGHT, bool headless = false);
 	~Renderer();
 
 	Window * CreateVulkanWindow(uint32_t size_x, uint32_t size_y, std::string name);
+	HeadlessTarget * CreateHeadlessTarget(uint32_t size_x, uint32_t size_y, uint32_t frame_limit = 0);
 	bool Run();
 
-	void BeginCommandBuffer(uint32_t buffer_number);
-	void EndCommandBuffer(uint32_t buffer_number);
-	void QueueCommandBuffer(uint32_t buffer_number);
-	void QueueCommandBuffer(uint32_t buffer_number, VkPipelineStageFlags flags[]);
-	void WaitCommandBuffer();
+	//with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS the frame's draws must all come through RecordParallel.
+	//before_render_pass records into the frame's command buffer ahead of the render pass, for compute work the draws read
+	VkCommandBuffer BeginFrame(VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE, const std::function<void(VkCommandBuffer)> & before_render_pass = nullptr);
+	//splits draw_count draws into jobs on the worker pool; record is called with each job's secondary
+	//command buffer (viewport and scissor already set) and its first draw and count. call from the main thread only
+	void RecordParallel(uint32_t draw_count, const std::function<void(VkCommandBuffer, uint32_t, uint32_t)> & record, uint32_t max_jobs = UINT32_MAX);
+	void EndFrame();
+	void WaitIdle();
+
+	//draws count copies of the scene mesh in a single call, one per model matrix. the matrices are
+	//copied into this frame's slice of the instance ring and read through a per-instance vertex binding
+	void DrawInstanced(VkCommandBuffer command_buffer, const glm::mat4 * model_matrices, uint32_t count);
+	//one copy per object in transforms, their world matrices computed on the worker pool. call from the main thread only
+	void DrawInstanced(VkCommandBuffer command_buffer, const TransformStore & transforms);
+	//only the model matrices that visible indexes, as a culling pass leaves them
+	void DrawInstanced(VkCommandBuffer command_buffer, const glm::mat4 * model_matrices, const uint32_t * visible, uint32_t visible_count);
+	//instances whose model matrices and count the gpu wrote. indirect_buffer holds a VkDrawIndexedIndirectCommand for all of
+	//them at offset 0, and from INDIRECT_DRAW_COMMANDS_OFFSET one single-instance command each, with the first command's
+	//instanceCount as the number of them. the per-instance commands are only read when the draw count extension is enabled
+	void DrawInstancedIndirect(VkCommandBuffer command_buffer, VkBuffer instance_buffer, VkBuffer indirect_buffer, uint32_t max_instance_count);
+	//count copies of the scene mesh, one draw each, with the mvp and material index of each in push constants instead of
+	//the uniform ring. materials may be null for material 0
+	void DrawPushConstants(VkCommandBuffer command_buffer, const glm::mat4 * model_matrices, const uint32_t * materials, uint32_t count);
+	//a cube with uvs, sampling whatever texture was last set
+	void DrawTextured(VkCommandBuffer command_buffer, const glm::mat4 & model_matrix);
+	//null goes back to the default checkerboard. each texture gets a cached set of its own, so it can change between draws
+	void SetTexture(const Texture * texture);
+	//count cubes, each sampling its own texture, null for the default. bindless, the pipeline and set are bound once and
+	//each draw only pushes its mvp and slots; otherwise, or with bindless false, every draw binds its texture's cached set
+	void DrawTexturedBatch(VkCommandBuffer command_buffer, const glm::mat4 * model_matrices, const Texture * const * textures, uint32_t count, bool bindless = true);
+
+	void Submit(QueueType type, uint32_t submit_count, const VkSubmitInfo * submits, VkFence fence);
 
 	//getters
 	const VkInstance GetVulkanInstance() const;
@@ -28,10 +113,59 @@ public:
 	const VkPhysicalDeviceProperties & GetVulkanPhysicalDeviceProperties() const;
 	VkPhysicalDeviceMemoryProperties & GetPhysicalDeviceMemoryProperties() ;
 	const uint32_t GetVulkanGraphicsQueueFamilyIndex() const;
+	const VkQueue GetQueue(QueueType type) const;
+	const uint32_t GetQueueFamilyIndex(QueueType type) const;
+	const uint32_t GetFramesInFlight() const;
+	const uint32_t GetFrameIndex() const;
+	Allocator * GetAllocator();
+	RingBuffer * GetUniformRing();
+	RingBuffer * GetInstanceRing();
+	Uploader * GetUploader();
+	DescriptorAllocator * GetDescriptorAllocator();
+	ShaderCache * GetShaderCache();
+	ThreadPool * GetThreadPool();
+	ShaderCompiler * GetShaderCompiler();
+	Pipeline * GetPipeline();
+	RenderTarget * GetRenderTarget();
+	GpuProfiler * GetGpuProfiler();
+	MipGenerator * GetMipGenerator();
+	//trilinear, repeating and as anisotropic as the device allows
+	VkSampler GetSampler() const;
+	//in the order they ran: the constructor's phases, then the render target's
+	const std::vector<StartupPhase> & GetStartupPhases() const;
+	bool IsHeadless() const;
+	VkPipeline GetGraphicsPipeline() const;
+	VkPipeline GetInstancedPipeline() const;
+	VkPipeline GetTexturedPipeline() const;
+	//frustum culls object bounds into instance matrices and indirect commands, see GpuCuller
+	VkPipeline GetCullPipeline() const;
+	VkPipelineLayout GetCullPipelineLayout() const;
+	VkDescriptorSetLayout GetCullDescriptorSetLayout() const;
+	//whether DrawInstancedIndirect has the gpu pick the draw count, rather than drawing one command with that many instances
+	bool HasDrawIndirectCount() const;
+	//whether VK_KHR_descriptor_update_template was enabled, for the DescriptorAllocator to write sets with
+	bool HasDescriptorUpdateTemplates() const;
+	//whether descriptor indexing was enabled for the Pipeline's bindless set, see BUILD_OPTIONS_BINDLESS
+	bool HasBindless() const;
+	VkBuffer GetVertexBuffer() const;
+	uint32_t GetVertexCount() const;
+	//the scene mesh's positions are quantised, anything drawing it puts this on the right of its model matrix
+	const glm::mat4 & GetDequantizationMatrix() const;
+	VkBuffer GetIndexBuffer() const;
+	uint32_t GetIndexCount() const;
+	VkIndexType GetIndexType() const;
+	VkPipelineCache GetPipelineCache() const;
+	VkFence GetFrameFence(uint32_t frame_index) const;
 
 private:
 	void SetupLayersAndExtentions();
 
+	//everything that depends on the render target's format and images
+	void InitRenderTarget();
+
+	//records the time since the previous phase ended
+	void EndStartupPhase(const char * name);
+
 	void InitInstance();
 	void DeInitInstance();
 
@@ -41,20 +175,41 @@ private:
 	void InitCommandBuffer();
 	void DeInitCommandBuffer();
 
+	void InitPipelineCache();
+	void DeInitPipelineCache();
+
 	void InitRenderPass();
 	void DeInitRenderPass();
 
 	void InitShaders();
 	void DeInitShaders();
 
+	//the sampler, the default texture and the textured cube; none of them depend on the render target
+	void InitTextures();
+	void DeInitTextures();
+
 	void InitFrameBuffer();
 	void DeInitFrameBuffer();
 
 	void InitVertexBuffer();
 	void DeInitVertexBuffer();
+	bool InitSceneMesh(const std::string & path);
+	void InitBuiltInMesh();
+	void CreateMeshBuffers(const void * vertices, VkDeviceSize vertex_size, const void * indices, VkDeviceSize index_size);
+
+	void DrawScene(VkCommandBuffer command_buffer);
+	//binds the instanced pipeline and draws count instances whose model matrices start at instance_offset in the instance ring
+	void DrawInstancesFromRing(VkCommandBuffer command_buffer, uint32_t instance_offset, uint32_t count);
+	//everything the instanced draws share: the view projection, the instanced pipeline and the mesh and instance buffers
+	void BindInstancedDraw(VkCommandBuffer command_buffer, VkBuffer instance_buffer, VkDeviceSize instance_offset);
+	void SetViewportAndScissor(VkCommandBuffer command_buffer);
 
 	void InitPipeline();
 	void DeInitPipeline();
+	//everything but the shaders, vertex layout and pipeline layout is shared by the scene's pipelines
+	VkPipeline CreateGraphicsPipeline(const VkPipelineShaderStageCreateInfo * stages, uint32_t stage_count, const VkPipelineVertexInputStateCreateInfo & vertex_input_state, VkPipelineLayout layout);
+	void InitCullPipeline();
+	void DeInitCullPipeline();
 
 	void SetupDebug();
 	void InitDebug();
@@ -63,29 +218,97 @@ private:
 	VkInstance m_instance;
 	VkPhysicalDevice m_gpu;
 	VkDevice m_device;
-	VkDeviceMemory m_vertex_buffer_memory;
 	VkQueue m_queue;
 	VkPhysicalDeviceProperties	m_gpu_properties;
 	VkPhysicalDeviceMemoryProperties m_gpu_memory_properties;
 	uint32_t m_graphics_family_index;
+	VkQueue m_queues[QUEUE_TYPE_COUNT];
+	uint32_t m_queue_family_indices[QUEUE_TYPE_COUNT];
 	std::vector<const char *> m_instance_layer_list;
 	std::vector<const char *> m_instance_extention_list;
 	std::vector<const char *> m_device_layer_list;
 	std::vector<const char *> m_device_extention_list;
+#ifdef VK_KHR_draw_indirect_count
+	//null unless the extension and the multi draw features it is used with are all there
+	PFN_vkCmdDrawIndexedIndirectCountKHR m_fvkCmdDrawIndexedIndirectCountKHR;
+#endif
+	bool m_descriptor_update_templates;
+	//VK_KHR_get_physical_device_properties2 is enabled on the instance
+	bool m_physical_device_properties2;
+	bool m_bindless;
 	VkDebugReportCallbackEXT m_debug_report;
 	VkDebugReportCallbackCreateInfoEXT m_debug_report_callback_create_info;
-	Window * m_window;
+	RenderTarget * m_render_target;
+	bool m_headless;
 	Pipeline * m_pipeline;
-	VkFence m_fence;
-	VkSemaphore m_semaphore;
-	VkCommandBuffer m_command_buffer[2];
+	Allocator * m_allocator;
+	RingBuffer * m_uniform_ring;
+	RingBuffer * m_instance_ring;
+	Uploader * m_uploader;
+	DescriptorAllocator * m_descriptor_allocator;
+	ShaderCache * m_shader_cache;
+	ThreadPool * m_thread_pool;
+	ShaderCompiler * m_shader_compiler;
+	CommandRecorder * m_command_recorder;
+	GpuProfiler * m_gpu_profiler;
+	MipGenerator * m_mip_generator;
+	uint32_t m_render_pass_scope;
+	VkPipelineCache m_pipeline_cache;
+	bool m_pipeline_cache_loaded;
+	std::vector<FrameData> m_frames;
+	uint32_t m_frames_in_flight;
+	uint32_t m_frame_index;
 	VkCommandPool m_command_pool;
 	uint32_t m_current_buffer;
+	bool m_image_acquired;
+	std::chrono::steady_clock::time_point m_start_time;
+	std::chrono::steady_clock::time_point m_phase_start;
+	std::vector<StartupPhase> m_startup_phases;
+	std::chrono::steady_clock::time_point m_fps_timer;
+	uint32_t m_fps_frame_count;
 	VkRenderPass m_render_pass;
 	VkPipelineShaderStageCreateInfo m_pipeline_shader_stage_create_info[2];
+	//instanced vertex shader, sharing the fragment module of m_pipeline_shader_stage_create_info
+	VkPipelineShaderStageCreateInfo m_instanced_shader_stage_create_info[2];
+	VkPipelineShaderStageCreateInfo m_cull_shader_stage_create_info;
+	VkPipelineShaderStageCreateInfo m_textured_shader_stage_create_info[2];
+	VkPipelineShaderStageCreateInfo m_push_constant_shader_stage_create_info[2];
+	//only compiled when bindless
+	VkPipelineShaderStageCreateInfo m_bindless_shader_stage_create_info[2];
 	VkFramebuffer * m_frame_buffers;
 	VkBuffer m_vertex_buffer;
-	VkVertexInputAttributeDescription m_vertex_input_attribute_descriptions[2];
+	Allocation m_vertex_buffer_allocation;
+	uint32_t m_vertex_count;
+	VkBuffer m_index_buffer;
+	Allocation m_index_buffer_allocation;
+	uint32_t m_index_count;
+	VkIndexType m_index_type;
+	VertexLayout m_vertex_layout;
+	VertexQuantization m_vertex_quantization;
+	glm::mat4 m_dequantization_matrix;
+	VkVertexInputAttributeDescription m_vertex_input_attribute_descriptions[VERTEX_LAYOUT_MAX_ATTRIBUTES];
+	uint32_t m_vertex_attribute_count;
 	VkVertexInputBindingDescription m_vertex_input_binding_description;
+	//a mat4 attribute takes one location per column
+	VkVertexInputAttributeDescription m_instance_input_attribute_descriptions[4];
+	VkVertexInputBindingDescription m_instance_input_binding_description;
 	VkPipeline m_graphics_pipeline;
+	VkPipeline m_instanced_pipeline;
+	bool m_sampler_anisotropy;
+	VkSampler m_sampler;
+	Texture * m_default_texture;
+	VkBuffer m_textured_vertex_buffer;
+	Allocation m_textured_vertex_buffer_allocation;
+	uint32_t m_textured_vertex_count;
+	VkVertexInputAttributeDescription m_textured_input_attribute_descriptions[VERTEX_LAYOUT_MAX_ATTRIBUTES];
+	uint32_t m_textured_attribute_count;
+	VkVertexInputBindingDescription m_textured_input_binding_description;
+	VkPipeline m_textured_pipeline;
+	VkPipeline m_bindless_textured_pipeline;
+	VkPipeline m_push_constant_pipeline;
+	//m_sampler's slot in the bindless set
+	uint32_t m_bindless_sampler;
+	VkDescriptorSetLayout m_cull_descriptor_set_layout;
+	VkPipelineLayout m_cull_pipeline_layout;
+	VkPipeline m_cull_pipeline;
 };
\ No newline at end of file
@@ -0,0 +1,82 @@
+#include "RingBuffer.h"
+#include "Renderer.h"
+#include "Shared.h"
+
+RingBuffer::RingBuffer(Renderer * renderer, VkDeviceSize size, VkBufferUsageFlags usage, VkDeviceSize alignment) :
+	m_renderer(renderer),
+	m_buffer(VK_NULL_HANDLE),
+	m_size(size),
+	m_alignment(alignment > 0 ? alignment : 1),
+	m_head(0),
+	m_tail(0),
+	m_frame_index(0)
+{
+	m_frame_ends.resize(m_renderer->GetFramesInFlight(), 0);
+
+	VkBufferCreateInfo buffer_create_info{};
+	buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_create_info.pNext = VK_NULL_HANDLE;
+	buffer_create_info.usage = usage;
+	buffer_create_info.size = m_size;
+	buffer_create_info.queueFamilyIndexCount = 0;
+	buffer_create_info.pQueueFamilyIndices = VK_NULL_HANDLE;
+	buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	buffer_create_info.flags = 0;
+	ErrorCheck(vkCreateBuffer(m_renderer->GetVulkanDevice(), &buffer_create_info, VK_NULL_HANDLE, &m_buffer));
+
+	//coherent so writes never need flushing; device local too when the driver offers it
+	m_allocation = m_renderer->GetAllocator()->AllocateForBuffer(m_buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+RingBuffer::~RingBuffer() {
+	vkDestroyBuffer(m_renderer->GetVulkanDevice(), m_buffer, VK_NULL_HANDLE);
+	m_renderer->GetAllocator()->Free(m_allocation);
+}
+
+void RingBuffer::BeginFrame(uint32_t frame_index) {
+	m_frame_index = frame_index;
+	RetireFrame(frame_index);
+}
+
+void RingBuffer::EndFrame() {
+	m_frame_ends[m_frame_index] = m_head;
+}
+
+void * RingBuffer::Allocate(VkDeviceSize size, uint32_t & offset) {
+	uint64_t start = (m_head + m_alignment - 1) / m_alignment * m_alignment;
+	//a range can't straddle the end of the buffer, so skip to the start of the next lap
+	if (start % m_size + size > m_size) {
+		start = (start / m_size + 1) * m_size;
+	}
+
+	//out of room: wait on the oldest frames still in flight until enough of them have retired
+	uint32_t frames_in_flight = m_renderer->GetFramesInFlight();
+	for (uint32_t i = 1; i < frames_in_flight && start + size - m_tail > m_size; i++) {
+		uint32_t oldest = (m_frame_index + i) % frames_in_flight;
+		VkFence fence = m_renderer->GetFrameFence(oldest);
+		ErrorCheck(vkWaitForFences(m_renderer->GetVulkanDevice(), 1, &fence, VK_TRUE, UINT64_MAX));
+		RetireFrame(oldest);
+	}
+	if (start + size - m_tail > m_size) {
+		assert(0 && "RingBuffer: a single frame needs more than the whole ring");
+		return nullptr;
+	}
+
+	m_head = start + size;
+	offset = (uint32_t)(start % m_size);
+	return (uint8_t *)m_allocation.mapped + offset;
+}
+
+VkBuffer RingBuffer::GetBuffer() const {
+	return m_buffer;
+}
+
+VkDeviceSize RingBuffer::GetSize() const {
+	return m_size;
+}
+
+void RingBuffer::RetireFrame(uint32_t frame_index) {
+	if (m_frame_ends[frame_index] > m_tail) {
+		m_tail = m_frame_ends[frame_index];
+	}
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Platform.h"
+#include "Allocator.h"
+#include <vector>
+
+#define RING_BUFFER_DEFAULT_SIZE (4 * 1024 * 1024)
+
+class Renderer;
+
+//persistently mapped buffer that hands out transient per-frame ranges with a pointer bump.
+//each frame remembers where its data ended, and that range only becomes reusable once the
+//frame's fence has been waited on, so the cpu never overwrites anything the gpu is still reading
+class RingBuffer {
+public:
+	RingBuffer(Renderer * renderer, VkDeviceSize size, VkBufferUsageFlags usage, VkDeviceSize alignment);
+	~RingBuffer();
+
+	//call once the frame's fence has been waited on, before anything is allocated for it
+	void BeginFrame(uint32_t frame_index);
+	void EndFrame();
+
+	//returns where to write and the offset to bind (or pass as a dynamic offset)
+	void * Allocate(VkDeviceSize size, uint32_t & offset);
+
+	VkBuffer GetBuffer() const;
+	VkDeviceSize GetSize() const;
+private:
+	void RetireFrame(uint32_t frame_index);
+
+	Renderer * m_renderer;
+	VkBuffer m_buffer;
+	Allocation m_allocation;
+	VkDeviceSize m_size;
+	VkDeviceSize m_alignment;
+
+	//head and tail count bytes ever allocated/retired, so they never wrap themselves and
+	//head - tail is always the amount of data in flight
+	uint64_t m_head;
+	uint64_t m_tail;
+	std::vector<uint64_t> m_frame_ends;
+	uint32_t m_frame_index;
+};
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include "ShaderCache.h"
+#include "MappedFile.h"
+#include "Shared.h"
+#include <stdio.h>
+#include <string.h>
+
+ShaderCache::ShaderCache(const std::string & directory) :
+	m_directory(directory),
+	m_glslang_acquired(false),
+	m_hits(0),
+	m_misses(0)
+{
+	create_directory(m_directory);
+}
+
+ShaderCache::~ShaderCache() {
+	if (m_glslang_acquired) {
+		release_glslang();
+	}
+}
+
+bool ShaderCache::GetSPIRV(VkShaderStageFlagBits stage, const char * source, const std::vector<std::string> & defines, std::vector<unsigned int> & spirv, std::string * log) {
+	uint64_t key = ComputeKey(stage, source, defines);
+	if (Load(key, spirv)) {
+		m_hits++;
+		return true;
+	}
+
+	m_misses++;
+	std::call_once(m_glslang_once, [this]() {
+		acquire_glslang();
+		m_glslang_acquired = true;
+	});
+	if (!GLSLtoSPV(stage, source, spirv, defines, log)) {
+		return false;
+	}
+	Store(key, spirv);
+	return true;
+}
+
+void ShaderCache::Evict(VkShaderStageFlagBits stage, const char * source, const std::vector<std::string> & defines) {
+	remove(GetPath(ComputeKey(stage, source, defines)).c_str());
+}
+
+uint32_t ShaderCache::GetHitCount() const {
+	return m_hits;
+}
+
+uint32_t ShaderCache::GetMissCount() const {
+	return m_misses;
+}
+
+uint64_t ShaderCache::ComputeKey(VkShaderStageFlagBits stage, const char * source, const std::vector<std::string> & defines) const {
+	uint32_t version = SHADER_CACHE_VERSION;
+	uint64_t hash = fnv1a_64(&version, sizeof(version));
+	const char * glsl_version = glslang::GetGlslVersionString();
+	const char * essl_version = glslang::GetEsslVersionString();
+	hash = fnv1a_64(glsl_version, strlen(glsl_version) + 1, hash);
+	hash = fnv1a_64(essl_version, strlen(essl_version) + 1, hash);
+	hash = fnv1a_64(&stage, sizeof(stage), hash);
+	//the terminators keep ("ab", "c") and ("a", "bc") apart
+	for (uint32_t i = 0; i < defines.size(); i++) {
+		hash = fnv1a_64(defines[i].c_str(), defines[i].size() + 1, hash);
+	}
+	return fnv1a_64(source, strlen(source) + 1, hash);
+}
+
+std::string ShaderCache::GetPath(uint64_t key) const {
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.spv", (unsigned long long)key);
+	return m_directory + "/" + name;
+}
+
+bool ShaderCache::Load(uint64_t key, std::vector<unsigned int> & spirv) {
+	MappedFile file;
+	if (!file.Open(GetPath(key))) {
+		return false;
+	}
+
+	//anything truncated, stale or corrupt is treated as a miss and overwritten
+	if (file.GetSize() < sizeof(ShaderCacheHeader)) {
+		return false;
+	}
+	ShaderCacheHeader header;
+	memcpy(&header, file.GetData(), sizeof(header));
+	if (header.magic != SHADER_CACHE_MAGIC || header.version != SHADER_CACHE_VERSION || header.key != key) {
+		return false;
+	}
+	size_t spirv_size = (size_t)header.spirv_word_count * sizeof(unsigned int);
+	if (header.spirv_word_count == 0 || file.GetSize() != sizeof(header) + spirv_size) {
+		return false;
+	}
+	const uint8_t * code = file.GetData() + sizeof(header);
+	uint32_t first_word;
+	memcpy(&first_word, code, sizeof(first_word));
+	if (first_word != SPIRV_MAGIC || fnv1a_64(code, spirv_size) != header.checksum) {
+		return false;
+	}
+
+	spirv.resize(header.spirv_word_count);
+	memcpy(spirv.data(), code, spirv_size);
+	return true;
+}
+
+void ShaderCache::Store(uint64_t key, const std::vector<unsigned int> & spirv) {
+	size_t spirv_size = spirv.size() * sizeof(unsigned int);
+	ShaderCacheHeader header{};
+	header.magic = SHADER_CACHE_MAGIC;
+	header.version = SHADER_CACHE_VERSION;
+	header.key = key;
+	header.checksum = fnv1a_64(spirv.data(), spirv_size);
+	header.spirv_word_count = (uint32_t)spirv.size();
+
+	std::vector<uint8_t> data(sizeof(header) + spirv_size);
+	memcpy(data.data(), &header, sizeof(header));
+	memcpy(data.data() + sizeof(header), spirv.data(), spirv_size);
+	//a failed write only costs a recompile next time
+	write_file_atomic(GetPath(key), data.data(), data.size());
+}
\ No newline at end of file
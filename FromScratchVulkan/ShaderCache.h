@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Platform.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define SHADER_CACHE_DEFAULT_DIRECTORY "shader_cache"
+#define SHADER_CACHE_MAGIC 0x43565348
+//bump whenever GLSLtoSPV or init_resources change the generated code
+#define SHADER_CACHE_VERSION 1
+#define SPIRV_MAGIC 0x07230203
+
+struct ShaderCacheHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint64_t checksum;
+	uint32_t spirv_word_count;
+	uint32_t reserved;
+};
+
+//content addressed cache of compiled SPIR-V. entries are keyed by a hash of the source, stage,
+//defines and compiler version, so editing a shader simply misses instead of needing invalidation.
+//glslang is only brought up the first time something actually has to be compiled.
+//GetSPIRV may be called from several threads at once
+class ShaderCache {
+public:
+	ShaderCache(const std::string & directory = SHADER_CACHE_DEFAULT_DIRECTORY);
+	~ShaderCache();
+
+	bool GetSPIRV(VkShaderStageFlagBits stage, const char * source, const std::vector<std::string> & defines, std::vector<unsigned int> & spirv, std::string * log = nullptr);
+	//deletes the entry GetSPIRV would load for these, if there is one
+	void Evict(VkShaderStageFlagBits stage, const char * source, const std::vector<std::string> & defines);
+
+	uint32_t GetHitCount() const;
+	uint32_t GetMissCount() const;
+private:
+	uint64_t ComputeKey(VkShaderStageFlagBits stage, const char * source, const std::vector<std::string> & defines) const;
+	std::string GetPath(uint64_t key) const;
+	bool Load(uint64_t key, std::vector<unsigned int> & spirv);
+	void Store(uint64_t key, const std::vector<unsigned int> & spirv);
+
+	std::string m_directory;
+	std::once_flag m_glslang_once;
+	bool m_glslang_acquired;
+	std::atomic<uint32_t> m_hits;
+	std::atomic<uint32_t> m_misses;
+};
\ No newline at end of file
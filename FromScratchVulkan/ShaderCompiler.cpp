@@ -0,0 +1,51 @@
+#include "ShaderCompiler.h"
+#include "ThreadPool.h"
+#include "ShaderCache.h"
+#include "Shared.h"
+#include "Trace.h"
+
+ShaderCompiler::ShaderCompiler(ThreadPool * thread_pool, ShaderCache * shader_cache) :
+	m_thread_pool(thread_pool),
+	m_shader_cache(shader_cache)
+{
+	//the cache brings glslang up itself, and only on a miss
+	if (m_shader_cache == nullptr) {
+		acquire_glslang();
+	}
+}
+
+ShaderCompiler::~ShaderCompiler() {
+	if (m_shader_cache == nullptr) {
+		release_glslang();
+	}
+}
+
+std::future<ShaderCompileResult> ShaderCompiler::Compile(const ShaderCompileJob & job) {
+	//the job is copied into the task, so the caller's vector doesn't need to outlive it
+	return m_thread_pool->Submit([this, job]() { return Run(job); });
+}
+
+std::vector<std::future<ShaderCompileResult>> ShaderCompiler::CompileBatch(const std::vector<ShaderCompileJob> & jobs) {
+	std::vector<std::future<ShaderCompileResult>> results;
+	results.reserve(jobs.size());
+	for (uint32_t i = 0; i < jobs.size(); i++) {
+		results.push_back(Compile(jobs[i]));
+	}
+	return results;
+}
+
+ThreadPool * ShaderCompiler::GetThreadPool() const {
+	return m_thread_pool;
+}
+
+ShaderCompileResult ShaderCompiler::Run(const ShaderCompileJob & job) {
+	TRACE_ZONE("compile shader");
+	ShaderCompileResult result;
+	if (m_shader_cache != nullptr) {
+		result.success = m_shader_cache->GetSPIRV(job.stage, job.source.c_str(), job.defines, result.spirv, &result.log);
+	}
+	else {
+		result.success = GLSLtoSPV(job.stage, job.source.c_str(), result.spirv, job.defines, &result.log);
+	}
+	return result;
+}
\ No newline at end of file
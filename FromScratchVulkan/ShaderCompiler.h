@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Platform.h"
+#include <future>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+class ShaderCache;
+
+struct ShaderCompileJob {
+	VkShaderStageFlagBits stage;
+	std::string source;
+	std::vector<std::string> defines;
+};
+
+struct ShaderCompileResult {
+	bool success = false;
+	std::vector<unsigned int> spirv;
+	//glslang's info logs for this job only, empty on success
+	std::string log;
+};
+
+//compiles batches of shaders concurrently on a thread pool. each job gets its own glslang shader
+//and program and reports its own diagnostics, so nothing is shared between workers but the
+//process-wide glslang state. goes through the shader cache when one is given
+class ShaderCompiler {
+public:
+	ShaderCompiler(ThreadPool * thread_pool, ShaderCache * shader_cache = nullptr);
+	~ShaderCompiler();
+
+	std::future<ShaderCompileResult> Compile(const ShaderCompileJob & job);
+	//results come back in job order
+	std::vector<std::future<ShaderCompileResult>> CompileBatch(const std::vector<ShaderCompileJob> & jobs);
+
+	ThreadPool * GetThreadPool() const;
+private:
+	ShaderCompileResult Run(const ShaderCompileJob & job);
+
+	ThreadPool * m_thread_pool;
+	ShaderCache * m_shader_cache;
+};
\ No newline at end of file
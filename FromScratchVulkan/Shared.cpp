@@ -1,6 +1,16 @@
 #include "BUILD_OPTIONS.h"
 #include "Platform.h"
 #include "Shared.h"
+#include <errno.h>
+#include <stdio.h>
+#include <functional>
+#include <mutex>
+#include <thread>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
 
 
 #if BUILD_OPTIONS_RUNTIME_DEBUG
@@ -80,29 +90,56 @@ void Errcheck(VkResult error)() {}
 
 #endif // BUILD_OPTIONS_RUNTIME_DEBUG
 
-bool memory_types_from_properties(uint32_t type_bits, VkFlags requirements_mask, uint32_t * typeIndex, VkPhysicalDeviceMemoryProperties memory_properties) {
+//picks the best memory type rather than the first one that fits: every type must have all the
+//required flags, each preferred flag it has counts strongly in its favour and each flag nobody asked
+//for (device local for a staging buffer, host cached for a vertex buffer...) counts slightly against it.
+//ties go to the lower index since drivers list faster types first
+bool memory_types_from_properties(uint32_t type_bits, VkFlags requirements_mask, VkFlags preferred_mask, uint32_t * typeIndex, const VkPhysicalDeviceMemoryProperties & memory_properties) {
+	bool found = false;
+	int best_score = 0;
 	for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++) {
-		if ((type_bits & 1) == 1) {
-			// Type is available, does it match user properties?
-			if ((memory_properties.memoryTypes[i].propertyFlags &
-				requirements_mask) == requirements_mask) {
-				*typeIndex = i;
-				return true;
+		if ((type_bits & (1u << i)) == 0) {
+			continue;
+		}
+		VkMemoryPropertyFlags flags = memory_properties.memoryTypes[i].propertyFlags;
+		if ((flags & requirements_mask) != requirements_mask) {
+			continue;
+		}
+		int score = 0;
+		for (uint32_t bit = 0; bit < 32; bit++) {
+			VkFlags flag = 1u << bit;
+			if ((flags & flag) == 0) {
+				continue;
+			}
+			if (preferred_mask & flag) {
+				score += 16;
+			}
+			else if ((requirements_mask & flag) == 0) {
+				score -= 1;
 			}
 		}
-		type_bits >>= 1;
+		if (!found || score > best_score) {
+			found = true;
+			best_score = score;
+			*typeIndex = i;
+		}
 	}
-	return false;
+	return found;
 }
 
 bool GLSLtoSPV(const VkShaderStageFlagBits shader_type, const char *pshader,
-	std::vector<unsigned int> &spirv) {
+	std::vector<unsigned int> &spirv, const std::vector<std::string> &defines, std::string *log) {
 	EShLanguage stage = FindLanguage(shader_type);
 	glslang::TShader shader(stage);
 	glslang::TProgram program;
 	const char *shaderStrings[1];
-	TBuiltInResource Resources;
-	init_resources(Resources);
+	//glslang keeps its pools per thread already, the limits only need filling in once per thread
+	static thread_local TBuiltInResource Resources;
+	static thread_local bool resources_initialised = false;
+	if (!resources_initialised) {
+		init_resources(Resources);
+		resources_initialised = true;
+	}
 
 	// Enable SPIR-V and Vulkan rules when parsing GLSL
 	EShMessages messages = (EShMessages)(EShMsgSpvRules | EShMsgVulkanRules);
@@ -110,9 +147,22 @@ bool GLSLtoSPV(const VkShaderStageFlagBits shader_type, const char *pshader,
 	shaderStrings[0] = pshader;
 	shader.setStrings(shaderStrings, 1);
 
+	//defines go in the preamble, which glslang places after the #version line
+	std::string preamble;
+	for (uint32_t i = 0; i < defines.size(); i++) {
+		preamble += "#define " + defines[i] + "\n";
+	}
+	shader.setPreamble(preamble.c_str());
+
 	if (!shader.parse(&Resources, 100, false, messages)) {
-		puts(shader.getInfoLog());
-		puts(shader.getInfoDebugLog());
+		if (log != nullptr) {
+			*log += shader.getInfoLog();
+			*log += shader.getInfoDebugLog();
+		}
+		else {
+			puts(shader.getInfoLog());
+			puts(shader.getInfoDebugLog());
+		}
 		return false; // something didn't work
 	}
 
@@ -123,9 +173,15 @@ bool GLSLtoSPV(const VkShaderStageFlagBits shader_type, const char *pshader,
 	//
 
 	if (!program.link(messages)) {
-		puts(shader.getInfoLog());
-		puts(shader.getInfoDebugLog());
-		fflush(stdout);
+		if (log != nullptr) {
+			*log += program.getInfoLog();
+			*log += program.getInfoDebugLog();
+		}
+		else {
+			puts(shader.getInfoLog());
+			puts(shader.getInfoDebugLog());
+			fflush(stdout);
+		}
 		return false;
 	}
 
@@ -251,4 +307,73 @@ void init_resources(TBuiltInResource &Resources) {
 	Resources.limits.generalSamplerIndexing = 1;
 	Resources.limits.generalVariableIndexing = 1;
 	Resources.limits.generalConstantMatrixVectorIndexing = 1;
+}
+
+uint64_t fnv1a_64(const void * data, size_t size, uint64_t hash) {
+	const uint8_t * bytes = (const uint8_t *)data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= FNV1A_64_PRIME;
+	}
+	return hash;
+}
+
+bool read_file(const std::string & path, std::vector<uint8_t> & data) {
+	FILE * file = fopen(path.c_str(), "rb");
+	if (file == nullptr) {
+		return false;
+	}
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	data.resize(size > 0 ? size : 0);
+	bool result = size >= 0 && fread(data.data(), 1, data.size(), file) == data.size();
+	fclose(file);
+	return result;
+}
+
+bool write_file_atomic(const std::string & path, const void * data, size_t size) {
+	//unique per thread, so two workers storing the same entry don't write into each other's file
+	std::string temporary_path = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+	FILE * file = fopen(temporary_path.c_str(), "wb");
+	if (file == nullptr) {
+		return false;
+	}
+	bool result = fwrite(data, 1, size, file) == size;
+	result = fclose(file) == 0 && result;
+	if (!result) {
+		remove(temporary_path.c_str());
+		return false;
+	}
+#ifdef _WIN32
+	return MoveFileExA(temporary_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(temporary_path.c_str(), path.c_str()) == 0;
+#endif
+}
+
+bool create_directory(const std::string & path) {
+#ifdef _WIN32
+	return _mkdir(path.c_str()) == 0 || errno == EEXIST;
+#else
+	return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+static std::mutex glslang_mutex;
+static uint32_t glslang_users = 0;
+
+void acquire_glslang() {
+	std::lock_guard<std::mutex> lock(glslang_mutex);
+	if (glslang_users++ == 0) {
+		glslang::InitializeProcess();
+	}
+}
+
+void release_glslang() {
+	std::lock_guard<std::mutex> lock(glslang_mutex);
+	assert(glslang_users > 0);
+	if (--glslang_users == 0) {
+		glslang::FinalizeProcess();
+	}
 }
\ No newline at end of file
@@ -3,14 +3,27 @@
 #include "Platform.h"
 #include <assert.h>
 #include <iostream>
+#include <string>
 #include <vector>
 
+#define FNV1A_64_OFFSET 14695981039346656037ull
+#define FNV1A_64_PRIME 1099511628211ull
 
 void ErrorCheck(VkResult result);
-bool memory_types_from_properties(uint32_t type_bits, VkFlags requirements_mask, uint32_t * typeIndex, VkPhysicalDeviceMemoryProperties memory_properties);
-bool GLSLtoSPV(const VkShaderStageFlagBits shader_type, const char *pshader, std::vector<unsigned int> &spirv);
+bool memory_types_from_properties(uint32_t type_bits, VkFlags requirements_mask, VkFlags preferred_mask, uint32_t * typeIndex, const VkPhysicalDeviceMemoryProperties & memory_properties);
+//diagnostics go to log when one is given, otherwise to stdout. safe to call from several threads at once
+bool GLSLtoSPV(const VkShaderStageFlagBits shader_type, const char *pshader, std::vector<unsigned int> &spirv, const std::vector<std::string> &defines = std::vector<std::string>(), std::string *log = nullptr);
 EShLanguage FindLanguage(const VkShaderStageFlagBits shader_type);
 void init_resources(TBuiltInResource &Resources);
+//glslang's process state is shared by everything that compiles; the first acquire brings it up and the last release tears it down
+void acquire_glslang();
+void release_glslang();
+
+uint64_t fnv1a_64(const void * data, size_t size, uint64_t hash = FNV1A_64_OFFSET);
+bool read_file(const std::string & path, std::vector<uint8_t> & data);
+//writes to a temporary file and renames it over path, so readers never see half a file
+bool write_file_atomic(const std::string & path, const void * data, size_t size);
+bool create_directory(const std::string & path);
 
 struct vertex_data {
 	glm::vec3 position;
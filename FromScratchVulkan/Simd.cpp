@@ -0,0 +1,73 @@
+#include "Simd.h"
+
+#if SIMD_AVX2 && !defined(_MSC_VER)
+#include <cpuid.h>
+#endif
+
+#if SIMD_AVX2
+static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t registers[4]) {
+#ifdef _MSC_VER
+	__cpuidex((int *)registers, (int)leaf, (int)subleaf);
+#else
+	__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+static uint64_t xgetbv(uint32_t index) {
+#ifdef _MSC_VER
+	return _xgetbv(index);
+#else
+	uint32_t eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
+	return ((uint64_t)edx << 32) | eax;
+#endif
+}
+
+static bool cpu_has_avx2() {
+	uint32_t registers[4];
+	cpuid(0, 0, registers);
+	if (registers[0] < 7) {
+		return false;
+	}
+
+	//fma (ecx 12), osxsave (ecx 27) and avx (ecx 28), then the os has to actually save xmm and ymm state
+	cpuid(1, 0, registers);
+	const uint32_t leaf1_bits = (1u << 12) | (1u << 27) | (1u << 28);
+	if ((registers[2] & leaf1_bits) != leaf1_bits || (xgetbv(0) & 6) != 6) {
+		return false;
+	}
+
+	//avx2 (ebx 5)
+	cpuid(7, 0, registers);
+	return (registers[1] & (1u << 5)) != 0;
+}
+#endif
+
+static SimdLevel detect_level() {
+#if SIMD_AVX2
+	if (cpu_has_avx2()) {
+		return SIMD_LEVEL_AVX2;
+	}
+#endif
+#if SIMD_SSE2
+	return SIMD_LEVEL_SSE2;
+#else
+	return SIMD_LEVEL_SCALAR;
+#endif
+}
+
+SimdLevel Simd::GetLevel() {
+	static const SimdLevel level = detect_level();
+	return level;
+}
+
+const char * Simd::GetLevelName(SimdLevel level) {
+	switch (level) {
+	case SIMD_LEVEL_AVX2:
+		return "avx2";
+	case SIMD_LEVEL_SSE2:
+		return "sse2";
+	default:
+		return "scalar";
+	}
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//every x64 target has sse2, 32 bit builds only when the compiler is told it can use it
+#if defined(_M_X64) || defined(__SSE2__)
+#define SIMD_SSE2 1
+#include <emmintrin.h>
+#else
+#define SIMD_SSE2 0
+#endif
+
+//avx2 kernels are compiled next to the sse2 ones and picked at runtime, so the build doesn't need /arch:AVX2.
+//msvc accepts the intrinsics anywhere, gcc and clang want the function marked with SIMD_TARGET_AVX2
+#if SIMD_SSE2 && (defined(_MSC_VER) || defined(__GNUC__))
+#define SIMD_AVX2 1
+#include <immintrin.h>
+#else
+#define SIMD_AVX2 0
+#endif
+
+#if SIMD_AVX2 && !defined(_MSC_VER)
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define SIMD_TARGET_AVX2
+#endif
+
+enum SimdLevel {
+	SIMD_LEVEL_SCALAR = 0,
+	SIMD_LEVEL_SSE2 = 1,
+	//avx2 and fma, with the os saving the ymm registers
+	SIMD_LEVEL_AVX2 = 2
+};
+
+namespace Simd {
+	//the widest level both the build and the cpu support, detected once
+	SimdLevel GetLevel();
+	const char * GetLevelName(SimdLevel level);
+
+	//index of the lowest set bit, for walking movemask results. mask must not be 0
+	inline uint32_t CountTrailingZeros(uint32_t mask) {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return index;
+#else
+		return (uint32_t)__builtin_ctz(mask);
+#endif
+	}
+}
\ No newline at end of file
@@ -0,0 +1,276 @@
+#include "Texture.h"
+#include "Renderer.h"
+#include "DescriptorAllocator.h"
+#include "Pipeline.h"
+#include "Uploader.h"
+#include "Ktx2File.h"
+#include "BlockCompression.h"
+#include "Shared.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+Texture::Texture(Renderer * renderer, uint32_t width, uint32_t height, VkFormat format, const void * pixels, VkDeviceSize size, bool mipmaps) :
+	m_renderer(renderer),
+	m_device(renderer->GetVulkanDevice()),
+	m_width(width),
+	m_height(height),
+	m_format(format),
+	m_mip_levels(1),
+	m_mip_generation_method(MIP_GENERATION_NONE),
+	m_image(VK_NULL_HANDLE),
+	m_image_view(VK_NULL_HANDLE),
+	m_bindless_index(BINDLESS_INDEX_INVALID),
+	m_upload_token(0),
+	m_mip_token(0)
+{
+	if (mipmaps) {
+		//formats neither path can write to are left at their base level rather than sampled with garbage below it
+		m_mip_generation_method = m_renderer->GetMipGenerator()->GetMethod(format);
+		if (m_mip_generation_method != MIP_GENERATION_NONE) {
+			m_mip_levels = GetMipLevelCount(width, height);
+		} else {
+			std::cout << "texture: no way to generate mips for format " << format << ", sampling the base level only" << std::endl;
+		}
+	}
+	if (m_mip_levels == 1) {
+		m_mip_generation_method = MIP_GENERATION_NONE;
+	}
+
+	VkBufferImageCopy region{};
+	region.bufferOffset = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent = { m_width, m_height, 1 };
+	InitImage(&region, 1, pixels, size);
+}
+
+Texture::Texture(Renderer * renderer, uint32_t width, uint32_t height, VkFormat format, uint32_t mip_levels, const VkBufferImageCopy * regions, uint32_t region_count, const void * data, VkDeviceSize size) :
+	m_renderer(renderer),
+	m_device(renderer->GetVulkanDevice()),
+	m_width(width),
+	m_height(height),
+	m_format(format),
+	m_mip_levels(mip_levels),
+	m_mip_generation_method(MIP_GENERATION_NONE),
+	m_image(VK_NULL_HANDLE),
+	m_image_view(VK_NULL_HANDLE),
+	m_bindless_index(BINDLESS_INDEX_INVALID),
+	m_upload_token(0),
+	m_mip_token(0)
+{
+	InitImage(regions, region_count, data, size);
+}
+
+Texture::~Texture() {
+	DeInitImage();
+}
+
+//the rgba8 format a bc format is decoded to, or VK_FORMAT_UNDEFINED when there is no decoder for it
+static VkFormat get_decoded_format(VkFormat format) {
+	switch (format) {
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+		return VK_FORMAT_R8G8B8A8_UNORM;
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+		return VK_FORMAT_R8G8B8A8_SRGB;
+	default:
+		return VK_FORMAT_UNDEFINED;
+	}
+}
+
+Texture * Texture::LoadKtx2(Renderer * renderer, const std::string & path) {
+	Ktx2File file;
+	if (!file.Open(path)) {
+		return nullptr;
+	}
+
+	auto load_start = std::chrono::steady_clock::now();
+	VkFormat format = file.GetFormat();
+	uint32_t width = file.GetWidth();
+	uint32_t height = file.GetHeight();
+	uint32_t level_count = file.GetLevelCount();
+
+	VkFormatProperties format_properties;
+	vkGetPhysicalDeviceFormatProperties(renderer->GetVulkanPhysicalDevice(), format, &format_properties);
+	VkFormatFeatureFlags sampled_features = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	bool sampled = (format_properties.optimalTilingFeatures & sampled_features) == sampled_features;
+
+	Texture * texture = nullptr;
+	const char * path_taken = "direct";
+	if (sampled && file.GetGenerateMips()) {
+		//only level 0 is stored; the mip generator fills the rest if it can write the format, which rules out compressed ones
+		texture = new Texture(renderer, width, height, format, file.GetLevelData(0), file.GetLevelSize(0));
+		path_taken = "generated mips";
+	} else if (sampled) {
+		//the levels are copied out of the mapping as they are stored; the uploader's copy into staging is the only pass over them
+		std::vector<VkBufferImageCopy> regions(level_count);
+		for (uint32_t level = 0; level < level_count; level++) {
+			regions[level] = {};
+			regions[level].bufferOffset = file.GetLevelOffset(level);
+			regions[level].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			regions[level].imageSubresource.mipLevel = level;
+			regions[level].imageSubresource.layerCount = 1;
+			regions[level].imageExtent = { std::max(width >> level, 1u), std::max(height >> level, 1u), 1 };
+		}
+		texture = new Texture(renderer, width, height, format, level_count, regions.data(), level_count, file.GetLevelsData(), file.GetLevelsSize());
+	} else {
+		VkFormat decoded_format = get_decoded_format(format);
+		if (decoded_format == VK_FORMAT_UNDEFINED) {
+			std::cout << "texture: " << path << " is in format " << format << ", which the device can't sample and there is no decoder for" << std::endl;
+			return nullptr;
+		}
+
+		//every level decoded into one buffer, laid out like an uncompressed ktx2
+		std::vector<VkBufferImageCopy> regions(level_count);
+		VkDeviceSize decoded_size = 0;
+		for (uint32_t level = 0; level < level_count; level++) {
+			uint32_t level_width = std::max(width >> level, 1u);
+			uint32_t level_height = std::max(height >> level, 1u);
+			regions[level] = {};
+			regions[level].bufferOffset = decoded_size;
+			regions[level].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			regions[level].imageSubresource.mipLevel = level;
+			regions[level].imageSubresource.layerCount = 1;
+			regions[level].imageExtent = { level_width, level_height, 1 };
+			decoded_size += (VkDeviceSize)level_width * level_height * 4;
+		}
+		std::vector<uint8_t> decoded((size_t)decoded_size);
+		bool bc3 = format == VK_FORMAT_BC3_UNORM_BLOCK || format == VK_FORMAT_BC3_SRGB_BLOCK;
+		bool alpha = format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK || format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+		//Open has already checked every level holds all of its blocks
+		for (uint32_t level = 0; level < level_count; level++) {
+			uint32_t level_width = regions[level].imageExtent.width;
+			uint32_t level_height = regions[level].imageExtent.height;
+			if (bc3) {
+				BlockCompression::DecodeBC3(file.GetLevelData(level), level_width, level_height, decoded.data() + regions[level].bufferOffset);
+			} else {
+				BlockCompression::DecodeBC1(file.GetLevelData(level), level_width, level_height, alpha, decoded.data() + regions[level].bufferOffset);
+			}
+		}
+		texture = new Texture(renderer, width, height, decoded_format, level_count, regions.data(), level_count, decoded.data(), decoded.size());
+		path_taken = "decoded to rgba8";
+	}
+
+	float load_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - load_start).count();
+	std::cout << "texture: " << path << ", " << width << "x" << height << ", " << texture->GetMipLevels() << " levels, format " << format << " " << path_taken
+		<< ", " << texture->GetMemorySize() / 1024 << " KB queued in " << load_ms << " ms" << std::endl;
+	return texture;
+}
+
+uint32_t Texture::GetMipLevelCount(uint32_t width, uint32_t height) {
+	uint32_t levels = 1;
+	uint32_t largest = width > height ? width : height;
+	while (largest > 1) {
+		largest /= 2;
+		levels++;
+	}
+	return levels;
+}
+
+void Texture::Wait() {
+	if (m_mip_generation_method != MIP_GENERATION_NONE) {
+		m_renderer->GetMipGenerator()->Wait(m_mip_token);
+	} else {
+		m_renderer->GetUploader()->Wait(m_upload_token);
+	}
+}
+
+VkImage Texture::GetImage() const {
+	return m_image;
+}
+
+VkImageView Texture::GetImageView() const {
+	return m_image_view;
+}
+
+VkFormat Texture::GetFormat() const {
+	return m_format;
+}
+
+uint32_t Texture::GetWidth() const {
+	return m_width;
+}
+
+uint32_t Texture::GetHeight() const {
+	return m_height;
+}
+
+uint32_t Texture::GetMipLevels() const {
+	return m_mip_levels;
+}
+
+MipGenerationMethod Texture::GetMipGenerationMethod() const {
+	return m_mip_generation_method;
+}
+
+uint32_t Texture::GetBindlessIndex() const {
+	return m_bindless_index;
+}
+
+VkDeviceSize Texture::GetMemorySize() const {
+	return m_allocation.size;
+}
+
+void Texture::InitImage(const VkBufferImageCopy * regions, uint32_t region_count, const void * data, VkDeviceSize size) {
+	VkImageCreateInfo image_create_info{};
+	image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_create_info.imageType = VK_IMAGE_TYPE_2D;
+	image_create_info.format = m_format;
+	image_create_info.extent = { m_width, m_height, 1 };
+	image_create_info.mipLevels = m_mip_levels;
+	image_create_info.arrayLayers = 1;
+	image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_create_info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | MipGenerator::GetUsage(m_mip_generation_method);
+	image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	ErrorCheck(vkCreateImage(m_device, &image_create_info, VK_NULL_HANDLE, &m_image));
+
+	//optimal tiling can't be written from the cpu anyway, so host visibility is worth nothing here
+	m_allocation = m_renderer->GetAllocator()->AllocateForImage(m_image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0);
+
+	VkImageSubresourceRange range{};
+	range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	range.baseMipLevel = 0;
+	range.levelCount = m_mip_levels;
+	range.baseArrayLayer = 0;
+	range.layerCount = 1;
+
+	//when the chain is generated only level 0 is copied, but every level is moved into the layout the mip generator starts from
+	m_upload_token = m_renderer->GetUploader()->UploadImage(m_image, range, MipGenerator::GetUploadLayout(m_mip_generation_method), regions, region_count, data, size);
+	if (m_mip_generation_method != MIP_GENERATION_NONE) {
+		m_mip_token = m_renderer->GetMipGenerator()->Generate(m_image, m_format, m_width, m_height, m_mip_levels);
+	}
+
+	VkImageViewCreateInfo image_view_create_info{};
+	image_view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	image_view_create_info.image = m_image;
+	image_view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	image_view_create_info.format = m_format;
+	image_view_create_info.components = { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A };
+	image_view_create_info.subresourceRange = range;
+
+	ErrorCheck(vkCreateImageView(m_device, &image_view_create_info, VK_NULL_HANDLE, &m_image_view));
+
+	//written now, but only read by draws recorded after the uploads that fill the image
+	if (m_renderer->GetPipeline()->IsBindless()) {
+		m_bindless_index = m_renderer->GetPipeline()->AddBindlessImage(m_image_view);
+	}
+}
+
+void Texture::DeInitImage() {
+	//any set still pointing at the view would be handed out again if a new one were created with the same handle
+	m_renderer->GetDescriptorAllocator()->Evict(m_image_view);
+	if (m_bindless_index != BINDLESS_INDEX_INVALID) {
+		m_renderer->GetPipeline()->RemoveBindlessImage(m_bindless_index);
+	}
+	vkDestroyImageView(m_device, m_image_view, VK_NULL_HANDLE);
+	vkDestroyImage(m_device, m_image, VK_NULL_HANDLE);
+	m_renderer->GetAllocator()->Free(m_allocation);
+}
\ No newline at end of file
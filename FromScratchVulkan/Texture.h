@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Platform.h"
+#include "Allocator.h"
+#include "MipGenerator.h"
+#include <string>
+
+class Renderer;
+
+//a sampled 2d image in device local memory. pixels is level 0, tightly packed; it goes through the uploader and,
+//with mipmaps, the rest of the chain is filled in on the gpu by the renderer's MipGenerator. nothing is resident
+//until the uploader and mip generator have been flushed, which EndFrame does, or until Wait returns
+class Texture {
+public:
+	Texture(Renderer * renderer, uint32_t width, uint32_t height, VkFormat format, const void * pixels, VkDeviceSize size, bool mipmaps = true);
+	//every level comes with the data, one region per level with buffer offsets relative to data; nothing is generated
+	Texture(Renderer * renderer, uint32_t width, uint32_t height, VkFormat format, uint32_t mip_levels, const VkBufferImageCopy * regions, uint32_t region_count, const void * data, VkDeviceSize size);
+	~Texture();
+
+	//a 2d ktx2 file's levels go to the gpu as they are stored when the device can sample the format; bc1 and bc3
+	//are decoded to rgba8 when it can't. null when the file can't be opened or its format can be neither
+	static Texture * LoadKtx2(Renderer * renderer, const std::string & path);
+
+	//levels in a full chain down to 1x1
+	static uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+
+	//blocks until every level can be sampled
+	void Wait();
+
+	VkImage GetImage() const;
+	//covers every level
+	VkImageView GetImageView() const;
+	VkFormat GetFormat() const;
+	uint32_t GetWidth() const;
+	uint32_t GetHeight() const;
+	uint32_t GetMipLevels() const;
+	MipGenerationMethod GetMipGenerationMethod() const;
+	//the view's slot in the pipeline's bindless set, BINDLESS_INDEX_INVALID when the renderer isn't bindless
+	uint32_t GetBindlessIndex() const;
+	//of the image's allocation, every level included
+	VkDeviceSize GetMemorySize() const;
+private:
+	Texture(const Texture &);
+	Texture & operator=(const Texture &);
+
+	void InitImage(const VkBufferImageCopy * regions, uint32_t region_count, const void * data, VkDeviceSize size);
+	void DeInitImage();
+
+	Renderer * m_renderer;
+	VkDevice m_device;
+
+	uint32_t m_width;
+	uint32_t m_height;
+	VkFormat m_format;
+	uint32_t m_mip_levels;
+	MipGenerationMethod m_mip_generation_method;
+
+	VkImage m_image;
+	Allocation m_allocation;
+	VkImageView m_image_view;
+	uint32_t m_bindless_index;
+
+	//the mip generator's when it has work to do for this texture, the uploader's otherwise
+	uint64_t m_upload_token;
+	uint64_t m_mip_token;
+};
\ No newline at end of file
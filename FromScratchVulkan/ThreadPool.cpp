@@ -0,0 +1,57 @@
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <stdint.h>
+
+static thread_local uint32_t worker_index = UINT32_MAX;
+
+ThreadPool::ThreadPool(uint32_t thread_count) :
+	m_stopping(false)
+{
+	if (thread_count == 0) {
+		thread_count = std::thread::hardware_concurrency();
+	}
+	if (thread_count == 0) {
+		thread_count = 1;
+	}
+	for (uint32_t i = 0; i < thread_count; i++) {
+		m_threads.push_back(std::thread(&ThreadPool::WorkerLoop, this, i));
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_condition.notify_all();
+	//workers drain whatever is still queued before they exit, so no future is left dangling
+	for (uint32_t i = 0; i < m_threads.size(); i++) {
+		m_threads[i].join();
+	}
+}
+
+uint32_t ThreadPool::GetThreadCount() const {
+	return (uint32_t)m_threads.size();
+}
+
+uint32_t ThreadPool::GetWorkerIndex() {
+	return worker_index;
+}
+
+void ThreadPool::WorkerLoop(uint32_t index) {
+	worker_index = index;
+	TRACE_THREAD_NAME("worker " + std::to_string(index));
+	for (;;) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+			if (m_jobs.empty()) {
+				return;
+			}
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+		}
+		job();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//fixed set of worker threads pulling jobs off a shared fifo. Submit hands back a future, so
+//callers can fan work out and collect results (or exceptions) without any extra bookkeeping
+class ThreadPool {
+public:
+	//0 means one worker per hardware thread
+	ThreadPool(uint32_t thread_count = 0);
+	~ThreadPool();
+
+	template <typename F>
+	std::future<decltype(std::declval<F &>()())> Submit(F function) {
+		typedef decltype(std::declval<F &>()()) result_type;
+		//std::function needs something copyable, packaged_task isn't
+		std::shared_ptr<std::packaged_task<result_type()>> task = std::make_shared<std::packaged_task<result_type()>>(function);
+		std::future<result_type> future = task->get_future();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_jobs.push_back([task]() { (*task)(); });
+		}
+		m_condition.notify_one();
+		return future;
+	}
+
+	uint32_t GetThreadCount() const;
+
+	//index of the calling worker in [0, GetThreadCount()), or UINT32_MAX off the pool
+	static uint32_t GetWorkerIndex();
+private:
+	ThreadPool(const ThreadPool &);
+	ThreadPool & operator=(const ThreadPool &);
+
+	void WorkerLoop(uint32_t index);
+
+	std::vector<std::thread> m_threads;
+	std::deque<std::function<void()>> m_jobs;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stopping;
+};
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include "Trace.h"
+
+#if BUILD_OPTIONS_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <vector>
+
+namespace {
+	struct TraceEvent {
+		const char * name;
+		uint64_t start;
+		uint64_t end;
+	};
+
+	//single writer: only the owning thread appends, and publishes with the release store of count
+	struct ThreadBuffer {
+		uint32_t id;
+		std::string name;
+		std::atomic<uint64_t> count;
+		std::vector<TraceEvent> events;
+	};
+
+	std::mutex registry_mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> registry;
+	const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	thread_local ThreadBuffer * thread_buffer = nullptr;
+
+	ThreadBuffer * GetThreadBuffer() {
+		if (thread_buffer == nullptr) {
+			std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+			buffer->count = 0;
+			buffer->events.resize(TRACE_EVENTS_PER_THREAD);
+			//buffers outlive their threads so a dump still sees what finished threads recorded
+			std::lock_guard<std::mutex> lock(registry_mutex);
+			buffer->id = (uint32_t)registry.size();
+			thread_buffer = buffer.get();
+			registry.push_back(std::move(buffer));
+		}
+		return thread_buffer;
+	}
+}
+
+uint64_t Trace::Now() {
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Trace::Record(const char * name, uint64_t start, uint64_t end) {
+	ThreadBuffer * buffer = GetThreadBuffer();
+	uint64_t count = buffer->count.load(std::memory_order_relaxed);
+	TraceEvent & event = buffer->events[count % TRACE_EVENTS_PER_THREAD];
+	event.name = name;
+	event.start = start;
+	event.end = end;
+	buffer->count.store(count + 1, std::memory_order_release);
+}
+
+void Trace::SetThreadName(const std::string & name) {
+	ThreadBuffer * buffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	buffer->name = name;
+}
+
+bool Trace::Dump(const std::string & path) {
+	FILE * file = fopen(path.c_str(), "w");
+	if (file == nullptr) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	fprintf(file, "{\"traceEvents\":[\n");
+	bool first = true;
+	for (uint32_t i = 0; i < registry.size(); i++) {
+		ThreadBuffer * buffer = registry[i].get();
+		if (!buffer->name.empty()) {
+			fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", buffer->id, buffer->name.c_str());
+			first = false;
+		}
+
+		uint64_t count = buffer->count.load(std::memory_order_acquire);
+		uint64_t begin = count > TRACE_EVENTS_PER_THREAD ? count - TRACE_EVENTS_PER_THREAD : 0;
+		for (uint64_t j = begin; j < count; j++) {
+			const TraceEvent & event = buffer->events[j % TRACE_EVENTS_PER_THREAD];
+			//chrome wants microseconds
+			fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", first ? "" : ",\n", event.name, buffer->id, event.start / 1000.0, (event.end - event.start) / 1000.0);
+			first = false;
+		}
+	}
+	fprintf(file, "\n]}\n");
+	return fclose(file) == 0;
+}
+
+#endif
\ No newline at end of file
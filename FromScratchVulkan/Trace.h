@@ -0,0 +1,45 @@
+#pragma once
+
+#include "BUILD_OPTIONS.h"
+#include <stdint.h>
+#include <string>
+
+//events each thread keeps; older ones are overwritten once a thread has recorded more
+#define TRACE_EVENTS_PER_THREAD (64 * 1024)
+
+//cpu zone markers, dumped as chrome://tracing / perfetto json. each thread appends to its own buffer with
+//no locks; only a thread's first event and Dump take the registry mutex. compiled out entirely unless
+//BUILD_OPTIONS_TRACE is set
+#if BUILD_OPTIONS_TRACE
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+//times the rest of the enclosing block. name must be a string literal
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(trace_zone_, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) Trace::SetThreadName(name)
+#define TRACE_DUMP(path) Trace::Dump(path)
+
+namespace Trace {
+	uint64_t Now();
+	void Record(const char * name, uint64_t start, uint64_t end);
+	void SetThreadName(const std::string & name);
+	//safe to call while other threads are still recording, though their newest events may be torn
+	bool Dump(const std::string & path);
+}
+
+class TraceZone {
+public:
+	TraceZone(const char * name) : m_name(name), m_start(Trace::Now()) {}
+	~TraceZone() { Trace::Record(m_name, m_start, Trace::Now()); }
+private:
+	const char * m_name;
+	uint64_t m_start;
+};
+
+#else
+
+#define TRACE_ZONE(name)
+#define TRACE_THREAD_NAME(name)
+#define TRACE_DUMP(path)
+
+#endif
\ No newline at end of file
@@ -0,0 +1,335 @@
+#include "TransformStore.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <string.h>
+
+//the kernels hold each matrix as m[column][row], and the widest handles eight objects per register
+#define TRANSFORM_STORE_MAX_LANES 8
+
+TransformStore::TransformStore(uint32_t count) {
+	m_count = 0;
+	Resize(count);
+}
+
+void TransformStore::Resize(uint32_t count) {
+	//new objects start at the identity transform
+	m_position_x.resize(count, 0.0f);
+	m_position_y.resize(count, 0.0f);
+	m_position_z.resize(count, 0.0f);
+	m_rotation_x.resize(count, 0.0f);
+	m_rotation_y.resize(count, 0.0f);
+	m_rotation_z.resize(count, 0.0f);
+	m_rotation_w.resize(count, 1.0f);
+	m_scale_x.resize(count, 1.0f);
+	m_scale_y.resize(count, 1.0f);
+	m_scale_z.resize(count, 1.0f);
+	m_count = count;
+}
+
+uint32_t TransformStore::GetCount() const {
+	return m_count;
+}
+
+void TransformStore::Set(uint32_t index, const glm::vec3 & position, const glm::quat & rotation, const glm::vec3 & scale) {
+	SetPosition(index, position);
+	SetRotation(index, rotation);
+	SetScale(index, scale);
+}
+
+void TransformStore::SetPosition(uint32_t index, const glm::vec3 & position) {
+	m_position_x[index] = position.x;
+	m_position_y[index] = position.y;
+	m_position_z[index] = position.z;
+}
+
+void TransformStore::SetRotation(uint32_t index, const glm::quat & rotation) {
+	m_rotation_x[index] = rotation.x;
+	m_rotation_y[index] = rotation.y;
+	m_rotation_z[index] = rotation.z;
+	m_rotation_w[index] = rotation.w;
+}
+
+void TransformStore::SetScale(uint32_t index, const glm::vec3 & scale) {
+	m_scale_x[index] = scale.x;
+	m_scale_y[index] = scale.y;
+	m_scale_z[index] = scale.z;
+}
+
+glm::vec3 TransformStore::GetPosition(uint32_t index) const {
+	return glm::vec3(m_position_x[index], m_position_y[index], m_position_z[index]);
+}
+
+float TransformStore::GetMaxScale(uint32_t index) const {
+	return std::max(std::max(std::fabs(m_scale_x[index]), std::fabs(m_scale_y[index])), std::fabs(m_scale_z[index]));
+}
+
+void TransformStore::Compute(SimdLevel level, const glm::mat4 & view_projection, const glm::mat4 & local, uint32_t first, uint32_t count,
+	void * world_out, uint32_t world_stride, void * mvp_out, uint32_t mvp_stride) const {
+	uint8_t * world = (uint8_t *)world_out;
+	uint8_t * mvp = (uint8_t *)mvp_out;
+
+	//the vector kernels only take whole registers, the scalar one mops up what is left
+	uint32_t done = 0;
+#if SIMD_AVX2
+	if (level >= SIMD_LEVEL_AVX2) {
+		done = count / 8 * 8;
+		ComputeAVX2(view_projection, local, first, done, world, world_stride, mvp, mvp_stride);
+	}
+#endif
+#if SIMD_SSE2
+	if (done == 0 && level >= SIMD_LEVEL_SSE2) {
+		done = count / 4 * 4;
+		ComputeSSE2(view_projection, local, first, done, world, world_stride, mvp, mvp_stride);
+	}
+#endif
+	ComputeScalar(view_projection, local, first + done, count - done,
+		world != nullptr ? world + (size_t)done * world_stride : nullptr, world_stride,
+		mvp != nullptr ? mvp + (size_t)done * mvp_stride : nullptr, mvp_stride);
+}
+
+void TransformStore::ComputeParallel(ThreadPool * thread_pool, SimdLevel level, const glm::mat4 & view_projection, const glm::mat4 & local,
+	void * world_out, uint32_t world_stride, void * mvp_out, uint32_t mvp_stride) const {
+	uint32_t job_count = (m_count + TRANSFORM_STORE_MIN_OBJECTS_PER_JOB - 1) / TRANSFORM_STORE_MIN_OBJECTS_PER_JOB;
+	job_count = std::min(job_count, thread_pool->GetThreadCount());
+	if (job_count <= 1) {
+		Compute(level, view_projection, local, 0, m_count, world_out, world_stride, mvp_out, mvp_stride);
+		return;
+	}
+
+	//chunk boundaries stay on whole registers so only the last chunk has a scalar tail
+	std::vector<std::future<void>> jobs(job_count);
+	for (uint32_t i = 0; i < job_count; i++) {
+		uint32_t first = (uint32_t)((uint64_t)m_count * i / job_count) / TRANSFORM_STORE_MAX_LANES * TRANSFORM_STORE_MAX_LANES;
+		uint32_t last = i + 1 == job_count ? m_count : (uint32_t)((uint64_t)m_count * (i + 1) / job_count) / TRANSFORM_STORE_MAX_LANES * TRANSFORM_STORE_MAX_LANES;
+		uint8_t * world = world_out != nullptr ? (uint8_t *)world_out + (size_t)first * world_stride : nullptr;
+		uint8_t * mvp = mvp_out != nullptr ? (uint8_t *)mvp_out + (size_t)first * mvp_stride : nullptr;
+		jobs[i] = thread_pool->Submit([=, &view_projection, &local]() {
+			Compute(level, view_projection, local, first, last - first, world, world_stride, mvp, mvp_stride);
+		});
+	}
+	for (uint32_t i = 0; i < job_count; i++) {
+		jobs[i].get();
+	}
+}
+
+void TransformStore::ComputeScalar(const glm::mat4 & view_projection, const glm::mat4 & local, uint32_t first, uint32_t count, uint8_t * world_out, uint32_t world_stride, uint8_t * mvp_out, uint32_t mvp_stride) const {
+	for (uint32_t o = 0; o < count; o++) {
+		uint32_t i = first + o;
+		float x = m_rotation_x[i];
+		float y = m_rotation_y[i];
+		float z = m_rotation_z[i];
+		float w = m_rotation_w[i];
+
+		//rotation matrix of the unit quaternion with the scale folded into its columns, then the translation
+		float affine[4][3] = {
+			{ (1.0f - 2.0f * (y * y + z * z)) * m_scale_x[i], 2.0f * (x * y + w * z) * m_scale_x[i], 2.0f * (x * z - w * y) * m_scale_x[i] },
+			{ 2.0f * (x * y - w * z) * m_scale_y[i], (1.0f - 2.0f * (x * x + z * z)) * m_scale_y[i], 2.0f * (y * z + w * x) * m_scale_y[i] },
+			{ 2.0f * (x * z + w * y) * m_scale_z[i], 2.0f * (y * z - w * x) * m_scale_z[i], (1.0f - 2.0f * (x * x + y * y)) * m_scale_z[i] },
+			{ m_position_x[i], m_position_y[i], m_position_z[i] }
+		};
+
+		//the affine matrix's bottom row is (0, 0, 0, 1), so the product's is just local's
+		float world[4][4];
+		for (uint32_t c = 0; c < 4; c++) {
+			for (uint32_t r = 0; r < 3; r++) {
+				world[c][r] = affine[0][r] * local[c][0] + affine[1][r] * local[c][1] + affine[2][r] * local[c][2] + affine[3][r] * local[c][3];
+			}
+			world[c][3] = local[c][3];
+		}
+		if (world_out != nullptr) {
+			memcpy(world_out + (size_t)o * world_stride, world, sizeof(world));
+		}
+
+		if (mvp_out != nullptr) {
+			float mvp[4][4];
+			for (uint32_t c = 0; c < 4; c++) {
+				for (uint32_t r = 0; r < 4; r++) {
+					mvp[c][r] = view_projection[0][r] * world[c][0] + view_projection[1][r] * world[c][1] + view_projection[2][r] * world[c][2] + view_projection[3][r] * world[c][3];
+				}
+			}
+			memcpy(mvp_out + (size_t)o * mvp_stride, mvp, sizeof(mvp));
+		}
+	}
+}
+
+#if SIMD_SSE2
+
+//m[column][row] holds that element for four objects; transposing each column hands back one object's column per register
+static void store_matrices_sse2(__m128 m[4][4], uint8_t * out, uint32_t stride) {
+	for (uint32_t c = 0; c < 4; c++) {
+		__m128 r0 = m[c][0];
+		__m128 r1 = m[c][1];
+		__m128 r2 = m[c][2];
+		__m128 r3 = m[c][3];
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		_mm_storeu_ps((float *)(out + 0 * (size_t)stride) + c * 4, r0);
+		_mm_storeu_ps((float *)(out + 1 * (size_t)stride) + c * 4, r1);
+		_mm_storeu_ps((float *)(out + 2 * (size_t)stride) + c * 4, r2);
+		_mm_storeu_ps((float *)(out + 3 * (size_t)stride) + c * 4, r3);
+	}
+}
+
+void TransformStore::ComputeSSE2(const glm::mat4 & view_projection, const glm::mat4 & local, uint32_t first, uint32_t count, uint8_t * world_out, uint32_t world_stride, uint8_t * mvp_out, uint32_t mvp_stride) const {
+	__m128 vp[4][4];
+	__m128 l[4][4];
+	for (uint32_t c = 0; c < 4; c++) {
+		for (uint32_t r = 0; r < 4; r++) {
+			vp[c][r] = _mm_set1_ps(view_projection[c][r]);
+			l[c][r] = _mm_set1_ps(local[c][r]);
+		}
+	}
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+
+	for (uint32_t o = 0; o < count; o += 4) {
+		uint32_t i = first + o;
+		__m128 x = _mm_loadu_ps(&m_rotation_x[i]);
+		__m128 y = _mm_loadu_ps(&m_rotation_y[i]);
+		__m128 z = _mm_loadu_ps(&m_rotation_z[i]);
+		__m128 w = _mm_loadu_ps(&m_rotation_w[i]);
+		__m128 scale_x = _mm_loadu_ps(&m_scale_x[i]);
+		__m128 scale_y = _mm_loadu_ps(&m_scale_y[i]);
+		__m128 scale_z = _mm_loadu_ps(&m_scale_z[i]);
+
+		__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+		__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+		__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+		__m128 affine[4][3];
+		affine[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), scale_x);
+		affine[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), scale_x);
+		affine[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), scale_x);
+		affine[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), scale_y);
+		affine[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), scale_y);
+		affine[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), scale_y);
+		affine[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), scale_z);
+		affine[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), scale_z);
+		affine[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), scale_z);
+		affine[3][0] = _mm_loadu_ps(&m_position_x[i]);
+		affine[3][1] = _mm_loadu_ps(&m_position_y[i]);
+		affine[3][2] = _mm_loadu_ps(&m_position_z[i]);
+
+		__m128 world[4][4];
+		for (uint32_t c = 0; c < 4; c++) {
+			for (uint32_t r = 0; r < 3; r++) {
+				__m128 sum = _mm_mul_ps(affine[0][r], l[c][0]);
+				sum = _mm_add_ps(sum, _mm_mul_ps(affine[1][r], l[c][1]));
+				sum = _mm_add_ps(sum, _mm_mul_ps(affine[2][r], l[c][2]));
+				world[c][r] = _mm_add_ps(sum, _mm_mul_ps(affine[3][r], l[c][3]));
+			}
+			world[c][3] = l[c][3];
+		}
+		if (world_out != nullptr) {
+			store_matrices_sse2(world, world_out + (size_t)o * world_stride, world_stride);
+		}
+
+		if (mvp_out != nullptr) {
+			__m128 mvp[4][4];
+			for (uint32_t c = 0; c < 4; c++) {
+				for (uint32_t r = 0; r < 4; r++) {
+					__m128 sum = _mm_mul_ps(vp[0][r], world[c][0]);
+					sum = _mm_add_ps(sum, _mm_mul_ps(vp[1][r], world[c][1]));
+					sum = _mm_add_ps(sum, _mm_mul_ps(vp[2][r], world[c][2]));
+					mvp[c][r] = _mm_add_ps(sum, _mm_mul_ps(vp[3][r], world[c][3]));
+				}
+			}
+			store_matrices_sse2(mvp, mvp_out + (size_t)o * mvp_stride, mvp_stride);
+		}
+	}
+}
+
+#endif
+
+#if SIMD_AVX2
+
+//as store_matrices_sse2, but the in-lane transpose leaves objects 0-3 in the low halves and 4-7 in the high ones
+SIMD_TARGET_AVX2 static void store_matrices_avx2(__m256 m[4][4], uint8_t * out, uint32_t stride) {
+	for (uint32_t c = 0; c < 4; c++) {
+		__m256 t0 = _mm256_unpacklo_ps(m[c][0], m[c][1]);
+		__m256 t1 = _mm256_unpackhi_ps(m[c][0], m[c][1]);
+		__m256 t2 = _mm256_unpacklo_ps(m[c][2], m[c][3]);
+		__m256 t3 = _mm256_unpackhi_ps(m[c][2], m[c][3]);
+		__m256 columns[4];
+		columns[0] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+		columns[1] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+		columns[2] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+		columns[3] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+		for (uint32_t j = 0; j < 4; j++) {
+			_mm_storeu_ps((float *)(out + j * (size_t)stride) + c * 4, _mm256_castps256_ps128(columns[j]));
+			_mm_storeu_ps((float *)(out + (j + 4) * (size_t)stride) + c * 4, _mm256_extractf128_ps(columns[j], 1));
+		}
+	}
+}
+
+SIMD_TARGET_AVX2 void TransformStore::ComputeAVX2(const glm::mat4 & view_projection, const glm::mat4 & local, uint32_t first, uint32_t count, uint8_t * world_out, uint32_t world_stride, uint8_t * mvp_out, uint32_t mvp_stride) const {
+	__m256 vp[4][4];
+	__m256 l[4][4];
+	for (uint32_t c = 0; c < 4; c++) {
+		for (uint32_t r = 0; r < 4; r++) {
+			vp[c][r] = _mm256_set1_ps(view_projection[c][r]);
+			l[c][r] = _mm256_set1_ps(local[c][r]);
+		}
+	}
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 two = _mm256_set1_ps(2.0f);
+
+	for (uint32_t o = 0; o < count; o += 8) {
+		uint32_t i = first + o;
+		__m256 x = _mm256_loadu_ps(&m_rotation_x[i]);
+		__m256 y = _mm256_loadu_ps(&m_rotation_y[i]);
+		__m256 z = _mm256_loadu_ps(&m_rotation_z[i]);
+		__m256 w = _mm256_loadu_ps(&m_rotation_w[i]);
+		__m256 scale_x = _mm256_loadu_ps(&m_scale_x[i]);
+		__m256 scale_y = _mm256_loadu_ps(&m_scale_y[i]);
+		__m256 scale_z = _mm256_loadu_ps(&m_scale_z[i]);
+
+		__m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+		__m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+		__m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+		__m256 affine[4][3];
+		affine[0][0] = _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(yy, zz), one), scale_x);
+		affine[0][1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), scale_x);
+		affine[0][2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), scale_x);
+		affine[1][0] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), scale_y);
+		affine[1][1] = _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, zz), one), scale_y);
+		affine[1][2] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), scale_y);
+		affine[2][0] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), scale_z);
+		affine[2][1] = _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), scale_z);
+		affine[2][2] = _mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, yy), one), scale_z);
+		affine[3][0] = _mm256_loadu_ps(&m_position_x[i]);
+		affine[3][1] = _mm256_loadu_ps(&m_position_y[i]);
+		affine[3][2] = _mm256_loadu_ps(&m_position_z[i]);
+
+		__m256 world[4][4];
+		for (uint32_t c = 0; c < 4; c++) {
+			for (uint32_t r = 0; r < 3; r++) {
+				__m256 sum = _mm256_mul_ps(affine[0][r], l[c][0]);
+				sum = _mm256_fmadd_ps(affine[1][r], l[c][1], sum);
+				sum = _mm256_fmadd_ps(affine[2][r], l[c][2], sum);
+				world[c][r] = _mm256_fmadd_ps(affine[3][r], l[c][3], sum);
+			}
+			world[c][3] = l[c][3];
+		}
+		if (world_out != nullptr) {
+			store_matrices_avx2(world, world_out + (size_t)o * world_stride, world_stride);
+		}
+
+		if (mvp_out != nullptr) {
+			__m256 mvp[4][4];
+			for (uint32_t c = 0; c < 4; c++) {
+				for (uint32_t r = 0; r < 4; r++) {
+					__m256 sum = _mm256_mul_ps(vp[0][r], world[c][0]);
+					sum = _mm256_fmadd_ps(vp[1][r], world[c][1], sum);
+					sum = _mm256_fmadd_ps(vp[2][r], world[c][2], sum);
+					mvp[c][r] = _mm256_fmadd_ps(vp[3][r], world[c][3], sum);
+				}
+			}
+			store_matrices_avx2(mvp, mvp_out + (size_t)o * mvp_stride, mvp_stride);
+		}
+	}
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Platform.h"
+#include "Simd.h"
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+
+//smaller chunks cost more in scheduling than they save
+#define TRANSFORM_STORE_MIN_OBJECTS_PER_JOB 4096
+
+class ThreadPool;
+
+//object transforms as structure of arrays, one array per component, so the kernels can load eight
+//objects' worth of any component with a single instruction
+class TransformStore {
+public:
+	TransformStore(uint32_t count = 0);
+
+	void Resize(uint32_t count);
+	uint32_t GetCount() const;
+
+	void Set(uint32_t index, const glm::vec3 & position, const glm::quat & rotation, const glm::vec3 & scale);
+	void SetPosition(uint32_t index, const glm::vec3 & position);
+	void SetRotation(uint32_t index, const glm::quat & rotation);
+	void SetScale(uint32_t index, const glm::vec3 & scale);
+	glm::vec3 GetPosition(uint32_t index) const;
+	//largest axis of the scale, for scaling bounding spheres
+	float GetMaxScale(uint32_t index) const;
+
+	//for objects [first, first + count): world = translate * rotate * scale * local, mvp = view_projection * world.
+	//local is shared by every object (the mesh's dequantisation, say). each matrix is written to out + i * stride,
+	//either output may be null, and both may point straight into mapped gpu memory
+	void Compute(SimdLevel level, const glm::mat4 & view_projection, const glm::mat4 & local, uint32_t first, uint32_t count,
+		void * world_out, uint32_t world_stride, void * mvp_out, uint32_t mvp_stride) const;
+	//the same over every object, split into chunks across the pool. blocks until done, so call it from off the pool
+	void ComputeParallel(ThreadPool * thread_pool, SimdLevel level, const glm::mat4 & view_projection, const glm::mat4 & local,
+		void * world_out, uint32_t world_stride, void * mvp_out, uint32_t mvp_stride) const;
+
+private:
+	void ComputeScalar(const glm::mat4 & view_projection, const glm::mat4 & local, uint32_t first, uint32_t count, uint8_t * world_out, uint32_t world_stride, uint8_t * mvp_out, uint32_t mvp_stride) const;
+#if SIMD_SSE2
+	void ComputeSSE2(const glm::mat4 & view_projection, const glm::mat4 & local, uint32_t first, uint32_t count, uint8_t * world_out, uint32_t world_stride, uint8_t * mvp_out, uint32_t mvp_stride) const;
+#endif
+#if SIMD_AVX2
+	SIMD_TARGET_AVX2 void ComputeAVX2(const glm::mat4 & view_projection, const glm::mat4 & local, uint32_t first, uint32_t count, uint8_t * world_out, uint32_t world_stride, uint8_t * mvp_out, uint32_t mvp_stride) const;
+#endif
+
+	uint32_t m_count;
+	std::vector<float> m_position_x;
+	std::vector<float> m_position_y;
+	std::vector<float> m_position_z;
+	std::vector<float> m_rotation_x;
+	std::vector<float> m_rotation_y;
+	std::vector<float> m_rotation_z;
+	std::vector<float> m_rotation_w;
+	std::vector<float> m_scale_x;
+	std::vector<float> m_scale_y;
+	std::vector<float> m_scale_z;
+};
\ No newline at end of file
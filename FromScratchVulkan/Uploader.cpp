@@ -0,0 +1,433 @@
+#include "Uploader.h"
+#include "Renderer.h"
+#include "Shared.h"
+#include "Trace.h"
+#include <algorithm>
+#include <string.h>
+
+Uploader::Uploader(Renderer * renderer, VkDeviceSize staging_size) :
+	m_renderer(renderer),
+	m_device(renderer->GetVulkanDevice()),
+	m_staging_buffer(VK_NULL_HANDLE),
+	m_staging_size(staging_size),
+	m_staging_head(0),
+	m_staging_tail(0),
+	m_command_pool(VK_NULL_HANDLE),
+	m_acquire_command_pool(VK_NULL_HANDLE),
+	m_next_token(1),
+	m_completed_token(0)
+{
+	//16 covers every uncompressed texel and compressed block size copies have to be aligned to
+	m_staging_alignment = m_renderer->GetVulkanPhysicalDeviceProperties().limits.optimalBufferCopyOffsetAlignment;
+	if (m_staging_alignment < 16) {
+		m_staging_alignment = 16;
+	}
+
+	m_transfer_family_index = m_renderer->GetQueueFamilyIndex(QUEUE_TRANSFER);
+	m_graphics_family_index = m_renderer->GetQueueFamilyIndex(QUEUE_GRAPHICS);
+	m_separate_queue = m_renderer->GetQueue(QUEUE_TRANSFER) != m_renderer->GetQueue(QUEUE_GRAPHICS);
+	m_ownership_transfer = m_transfer_family_index != m_graphics_family_index;
+
+	CreateStagingBuffer(m_staging_size, m_staging_buffer, m_staging_allocation);
+
+	VkCommandPoolCreateInfo pool_info{};
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.queueFamilyIndex = m_transfer_family_index;
+	pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	ErrorCheck(vkCreateCommandPool(m_device, &pool_info, VK_NULL_HANDLE, &m_command_pool));
+
+	VkCommandBuffer command_buffers[UPLOADER_MAX_BATCHES];
+	VkCommandBuffer acquire_command_buffers[UPLOADER_MAX_BATCHES];
+	VkCommandBufferAllocateInfo command_buffer_info{};
+	command_buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	command_buffer_info.commandPool = m_command_pool;
+	command_buffer_info.commandBufferCount = UPLOADER_MAX_BATCHES;
+	command_buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	ErrorCheck(vkAllocateCommandBuffers(m_device, &command_buffer_info, command_buffers));
+
+	if (m_separate_queue) {
+		pool_info.queueFamilyIndex = m_graphics_family_index;
+		ErrorCheck(vkCreateCommandPool(m_device, &pool_info, VK_NULL_HANDLE, &m_acquire_command_pool));
+		command_buffer_info.commandPool = m_acquire_command_pool;
+		ErrorCheck(vkAllocateCommandBuffers(m_device, &command_buffer_info, acquire_command_buffers));
+	}
+
+	VkFenceCreateInfo fence_create_info{};
+	fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	VkSemaphoreCreateInfo semaphore_create_info{};
+	semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	for (uint32_t i = 0; i < UPLOADER_MAX_BATCHES; i++) {
+		m_batches[i].command_buffer = command_buffers[i];
+		m_batches[i].acquire_command_buffer = m_separate_queue ? acquire_command_buffers[i] : VK_NULL_HANDLE;
+		m_batches[i].semaphore = VK_NULL_HANDLE;
+		m_batches[i].token = 0;
+		m_batches[i].staging_end = 0;
+		ErrorCheck(vkCreateFence(m_device, &fence_create_info, VK_NULL_HANDLE, &m_batches[i].fence));
+		if (m_separate_queue) {
+			ErrorCheck(vkCreateSemaphore(m_device, &semaphore_create_info, VK_NULL_HANDLE, &m_batches[i].semaphore));
+		}
+	}
+}
+
+Uploader::~Uploader() {
+	RetireUntil(m_next_token - 1);
+	//anything queued but never flushed is dropped
+	for (uint32_t i = 0; i < m_temporary_buffers.size(); i++) {
+		vkDestroyBuffer(m_device, m_temporary_buffers[i].buffer, VK_NULL_HANDLE);
+		m_renderer->GetAllocator()->Free(m_temporary_buffers[i].allocation);
+	}
+	for (uint32_t i = 0; i < UPLOADER_MAX_BATCHES; i++) {
+		vkDestroyFence(m_device, m_batches[i].fence, VK_NULL_HANDLE);
+		if (m_batches[i].semaphore != VK_NULL_HANDLE) {
+			vkDestroySemaphore(m_device, m_batches[i].semaphore, VK_NULL_HANDLE);
+		}
+	}
+	if (m_acquire_command_pool != VK_NULL_HANDLE) {
+		vkDestroyCommandPool(m_device, m_acquire_command_pool, VK_NULL_HANDLE);
+	}
+	vkDestroyCommandPool(m_device, m_command_pool, VK_NULL_HANDLE);
+	vkDestroyBuffer(m_device, m_staging_buffer, VK_NULL_HANDLE);
+	m_renderer->GetAllocator()->Free(m_staging_allocation);
+}
+
+uint64_t Uploader::UploadBuffer(VkBuffer buffer, const Allocation & allocation, VkDeviceSize offset, const void * data, VkDeviceSize size) {
+	if (allocation.mapped != nullptr) {
+		memcpy((uint8_t *)allocation.mapped + offset, data, size);
+		VkMemoryPropertyFlags flags = m_renderer->GetPhysicalDeviceMemoryProperties().memoryTypes[allocation.memory_type].propertyFlags;
+		if ((flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0) {
+			VkDeviceSize atom = m_renderer->GetVulkanPhysicalDeviceProperties().limits.nonCoherentAtomSize;
+			VkDeviceSize begin = (allocation.offset + offset) / atom * atom;
+			VkDeviceSize end = (allocation.offset + offset + size + atom - 1) / atom * atom;
+			VkMappedMemoryRange mapped_memory_range{};
+			mapped_memory_range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+			mapped_memory_range.memory = allocation.memory;
+			mapped_memory_range.offset = begin;
+			mapped_memory_range.size = end - begin;
+			ErrorCheck(vkFlushMappedMemoryRanges(m_device, 1, &mapped_memory_range));
+		}
+		//host writes are visible to every later submission, so there's nothing to wait for
+		return 0;
+	}
+
+	BufferCopy copy;
+	void * staging = AllocateStaging(size, m_staging_alignment, copy.source, copy.region.srcOffset);
+	memcpy(staging, data, size);
+	copy.destination = buffer;
+	copy.region.dstOffset = offset;
+	copy.region.size = size;
+	m_buffer_copies.push_back(copy);
+	return m_next_token;
+}
+
+uint64_t Uploader::UploadImage(VkImage image, const VkImageSubresourceRange & range, VkImageLayout final_layout, const VkBufferImageCopy * regions, uint32_t region_count, const void * data, VkDeviceSize size) {
+	ImageCopy copy;
+	VkDeviceSize staging_offset;
+	void * staging = AllocateStaging(size, m_staging_alignment, copy.source, staging_offset);
+	memcpy(staging, data, size);
+	copy.destination = image;
+	copy.range = range;
+	copy.final_layout = final_layout;
+	copy.first_region = (uint32_t)m_image_regions.size();
+	copy.region_count = region_count;
+	for (uint32_t i = 0; i < region_count; i++) {
+		m_image_regions.push_back(regions[i]);
+		m_image_regions.back().bufferOffset += staging_offset;
+	}
+	m_image_copies.push_back(copy);
+	return m_next_token;
+}
+
+uint64_t Uploader::Flush() {
+	Poll();
+	if (m_buffer_copies.empty() && m_image_copies.empty()) {
+		return m_next_token - 1;
+	}
+	TRACE_ZONE("flush uploads");
+
+	uint64_t token = m_next_token;
+	Batch & batch = m_batches[token % UPLOADER_MAX_BATCHES];
+	if (batch.token != 0) {
+		RetireUntil(batch.token);
+	}
+	ErrorCheck(vkResetFences(m_device, 1, &batch.fence));
+
+	RecordTransfer(batch);
+	VkSubmitInfo submit_info{};
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &batch.command_buffer;
+	if (!m_separate_queue) {
+		m_renderer->Submit(QUEUE_GRAPHICS, 1, &submit_info, batch.fence);
+	}
+	else {
+		submit_info.signalSemaphoreCount = 1;
+		submit_info.pSignalSemaphores = &batch.semaphore;
+		m_renderer->Submit(QUEUE_TRANSFER, 1, &submit_info, VK_NULL_HANDLE);
+
+		//graphics work submitted after this waits for the copies, and the fence only fires once
+		//the destinations belong to the graphics family
+		RecordAcquire(batch);
+		VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		VkSubmitInfo acquire_submit_info{};
+		acquire_submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		acquire_submit_info.waitSemaphoreCount = 1;
+		acquire_submit_info.pWaitSemaphores = &batch.semaphore;
+		acquire_submit_info.pWaitDstStageMask = &wait_stage;
+		acquire_submit_info.commandBufferCount = 1;
+		acquire_submit_info.pCommandBuffers = &batch.acquire_command_buffer;
+		m_renderer->Submit(QUEUE_GRAPHICS, 1, &acquire_submit_info, batch.fence);
+	}
+
+	batch.token = token;
+	batch.staging_end = m_staging_head;
+	batch.temporary_buffers.swap(m_temporary_buffers);
+	m_buffer_copies.clear();
+	m_image_copies.clear();
+	m_image_regions.clear();
+	m_next_token++;
+	return token;
+}
+
+bool Uploader::IsComplete(uint64_t token) {
+	Poll();
+	return token <= m_completed_token;
+}
+
+void Uploader::Wait(uint64_t token) {
+	if (token >= m_next_token) {
+		Flush();
+	}
+	RetireUntil(token);
+}
+
+void Uploader::CreateStagingBuffer(VkDeviceSize size, VkBuffer & buffer, Allocation & allocation) {
+	//copies into buffers the graphics family already owns read staging from the graphics queue as well
+	uint32_t family_indices[2] = { m_transfer_family_index, m_graphics_family_index };
+	VkBufferCreateInfo buffer_create_info{};
+	buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_create_info.pNext = VK_NULL_HANDLE;
+	buffer_create_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	buffer_create_info.size = size;
+	if (m_ownership_transfer) {
+		buffer_create_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		buffer_create_info.queueFamilyIndexCount = 2;
+		buffer_create_info.pQueueFamilyIndices = family_indices;
+	}
+	else {
+		buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	}
+	ErrorCheck(vkCreateBuffer(m_device, &buffer_create_info, VK_NULL_HANDLE, &buffer));
+	allocation = m_renderer->GetAllocator()->AllocateForBuffer(buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0);
+}
+
+void Uploader::RecordBufferCopies(VkCommandBuffer command_buffer, const std::vector<BufferCopy> & copies) {
+	//neighbouring copies between the same pair of buffers go out as one command
+	std::vector<VkBufferCopy> regions;
+	for (uint32_t i = 0; i < copies.size(); i++) {
+		regions.push_back(copies[i].region);
+		if (i + 1 == copies.size() || copies[i + 1].source != copies[i].source || copies[i + 1].destination != copies[i].destination) {
+			vkCmdCopyBuffer(command_buffer, copies[i].source, copies[i].destination, (uint32_t)regions.size(), regions.data());
+			regions.clear();
+		}
+	}
+}
+
+void Uploader::RecordTransfer(Batch & batch) {
+	//a buffer released to the graphics family earlier would need releasing back before the transfer queue could
+	//touch it again, so its copies are left for RecordAcquire to record on the graphics queue instead
+	if (m_ownership_transfer) {
+		std::vector<BufferCopy> transfer_copies;
+		for (uint32_t i = 0; i < m_buffer_copies.size(); i++) {
+			if (m_graphics_buffers.count(m_buffer_copies[i].destination) != 0) {
+				m_graphics_buffer_copies.push_back(m_buffer_copies[i]);
+			}
+			else {
+				transfer_copies.push_back(m_buffer_copies[i]);
+			}
+		}
+		m_buffer_copies.swap(transfer_copies);
+	}
+
+	VkCommandBufferBeginInfo command_buffer_begin_info{};
+	command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	ErrorCheck(vkBeginCommandBuffer(batch.command_buffer, &command_buffer_begin_info));
+
+	//the old contents are thrown away, so no ownership is needed for the first transition
+	std::vector<VkImageMemoryBarrier> image_barriers(m_image_copies.size());
+	for (uint32_t i = 0; i < m_image_copies.size(); i++) {
+		image_barriers[i] = {};
+		image_barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		image_barriers[i].srcAccessMask = 0;
+		image_barriers[i].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		image_barriers[i].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		image_barriers[i].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		image_barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		image_barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		image_barriers[i].image = m_image_copies[i].destination;
+		image_barriers[i].subresourceRange = m_image_copies[i].range;
+	}
+	if (!image_barriers.empty()) {
+		vkCmdPipelineBarrier(batch.command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, VK_NULL_HANDLE, 0, VK_NULL_HANDLE, (uint32_t)image_barriers.size(), image_barriers.data());
+	}
+
+	RecordBufferCopies(batch.command_buffer, m_buffer_copies);
+	for (uint32_t i = 0; i < m_image_copies.size(); i++) {
+		vkCmdCopyBufferToImage(batch.command_buffer, m_image_copies[i].source, m_image_copies[i].destination, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_image_copies[i].region_count, &m_image_regions[m_image_copies[i].first_region]);
+	}
+
+	for (uint32_t i = 0; i < m_image_copies.size(); i++) {
+		image_barriers[i].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		image_barriers[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+		image_barriers[i].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		image_barriers[i].newLayout = m_image_copies[i].final_layout;
+	}
+
+	if (!m_ownership_transfer) {
+		//make the writes visible to whatever reads them in later submissions on the graphics queue
+		VkMemoryBarrier memory_barrier{};
+		memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		memory_barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT |
+			VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(batch.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &memory_barrier, 0, VK_NULL_HANDLE, (uint32_t)image_barriers.size(), image_barriers.data());
+	}
+	else {
+		//release half of the ownership transfer; the acquire half in RecordAcquire must match it exactly
+		std::vector<VkBufferMemoryBarrier> buffer_barriers;
+		std::vector<VkBuffer> buffers;
+		for (uint32_t i = 0; i < m_buffer_copies.size(); i++) {
+			buffers.push_back(m_buffer_copies[i].destination);
+		}
+		std::sort(buffers.begin(), buffers.end());
+		buffers.erase(std::unique(buffers.begin(), buffers.end()), buffers.end());
+		for (uint32_t i = 0; i < buffers.size(); i++) {
+			VkBufferMemoryBarrier buffer_barrier{};
+			buffer_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			buffer_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			buffer_barrier.dstAccessMask = 0;
+			buffer_barrier.srcQueueFamilyIndex = m_transfer_family_index;
+			buffer_barrier.dstQueueFamilyIndex = m_graphics_family_index;
+			buffer_barrier.buffer = buffers[i];
+			buffer_barrier.offset = 0;
+			buffer_barrier.size = VK_WHOLE_SIZE;
+			buffer_barriers.push_back(buffer_barrier);
+			m_graphics_buffers.insert(buffers[i]);
+		}
+		for (uint32_t i = 0; i < image_barriers.size(); i++) {
+			image_barriers[i].dstAccessMask = 0;
+			image_barriers[i].srcQueueFamilyIndex = m_transfer_family_index;
+			image_barriers[i].dstQueueFamilyIndex = m_graphics_family_index;
+		}
+		vkCmdPipelineBarrier(batch.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, VK_NULL_HANDLE, (uint32_t)buffer_barriers.size(), buffer_barriers.data(), (uint32_t)image_barriers.size(), image_barriers.data());
+		m_release_buffer_barriers.swap(buffer_barriers);
+		m_release_image_barriers.swap(image_barriers);
+	}
+
+	ErrorCheck(vkEndCommandBuffer(batch.command_buffer));
+}
+
+void Uploader::RecordAcquire(Batch & batch) {
+	VkCommandBufferBeginInfo command_buffer_begin_info{};
+	command_buffer_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	command_buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	ErrorCheck(vkBeginCommandBuffer(batch.acquire_command_buffer, &command_buffer_begin_info));
+
+	//same queue family on a different queue: the semaphore alone orders and publishes the writes
+	if (m_ownership_transfer) {
+		for (uint32_t i = 0; i < m_release_buffer_barriers.size(); i++) {
+			m_release_buffer_barriers[i].srcAccessMask = 0;
+			m_release_buffer_barriers[i].dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT |
+				VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+		}
+		for (uint32_t i = 0; i < m_release_image_barriers.size(); i++) {
+			m_release_image_barriers[i].srcAccessMask = 0;
+			m_release_image_barriers[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+		}
+		vkCmdPipelineBarrier(batch.acquire_command_buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, VK_NULL_HANDLE,
+			(uint32_t)m_release_buffer_barriers.size(), m_release_buffer_barriers.data(), (uint32_t)m_release_image_barriers.size(), m_release_image_barriers.data());
+		m_release_buffer_barriers.clear();
+		m_release_image_barriers.clear();
+
+		if (!m_graphics_buffer_copies.empty()) {
+			RecordBufferCopies(batch.acquire_command_buffer, m_graphics_buffer_copies);
+			VkMemoryBarrier memory_barrier{};
+			memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			memory_barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT |
+				VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+			vkCmdPipelineBarrier(batch.acquire_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &memory_barrier, 0, VK_NULL_HANDLE, 0, VK_NULL_HANDLE);
+			m_graphics_buffer_copies.clear();
+		}
+	}
+
+	ErrorCheck(vkEndCommandBuffer(batch.acquire_command_buffer));
+}
+
+void * Uploader::AllocateStaging(VkDeviceSize size, VkDeviceSize alignment, VkBuffer & buffer, VkDeviceSize & offset) {
+	//bigger than the whole ring: give it a buffer of its own that goes away with its batch
+	if (size > m_staging_size) {
+		TemporaryBuffer temporary;
+		CreateStagingBuffer(size, temporary.buffer, temporary.allocation);
+		m_temporary_buffers.push_back(temporary);
+		buffer = temporary.buffer;
+		offset = 0;
+		return temporary.allocation.mapped;
+	}
+
+	uint64_t start = (m_staging_head + alignment - 1) / alignment * alignment;
+	if (start % m_staging_size + size > m_staging_size) {
+		start = (start / m_staging_size + 1) * m_staging_size;
+	}
+	if (start + size - m_staging_tail > m_staging_size) {
+		Poll();
+	}
+	if (start + size - m_staging_tail > m_staging_size) {
+		//the unflushed copies own the space up to the head, so they have to go out before it can be reclaimed
+		Flush();
+		while (start + size - m_staging_tail > m_staging_size && m_completed_token + 1 < m_next_token) {
+			RetireUntil(m_completed_token + 1);
+		}
+		if (m_staging_tail == m_staging_head) {
+			//nothing in flight, start again at the beginning of a lap
+			m_staging_tail = m_staging_head = (m_staging_head + m_staging_size - 1) / m_staging_size * m_staging_size;
+			start = m_staging_head;
+		}
+	}
+
+	m_staging_head = start + size;
+	buffer = m_staging_buffer;
+	offset = start % m_staging_size;
+	return (uint8_t *)m_staging_allocation.mapped + offset;
+}
+
+void Uploader::RetireBatch(Batch & batch) {
+	if (batch.staging_end > m_staging_tail) {
+		m_staging_tail = batch.staging_end;
+	}
+	for (uint32_t i = 0; i < batch.temporary_buffers.size(); i++) {
+		vkDestroyBuffer(m_device, batch.temporary_buffers[i].buffer, VK_NULL_HANDLE);
+		m_renderer->GetAllocator()->Free(batch.temporary_buffers[i].allocation);
+	}
+	batch.temporary_buffers.clear();
+	m_completed_token = batch.token;
+	batch.token = 0;
+}
+
+void Uploader::RetireUntil(uint64_t token) {
+	while (m_completed_token < token && m_completed_token + 1 < m_next_token) {
+		Batch & batch = m_batches[(m_completed_token + 1) % UPLOADER_MAX_BATCHES];
+		ErrorCheck(vkWaitForFences(m_device, 1, &batch.fence, VK_TRUE, UINT64_MAX));
+		RetireBatch(batch);
+	}
+}
+
+void Uploader::Poll() {
+	while (m_completed_token + 1 < m_next_token) {
+		Batch & batch = m_batches[(m_completed_token + 1) % UPLOADER_MAX_BATCHES];
+		if (vkGetFenceStatus(m_device, batch.fence) != VK_SUCCESS) {
+			break;
+		}
+		RetireBatch(batch);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Platform.h"
+#include "Allocator.h"
+#include <unordered_set>
+#include <vector>
+
+#define UPLOADER_DEFAULT_STAGING_SIZE (32 * 1024 * 1024)
+#define UPLOADER_MAX_BATCHES 4
+//memory flags for resources that will be filled through the uploader
+#define UPLOADER_MEMORY_REQUIRED VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+#define UPLOADER_MEMORY_PREFERRED (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+
+class Renderer;
+
+//moves data into device local buffers and images. copies are queued into a staging ring and
+//recorded together into one command buffer per Flush(), and every upload returns a token that
+//can be polled or waited on to know when the data is resident.
+//copies go out on the transfer queue; when that is a separate dma family the destinations are
+//released to the graphics family and acquired there behind a semaphore before the token completes.
+//later copies into a buffer the graphics family already owns are recorded on the graphics queue.
+//destinations that are host visible (integrated gpus, resizable BAR) are written directly.
+//the destination range must not be in use by the gpu while it is being uploaded to
+class Uploader {
+public:
+	Uploader(Renderer * renderer, VkDeviceSize staging_size = UPLOADER_DEFAULT_STAGING_SIZE);
+	~Uploader();
+
+	uint64_t UploadBuffer(VkBuffer buffer, const Allocation & allocation, VkDeviceSize offset, const void * data, VkDeviceSize size);
+	//region buffer offsets are relative to data; the image ends up in final_layout
+	uint64_t UploadImage(VkImage image, const VkImageSubresourceRange & range, VkImageLayout final_layout, const VkBufferImageCopy * regions, uint32_t region_count, const void * data, VkDeviceSize size);
+
+	//submits everything queued since the last flush in one go
+	uint64_t Flush();
+	bool IsComplete(uint64_t token);
+	void Wait(uint64_t token);
+private:
+	struct BufferCopy {
+		VkBuffer source;
+		VkBuffer destination;
+		VkBufferCopy region;
+	};
+
+	struct ImageCopy {
+		VkBuffer source;
+		VkImage destination;
+		VkImageSubresourceRange range;
+		VkImageLayout final_layout;
+		uint32_t first_region;
+		uint32_t region_count;
+	};
+
+	struct TemporaryBuffer {
+		VkBuffer buffer;
+		Allocation allocation;
+	};
+
+	struct Batch {
+		VkCommandBuffer command_buffer;
+		VkCommandBuffer acquire_command_buffer;
+		VkSemaphore semaphore;
+		VkFence fence;
+		uint64_t token;
+		uint64_t staging_end;
+		std::vector<TemporaryBuffer> temporary_buffers;
+	};
+
+	void CreateStagingBuffer(VkDeviceSize size, VkBuffer & buffer, Allocation & allocation);
+	void RecordBufferCopies(VkCommandBuffer command_buffer, const std::vector<BufferCopy> & copies);
+	void RecordTransfer(Batch & batch);
+	void RecordAcquire(Batch & batch);
+	void * AllocateStaging(VkDeviceSize size, VkDeviceSize alignment, VkBuffer & buffer, VkDeviceSize & offset);
+	void RetireBatch(Batch & batch);
+	void RetireUntil(uint64_t token);
+	void Poll();
+
+	Renderer * m_renderer;
+	VkDevice m_device;
+
+	VkBuffer m_staging_buffer;
+	Allocation m_staging_allocation;
+	VkDeviceSize m_staging_size;
+	VkDeviceSize m_staging_alignment;
+	uint64_t m_staging_head;
+	uint64_t m_staging_tail;
+
+	//the acquire side only exists when transfer and graphics are different queues
+	bool m_separate_queue;
+	bool m_ownership_transfer;
+	uint32_t m_transfer_family_index;
+	uint32_t m_graphics_family_index;
+	VkCommandPool m_command_pool;
+	VkCommandPool m_acquire_command_pool;
+	Batch m_batches[UPLOADER_MAX_BATCHES];
+
+	//the batch being filled has token m_next_token, everything up to m_completed_token is resident
+	uint64_t m_next_token;
+	uint64_t m_completed_token;
+
+	std::vector<BufferCopy> m_buffer_copies;
+	std::vector<ImageCopy> m_image_copies;
+	std::vector<VkBufferImageCopy> m_image_regions;
+	std::vector<TemporaryBuffer> m_temporary_buffers;
+	std::vector<VkBufferMemoryBarrier> m_release_buffer_barriers;
+	std::vector<VkImageMemoryBarrier> m_release_image_barriers;
+	//buffers whose ownership has gone to the graphics family. a destroyed buffer's handle may stay in here, which is
+	//harmless: a new buffer with the same handle can be written from the graphics queue just the same
+	std::unordered_set<VkBuffer> m_graphics_buffers;
+	std::vector<BufferCopy> m_graphics_buffer_copies;
+};
\ No newline at end of file
@@ -0,0 +1,331 @@
+#include "VertexFormat.h"
+#include "Simd.h"
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+#define VERTEX_SNORM16_MAX 32767.0f
+//keeps zero length normals and flat mesh axes from dividing by zero
+#define VERTEX_MIN_EXTENT 1e-20f
+
+struct VertexOffsets {
+	uint32_t colour;
+	uint32_t normal;
+	uint32_t uv;
+	uint32_t stride;
+};
+
+static VertexOffsets get_offsets(const VertexLayout & layout) {
+	VertexOffsets offsets;
+	offsets.stride = layout.position == VERTEX_POSITION_FLOAT ? sizeof(float) * 3 : sizeof(uint16_t) * 4;
+	offsets.colour = offsets.stride;
+	offsets.stride += layout.colour ? sizeof(uint8_t) * 4 : 0;
+	offsets.normal = offsets.stride;
+	offsets.stride += layout.normal ? sizeof(int16_t) * 2 : 0;
+	offsets.uv = offsets.stride;
+	offsets.stride += layout.uv ? sizeof(uint16_t) * 2 : 0;
+	return offsets;
+}
+
+//round to nearest even, with the same bit tricks as the sse2 version below so both agree exactly
+static uint16_t float_to_half(float value) {
+	uint32_t f;
+	memcpy(&f, &value, sizeof(f));
+	uint32_t sign = f & 0x80000000u;
+	f ^= sign;
+
+	uint16_t result;
+	if (f >= (uint32_t)(127 + 16) << 23) {
+		//too big for a half, or inf/nan
+		result = f > 0x7f800000u ? 0x7e00 : 0x7c00;
+	} else if (f < (uint32_t)(127 - 14) << 23) {
+		//the result is subnormal, let the fpu do the rounding by adding a magic number
+		uint32_t magic_bits = (uint32_t)((127 - 15) + (23 - 10) + 1) << 23;
+		float magic;
+		memcpy(&magic, &magic_bits, sizeof(magic));
+		float absolute;
+		memcpy(&absolute, &f, sizeof(absolute));
+		absolute += magic;
+		uint32_t rounded;
+		memcpy(&rounded, &absolute, sizeof(rounded));
+		result = (uint16_t)(rounded - magic_bits);
+	} else {
+		uint32_t mantissa_odd = (f >> 13) & 1;
+		f += (uint32_t)(15 - 127) << 23;
+		f += 0xfff + mantissa_odd;
+		result = (uint16_t)(f >> 13);
+	}
+	return result | (uint16_t)(sign >> 16);
+}
+
+static int16_t float_to_snorm16(float value) {
+	value = std::max(std::min(value, 1.0f), -1.0f);
+	return (int16_t)std::nearbyint(value * VERTEX_SNORM16_MAX);
+}
+
+static uint8_t float_to_unorm8(float value) {
+	value = std::max(std::min(value * 255.0f, 255.0f), 0.0f);
+	return (uint8_t)std::nearbyint(value);
+}
+
+//projects the normal onto the octahedron |x| + |y| + |z| = 1 and folds the lower half over the upper one
+static void oct_encode(const glm::vec3 & normal, float & x, float & y) {
+	float inverse_length = 1.0f / std::max(std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z), VERTEX_MIN_EXTENT);
+	x = normal.x * inverse_length;
+	y = normal.y * inverse_length;
+	if (normal.z < 0.0f) {
+		float folded_x = (1.0f - std::fabs(y)) * std::copysign(1.0f, x);
+		float folded_y = (1.0f - std::fabs(x)) * std::copysign(1.0f, y);
+		x = folded_x;
+		y = folded_y;
+	}
+}
+
+static glm::vec3 get_inverse_scale(const VertexQuantization & quantization) {
+	return glm::vec3(1.0f / quantization.scale.x, 1.0f / quantization.scale.y, 1.0f / quantization.scale.z);
+}
+
+static void encode_scalar(const VertexLayout & layout, const VertexStreams & streams, uint32_t first, uint32_t count, const VertexQuantization & quantization, uint8_t * out) {
+	VertexOffsets offsets = get_offsets(layout);
+	glm::vec3 inverse_scale = get_inverse_scale(quantization);
+
+	for (uint32_t i = first; i < first + count; i++) {
+		uint8_t * vertex = out + (size_t)i * offsets.stride;
+
+		const glm::vec3 & position = streams.positions[i];
+		if (layout.position == VERTEX_POSITION_FLOAT) {
+			memcpy(vertex, &position, sizeof(float) * 3);
+		} else {
+			uint16_t encoded[4];
+			for (uint32_t c = 0; c < 3; c++) {
+				float value = (position[c] - quantization.offset[c]) * inverse_scale[c];
+				encoded[c] = layout.position == VERTEX_POSITION_HALF ? float_to_half(value) : (uint16_t)float_to_snorm16(value);
+			}
+			//w reads back as 1 in the shader
+			encoded[3] = layout.position == VERTEX_POSITION_HALF ? float_to_half(1.0f) : (uint16_t)float_to_snorm16(1.0f);
+			memcpy(vertex, encoded, sizeof(encoded));
+		}
+
+		if (layout.colour) {
+			const glm::vec3 & colour = streams.colours[i];
+			uint8_t encoded[4] = { float_to_unorm8(colour.x), float_to_unorm8(colour.y), float_to_unorm8(colour.z), float_to_unorm8(1.0f) };
+			memcpy(vertex + offsets.colour, encoded, sizeof(encoded));
+		}
+
+		if (layout.normal) {
+			float x, y;
+			oct_encode(streams.normals[i], x, y);
+			int16_t encoded[2] = { float_to_snorm16(x), float_to_snorm16(y) };
+			memcpy(vertex + offsets.normal, encoded, sizeof(encoded));
+		}
+
+		if (layout.uv) {
+			uint16_t encoded[2] = { float_to_half(streams.uvs[i].x), float_to_half(streams.uvs[i].y) };
+			memcpy(vertex + offsets.uv, encoded, sizeof(encoded));
+		}
+	}
+}
+
+#if SIMD_SSE2
+
+//four floats to four halves in the low 16 bits of each lane, sign extended so _mm_packs_epi32 keeps them intact
+static __m128i float_to_half_sse2(__m128 value) {
+	const __m128i sign_mask = _mm_set1_epi32(0x80000000u);
+	const __m128i half_max = _mm_set1_epi32((127 + 16) << 23);
+	const __m128i infinity = _mm_set1_epi32(0x7f800000);
+	const __m128i half_infinity = _mm_set1_epi32(0x7c00);
+	const __m128i half_nan_bit = _mm_set1_epi32(0x200);
+	const __m128i min_normal = _mm_set1_epi32((127 - 14) << 23);
+	const __m128i subnormal_magic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+	const __m128i normal_bias = _mm_set1_epi32((int)(0xfffu - ((127u - 15u) << 23)));
+
+	__m128 sign = _mm_and_ps(value, _mm_castsi128_ps(sign_mask));
+	__m128 absolute = _mm_xor_ps(value, sign);
+	__m128i absolute_bits = _mm_castps_si128(absolute);
+
+	__m128i is_nan = _mm_cmpgt_epi32(absolute_bits, infinity);
+	__m128i is_regular = _mm_cmpgt_epi32(half_max, absolute_bits);
+	__m128i is_subnormal = _mm_cmpgt_epi32(min_normal, absolute_bits);
+	__m128i special = _mm_or_si128(half_infinity, _mm_and_si128(is_nan, half_nan_bit));
+
+	__m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absolute, _mm_castsi128_ps(subnormal_magic))), subnormal_magic);
+
+	__m128i mantissa_odd = _mm_and_si128(_mm_srli_epi32(absolute_bits, 13), _mm_set1_epi32(1));
+	__m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(absolute_bits, normal_bias), mantissa_odd), 13);
+
+	__m128i result = _mm_or_si128(_mm_and_si128(is_subnormal, subnormal), _mm_andnot_si128(is_subnormal, normal));
+	result = _mm_or_si128(_mm_and_si128(is_regular, result), _mm_andnot_si128(is_regular, special));
+	return _mm_or_si128(result, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+}
+
+static __m128i float_to_snorm16_sse2(__m128 value) {
+	value = _mm_max_ps(_mm_min_ps(value, _mm_set1_ps(1.0f)), _mm_set1_ps(-1.0f));
+	return _mm_cvtps_epi32(_mm_mul_ps(value, _mm_set1_ps(VERTEX_SNORM16_MAX)));
+}
+
+//writes the four 32 bit lanes to four consecutive vertices
+static void store_lanes32(__m128i lanes, uint8_t * out, uint32_t stride) {
+	for (uint32_t i = 0; i < 4; i++) {
+		int32_t lane = _mm_cvtsi128_si32(lanes);
+		memcpy(out + i * stride, &lane, sizeof(lane));
+		lanes = _mm_srli_si128(lanes, 4);
+	}
+}
+
+//writes the two 64 bit halves to two consecutive vertices
+static void store_lanes64(__m128i lanes, uint8_t * out, uint32_t stride) {
+	_mm_storel_epi64((__m128i *)out, lanes);
+	_mm_storel_epi64((__m128i *)(out + stride), _mm_unpackhi_epi64(lanes, lanes));
+}
+
+static void encode_sse2(const VertexLayout & layout, const VertexStreams & streams, uint32_t count, const VertexQuantization & quantization, uint8_t * out) {
+	VertexOffsets offsets = get_offsets(layout);
+	glm::vec3 inverse_scale = get_inverse_scale(quantization);
+	//w passes through as 1 so the shader sees a homogeneous position
+	const __m128 position_offset = _mm_setr_ps(quantization.offset.x, quantization.offset.y, quantization.offset.z, 0.0f);
+	const __m128 position_scale = _mm_setr_ps(inverse_scale.x, inverse_scale.y, inverse_scale.z, 1.0f);
+
+	uint32_t block_count = count / 4 * 4;
+	for (uint32_t i = 0; i < block_count; i += 4) {
+		uint8_t * vertex = out + (size_t)i * offsets.stride;
+
+		//aos: one vertex per register
+		if (layout.position == VERTEX_POSITION_FLOAT) {
+			for (uint32_t j = 0; j < 4; j++) {
+				memcpy(vertex + j * offsets.stride, &streams.positions[i + j], sizeof(float) * 3);
+			}
+		} else {
+			__m128i encoded[4];
+			for (uint32_t j = 0; j < 4; j++) {
+				const glm::vec3 & position = streams.positions[i + j];
+				__m128 value = _mm_mul_ps(_mm_sub_ps(_mm_setr_ps(position.x, position.y, position.z, 1.0f), position_offset), position_scale);
+				encoded[j] = layout.position == VERTEX_POSITION_HALF ? float_to_half_sse2(value) : float_to_snorm16_sse2(value);
+			}
+			store_lanes64(_mm_packs_epi32(encoded[0], encoded[1]), vertex, offsets.stride);
+			store_lanes64(_mm_packs_epi32(encoded[2], encoded[3]), vertex + 2 * offsets.stride, offsets.stride);
+		}
+
+		if (layout.colour) {
+			__m128i encoded[4];
+			for (uint32_t j = 0; j < 4; j++) {
+				const glm::vec3 & colour = streams.colours[i + j];
+				__m128 value = _mm_mul_ps(_mm_setr_ps(colour.x, colour.y, colour.z, 1.0f), _mm_set1_ps(255.0f));
+				value = _mm_max_ps(_mm_min_ps(value, _mm_set1_ps(255.0f)), _mm_setzero_ps());
+				encoded[j] = _mm_cvtps_epi32(value);
+			}
+			__m128i packed = _mm_packus_epi16(_mm_packs_epi32(encoded[0], encoded[1]), _mm_packs_epi32(encoded[2], encoded[3]));
+			store_lanes32(packed, vertex + offsets.colour, offsets.stride);
+		}
+
+		//soa: one component of four vertices per register
+		if (layout.normal) {
+			const glm::vec3 * normals = &streams.normals[i];
+			__m128 x = _mm_setr_ps(normals[0].x, normals[1].x, normals[2].x, normals[3].x);
+			__m128 y = _mm_setr_ps(normals[0].y, normals[1].y, normals[2].y, normals[3].y);
+			__m128 z = _mm_setr_ps(normals[0].z, normals[1].z, normals[2].z, normals[3].z);
+			const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000u));
+			const __m128 one = _mm_set1_ps(1.0f);
+
+			__m128 length = _mm_add_ps(_mm_add_ps(_mm_andnot_ps(sign_mask, x), _mm_andnot_ps(sign_mask, y)), _mm_andnot_ps(sign_mask, z));
+			__m128 inverse_length = _mm_div_ps(one, _mm_max_ps(length, _mm_set1_ps(VERTEX_MIN_EXTENT)));
+			x = _mm_mul_ps(x, inverse_length);
+			y = _mm_mul_ps(y, inverse_length);
+
+			__m128 folded_x = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(sign_mask, y)), _mm_or_ps(one, _mm_and_ps(sign_mask, x)));
+			__m128 folded_y = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(sign_mask, x)), _mm_or_ps(one, _mm_and_ps(sign_mask, y)));
+			__m128 lower = _mm_cmplt_ps(z, _mm_setzero_ps());
+			x = _mm_or_ps(_mm_and_ps(lower, folded_x), _mm_andnot_ps(lower, x));
+			y = _mm_or_ps(_mm_and_ps(lower, folded_y), _mm_andnot_ps(lower, y));
+
+			__m128i encoded_x = float_to_snorm16_sse2(x);
+			__m128i encoded_y = float_to_snorm16_sse2(y);
+			__m128i packed = _mm_packs_epi32(_mm_unpacklo_epi32(encoded_x, encoded_y), _mm_unpackhi_epi32(encoded_x, encoded_y));
+			store_lanes32(packed, vertex + offsets.normal, offsets.stride);
+		}
+
+		if (layout.uv) {
+			const glm::vec2 * uvs = &streams.uvs[i];
+			__m128i first = float_to_half_sse2(_mm_setr_ps(uvs[0].x, uvs[0].y, uvs[1].x, uvs[1].y));
+			__m128i second = float_to_half_sse2(_mm_setr_ps(uvs[2].x, uvs[2].y, uvs[3].x, uvs[3].y));
+			store_lanes32(_mm_packs_epi32(first, second), vertex + offsets.uv, offsets.stride);
+		}
+	}
+
+	encode_scalar(layout, streams, block_count, count - block_count, quantization, out);
+}
+
+#endif
+
+uint32_t VertexFormat::GetStride(const VertexLayout & layout) {
+	return get_offsets(layout).stride;
+}
+
+uint32_t VertexFormat::GetAttributes(const VertexLayout & layout, uint32_t binding, uint32_t first_location, VkVertexInputAttributeDescription * attributes) {
+	VertexOffsets offsets = get_offsets(layout);
+	uint32_t count = 0;
+
+	const VkFormat position_formats[] = { VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT, VK_FORMAT_R16G16B16A16_SNORM };
+	attributes[count].binding = binding;
+	attributes[count].location = first_location + count;
+	attributes[count].format = position_formats[layout.position];
+	attributes[count].offset = 0;
+	count++;
+
+	if (layout.colour) {
+		attributes[count].binding = binding;
+		attributes[count].location = first_location + count;
+		attributes[count].format = VK_FORMAT_R8G8B8A8_UNORM;
+		attributes[count].offset = offsets.colour;
+		count++;
+	}
+	if (layout.normal) {
+		attributes[count].binding = binding;
+		attributes[count].location = first_location + count;
+		attributes[count].format = VK_FORMAT_R16G16_SNORM;
+		attributes[count].offset = offsets.normal;
+		count++;
+	}
+	if (layout.uv) {
+		attributes[count].binding = binding;
+		attributes[count].location = first_location + count;
+		attributes[count].format = VK_FORMAT_R16G16_SFLOAT;
+		attributes[count].offset = offsets.uv;
+		count++;
+	}
+	return count;
+}
+
+VertexQuantization VertexFormat::ComputeQuantization(const VertexLayout & layout, const glm::vec3 * positions, uint32_t count) {
+	VertexQuantization quantization;
+	quantization.offset = glm::vec3(0.0f);
+	quantization.scale = glm::vec3(1.0f);
+	if (layout.position != VERTEX_POSITION_SNORM16 || count == 0) {
+		return quantization;
+	}
+
+	glm::vec3 minimum = positions[0];
+	glm::vec3 maximum = positions[0];
+	for (uint32_t i = 1; i < count; i++) {
+		minimum = glm::min(minimum, positions[i]);
+		maximum = glm::max(maximum, positions[i]);
+	}
+	quantization.offset = (minimum + maximum) * 0.5f;
+	quantization.scale = glm::max((maximum - minimum) * 0.5f, glm::vec3(VERTEX_MIN_EXTENT));
+	return quantization;
+}
+
+glm::mat4 VertexFormat::GetDequantizationMatrix(const VertexQuantization & quantization) {
+	return glm::scale(glm::translate(glm::mat4(1.0f), quantization.offset), quantization.scale);
+}
+
+void VertexFormat::Encode(const VertexLayout & layout, const VertexStreams & streams, uint32_t count, const VertexQuantization & quantization, void * out) {
+#if SIMD_SSE2
+	encode_sse2(layout, streams, count, quantization, (uint8_t *)out);
+#else
+	encode_scalar(layout, streams, 0, count, quantization, (uint8_t *)out);
+#endif
+}
+
+void VertexFormat::EncodeScalar(const VertexLayout & layout, const VertexStreams & streams, uint32_t count, const VertexQuantization & quantization, void * out) {
+	encode_scalar(layout, streams, 0, count, quantization, (uint8_t *)out);
+}
\ No newline at end of file
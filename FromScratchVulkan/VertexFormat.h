@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Platform.h"
+
+//position, colour, normal, uv
+#define VERTEX_LAYOUT_MAX_ATTRIBUTES 4
+
+enum VertexPositionEncoding {
+	//R32G32B32_SFLOAT, 12 bytes
+	VERTEX_POSITION_FLOAT = 0,
+	//R16G16B16A16_SFLOAT, 8 bytes. exact for small integer grids, loses precision far from the origin
+	VERTEX_POSITION_HALF = 1,
+	//R16G16B16A16_SNORM, 8 bytes. uniform precision over the mesh bounds, needs the mesh's VertexQuantization to decode
+	VERTEX_POSITION_SNORM16 = 2
+};
+
+//attributes are interleaved in this order and get consecutive shader locations
+struct VertexLayout {
+	VertexPositionEncoding position;
+	//R8G8B8A8_UNORM
+	bool colour;
+	//octahedral R16G16_SNORM, decoded in the shader
+	bool normal;
+	//R16G16_SFLOAT
+	bool uv;
+};
+
+//snorm16 positions decode to [-1, 1]; position = decoded * scale + offset. the other encodings leave it at identity
+struct VertexQuantization {
+	glm::vec3 offset;
+	glm::vec3 scale;
+};
+
+//unpacked input, one array per attribute. the ones the layout doesn't use may be null
+struct VertexStreams {
+	const glm::vec3 * positions;
+	const glm::vec3 * colours;
+	const glm::vec3 * normals;
+	const glm::vec2 * uvs;
+};
+
+namespace VertexFormat {
+	uint32_t GetStride(const VertexLayout & layout);
+	//fills in one description per attribute the layout has, from first_location up, and returns how many
+	uint32_t GetAttributes(const VertexLayout & layout, uint32_t binding, uint32_t first_location, VkVertexInputAttributeDescription * attributes);
+
+	//the bounds of the positions, so snorm16 spends its precision on the mesh rather than on a fixed range
+	VertexQuantization ComputeQuantization(const VertexLayout & layout, const glm::vec3 * positions, uint32_t count);
+	//folded into the model matrix so the shader reads quantised positions as if they were floats
+	glm::mat4 GetDequantizationMatrix(const VertexQuantization & quantization);
+
+	//writes count interleaved vertices of stride GetStride(layout) to out, four at a time with sse2 where it is available
+	void Encode(const VertexLayout & layout, const VertexStreams & streams, uint32_t count, const VertexQuantization & quantization, void * out);
+	//reference version, same output bit for bit
+	void EncodeScalar(const VertexLayout & layout, const VertexStreams & streams, uint32_t count, const VertexQuantization & quantization, void * out);
+}
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "Renderer.h"
 #include <assert.h>
 #include "Shared.h"
+#include "Trace.h"
 
 Window::Window(Renderer * renderer, uint32_t size_x, uint32_t size_y, std::string name) :
 	m_surface_size_x(size_x),
@@ -34,10 +35,49 @@ void Window::Close() {
 }
 
 bool Window::Update() {
+	TRACE_ZONE("pump events");
 	UpdateOSWindow();
 	return m_running;
 }
 
+bool Window::AcquireImage(VkSemaphore image_acquired_semaphore, uint32_t & image_index) {
+	TRACE_ZONE("acquire");
+	ErrorCheck(vkAcquireNextImageKHR(m_renderer->GetVulkanDevice(), m_swapchain, UINT64_MAX, image_acquired_semaphore, VK_NULL_HANDLE, &image_index));
+	return true;
+}
+
+bool Window::IsPresentable() {
+	return true;
+}
+
+void Window::Present(uint32_t image_index, VkSemaphore render_finished_semaphore) {
+	TRACE_ZONE("present");
+	VkPresentInfoKHR present_info{};
+	present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	present_info.waitSemaphoreCount = 1;
+	present_info.pWaitSemaphores = &render_finished_semaphore;
+	present_info.swapchainCount = 1;
+	present_info.pSwapchains = &m_swapchain;
+	present_info.pImageIndices = &image_index;
+	ErrorCheck(vkQueuePresentKHR(m_renderer->GetQueue(QUEUE_GRAPHICS), &present_info));
+}
+
+VkFormat Window::GetColourFormat() {
+	return m_surface_format.format;
+}
+
+VkImageLayout Window::GetFinalLayout() {
+	return VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+}
+
+uint32_t Window::GetImageCount() {
+	return m_swapchain_image_count;
+}
+
+VkImageView Window::GetImageView(uint32_t index) {
+	return m_swapchain_image_views[index];
+}
+
 VkSwapchainKHR & Window::GetSwapchain() {
 	return m_swapchain;
 }
@@ -54,15 +94,15 @@ VkSurfaceFormatKHR & Window::GetSurfaceFormatKHR() {
 	return m_surface_format;
 }
 
-VkImageView & Window::GetDepthBuffer() {
+VkImageView Window::GetDepthBuffer() {
 	return m_image_view;
 }
 
-uint32_t & Window::GetSurfaceSizeX() {
+uint32_t Window::GetSurfaceSizeX() {
 	return m_surface_size_x;
 }
 
-uint32_t & Window::GetSurfaceSizeY() {
+uint32_t Window::GetSurfaceSizeY() {
 	return m_surface_size_y;
 }
 
@@ -214,17 +254,7 @@ void Window::InitDepthBuffer() {
 
 	vkCreateImage(m_renderer->GetVulkanDevice(), &image_create_info, VK_NULL_HANDLE, &m_image);
 
-	VkMemoryRequirements memreqs;
-	vkGetImageMemoryRequirements(m_renderer->GetVulkanDevice(), m_image, &memreqs);
-	VkMemoryAllocateInfo memory_allocate_info{};
-	memory_allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	memory_allocate_info.pNext = VK_NULL_HANDLE;
-	memory_allocate_info.allocationSize = memreqs.size;
-	memory_allocate_info.memoryTypeIndex = 0;
-	memory_types_from_properties(memreqs.memoryTypeBits, 0, &memory_allocate_info.memoryTypeIndex, m_renderer->GetPhysicalDeviceMemoryProperties());
-	ErrorCheck(vkAllocateMemory(m_renderer->GetVulkanDevice(), &memory_allocate_info, nullptr, &m_depth_buffer_memory));
-
-	ErrorCheck(vkBindImageMemory(m_renderer->GetVulkanDevice(), m_image, m_depth_buffer_memory, 0));
+	m_depth_buffer_allocation = m_renderer->GetAllocator()->AllocateForImage(m_image, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
 	VkImageViewCreateInfo image_view_create_info{};
 	image_view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -249,5 +279,5 @@ void Window::InitDepthBuffer() {
 void Window::DeInitDepthBuffer() {
 	vkDestroyImageView(m_renderer->GetVulkanDevice(), m_image_view, nullptr);
 	vkDestroyImage(m_renderer->GetVulkanDevice(), m_image, nullptr);
-	vkFreeMemory(m_renderer->GetVulkanDevice(), m_depth_buffer_memory, nullptr);
+	m_renderer->GetAllocator()->Free(m_depth_buffer_allocation);
 }
\ No newline at end of file
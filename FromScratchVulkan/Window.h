@@ -1,24 +1,35 @@
 #pragma once
 
 #include "Platform.h"
+#include "Allocator.h"
+#include "RenderTarget.h"
 #include <string>
 #include <vector>
 
 class Renderer;
 
-class Window {
+class Window : public RenderTarget {
 public:
 	Window(Renderer * renderer, uint32_t size_x, uint32_t size_y, std::string name);
 	~Window();
 	void Close();
 	bool Update();
+	bool AcquireImage(VkSemaphore image_acquired_semaphore, uint32_t & image_index);
+	bool IsPresentable();
+	void Present(uint32_t image_index, VkSemaphore render_finished_semaphore);
+
+	VkFormat GetColourFormat();
+	VkImageLayout GetFinalLayout();
+	uint32_t GetImageCount();
+	VkImageView GetImageView(uint32_t index);
+	VkImageView GetDepthBuffer();
+	uint32_t GetSurfaceSizeX();
+	uint32_t GetSurfaceSizeY();
+
 	VkSwapchainKHR & GetSwapchain();
 	std::vector<VkImage> GetSwapchainImages();
 	std::vector<VkImageView> GetSwapchainImageViews();
 	VkSurfaceFormatKHR & GetSurfaceFormatKHR();
-	VkImageView & GetDepthBuffer();
-	uint32_t & GetSurfaceSizeX();
-	uint32_t & GetSurfaceSizeY();
 	uint32_t & GetSwapchainImageCount();
 private:
 	void InitOSWindow();
@@ -58,7 +69,7 @@ private:
 	VkImage m_image;
 	VkImageView m_image_view;
 
-	VkDeviceMemory m_depth_buffer_memory;
+	Allocation m_depth_buffer_allocation;
 
 	bool m_running = true;
 
@@ -1,10 +1,30 @@
+#include "BUILD_OPTIONS.h"
 #include "Renderer.h"
+#include "Benchmark.h"
+#include "Trace.h"
 
 int main() {
-	Renderer r;
-	r.CreateVulkanWindow(800, 600, "test");
-	while (r.Run()) {
-		
+	TRACE_THREAD_NAME("main");
+#if BUILD_OPTIONS_BENCHMARK
+	RunBenchmarks();
+#elif BUILD_OPTIONS_HEADLESS
+	//scoped so the renderer's teardown is in the trace too
+	{
+		Renderer r(BUILD_OPTIONS_FRAMES_IN_FLIGHT, true);
+		r.CreateHeadlessTarget(800, 600, BUILD_OPTIONS_HEADLESS_FRAMES);
+		while (r.Run()) {
+
+		}
+	}
+#else
+	{
+		Renderer r;
+		r.CreateVulkanWindow(800, 600, "test");
+		while (r.Run()) {
+			
+		}
 	}
+#endif
+	TRACE_DUMP("trace.json");
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,350 @@
+#include "Platform.h"
+#include "Shared.h"
+#include "MeshFile.h"
+#include "MeshProcessing.h"
+#include "VertexFormat.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <unordered_map>
+
+//cells along the longest side of the bounds for lod 1, halved for every lod after it
+#define MESH_CONVERTER_LOD_BASE_GRID 256
+//a lod that keeps more of the previous one's triangles than this isn't worth its indices
+#define MESH_CONVERTER_LOD_MIN_REDUCTION 0.9f
+#define MESH_CONVERTER_DEFAULT_LODS 4
+
+//offline conversion of wavefront obj into the mesh file the renderer maps at startup. everything that costs
+//time happens here: parsing, welding, cache and fetch ordering, lod generation and vertex encoding
+
+struct ObjMesh {
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> colours;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> uvs;
+	//position, uv and normal index per triangle corner, UINT32_MAX when the face didn't give one
+	std::vector<uint32_t> corners;
+};
+
+static const char * skip_spaces(const char * cursor) {
+	while (*cursor == ' ' || *cursor == '\t') {
+		cursor++;
+	}
+	return cursor;
+}
+
+static const char * skip_line(const char * cursor) {
+	while (*cursor != '\0' && *cursor != '\n') {
+		cursor++;
+	}
+	return *cursor == '\n' ? cursor + 1 : cursor;
+}
+
+//obj indices are 1 based, negative ones count back from the latest element
+static uint32_t resolve_index(long index, size_t count) {
+	if (index > 0 && (size_t)index <= count) {
+		return (uint32_t)(index - 1);
+	}
+	if (index < 0 && (size_t)-index <= count) {
+		return (uint32_t)(count + index);
+	}
+	return UINT32_MAX;
+}
+
+static bool parse_obj(const std::string & path, ObjMesh & mesh) {
+	std::vector<uint8_t> data;
+	if (!read_file(path, data)) {
+		return false;
+	}
+	data.push_back('\0');
+
+	uint32_t polygon[3 * 64];
+	const char * cursor = (const char *)data.data();
+	while (*cursor != '\0') {
+		cursor = skip_spaces(cursor);
+		char * end = nullptr;
+		if (cursor[0] == 'v' && (cursor[1] == ' ' || cursor[1] == '\t')) {
+			float values[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+			uint32_t count = 0;
+			cursor += 2;
+			while (count < 6) {
+				values[count] = strtof(cursor, &end);
+				if (end == cursor) {
+					break;
+				}
+				cursor = end;
+				count++;
+			}
+			mesh.positions.push_back(glm::vec3(values[0], values[1], values[2]));
+			//the common extension puts a colour after the position
+			if (count == 6) {
+				mesh.colours.resize(mesh.positions.size() - 1, glm::vec3(1.0f));
+				mesh.colours.push_back(glm::vec3(values[3], values[4], values[5]));
+			}
+		} else if (cursor[0] == 'v' && cursor[1] == 't') {
+			float u = strtof(cursor + 2, &end);
+			float v = strtof(end, &end);
+			mesh.uvs.push_back(glm::vec2(u, v));
+		} else if (cursor[0] == 'v' && cursor[1] == 'n') {
+			float x = strtof(cursor + 2, &end);
+			float y = strtof(end, &end);
+			float z = strtof(end, &end);
+			mesh.normals.push_back(glm::vec3(x, y, z));
+		} else if (cursor[0] == 'f' && (cursor[1] == ' ' || cursor[1] == '\t')) {
+			uint32_t corner_count = 0;
+			cursor += 2;
+			while (corner_count < 64) {
+				cursor = skip_spaces(cursor);
+				long position = strtol(cursor, &end, 10);
+				if (end == cursor) {
+					break;
+				}
+				cursor = end;
+				long uv = 0;
+				long normal = 0;
+				if (*cursor == '/') {
+					uv = strtol(cursor + 1, &end, 10);
+					cursor = end;
+					if (*cursor == '/') {
+						normal = strtol(cursor + 1, &end, 10);
+						cursor = end;
+					}
+				}
+				polygon[corner_count * 3 + 0] = resolve_index(position, mesh.positions.size());
+				polygon[corner_count * 3 + 1] = resolve_index(uv, mesh.uvs.size());
+				polygon[corner_count * 3 + 2] = resolve_index(normal, mesh.normals.size());
+				if (polygon[corner_count * 3] == UINT32_MAX) {
+					std::cout << "MeshConverter: face refers to a vertex that doesn't exist" << std::endl;
+					return false;
+				}
+				corner_count++;
+			}
+			//polygons become fans around their first corner
+			for (uint32_t i = 2; i < corner_count; i++) {
+				mesh.corners.insert(mesh.corners.end(), polygon, polygon + 3);
+				mesh.corners.insert(mesh.corners.end(), polygon + (i - 1) * 3, polygon + (i + 1) * 3);
+			}
+		}
+		cursor = skip_line(cursor);
+	}
+	if (!mesh.colours.empty()) {
+		mesh.colours.resize(mesh.positions.size(), glm::vec3(1.0f));
+	}
+	return !mesh.corners.empty();
+}
+
+struct ObjCorner {
+	uint32_t position;
+	uint32_t uv;
+	uint32_t normal;
+
+	bool operator==(const ObjCorner & other) const {
+		return position == other.position && uv == other.uv && normal == other.normal;
+	}
+};
+
+struct ObjCornerHash {
+	size_t operator()(const ObjCorner & corner) const {
+		return (size_t)fnv1a_64(&corner, sizeof(corner));
+	}
+};
+
+//lod l snaps every vertex to the first vertex in its cell of a grid that gets coarser with l; the triangles
+//that collapse are dropped and the rest keep the vertices of lod 0, so every lod shares one vertex blob
+static std::vector<uint32_t> simplify(const std::vector<uint32_t> & indices, const std::vector<glm::vec3> & positions, const glm::vec3 & bounds_min, float cell_size, float & error) {
+	std::unordered_map<uint64_t, uint32_t> cells;
+	std::vector<uint32_t> representative(positions.size());
+	error = 0.0f;
+	for (uint32_t i = 0; i < positions.size(); i++) {
+		glm::vec3 cell = (positions[i] - bounds_min) / cell_size;
+		uint64_t key = (uint64_t)cell.x | (uint64_t)cell.y << 21 | (uint64_t)cell.z << 42;
+		representative[i] = cells.insert(std::make_pair(key, i)).first->second;
+		error = std::max(error, glm::length(positions[i] - positions[representative[i]]));
+	}
+
+	std::vector<uint32_t> simplified;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		uint32_t a = representative[indices[i + 0]];
+		uint32_t b = representative[indices[i + 1]];
+		uint32_t c = representative[indices[i + 2]];
+		if (a != b && b != c && a != c) {
+			simplified.push_back(a);
+			simplified.push_back(b);
+			simplified.push_back(c);
+		}
+	}
+	return simplified;
+}
+
+static void print_usage() {
+	std::cout << "usage: MeshConverter input.obj output.mesh [-position float|half|snorm16] [-lods 1-" << MESH_FILE_MAX_LODS << "]" << std::endl;
+}
+
+int main(int argc, char ** argv) {
+	if (argc < 3) {
+		print_usage();
+		return 1;
+	}
+	std::string input_path = argv[1];
+	std::string output_path = argv[2];
+	VertexLayout layout{};
+	layout.position = VERTEX_POSITION_SNORM16;
+	uint32_t max_lods = MESH_CONVERTER_DEFAULT_LODS;
+	for (int i = 3; i + 1 < argc; i += 2) {
+		std::string option = argv[i];
+		std::string value = argv[i + 1];
+		if (option == "-position" && value == "float") {
+			layout.position = VERTEX_POSITION_FLOAT;
+		} else if (option == "-position" && value == "half") {
+			layout.position = VERTEX_POSITION_HALF;
+		} else if (option == "-position" && value == "snorm16") {
+			layout.position = VERTEX_POSITION_SNORM16;
+		} else if (option == "-lods") {
+			max_lods = std::min(std::max((uint32_t)atoi(value.c_str()), 1u), (uint32_t)MESH_FILE_MAX_LODS);
+		} else {
+			print_usage();
+			return 1;
+		}
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	ObjMesh obj;
+	if (!parse_obj(input_path, obj)) {
+		std::cout << "MeshConverter: could not read any triangles from " << input_path << std::endl;
+		return 1;
+	}
+
+	//one vertex per distinct position/uv/normal combination
+	std::unordered_map<ObjCorner, uint32_t, ObjCornerHash> corner_vertices;
+	std::vector<ObjCorner> vertices;
+	std::vector<uint32_t> indices(obj.corners.size() / 3);
+	for (uint32_t i = 0; i < indices.size(); i++) {
+		ObjCorner corner = { obj.corners[i * 3 + 0], obj.corners[i * 3 + 1], obj.corners[i * 3 + 2] };
+		auto inserted = corner_vertices.insert(std::make_pair(corner, (uint32_t)vertices.size()));
+		if (inserted.second) {
+			vertices.push_back(corner);
+		}
+		indices[i] = inserted.first->second;
+	}
+
+	double acmr_before = MeshProcessing::ComputeACMR(indices.data(), (uint32_t)indices.size(), (uint32_t)vertices.size());
+	MeshProcessing::OptimizeVertexCache(indices, (uint32_t)vertices.size());
+	std::vector<uint32_t> remap;
+	uint32_t vertex_count = MeshProcessing::OptimizeVertexFetchRemap(indices, (uint32_t)vertices.size(), remap);
+	double acmr_after = MeshProcessing::ComputeACMR(indices.data(), (uint32_t)indices.size(), vertex_count);
+
+	//the scene's shaders want a colour, so meshes without one get their normals or white
+	layout.colour = true;
+	layout.normal = !obj.normals.empty();
+	layout.uv = !obj.uvs.empty();
+	std::vector<glm::vec3> positions(vertex_count);
+	std::vector<glm::vec3> colours(vertex_count, glm::vec3(1.0f));
+	std::vector<glm::vec3> normals(layout.normal ? vertex_count : 0, glm::vec3(0.0f, 0.0f, 1.0f));
+	std::vector<glm::vec2> uvs(layout.uv ? vertex_count : 0, glm::vec2(0.0f));
+	for (uint32_t i = 0; i < vertices.size(); i++) {
+		uint32_t v = remap[i];
+		if (v == UINT32_MAX) {
+			continue;
+		}
+		const ObjCorner & corner = vertices[i];
+		positions[v] = obj.positions[corner.position];
+		if (!obj.colours.empty()) {
+			colours[v] = obj.colours[corner.position];
+		}
+		if (layout.uv && corner.uv != UINT32_MAX) {
+			uvs[v] = obj.uvs[corner.uv];
+		}
+		if (layout.normal && corner.normal != UINT32_MAX) {
+			normals[v] = glm::normalize(obj.normals[corner.normal]);
+			if (obj.colours.empty()) {
+				colours[v] = normals[v] * 0.5f + glm::vec3(0.5f);
+			}
+		}
+	}
+
+	glm::vec3 bounds_min = positions[0];
+	glm::vec3 bounds_max = positions[0];
+	for (uint32_t i = 1; i < vertex_count; i++) {
+		bounds_min = glm::min(bounds_min, positions[i]);
+		bounds_max = glm::max(bounds_max, positions[i]);
+	}
+	glm::vec3 centre = (bounds_min + bounds_max) * 0.5f;
+	float radius = 0.0f;
+	for (uint32_t i = 0; i < vertex_count; i++) {
+		radius = std::max(radius, glm::length(positions[i] - centre));
+	}
+
+	//lod 0 first, then the coarser ones after it in the same index blob
+	MeshFileLod lods[MESH_FILE_MAX_LODS];
+	lods[0].first_index = 0;
+	lods[0].index_count = (uint32_t)indices.size();
+	lods[0].error = 0.0f;
+	lods[0].reserved = 0;
+	uint32_t lod_count = 1;
+	glm::vec3 extent = bounds_max - bounds_min;
+	float cell_size = std::max(std::max(extent.x, extent.y), extent.z) / MESH_CONVERTER_LOD_BASE_GRID;
+	std::vector<uint32_t> all_indices(indices);
+	while (lod_count < max_lods && cell_size > 0.0f) {
+		float error = 0.0f;
+		std::vector<uint32_t> simplified = simplify(indices, positions, bounds_min, cell_size, error);
+		cell_size *= 2.0f;
+		if (simplified.empty() || simplified.size() > lods[lod_count - 1].index_count * MESH_CONVERTER_LOD_MIN_REDUCTION) {
+			if (simplified.empty()) {
+				break;
+			}
+			continue;
+		}
+		MeshProcessing::OptimizeVertexCache(simplified, vertex_count);
+		lods[lod_count].first_index = (uint32_t)all_indices.size();
+		lods[lod_count].index_count = (uint32_t)simplified.size();
+		lods[lod_count].error = error;
+		lods[lod_count].reserved = 0;
+		all_indices.insert(all_indices.end(), simplified.begin(), simplified.end());
+		lod_count++;
+	}
+
+	VertexStreams streams{};
+	streams.positions = positions.data();
+	streams.colours = colours.data();
+	streams.normals = layout.normal ? normals.data() : nullptr;
+	streams.uvs = layout.uv ? uvs.data() : nullptr;
+	VertexQuantization quantization = VertexFormat::ComputeQuantization(layout, positions.data(), vertex_count);
+	std::vector<uint8_t> encoded((size_t)vertex_count * VertexFormat::GetStride(layout));
+	VertexFormat::Encode(layout, streams, vertex_count, quantization, encoded.data());
+
+	//0xffff stays free for primitive restart, as in MeshProcessing::FitsUint16
+	std::vector<uint16_t> short_indices;
+	MeshFileContents contents{};
+	contents.indices = all_indices.data();
+	contents.index_size = sizeof(uint32_t);
+	if (vertex_count < 0xffff) {
+		short_indices.assign(all_indices.begin(), all_indices.end());
+		contents.indices = short_indices.data();
+		contents.index_size = sizeof(uint16_t);
+	}
+	contents.layout = layout;
+	contents.quantization = quantization;
+	contents.bounds_min = bounds_min;
+	contents.bounds_max = bounds_max;
+	contents.bounding_sphere = glm::vec4(centre, radius);
+	contents.vertices = encoded.data();
+	contents.vertex_count = vertex_count;
+	contents.index_count = (uint32_t)all_indices.size();
+	contents.lods = lods;
+	contents.lod_count = lod_count;
+	if (!MeshFile::Write(output_path, contents)) {
+		std::cout << "MeshConverter: could not write " << output_path << std::endl;
+		return 1;
+	}
+
+	float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+	std::cout << input_path << " -> " << output_path << ": " << vertex_count << " vertices of " << VertexFormat::GetStride(layout) << " bytes, "
+		<< indices.size() / 3 << " triangles, acmr " << acmr_before << " -> " << acmr_after << ", " << seconds << " s" << std::endl;
+	for (uint32_t i = 0; i < lod_count; i++) {
+		std::cout << "  lod " << i << ": " << lods[i].index_count / 3 << " triangles, error " << lods[i].error << std::endl;
+	}
+	return 0;
+}
\ No newline at end of file